@@ -0,0 +1,219 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// One file that says which wallets hold which addresses: per wallet, the
+// hash160s of its pubkeys, sorted, behind a Bloom filter. A lookup reads a
+// wallet's filter and only searches its hashes when the filter lets the
+// address through; no wallet file is opened.
+
+#ifndef ADDRESS_INDEX_H
+#define ADDRESS_INDEX_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "wallet-crypto.h"
+
+class AddressIndex {
+public:
+    static constexpr size_t HASH_SIZE = Ripemd160::OUTPUT_SIZE;
+    using Hash = std::array<uint8_t, HASH_SIZE>;
+
+    // File layout, all integers little-endian:
+    //   header     "WTADDRIX", u32 version, u32 wallet count, u64 directory offset
+    //   per wallet its filter, then its hashes, sorted and without repeats
+    //   directory  per wallet: u64 filter offset, u64 filter bits, u64 hashes
+    //              offset, u64 hash count, u64 wallet size, i64 wallet
+    //              modification time, u32 path length, path
+    static constexpr char MAGIC[8] = {'W', 'T', 'A', 'D', 'D', 'R', 'I', 'X'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 24;
+
+    // Ten bits and seven probes a key keep false positives near 1%
+    static constexpr uint64_t FILTER_BITS_PER_KEY = 10;
+    static constexpr unsigned FILTER_PROBES = 7;
+
+    struct Wallet {
+        std::string path;
+        uint64_t size = 0;
+        int64_t modified = 0;
+        uint64_t filterOffset = 0;
+        uint64_t filterBits = 0;
+        uint64_t hashesOffset = 0;
+        uint64_t count = 0;
+    };
+
+    // A hash160 is uniform already, so two of its words seed the probes
+    // (double hashing) and no further hashing is needed
+    static uint64_t probe(const uint8_t* hash, unsigned i, uint64_t bits) {
+        uint64_t a = read64(hash);
+        uint64_t b = read64(hash + 8) | 1;
+        return (a + i * b) % bits;
+    }
+
+    static bool filterHas(const uint8_t* filter, uint64_t bits, const uint8_t* hash) {
+        for (unsigned i = 0; i < FILTER_PROBES; i++) {
+            uint64_t bit = probe(hash, i, bits);
+            if (!(filter[bit / 8] & (1u << (bit % 8)))) return false;
+        }
+        return true;
+    }
+
+    class Writer {
+    public:
+        explicit Writer(const std::string& path) : path(path), file(path, std::ios::binary | std::ios::trunc) {
+            if (!file) throw std::runtime_error("Cannot create index " + path);
+            char header[HEADER_SIZE] = {};
+            file.write(header, sizeof(header));
+        }
+
+        // Adds one wallet; sorts its hashes in place
+        void add(const std::string& walletPath, uint64_t size, int64_t modified, std::vector<Hash>& hashes) {
+            std::sort(hashes.begin(), hashes.end());
+            hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+            Wallet wallet;
+            wallet.path = walletPath;
+            wallet.size = size;
+            wallet.modified = modified;
+            wallet.count = hashes.size();
+            wallet.filterBits = std::max<uint64_t>(64, (hashes.size() * FILTER_BITS_PER_KEY + 63) / 64 * 64);
+            std::vector<uint8_t> filter(wallet.filterBits / 8);
+            for (const Hash& hash : hashes) {
+                for (unsigned i = 0; i < FILTER_PROBES; i++) {
+                    uint64_t bit = probe(hash.data(), i, wallet.filterBits);
+                    filter[bit / 8] |= uint8_t(1u << (bit % 8));
+                }
+            }
+            wallet.filterOffset = static_cast<uint64_t>(file.tellp());
+            file.write(reinterpret_cast<const char*>(filter.data()), static_cast<std::streamsize>(filter.size()));
+            wallet.hashesOffset = static_cast<uint64_t>(file.tellp());
+            file.write(reinterpret_cast<const char*>(hashes.data()), static_cast<std::streamsize>(hashes.size() * HASH_SIZE));
+            if (!file) throw std::runtime_error("Cannot write index " + path);
+            wallets.push_back(std::move(wallet));
+        }
+
+        void finish() {
+            uint64_t directory = static_cast<uint64_t>(file.tellp());
+            for (const Wallet& wallet : wallets) {
+                put64(wallet.filterOffset);
+                put64(wallet.filterBits);
+                put64(wallet.hashesOffset);
+                put64(wallet.count);
+                put64(wallet.size);
+                put64(static_cast<uint64_t>(wallet.modified));
+                put32(static_cast<uint32_t>(wallet.path.size()));
+                file.write(wallet.path.data(), static_cast<std::streamsize>(wallet.path.size()));
+            }
+            file.seekp(0);
+            file.write(MAGIC, sizeof(MAGIC));
+            put32(VERSION);
+            put32(static_cast<uint32_t>(wallets.size()));
+            put64(directory);
+            file.close();
+            if (!file) throw std::runtime_error("Cannot write index " + path);
+        }
+
+    private:
+        std::string path;
+        std::ofstream file;
+        std::vector<Wallet> wallets;
+
+        void put32(uint32_t v) {
+            uint8_t b[4];
+            walletcrypto_detail::writeLE32(b, v);
+            file.write(reinterpret_cast<const char*>(b), sizeof(b));
+        }
+
+        void put64(uint64_t v) {
+            put32(uint32_t(v));
+            put32(uint32_t(v >> 32));
+        }
+    };
+
+    class Reader {
+    public:
+        std::vector<Wallet> wallets;
+
+        explicit Reader(const std::string& path) : path(path), file(path, std::ios::binary) {
+            if (!file) throw std::runtime_error("Cannot open index " + path);
+            uint8_t header[HEADER_SIZE];
+            read(0, header, sizeof(header));
+            if (memcmp(header, MAGIC, sizeof(MAGIC)) != 0) throw std::runtime_error(path + " is not an address index");
+            if (walletcrypto_detail::readLE32(header + 8) != VERSION) {
+                throw std::runtime_error(path + " is an index of an unsupported version");
+            }
+            uint32_t count = walletcrypto_detail::readLE32(header + 12);
+            file.seekg(0, std::ios::end);
+            uint64_t end = static_cast<uint64_t>(file.tellg());
+            uint64_t offset = read64(header + 16);
+            for (uint32_t i = 0; i < count; i++) {
+                uint8_t entry[52];
+                read(offset, entry, sizeof(entry));
+                Wallet wallet;
+                wallet.filterOffset = read64(entry);
+                wallet.filterBits = read64(entry + 8);
+                wallet.hashesOffset = read64(entry + 16);
+                wallet.count = read64(entry + 24);
+                wallet.size = read64(entry + 32);
+                wallet.modified = static_cast<int64_t>(read64(entry + 40));
+                uint32_t pathLength = walletcrypto_detail::readLE32(entry + 48);
+                if (!wallet.filterBits || wallet.filterBits % 8 || wallet.filterOffset > end ||
+                    wallet.filterBits / 8 > end - wallet.filterOffset ||
+                    wallet.hashesOffset > end || wallet.count > (end - wallet.hashesOffset) / HASH_SIZE ||
+                    pathLength > end - offset) {
+                    throw std::runtime_error(path + " is damaged");
+                }
+                wallet.path.resize(pathLength);
+                read(offset + sizeof(entry), reinterpret_cast<uint8_t*>(&wallet.path[0]), pathLength);
+                offset += sizeof(entry) + pathLength;
+                wallets.push_back(std::move(wallet));
+            }
+        }
+
+        // The wallet's filter, read once per wallet for all the hashes looked up
+        std::vector<uint8_t> filter(const Wallet& wallet) {
+            std::vector<uint8_t> bytes(wallet.filterBits / 8);
+            read(wallet.filterOffset, bytes.data(), bytes.size());
+            return bytes;
+        }
+
+        // Binary search of the wallet's sorted hashes, reading one at a time
+        bool contains(const Wallet& wallet, const uint8_t* hash) {
+            uint64_t low = 0, high = wallet.count;
+            uint8_t candidate[HASH_SIZE];
+            while (low < high) {
+                uint64_t middle = low + (high - low) / 2;
+                read(wallet.hashesOffset + middle * HASH_SIZE, candidate, HASH_SIZE);
+                int order = memcmp(candidate, hash, HASH_SIZE);
+                if (order == 0) return true;
+                if (order < 0) low = middle + 1;
+                else high = middle;
+            }
+            return false;
+        }
+
+    private:
+        std::string path;
+        std::ifstream file;
+
+        void read(uint64_t offset, uint8_t* out, size_t length) {
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(offset));
+            file.read(reinterpret_cast<char*>(out), static_cast<std::streamsize>(length));
+            if (static_cast<size_t>(file.gcount()) != length) throw std::runtime_error(path + " is damaged");
+        }
+    };
+
+private:
+    static uint64_t read64(const uint8_t* p) {
+        return uint64_t(walletcrypto_detail::readLE32(p)) | (uint64_t(walletcrypto_detail::readLE32(p + 4)) << 32);
+    }
+};
+
+#endif
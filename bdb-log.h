@@ -0,0 +1,737 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// Replays a BerkeleyDB environment's transaction log over a copy of a wallet.
+// Bitcoin Core writes every change to database/log.* first and to wallet.dat
+// only at a checkpoint, so a wallet copied from a running node can lack keys
+// that exist only in the log. The replay does what BerkeleyDB's own recovery
+// does in its redo pass, for the records that change b-tree pages: a change
+// is applied when the page still carries the LSN the record was made
+// against, and the page then carries the record's LSN. Pages already flushed
+// to the copy are newer and are left alone; changes of transactions that
+// never committed are skipped. Changed pages live in an overlay; the wallet
+// image itself is never written.
+//
+// The logs are streamed twice, record by record: once to learn which
+// transactions committed, once to redo. Memory holds one record, a bit per
+// transaction and the pages that changed.
+
+#ifndef BDB_LOG_H
+#define BDB_LOG_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "wallet-format.h"
+
+class BerkeleyLogReplay {
+public:
+    // image is a BerkeleyDB btree database as sniffed into info
+    BerkeleyLogReplay(const uint8_t* image, size_t size, const WalletFormat::Info& info)
+        : image(image), imageSize(size), info(info), pageSize(info.pageSize) {
+        memcpy(uid, image + META_UID_OFFSET, sizeof(uid));
+        filePages = static_cast<uint32_t>(size / pageSize);
+        pageLimit = filePages;
+    }
+
+    // The log files (log.0000000001, ...) of a directory, oldest first
+    static std::vector<std::string> logFiles(const std::string& directory) {
+        std::vector<std::pair<uint32_t, std::string>> found;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            std::string name = entry.path().filename().string();
+            if (name.size() != 14 || name.compare(0, 4, "log.") != 0 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            found.emplace_back(static_cast<uint32_t>(std::stoul(name.substr(4))), entry.path().string());
+        }
+        std::sort(found.begin(), found.end());
+        std::vector<std::string> paths;
+        for (auto& file : found) paths.push_back(std::move(file.second));
+        return paths;
+    }
+
+    // Replays the given log files; false if none of them is a readable,
+    // unencrypted log of this byte order
+    bool replay(const std::vector<std::string>& paths) {
+        bool readable = false;
+        for (const auto& path : paths) readable |= readLog(path, &BerkeleyLogReplay::collectCommit);
+        if (!readable) return false;
+        for (const auto& path : paths) readLog(path, &BerkeleyLogReplay::redo);
+        return true;
+    }
+
+    // The replayed version of a page, or nullptr where the log changed nothing
+    const uint8_t* page(uint32_t pgno) const {
+        auto found = pages.find(pgno);
+        return found == pages.end() ? nullptr : found->second.get();
+    }
+
+    // Pages in the replayed database: the file's, plus any the log allocated
+    uint32_t pageCount() const {
+        uint32_t count = filePages;
+        if (!pages.empty()) count = std::max(count, pages.rbegin()->first + 1);
+        return count;
+    }
+
+    uint64_t recordsApplied() const { return applied; }
+
+private:
+    // Log record types (dbinc_auto/*_auto.h) and page types (db_page.h)
+    enum RecordType : uint32_t {
+        DBREG_REGISTER = 2,
+        TXN_REGOP = 10,
+        TXN_CHILD = 12,
+        DB_ADDREM = 41,
+        DB_BIG = 43,
+        DB_OVREF = 44,
+        DB_NOOP = 48,
+        DB_PG_ALLOC = 49,
+        DB_PG_FREE = 50,
+        DB_PG_FREEDATA = 52,
+        BAM_CDEL = 57,
+        BAM_REPL = 58,
+        DB_PG_INIT = 60,
+        BAM_SPLIT = 62,
+        BAM_RSPLIT = 63,
+        CRDEL_METASUB = 142
+    };
+    static constexpr uint8_t P_INVALID = 0;
+    static constexpr uint8_t P_IBTREE = 3;
+    static constexpr uint8_t P_LBTREE = 5;
+    static constexpr uint8_t P_OVERFLOW = 7;
+    static constexpr uint8_t B_KEYDATA = 1;
+    static constexpr uint8_t B_DELETE = 0x80;
+    static constexpr uint32_t TXN_COMMIT = 1;
+    static constexpr uint32_t TXN_MINIMUM = 0x80000000;
+    static constexpr uint32_t DB_ADD_DUP = 1;
+    static constexpr uint32_t DB_REM_DUP = 2;
+    static constexpr uint32_t DB_ADD_BIG = 3;
+    static constexpr uint32_t LOG_VERSION_SPLIT_PARENT = 16;   // 5.0 logs the parent update with the split
+    static constexpr size_t HEADER_SIZE = 12;                  // prev, len, checksum
+    static constexpr size_t PAGE_HEADER = 26;
+    static constexpr size_t META_UID_OFFSET = 52;
+    static constexpr size_t MAX_RECORD = 64 * 1024 * 1024;
+
+    struct Lsn {
+        uint32_t file = 0;
+        uint32_t offset = 0;
+        bool operator==(const Lsn& other) const { return file == other.file && offset == other.offset; }
+        bool isZero() const { return file == 0 && offset == 0; }
+    };
+
+    // Reads a record's fields in order; any overrun leaves ok false
+    class Fields {
+    public:
+        Fields(const uint8_t* data, size_t length, bool bigEndian) : p(data), end(data + length), bigEndian(bigEndian) {}
+        bool ok = true;
+
+        uint32_t u32() {
+            if (end - p < 4) return fail(), 0;
+            uint32_t value = WalletFormat::read32(p, bigEndian);
+            p += 4;
+            return value;
+        }
+        Lsn lsn() {
+            Lsn value;
+            value.file = u32();
+            value.offset = u32();
+            return value;
+        }
+        // A DBT: a length and that many bytes
+        std::pair<const uint8_t*, size_t> dbt() {
+            uint32_t length = u32();
+            if (!ok || static_cast<size_t>(end - p) < length) return fail(), std::make_pair(nullptr, size_t(0));
+            const uint8_t* data = p;
+            p += length;
+            return {data, length};
+        }
+
+    private:
+        const uint8_t* p;
+        const uint8_t* end;
+        bool bigEndian;
+        void fail() { ok = false; p = end; }
+    };
+
+    using Handler = void (BerkeleyLogReplay::*)(uint32_t type, uint32_t txnid, const Lsn& lsn, Fields& fields);
+
+    const uint8_t* image;
+    size_t imageSize;
+    const WalletFormat::Info& info;
+    uint32_t pageSize;
+    uint8_t uid[20];
+    uint32_t filePages;
+    uint32_t pageLimit;             // highest page number the log may touch, plus one
+    bool bigEndian = false;
+    uint32_t logVersion = 0;
+    std::set<int32_t> fileids;      // the handles the log uses for this wallet
+    std::vector<bool> committed;    // by transaction id - TXN_MINIMUM
+    std::map<uint32_t, uint32_t> parents;   // child transaction -> parent
+    std::map<uint32_t, std::unique_ptr<uint8_t[]>> pages;
+    uint64_t applied = 0;
+
+    // Streams one log file through handler. Stops at the first record whose
+    // length or checksum does not hold: the end of what was written.
+    bool readLog(const std::string& path, Handler handler) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        std::string name = std::filesystem::path(path).filename().string();
+        uint32_t fileNumber = static_cast<uint32_t>(std::stoul(name.substr(4)));
+
+        std::vector<uint8_t> record;
+        uint8_t header[HEADER_SIZE];
+        uint32_t offset = 0;
+        bool first = true;
+        while (in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+            if (first && !persistentHeader(header, in)) return false;
+            uint32_t prev = WalletFormat::read32(header, bigEndian);
+            uint32_t length = WalletFormat::read32(header + 4, bigEndian);
+            if (length <= HEADER_SIZE || length > MAX_RECORD) break;
+            record.resize(length - HEADER_SIZE);
+            if (!in.read(reinterpret_cast<char*>(record.data()), static_cast<std::streamsize>(record.size()))) break;
+            uint32_t sum = torekHash(record.data(), record.size());
+            uint32_t stored = WalletFormat::read32(header + 8, bigEndian);
+            if (stored != (sum ^ prev ^ length) && stored != sum) break;
+            if (!first) {
+                Fields fields(record.data(), record.size(), bigEndian);
+                uint32_t type = fields.u32();
+                uint32_t txnid = fields.u32();
+                fields.lsn();   // the transaction's previous record
+                if (fields.ok) (this->*handler)(type, txnid, Lsn{fileNumber, offset}, fields);
+            }
+            first = false;
+            offset += length;
+        }
+        return true;
+    }
+
+    // Every log file opens with a record holding the LOGP magic and version
+    bool persistentHeader(const uint8_t* header, std::ifstream& in) {
+        uint8_t magic[8];
+        std::streampos start = in.tellg();
+        if (!in.read(reinterpret_cast<char*>(magic), sizeof(magic))) return false;
+        in.seekg(start);
+        for (bool order : {false, true}) {
+            if (WalletFormat::read32(magic, order) == WalletFormat::BDB_LOG_MAGIC) {
+                // Logs are written in the writer's byte order, like its databases
+                if (order != info.bigEndian) return false;
+                bigEndian = order;
+                logVersion = WalletFormat::read32(magic + 4, order);
+                return WalletFormat::read32(header + 4, order) > HEADER_SIZE;
+            }
+        }
+        return false;   // encrypted environments put a 48-byte header first
+    }
+
+    // The log checksum of unencrypted environments (hash_func.c __ham_func4)
+    static uint32_t torekHash(const uint8_t* data, size_t length) {
+        uint32_t hash = 0;
+        for (size_t i = 0; i < length; i++) hash = hash * 33 + data[i];
+        return hash;
+    }
+
+    void collectCommit(uint32_t type, uint32_t txnid, const Lsn&, Fields& fields) {
+        if (type == TXN_REGOP && fields.u32() == TXN_COMMIT && fields.ok) {
+            markCommitted(txnid);
+        } else if (type == TXN_CHILD) {
+            uint32_t child = fields.u32();
+            if (fields.ok) parents[child] = txnid;
+        }
+    }
+
+    void markCommitted(uint32_t txnid) {
+        if (txnid < TXN_MINIMUM) return;
+        size_t index = txnid - TXN_MINIMUM;
+        if (index >= committed.size()) committed.resize(index + 1);
+        committed[index] = true;
+    }
+
+    // Records outside a transaction are always redone, as recovery does
+    bool isCommitted(uint32_t txnid) const {
+        if (txnid == 0) return true;
+        for (int depth = 0; depth < 64; depth++) {
+            if (txnid >= TXN_MINIMUM && txnid - TXN_MINIMUM < committed.size() && committed[txnid - TXN_MINIMUM]) {
+                return true;
+            }
+            auto parent = parents.find(txnid);
+            if (parent == parents.end()) return false;
+            txnid = parent->second;
+        }
+        return false;
+    }
+
+    void redo(uint32_t type, uint32_t txnid, const Lsn& lsn, Fields& fields) {
+        if (type == DBREG_REGISTER) {
+            registerFile(fields);
+            return;
+        }
+        if (!isCommitted(txnid)) return;
+        switch (type) {
+            case DB_ADDREM: redoAddRemove(lsn, fields); break;
+            case DB_BIG: redoBig(lsn, fields); break;
+            case DB_OVREF: redoOverflowReference(lsn, fields); break;
+            case DB_NOOP: redoNoop(lsn, fields); break;
+            case DB_PG_ALLOC: redoAllocate(lsn, fields); break;
+            case DB_PG_FREE:
+            case DB_PG_FREEDATA: redoFree(lsn, fields); break;
+            case BAM_CDEL: redoCursorDelete(lsn, fields); break;
+            case BAM_REPL: redoReplace(lsn, fields); break;
+            case DB_PG_INIT: redoPageInit(lsn, fields); break;
+            case BAM_SPLIT: redoSplit(lsn, fields); break;
+            case BAM_RSPLIT: redoReverseSplit(lsn, fields); break;
+            case CRDEL_METASUB: redoMetaSubdatabase(lsn, fields); break;
+            default: break;   // internal-page, meta and file records leave the leaves as they are
+        }
+    }
+
+    // A file handle: every handle opened on this wallet (the master database
+    // and its "main" subdatabase) carries the uid stored in its meta page
+    void registerFile(Fields& fields) {
+        fields.u32();   // opcode
+        fields.dbt();   // name
+        auto fileUid = fields.dbt();
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        if (!fields.ok) return;
+        if (fileUid.second == sizeof(uid) && memcmp(fileUid.first, uid, sizeof(uid)) == 0) {
+            fileids.insert(fileid);
+        } else {
+            fileids.erase(fileid);
+        }
+    }
+
+    bool ours(int32_t fileid) const { return fileids.count(fileid) != 0; }
+
+    // -- pages --
+
+    uint32_t get32(const uint8_t* p) const { return WalletFormat::read32(p, bigEndian); }
+    uint16_t get16(const uint8_t* p) const { return WalletFormat::read16(p, bigEndian); }
+    void put32(uint8_t* p, uint32_t value) const {
+        for (int i = 0; i < 4; i++) p[bigEndian ? 3 - i : i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+    void put16(uint8_t* p, uint16_t value) const {
+        p[bigEndian ? 1 : 0] = static_cast<uint8_t>(value);
+        p[bigEndian ? 0 : 1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    Lsn pageLsn(const uint8_t* page) const { return Lsn{get32(page), get32(page + 4)}; }
+    void setLsn(uint8_t* page, const Lsn& lsn) {
+        put32(page, lsn.file);
+        put32(page + 4, lsn.offset);
+        applied++;
+    }
+    uint16_t entries(const uint8_t* page) const { return get16(page + 20); }
+    uint16_t freeOffset(const uint8_t* page) const { return get16(page + 22); }
+    uint16_t index(const uint8_t* page, size_t i) const { return get16(page + PAGE_HEADER + 2 * i); }
+
+    // The overlay copy of a page, made on first change; nullptr for page
+    // numbers the log has not shown to exist
+    uint8_t* writablePage(uint32_t pgno) {
+        auto found = pages.find(pgno);
+        if (found != pages.end()) return found->second.get();
+        if (pgno >= pageLimit) return nullptr;
+        auto copy = std::make_unique<uint8_t[]>(pageSize);
+        if (pgno < filePages) {
+            memcpy(copy.get(), image + uint64_t(pgno) * pageSize, pageSize);
+        } else {
+            memset(copy.get(), 0, pageSize);
+        }
+        uint8_t* page = copy.get();
+        pages.emplace(pgno, std::move(copy));
+        return page;
+    }
+
+    // The page, if it is in the state the record was made against
+    uint8_t* pageAt(uint32_t pgno, const Lsn& expected) {
+        const uint8_t* current = page(pgno);
+        if (!current) {
+            if (pgno >= pageLimit) return nullptr;
+            current = pgno < filePages ? image + uint64_t(pgno) * pageSize : nullptr;
+            if (current && !(pageLsn(current) == expected)) return nullptr;
+            if (!current && !expected.isZero()) return nullptr;
+        } else if (!(pageLsn(current) == expected)) {
+            return nullptr;
+        }
+        return writablePage(pgno);
+    }
+
+    void initPage(uint8_t* page, uint32_t pgno, uint32_t prev, uint32_t next, uint8_t level, uint8_t type) const {
+        put32(page + 8, pgno);
+        put32(page + 12, prev);
+        put32(page + 16, next);
+        put16(page + 20, 0);
+        put16(page + 22, static_cast<uint16_t>(std::min<uint32_t>(pageSize, 0xffff)));
+        page[24] = level;
+        page[25] = type;
+    }
+
+    static size_t align4(size_t n) { return (n + 3) & ~size_t(3); }
+
+    // The bytes an item takes on its page (db_page.h *_SIZE macros)
+    size_t itemSize(const uint8_t* page, size_t offset) const {
+        if (offset + 3 > pageSize) return 0;
+        uint16_t length = get16(page + offset);
+        uint8_t type = page[offset + 2] & ~B_DELETE;
+        size_t size;
+        if (page[25] == P_IBTREE) size = align4(12 + length);
+        else size = type == B_KEYDATA ? align4(3 + size_t(length)) : 12;
+        return offset + size <= pageSize ? size : 0;
+    }
+
+    // __db_pitem: places an item of nbytes at index i, built from a header
+    // and data, or from the data alone as a B_KEYDATA item
+    bool insertItem(uint8_t* page, size_t i, size_t nbytes, const uint8_t* header, size_t headerLength,
+                    const uint8_t* data, size_t dataLength) const {
+        uint8_t keydata[3];
+        if (!header) {
+            put16(keydata, static_cast<uint16_t>(dataLength));
+            keydata[2] = B_KEYDATA;
+            header = keydata;
+            headerLength = sizeof(keydata);
+        }
+        size_t count = entries(page);
+        size_t top = freeOffset(page);
+        if (i > count || headerLength + dataLength > nbytes || top > pageSize || nbytes > top ||
+            top - nbytes < PAGE_HEADER + 2 * (count + 1)) {
+            return false;
+        }
+        uint8_t* inp = page + PAGE_HEADER;
+        memmove(inp + 2 * (i + 1), inp + 2 * i, 2 * (count - i));
+        top -= nbytes;
+        put16(inp + 2 * i, static_cast<uint16_t>(top));
+        put16(page + 20, static_cast<uint16_t>(count + 1));
+        put16(page + 22, static_cast<uint16_t>(top));
+        memcpy(page + top, header, headerLength);
+        if (dataLength) memcpy(page + top + headerLength, data, dataLength);
+        return true;
+    }
+
+    // __db_ditem: removes the item at index i, which takes nbytes
+    bool deleteItem(uint8_t* page, size_t i, size_t nbytes) const {
+        size_t count = entries(page);
+        if (i >= count) return false;
+        if (count == 1) {
+            put16(page + 20, 0);
+            put16(page + 22, static_cast<uint16_t>(std::min<uint32_t>(pageSize, 0xffff)));
+            return true;
+        }
+        size_t top = freeOffset(page);
+        size_t offset = index(page, i);
+        if (offset < top || offset + nbytes > pageSize) return false;
+        if (offset != top) {
+            memmove(page + top + nbytes, page + top, offset - top);
+            for (size_t k = 0; k < count; k++) {
+                size_t other = index(page, k);
+                if (other < offset) put16(page + PAGE_HEADER + 2 * k, static_cast<uint16_t>(other + nbytes));
+            }
+        }
+        put16(page + 22, static_cast<uint16_t>(top + nbytes));
+        uint8_t* inp = page + PAGE_HEADER;
+        memmove(inp + 2 * i, inp + 2 * (i + 1), 2 * (count - i - 1));
+        put16(page + 20, static_cast<uint16_t>(count - 1));
+        return true;
+    }
+
+    // Copies items [first, last) of a logged page image onto page
+    bool copyItems(uint8_t* page, const uint8_t* from, size_t first, size_t last) const {
+        for (size_t i = first; i < last; i++) {
+            size_t offset = index(from, i);
+            size_t size = itemSize(from, offset);
+            if (!size || !insertItem(page, entries(page), size, from + offset, size, nullptr, 0)) return false;
+        }
+        return true;
+    }
+
+    // -- redo, one function per record type; field order as in the *.src
+    //    descriptions BerkeleyDB generates its log code from --
+
+    void redoAddRemove(const Lsn& lsn, Fields& fields) {
+        uint32_t opcode = fields.u32();
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        uint32_t pgno = fields.u32();
+        uint32_t indx = fields.u32();
+        uint32_t nbytes = fields.u32();
+        auto header = fields.dbt();
+        auto data = fields.dbt();
+        Lsn previous = fields.lsn();
+        if (!fields.ok || !ours(fileid)) return;
+        // 5.x keeps the page type in the low byte and the operation above it
+        uint32_t mode = opcode > 0xff ? opcode >> 8 : opcode;
+        uint8_t* page = pageAt(pgno, previous);
+        if (!page) return;
+        bool done = false;
+        if (mode == DB_ADD_DUP) {
+            done = insertItem(page, indx, nbytes, header.second ? header.first : nullptr, header.second,
+                              data.first, data.second);
+        } else if (mode == DB_REM_DUP) {
+            done = deleteItem(page, indx, nbytes);
+        }
+        if (done) setLsn(page, lsn);
+    }
+
+    void redoBig(const Lsn& lsn, Fields& fields) {
+        uint32_t opcode = fields.u32();
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        uint32_t pgno = fields.u32();
+        uint32_t prevPgno = fields.u32();
+        uint32_t nextPgno = fields.u32();
+        auto data = fields.dbt();
+        Lsn pageLsnBefore = fields.lsn();
+        Lsn prevLsn = fields.lsn();
+        Lsn nextLsn = fields.lsn();
+        uint32_t mode = opcode > 0xff ? opcode >> 8 : opcode;
+        if (!fields.ok || !ours(fileid) || mode != DB_ADD_BIG) return;
+        if (uint8_t* page = pageAt(pgno, pageLsnBefore)) {
+            if (PAGE_HEADER + data.second <= pageSize) {
+                initPage(page, pgno, prevPgno, nextPgno, 0, P_OVERFLOW);
+                put16(page + 20, 1);                                     // reference count
+                put16(page + 22, static_cast<uint16_t>(data.second));   // length of the data
+                memcpy(page + PAGE_HEADER, data.first, data.second);
+                setLsn(page, lsn);
+            }
+        }
+        if (prevPgno) {
+            if (uint8_t* page = pageAt(prevPgno, prevLsn)) {
+                put32(page + 16, pgno);
+                setLsn(page, lsn);
+            }
+        }
+        if (nextPgno) {
+            if (uint8_t* page = pageAt(nextPgno, nextLsn)) {
+                put32(page + 12, pgno);
+                setLsn(page, lsn);
+            }
+        }
+    }
+
+    void redoOverflowReference(const Lsn& lsn, Fields& fields) {
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        uint32_t pgno = fields.u32();
+        int32_t adjust = static_cast<int32_t>(fields.u32());
+        Lsn previous = fields.lsn();
+        if (!fields.ok || !ours(fileid)) return;
+        if (uint8_t* page = pageAt(pgno, previous)) {
+            put16(page + 20, static_cast<uint16_t>(entries(page) + adjust));
+            setLsn(page, lsn);
+        }
+    }
+
+    void redoNoop(const Lsn& lsn, Fields& fields) {
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        uint32_t pgno = fields.u32();
+        Lsn previous = fields.lsn();
+        if (!fields.ok || !ours(fileid)) return;
+        if (uint8_t* page = pageAt(pgno, previous)) setLsn(page, lsn);
+    }
+
+    void redoAllocate(const Lsn& lsn, Fields& fields) {
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        fields.lsn();   // meta page
+        fields.u32();
+        Lsn previous = fields.lsn();
+        uint32_t pgno = fields.u32();
+        uint32_t type = fields.u32();
+        uint32_t next = fields.u32();
+        uint32_t lastPgno = fields.u32();
+        if (!fields.ok || !ours(fileid)) return;
+        // The file grows to the allocated page; bounded, as a corrupt record
+        // must not make the overlay reserve gigabytes
+        uint32_t limit = std::max(pgno, lastPgno) + 1;
+        if (limit > pageLimit && limit - filePages <= (1u << 20)) pageLimit = limit;
+        const uint8_t* current = page(pgno);
+        if (!current && pgno < filePages) current = image + uint64_t(pgno) * pageSize;
+        // A page past the end of the copy, or never written, is new
+        bool fresh = !current || pageLsn(current).isZero();
+        if (!fresh && !(pageLsn(current) == previous)) return;
+        uint8_t* page = writablePage(pgno);
+        if (!page) return;
+        if (fresh) memset(page, 0, pageSize);
+        initPage(page, pgno, 0, next, type == P_LBTREE ? 1 : 0, static_cast<uint8_t>(type));
+        setLsn(page, lsn);
+    }
+
+    void redoFree(const Lsn& lsn, Fields& fields) {
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        uint32_t pgno = fields.u32();
+        fields.lsn();   // meta page
+        fields.u32();
+        auto header = fields.dbt();
+        uint32_t next = fields.u32();
+        if (!fields.ok || !ours(fileid) || header.second < PAGE_HEADER) return;
+        // The logged header holds the page's LSN before it was freed
+        Lsn previous{get32(header.first), get32(header.first + 4)};
+        if (uint8_t* page = pageAt(pgno, previous)) {
+            initPage(page, pgno, 0, next, 0, P_INVALID);
+            setLsn(page, lsn);
+        }
+    }
+
+    void redoCursorDelete(const Lsn& lsn, Fields& fields) {
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        uint32_t pgno = fields.u32();
+        Lsn previous = fields.lsn();
+        uint32_t indx = fields.u32();
+        if (!fields.ok || !ours(fileid)) return;
+        uint8_t* page = pageAt(pgno, previous);
+        if (!page) return;
+        // On a btree leaf the data item after the key is marked
+        size_t i = indx + (page[25] == P_LBTREE ? 1 : 0);
+        if (i < entries(page) && index(page, i) + 3u <= pageSize) page[index(page, i) + 2] |= B_DELETE;
+        setLsn(page, lsn);
+    }
+
+    void redoReplace(const Lsn& lsn, Fields& fields) {
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        uint32_t pgno = fields.u32();
+        Lsn previous = fields.lsn();
+        uint32_t indx = fields.u32();
+        fields.u32();   // isdeleted
+        auto original = fields.dbt();
+        auto replacement = fields.dbt();
+        uint32_t prefix = fields.u32();
+        uint32_t suffix = fields.u32();
+        if (!fields.ok || !ours(fileid)) return;
+        uint8_t* page = pageAt(pgno, previous);
+        if (!page || indx >= entries(page)) return;
+        size_t offset = index(page, indx);
+        size_t size = itemSize(page, offset);
+        if (!size || (page[offset + 2] & ~B_DELETE) != B_KEYDATA) return;
+        // The new data keeps prefix bytes from the front of the old and
+        // suffix bytes from its end, with the logged bytes in between
+        size_t oldLength = get16(page + offset);
+        if (prefix + suffix > oldLength || original.second + prefix + suffix != oldLength) return;
+        std::vector<uint8_t> data(page + offset + 3, page + offset + 3 + prefix);
+        data.insert(data.end(), replacement.first, replacement.first + replacement.second);
+        data.insert(data.end(), page + offset + 3 + oldLength - suffix, page + offset + 3 + oldLength);
+        uint8_t type = page[offset + 2];
+        if (data.size() > 0xffff || !deleteItem(page, indx, size)) return;
+        uint8_t header[3];
+        put16(header, static_cast<uint16_t>(data.size()));
+        header[2] = type;
+        if (insertItem(page, indx, align4(3 + data.size()), header, sizeof(header), data.data(), data.size())) {
+            setLsn(page, lsn);
+        }
+    }
+
+    void redoPageInit(const Lsn& lsn, Fields& fields) {
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        uint32_t pgno = fields.u32();
+        auto header = fields.dbt();
+        auto data = fields.dbt();
+        if (!fields.ok || !ours(fileid) || header.second < PAGE_HEADER || header.second > pageSize) return;
+        uint8_t* page = writablePage(pgno);
+        if (!page) return;
+        memcpy(page, header.first, header.second);
+        size_t top = freeOffset(page);
+        if (data.second && top + data.second <= pageSize) memcpy(page + top, data.first, data.second);
+        setLsn(page, lsn);
+    }
+
+    // A full page split in two. The record carries the page as it was, so
+    // both halves are rebuilt from it. A root split leaves the root as an
+    // internal page above two new leaves.
+    void redoSplit(const Lsn& lsn, Fields& fields) {
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        bool parentLogged = logVersion >= LOG_VERSION_SPLIT_PARENT;
+        if (parentLogged) fields.u32();   // opflags
+        uint32_t left = fields.u32();
+        Lsn leftLsn = fields.lsn();
+        uint32_t right = fields.u32();
+        Lsn rightLsn = fields.lsn();
+        uint32_t indx = fields.u32();
+        uint32_t next = fields.u32();
+        Lsn nextLsn = fields.lsn();
+        uint32_t root = fields.u32();   // 4.x: the root; 5.x: the parent
+        std::pair<const uint8_t*, size_t> parentEntry{nullptr, 0};
+        std::pair<const uint8_t*, size_t> rightEntry{nullptr, 0};
+        if (parentLogged) {
+            fields.lsn();
+            fields.u32();
+        }
+        auto original = fields.dbt();
+        if (parentLogged) {
+            parentEntry = fields.dbt();
+            rightEntry = fields.dbt();
+        }
+        if (!fields.ok || !ours(fileid) || original.second != pageSize) return;
+        const uint8_t* from = original.first;
+        size_t count = entries(from);
+        if (indx > count || PAGE_HEADER + 2 * count > pageSize) return;
+        uint32_t pgno = get32(from + 8);
+        bool rootSplit = pgno != left;
+
+        if (uint8_t* page = pageAt(left, leftLsn)) {
+            initPage(page, left, rootSplit ? 0 : get32(from + 12), right, from[24], from[25]);
+            if (copyItems(page, from, 0, indx)) setLsn(page, lsn);
+        }
+        if (uint8_t* page = pageAt(right, rightLsn)) {
+            initPage(page, right, left, rootSplit ? 0 : get32(from + 16), from[24], from[25]);
+            if (copyItems(page, from, indx, count)) setLsn(page, lsn);
+        }
+        if (rootSplit && (!parentLogged || root == pgno)) {
+            if (uint8_t* page = pageAt(pgno, pageLsn(from))) {
+                // Only the leaves hold records; the new internal root gets the
+                // two entries 5.x logs for it
+                initPage(page, pgno, 0, 0, static_cast<uint8_t>(from[24] + 1), P_IBTREE);
+                for (auto entry : {parentEntry, rightEntry}) {
+                    if (entry.second) insertItem(page, entries(page), align4(entry.second), entry.first, entry.second, nullptr, 0);
+                }
+                setLsn(page, lsn);
+            }
+        }
+        if (!rootSplit && next) {
+            if (uint8_t* page = pageAt(next, nextLsn)) {
+                put32(page + 12, right);
+                setLsn(page, lsn);
+            }
+        }
+    }
+
+    // The tree lost a level: the only child's contents become the root
+    void redoReverseSplit(const Lsn& lsn, Fields& fields) {
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        uint32_t pgno = fields.u32();
+        auto child = fields.dbt();
+        uint32_t root = fields.u32();
+        fields.u32();   // nrec
+        fields.dbt();   // the root's old entry
+        Lsn rootLsn = fields.lsn();
+        if (!fields.ok || !ours(fileid) || child.second != pageSize) return;
+        if (uint8_t* page = pageAt(root, rootLsn)) {
+            memcpy(page, child.first, pageSize);
+            put32(page + 8, root);
+            put32(page + 12, 0);
+            put32(page + 16, 0);
+            setLsn(page, lsn);
+        }
+        if (uint8_t* page = pageAt(pgno, pageLsn(child.first))) setLsn(page, lsn);
+    }
+
+    // The meta page of a new subdatabase, logged whole
+    void redoMetaSubdatabase(const Lsn& lsn, Fields& fields) {
+        int32_t fileid = static_cast<int32_t>(fields.u32());
+        uint32_t pgno = fields.u32();
+        auto meta = fields.dbt();
+        Lsn previous = fields.lsn();
+        if (!fields.ok || !ours(fileid) || meta.second > pageSize) return;
+        const uint8_t* current = page(pgno);
+        if (!current && pgno < filePages) current = image + uint64_t(pgno) * pageSize;
+        if (current && !pageLsn(current).isZero() && !(pageLsn(current) == previous)) return;
+        if (uint8_t* page = writablePage(pgno)) {
+            memset(page, 0, pageSize);
+            memcpy(page, meta.first, meta.second);
+            setLsn(page, lsn);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,142 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// BIP32 derivation for the HD chains wallets keep. A legacy HD wallet
+// derives its keys from the seed its hdchain record names, at m/0'/0'/i'
+// and, for change, m/0'/1'/i'; a descriptor wallet derives them from the
+// xpubs it caches. Children are derived a run at a time: a parent's chain
+// code keys one HMAC for all of them, and their points share a single
+// field inversion.
+
+#ifndef HD_KEYCHAIN_H
+#define HD_KEYCHAIN_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "secure-arena.h"
+#include "wallet-crypto.h"
+
+class HDKeychain {
+public:
+    static constexpr uint32_t HARDENED = 0x80000000;
+    static constexpr size_t EXTENDED_SIZE = 74;   // BIP32 serialization without the version
+
+    // A node of the tree. A public node (no secret) derives only
+    // non-hardened children. The secret is wiped with the node.
+    struct Key {
+        uint8_t chainCode[32];
+        uint8_t pubkey[Secp256k1::COMPRESSED_SIZE];
+        uint8_t secret[32];
+        bool hasSecret = false;
+        bool valid = false;   // false for the rare index BIP32 skips
+
+        Key() = default;
+        Key(const Key&) = default;
+        Key& operator=(const Key&) = default;
+        ~Key() { SecureArena::wipe(secret, sizeof(secret)); }
+    };
+
+    // The master node of a seed (for a legacy wallet, the 32-byte secret of
+    // its seed key)
+    static bool fromSeed(const uint8_t* seed, size_t len, Key& out) {
+        static const uint8_t salt[] = {'B', 'i', 't', 'c', 'o', 'i', 'n', ' ', 's', 'e', 'e', 'd'};
+        uint8_t digest[HmacSha512::OUTPUT_SIZE];
+        HmacSha512(salt, sizeof(salt)).mac(seed, len, digest);
+        out.valid = Secp256k1::isValidPrivateKey(digest);
+        if (out.valid) {
+            memcpy(out.secret, digest, 32);
+            memcpy(out.chainCode, digest + 32, 32);
+            Secp256k1::derivePublicKey(out.secret, true, out.pubkey);
+            out.hasSecret = true;
+        }
+        SecureArena::wipe(digest, sizeof(digest));
+        return out.valid;
+    }
+
+    // A public node from its serialization: depth, parent fingerprint, child
+    // number, chain code and compressed pubkey
+    static bool fromExtended(const uint8_t serialized[EXTENDED_SIZE], Key& out) {
+        Secp256k1::Affine point;
+        out.hasSecret = false;
+        out.valid = Secp256k1::parse(serialized + 41, Secp256k1::COMPRESSED_SIZE, point);
+        if (out.valid) {
+            memcpy(out.chainCode, serialized + 9, 32);
+            memcpy(out.pubkey, serialized + 41, Secp256k1::COMPRESSED_SIZE);
+        }
+        return out.valid;
+    }
+
+    // The children first .. first + count - 1 of parent, hardened or not,
+    // into out. A hardened run needs a parent with a secret; children of a
+    // public parent are public.
+    static void deriveChildren(const Key& parent, uint32_t first, size_t count, bool hardened, Key* out) {
+        if (!parent.valid || (hardened && !parent.hasSecret)) {
+            for (size_t i = 0; i < count; i++) out[i].valid = false;
+            return;
+        }
+        HmacSha512 hmac(parent.chainCode, sizeof(parent.chainCode));
+        uint8_t data[1 + 32 + 4];
+        if (hardened) {
+            data[0] = 0;
+            memcpy(data + 1, parent.secret, 32);
+        } else {
+            memcpy(data, parent.pubkey, Secp256k1::COMPRESSED_SIZE);
+        }
+        Secp256k1::Affine parentPoint{};
+        if (!parent.hasSecret) Secp256k1::parse(parent.pubkey, Secp256k1::COMPRESSED_SIZE, parentPoint);
+
+        std::vector<Secp256k1::Jacobian> points(count);
+        uint8_t digest[HmacSha512::OUTPUT_SIZE];
+        for (size_t i = 0; i < count; i++) {
+            Key& child = out[i];
+            walletcrypto_detail::writeBE32(data + 33, (first + uint32_t(i)) | (hardened ? HARDENED : 0));
+            hmac.mac(data, sizeof(data), digest);
+            child.hasSecret = parent.hasSecret;
+            child.valid = Secp256k1::isValidPrivateKey(digest);
+            memcpy(child.chainCode, digest + 32, 32);
+            if (child.valid && parent.hasSecret) {
+                child.valid = Secp256k1::addScalars(digest, parent.secret, child.secret);
+                if (child.valid) points[i] = Secp256k1::multiplyGenerator(child.secret);
+            } else if (child.valid) {
+                points[i] = Secp256k1::pointAdd(Secp256k1::multiplyGenerator(digest), parentPoint);
+                child.valid = !points[i].infinity;
+            }
+            if (!child.valid) points[i].infinity = true;
+        }
+        SecureArena::wipe(digest, sizeof(digest));
+        SecureArena::wipe(data, sizeof(data));
+
+        std::vector<Secp256k1::Affine> affine(count);
+        Secp256k1::toAffineBatch(points.data(), affine.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            if (out[i].valid) Secp256k1::serialize(affine[i], true, out[i].pubkey);
+        }
+    }
+
+    // The node at the end of a path of child numbers from parent
+    static bool derivePath(const Key& parent, const std::vector<uint32_t>& path, Key& out) {
+        out = parent;
+        for (uint32_t number : path) {
+            Key child;
+            deriveChildren(out, number & ~HARDENED, 1, (number & HARDENED) != 0, &child);
+            out = child;
+            if (!out.valid) return false;
+        }
+        return out.valid;
+    }
+
+    // "m/0'/0'/" style text for a path, each hardened step marked
+    static std::string pathText(const std::vector<uint32_t>& path) {
+        std::string text = "m";
+        for (uint32_t number : path) {
+            text += "/" + std::to_string(number & ~HARDENED);
+            if (number & HARDENED) text += "'";
+        }
+        return text;
+    }
+};
+
+#endif
@@ -0,0 +1,187 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// The set of keys a dump has already reported, for --dedupe.
+
+#ifndef KEY_SET_H
+#define KEY_SET_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "wallet-crypto.h"
+
+// An open-addressing table of pubkey hash160s. A hash160 is already
+// uniformly distributed, so its first bytes pick the slot and the 20 bytes
+// are the whole entry: the table is one flat array with no per-entry
+// allocation, probed linearly. The all-zero hash marks an empty slot and is
+// kept aside. Tables bigger than the memory limit move to an unlinked file
+// in the spill directory, when there is one, and are paged by the kernel.
+// Not thread-safe: one dump, or the thread printing a batch, owns a set.
+class KeySet {
+public:
+    static constexpr size_t HASH_SIZE = Ripemd160::OUTPUT_SIZE;
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = 256 * 1024 * 1024;
+
+    explicit KeySet(std::string spillDirectory = "", size_t memoryLimit = DEFAULT_MEMORY_LIMIT)
+        : spillDirectory(std::move(spillDirectory)), memoryLimit(memoryLimit) {}
+
+    ~KeySet() { release(table); }
+
+    KeySet(const KeySet&) = delete;
+    KeySet& operator=(const KeySet&) = delete;
+
+    // Sizes the table for this many keys in all, so it does not grow while
+    // they are added
+    void reserve(uint64_t keys) {
+        size_t capacity = MIN_CAPACITY;
+        while (capacity < keys + keys / 3 + 1) capacity *= 2;
+        if (capacity > table.capacity) rehash(capacity);
+    }
+
+    // Adds a hash; false if it was already there
+    bool insert(const uint8_t hash[HASH_SIZE]) {
+        if (isEmpty(hash)) {
+            if (haveZero) return false;
+            haveZero = true;
+            count++;
+            return true;
+        }
+        if (!table.capacity || (count + 1) * 4 > table.capacity * 3) {
+            rehash(table.capacity ? table.capacity * 2 : MIN_CAPACITY);
+        }
+        uint8_t* slot = find(table, hash);
+        if (!isEmpty(slot)) return false;
+        memcpy(slot, hash, HASH_SIZE);
+        count++;
+        return true;
+    }
+
+    bool contains(const uint8_t hash[HASH_SIZE]) const {
+        if (isEmpty(hash)) return haveZero;
+        return table.capacity && !isEmpty(find(table, hash));
+    }
+
+    uint64_t size() const { return count; }
+    bool spilled() const { return table.file; }
+
+private:
+    static constexpr size_t MIN_CAPACITY = 1024;
+
+    struct Table {
+        uint8_t* slots = nullptr;
+        size_t capacity = 0;   // a power of two
+        bool file = false;     // mapped from the spill directory
+    };
+
+    std::string spillDirectory;
+    size_t memoryLimit;
+    Table table;
+    uint64_t count = 0;
+    bool haveZero = false;
+
+    static bool isEmpty(const uint8_t* slot) {
+        static const uint8_t zero[HASH_SIZE] = {};
+        return memcmp(slot, zero, HASH_SIZE) == 0;
+    }
+
+    // The slot holding hash, or the empty slot where it belongs
+    static uint8_t* find(const Table& table, const uint8_t* hash) {
+        using namespace walletcrypto_detail;
+        size_t mask = table.capacity - 1;
+        uint64_t start = (uint64_t(readLE32(hash + 4)) << 32) | readLE32(hash);
+        for (size_t i = static_cast<size_t>(start) & mask;; i = (i + 1) & mask) {
+            uint8_t* slot = table.slots + i * HASH_SIZE;
+            if (isEmpty(slot) || memcmp(slot, hash, HASH_SIZE) == 0) return slot;
+        }
+    }
+
+    void rehash(size_t capacity) {
+        Table grown = allocate(capacity);
+        for (size_t i = 0; i < table.capacity; i++) {
+            const uint8_t* slot = table.slots + i * HASH_SIZE;
+            if (!isEmpty(slot)) memcpy(find(grown, slot), slot, HASH_SIZE);
+        }
+        release(table);
+        table = grown;
+    }
+
+    // Zeroed slots, from the heap or, past the memory limit, from a file
+    Table allocate(size_t capacity) {
+        Table grown;
+        grown.capacity = capacity;
+        size_t bytes = capacity * HASH_SIZE;
+        if (bytes <= memoryLimit || spillDirectory.empty()) {
+            grown.slots = static_cast<uint8_t*>(calloc(capacity, HASH_SIZE));
+            if (!grown.slots) throw std::bad_alloc();
+            return grown;
+        }
+        grown.file = true;
+        #ifdef _WIN32
+            char path[MAX_PATH];
+            if (!GetTempFileNameA(spillDirectory.c_str(), "wtk", 0, path)) spillError();
+            HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                                      FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+            if (file == INVALID_HANDLE_VALUE) spillError();
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, DWORD(uint64_t(bytes) >> 32),
+                                                DWORD(bytes), nullptr);
+            CloseHandle(file);
+            if (!mapping) spillError();
+            grown.slots = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes));
+            CloseHandle(mapping);
+            if (!grown.slots) spillError();
+        #else
+            std::string path = spillDirectory + "/wallet-tool-keys.XXXXXX";
+            int fd = mkstemp(&path[0]);
+            if (fd < 0) spillError();
+            unlink(path.c_str());
+            void* mapping = MAP_FAILED;
+            if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+                mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            int error = errno;
+            close(fd);
+            errno = error;
+            if (mapping == MAP_FAILED) spillError();
+            grown.slots = static_cast<uint8_t*>(mapping);
+        #endif
+        return grown;
+    }
+
+    void release(Table& old) {
+        if (!old.slots) return;
+        if (!old.file) {
+            free(old.slots);
+        } else {
+            #ifdef _WIN32
+                UnmapViewOfFile(old.slots);
+            #else
+                munmap(old.slots, old.capacity * HASH_SIZE);
+            #endif
+        }
+        old = Table();
+    }
+
+    [[noreturn]] void spillError() {
+        #ifdef _WIN32
+            std::string reason = "error " + std::to_string(GetLastError());
+        #else
+            std::string reason = strerror(errno);
+        #endif
+        throw std::runtime_error("Cannot spill the key set to " + spillDirectory + ": " + reason);
+    }
+};
+
+#endif
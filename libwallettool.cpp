@@ -0,0 +1,1965 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+#include "libwallettool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <fstream>
+#include <iterator>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "wallet-crypto.h"
+#include "secure-arena.h"
+#include "task-scheduler.h"
+#include "wallet-format.h"
+#include "bdb-log.h"
+#include "record-layout.h"
+
+namespace {
+
+thread_local std::string lastError;
+
+// Carries a status across the internal C++ code to the ABI boundary
+class WalletError : public std::runtime_error {
+public:
+    wt_status status;
+    WalletError(wt_status status, const std::string& message) : std::runtime_error(message), status(status) {}
+};
+
+template <typename F>
+wt_status guarded(F&& body) {
+    try {
+        body();
+        lastError.clear();
+        return WT_OK;
+    }
+    catch (const WalletError& e) {
+        lastError = e.what();
+        return e.status;
+    }
+    catch (const std::bad_alloc&) {
+        lastError = "Out of memory";
+        return WT_ERR_INTERNAL;
+    }
+    catch (const std::exception& e) {
+        lastError = e.what();
+        return WT_ERR_INTERNAL;
+    }
+}
+
+// Base58Check P2PKH on mainnet
+void encodeAddress(const uint8_t hash[WT_HASH160_SIZE], char* out, size_t capacity) {
+    uint8_t payload[1 + WT_HASH160_SIZE];
+    payload[0] = 0x00;
+    memcpy(payload + 1, hash, WT_HASH160_SIZE);
+    if (!Base58::encodeCheck(payload, sizeof(payload), out, capacity)) {
+        throw WalletError(WT_ERR_BUFFER, "Address buffer too small");
+    }
+}
+
+// A DER length: short form, or 0x81/0x82 and one or two bytes
+bool derLength(const uint8_t*& p, const uint8_t* end, size_t& length) {
+    if (p >= end) return false;
+    uint8_t first = *p++;
+    if (first < 0x80) {
+        length = first;
+    } else if (first == 0x81 && p < end) {
+        length = *p++;
+    } else if (first == 0x82 && end - p >= 2) {
+        length = (size_t(p[0]) << 8) | p[1];
+        p += 2;
+    } else {
+        return false;
+    }
+    return length <= static_cast<size_t>(end - p);
+}
+
+// CPrivKey, the DER ECPrivateKey of an unencrypted key: SEQUENCE { INTEGER 1,
+// OCTET STRING secret, [0] curve parameters, [1] BIT STRING pubkey }, the
+// last two optional. Wallets written through OpenSSL can drop the secret's
+// leading zero bytes. Like Bitcoin Core, only the secret has to be well
+// formed; a pubkey is reported only when the fields up to it parse.
+bool readDerKey(const uint8_t* der, size_t length, uint8_t secret[WT_SECRET_SIZE], const uint8_t*& pubkey,
+                size_t& pubkeyLength) {
+    const uint8_t* p = der;
+    const uint8_t* end = der + length;
+    size_t size;
+    if (p >= end || *p++ != 0x30 || !derLength(p, end, size)) return false;
+    end = p + size;
+    static const uint8_t version[] = {0x02, 0x01, 0x01, 0x04};
+    if (static_cast<size_t>(end - p) < sizeof(version) || memcmp(p, version, sizeof(version)) != 0) return false;
+    p += sizeof(version);
+    if (!derLength(p, end, size) || size == 0 || size > WT_SECRET_SIZE) return false;
+    memset(secret, 0, WT_SECRET_SIZE - size);
+    memcpy(secret + WT_SECRET_SIZE - size, p, size);
+    p += size;
+    pubkey = nullptr;
+    pubkeyLength = 0;
+    while (p < end) {
+        uint8_t tag = *p++;
+        if (!derLength(p, end, size)) break;
+        const uint8_t* field = p;
+        p += size;
+        // [1] holds a BIT STRING with no unused bits
+        const uint8_t* bits = field + 1;
+        size_t bitsLength;
+        if (tag == 0xa1 && size && field[0] == 0x03 && derLength(bits, p, bitsLength) && bitsLength && !bits[0]) {
+            pubkey = bits + 1;
+            pubkeyLength = bitsLength - 1;
+        }
+    }
+    return true;
+}
+
+static_assert(WT_FORMAT_SQLITE_JOURNAL == static_cast<int>(WalletFormat::SQLITE_JOURNAL) &&
+              WT_FORMAT_SQLITE == static_cast<int>(WalletFormat::SQLITE),
+              "wt_format must follow WalletFormat::Kind");
+
+using record_layout::MasterKey;
+using record_layout::CryptedKey;
+using record_layout::PlainKey;
+using record_layout::WalletKey;
+
+static_assert(WT_MKEY_RECORD_SIZE == MasterKey::Value::FIXED_SIZE - MasterKey::Value::offset<MasterKey::CRYPTED_KEY>(),
+              "wt_record.value of an mkey starts at the crypted key and ends after the iterations");
+static_assert(WT_CRYPTED_KEY_SIZE == CryptedKey::Value::FIXED_SIZE - CryptedKey::Value::offset<CryptedKey::CRYPTED_SECRET>(),
+              "wt_record.value of a ckey is the crypted secret");
+
+// In a BerkeleyDB leaf a record's data item lies just below its key item,
+// each a 3-byte header and the bytes, padded to 4. From the payload at
+// payloadOffset in a value of valueSize bytes to the name in the key item is
+// the rest of the padded data item and the key item's header, less the
+// name's length byte.
+constexpr size_t windowBefore(size_t valueSize, size_t payloadOffset) {
+    return ((3 + valueSize + 3) & ~size_t(3)) + 1 - payloadOffset;
+}
+
+// CMasterKey, with empty vchOtherDerivationParameters, starts 72 bytes
+// before "mkey"; a crypted secret 52 bytes before "ckey"
+constexpr size_t MKEY_WINDOW_BEFORE =
+    windowBefore(MasterKey::Value::FIXED_SIZE + 1, MasterKey::Value::offset<MasterKey::CRYPTED_KEY>());
+constexpr size_t CKEY_WINDOW_BEFORE =
+    windowBefore(CryptedKey::Value::FIXED_SIZE, CryptedKey::Value::offset<CryptedKey::CRYPTED_SECRET>());
+static_assert(MKEY_WINDOW_BEFORE == 72 && CKEY_WINDOW_BEFORE == 52, "scan windows moved");
+
+// A key or wkey value varies in size: a DER private key of up to
+// WT_DER_KEY_MAX_SIZE bytes, then the hash, or the wkey's times and comment.
+// The scan finds its data item by the header, at most this far below the
+// name; that leaves a wkey comment about 200 bytes.
+constexpr size_t PLAIN_KEY_VALUE_MAX = 512;
+constexpr size_t PLAIN_KEY_WINDOW_BEFORE = windowBefore(PLAIN_KEY_VALUE_MAX, 0) + 3;
+
+// Images this large are indexed by a parallel scan on first use, one task
+// per chunk. A chunk owns the tags that start inside it; their record
+// windows are read across the seam from the same mapping, so neighbouring
+// chunks never report the same record.
+constexpr size_t SCAN_CHUNK = 32 * 1024 * 1024;
+constexpr size_t PARALLEL_SCAN_MIN = 2 * SCAN_CHUNK;
+
+// A record with every field but the pubkey set; the parsers fill that in
+// when the key item carries one
+static wt_record makeRecord(wt_record_type type, uint64_t offset, const uint8_t* value, size_t valueLength,
+                            wt_record_origin origin, const uint8_t* descriptorId = nullptr) {
+    wt_record record{};
+    record.type = type;
+    record.offset = offset;
+    record.value = value;
+    record.value_len = valueLength;
+    record.origin = origin;
+    record.descriptor_id = descriptorId;
+    return record;
+}
+
+// A byte range searched for records: a whole wallet image or a stream window
+struct ImageView {
+    static constexpr uint8_t B_KEYDATA = 1;
+    static constexpr uint8_t B_OVERFLOW = 3;
+    static constexpr uint8_t B_DELETE = 0x80;
+    static constexpr uint8_t P_LBTREE = 5;
+    static constexpr uint8_t P_OVERFLOW = 7;
+    static constexpr size_t BDB_PAGE_HEADER = 26;
+    static constexpr size_t BOVERFLOW_SIZE = 12;
+    static constexpr size_t SECTOR_SIZE = 512;
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    uint64_t origin = 0;   // offset of data[0] in the file or stream
+
+    // The record for the tag at offset, if its window lies inside the image
+    bool recordAt(size_t offset, wt_record& record) const {
+        if (data[offset] == 'm' && offset >= MKEY_WINDOW_BEFORE) {
+            record = makeRecord(WT_RECORD_MKEY, offset, data + offset - MKEY_WINDOW_BEFORE, WT_MKEY_RECORD_SIZE,
+                                WT_ORIGIN_SCAN);
+            return true;
+        }
+        if (data[offset] == 'c' && offset >= CKEY_WINDOW_BEFORE && offset + 5 <= size) {
+            record = makeRecord(WT_RECORD_CKEY, offset, data + offset - CKEY_WINDOW_BEFORE, WT_CRYPTED_KEY_SIZE,
+                                WT_ORIGIN_SCAN);
+            size_t skip, pubkeyLen;
+            if (record_layout::PubKey::measure(data + offset + 4, data + size, skip, pubkeyLen)) {
+                record.pubkey = data + offset + 4 + skip;
+                record.pubkey_len = pubkeyLen;
+            }
+            return true;
+        }
+        if (data[offset] == 'k') return plainKeyAt(offset, 3, WT_RECORD_KEY, record);
+        if (data[offset] == 'w') return plainKeyAt(offset, 4, WT_RECORD_WKEY, record);
+        return false;
+    }
+
+    // Finds the next "mkey"/"ckey"/"key"/"wkey" tag at or after position and
+    // before limit whose record window lies inside the image, and advances
+    // position past the tag. A key or wkey tag must follow its length byte.
+    bool nextRecord(size_t& position, wt_record& record, size_t limit = SIZE_MAX) const {
+        size_t end = std::min(size - std::min<size_t>(size, 3), limit);
+        while (position < end) {
+            const void* hit = memchr(data + position + 1, 'k', end - position);
+            if (!hit) {
+                position = end;
+                return false;
+            }
+            size_t k = static_cast<size_t>(static_cast<const uint8_t*>(hit) - data);
+            if (data[k + 1] != 'e' || data[k + 2] != 'y') {
+                position = k;
+                continue;
+            }
+            uint8_t tag = data[k - 1];
+            size_t offset;
+            if (tag == 'm' || tag == 'c') offset = k - 1;
+            else if (tag == 3) offset = k;
+            else if (tag == 'w' && k >= 2 && data[k - 2] == 4) offset = k - 1;
+            else {
+                position = k;
+                continue;
+            }
+            position = k + 3;
+            if (recordAt(offset, record)) return true;
+        }
+        return false;
+    }
+
+private:
+    // A key or wkey value has no fixed size, so unlike the windows above it
+    // is found from the BerkeleyDB framing: the key item (length, type,
+    // name, pubkey) must hold up, and the data item right below it must have
+    // a header whose length pads out to the gap, in either byte order, or
+    // refer to an overflow page the scan can find. The record is the DER
+    // private key, as the parser reports it.
+    bool plainKeyAt(size_t offset, size_t nameLength, wt_record_type type, wt_record& record) const {
+        size_t skip, pubkeyLen;
+        if (offset < 4 || !record_layout::PubKey::measure(data + offset + nameLength, data + size, skip, pubkeyLen)) {
+            return false;
+        }
+        size_t keyItem = offset - 4;
+        size_t keyLength = 1 + nameLength + skip + pubkeyLen;
+        if (!itemHeader(keyItem, keyLength)) return false;
+        auto found = [&](const uint8_t* value, size_t valueLength) {
+            const uint8_t* der;
+            size_t derLength;
+            if (!plainKeyDer(type, value, valueLength, der, derLength)) return false;
+            record = makeRecord(type, offset, der, derLength, WT_ORIGIN_SCAN);
+            record.pubkey = data + offset + nameLength + skip;
+            record.pubkey_len = pubkeyLen;
+            return true;
+        };
+        if (keyItem >= BOVERFLOW_SIZE && (data[keyItem - BOVERFLOW_SIZE + 2] & ~B_DELETE) == B_OVERFLOW) {
+            size_t valueLength;
+            const uint8_t* value = overflowPageAt(keyItem - BOVERFLOW_SIZE, valueLength);
+            if (value && found(value, valueLength)) return true;
+        }
+        for (size_t gap = 4; gap + 4 <= PLAIN_KEY_WINDOW_BEFORE && gap <= keyItem; gap += 4) {
+            size_t dataItem = keyItem - gap;
+            for (bool bigEndian : {false, true}) {
+                size_t valueLength = WalletFormat::read16(data + dataItem, bigEndian);
+                if ((data[dataItem + 2] & ~B_DELETE) != B_KEYDATA || valueLength > PLAIN_KEY_VALUE_MAX ||
+                    ((3 + valueLength + 3) & ~size_t(3)) != gap) {
+                    continue;
+                }
+                if (found(data + dataItem + 3, valueLength)) return true;
+            }
+        }
+        return false;
+    }
+
+    // The DER private key at the start of a key or wkey value
+    static bool plainKeyDer(wt_record_type type, const uint8_t* value, size_t valueLength, const uint8_t*& der,
+                            size_t& derLength) {
+        der = nullptr;
+        derLength = 0;
+        if (type == WT_RECORD_KEY) {
+            PlainKey::Value::Decoded decoded;
+            if (PlainKey::Value::decode(value, valueLength, decoded, PlainKey::PRIVATE_KEY + 1)) {
+                der = decoded.fields[PlainKey::PRIVATE_KEY].data;
+                derLength = decoded.fields[PlainKey::PRIVATE_KEY].length;
+            }
+        } else {
+            WalletKey::Value::Decoded decoded;
+            if (WalletKey::Value::decode(value, valueLength, decoded, WalletKey::PRIVATE_KEY + 1)) {
+                der = decoded.fields[WalletKey::PRIVATE_KEY].data;
+                derLength = decoded.fields[WalletKey::PRIVATE_KEY].length;
+            }
+        }
+        return derLength && derLength <= WT_DER_KEY_MAX_SIZE;
+    }
+
+    // The bytes on the first overflow page of the data item at item, which
+    // hold the DER of any key or wkey value. The scan knows neither the page
+    // size nor where the file starts, so each page size is tried with the
+    // leaf at every sector boundary within a page before the item (files
+    // and carved wallets start on one). The leaf's page number then says
+    // where the file starts, and the overflow page must be found there,
+    // carrying its own page number.
+    const uint8_t* overflowPageAt(size_t item, size_t& length) const {
+        const uint64_t at = origin + item;
+        for (bool bigEndian : {false, true}) {
+            uint64_t pgno = WalletFormat::read32(data + item + 4, bigEndian);
+            uint64_t total = WalletFormat::read32(data + item + 8, bigEndian);
+            if (pgno == 0 || total == 0) continue;
+            for (uint64_t pageSize = SECTOR_SIZE; pageSize <= 65536; pageSize *= 2) {
+                uint64_t first = at >= pageSize ? at - pageSize + 1 : 0;
+                first = std::max((first + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE,
+                                 (origin + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE);
+                for (uint64_t leafAt = first; leafAt + BDB_PAGE_HEADER <= at; leafAt += SECTOR_SIZE) {
+                    const uint8_t* leaf = data + (leafAt - origin);
+                    if (leaf[25] != P_LBTREE) continue;
+                    uint64_t leafPgno = WalletFormat::read32(leaf + 8, bigEndian);
+                    if (leafPgno * pageSize > leafAt) continue;
+                    uint64_t pageAt = leafAt - leafPgno * pageSize + pgno * pageSize;
+                    if (pageAt < origin || pageAt - origin + BDB_PAGE_HEADER > size) continue;
+                    const uint8_t* page = data + (pageAt - origin);
+                    if (WalletFormat::read32(page + 8, bigEndian) != pgno || page[25] != P_OVERFLOW) continue;
+                    length = WalletFormat::read16(page + 22, bigEndian);
+                    if (length == 0 || length > pageSize - BDB_PAGE_HEADER || length > total ||
+                        pageAt - origin + BDB_PAGE_HEADER + length > size) {
+                        continue;
+                    }
+                    return page + BDB_PAGE_HEADER;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    // An item header of either byte order for length bytes, live or deleted
+    bool itemHeader(size_t item, size_t length) const {
+        return (data[item + 2] & ~B_DELETE) == B_KEYDATA &&
+               (WalletFormat::read16(data + item, false) == length || WalletFormat::read16(data + item, true) == length);
+    }
+};
+
+// Reads a whole file into memory; false if it cannot be opened
+bool readFile(const char* path, std::vector<uint8_t>& contents) {
+    #ifdef _WIN32
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return true;
+    #else
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        contents.clear();
+        uint8_t buffer[65536];
+        ssize_t n;
+        while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                close(fd);
+                return false;
+            }
+            contents.insert(contents.end(), buffer, buffer + n);
+        }
+        close(fd);
+        return true;
+    #endif
+}
+
+// The -wal file beside an SQLite database in WAL mode: frames holding pages
+// newer than the database file, each a 24-byte header (page number, database
+// size in pages for the last frame of a commit, the WAL salts, a running
+// checksum) and the page. A frame counts only if its salts match the WAL
+// header and the checksum chain holds up to it, and only frames up to the
+// last commit are visible, exactly as SQLite decides when it opens the
+// database. The -shm index is a cache of the same map that is only
+// meaningful under SQLite's locks, so the map is rebuilt from the frames.
+// Nothing is written back: the database is never checkpointed.
+class WalOverlay {
+public:
+    static constexpr size_t HEADER_SIZE = 32;
+    static constexpr size_t FRAME_HEADER_SIZE = 24;
+
+    std::vector<uint8_t> contents;              // a private copy, taken once
+    std::unordered_map<uint32_t, size_t> frames; // page number -> offset of its latest committed page
+    uint32_t pageSize = 0;
+    uint32_t pageCount = 0;                     // database size after the last commit; 0 if none
+
+    // Builds the page map; false if the file is not a WAL or has no commit
+    bool load(uint32_t databasePageSize) {
+        frames.clear();
+        pageCount = 0;
+        if (contents.size() < HEADER_SIZE) return false;
+        const uint8_t* header = contents.data();
+        uint32_t magic = walletcrypto_detail::readBE32(header);
+        if ((magic & ~1u) != WalletFormat::SQLITE_WAL_MAGIC) return false;
+        pageSize = walletcrypto_detail::readBE32(header + 8);
+        if (pageSize != databasePageSize) return false;
+        bool bigEndian = magic & 1;
+        uint32_t sum[2] = {0, 0};
+        checksum(header, 24, bigEndian, sum);
+        if (sum[0] != walletcrypto_detail::readBE32(header + 24) || sum[1] != walletcrypto_detail::readBE32(header + 28)) {
+            return false;
+        }
+
+        std::unordered_map<uint32_t, size_t> pending;
+        for (size_t offset = HEADER_SIZE; offset + FRAME_HEADER_SIZE + pageSize <= contents.size();
+             offset += FRAME_HEADER_SIZE + pageSize) {
+            const uint8_t* frame = contents.data() + offset;
+            if (memcmp(frame + 8, header + 16, 8) != 0) break;   // salts of an earlier WAL generation
+            checksum(frame, 8, bigEndian, sum);
+            checksum(frame + FRAME_HEADER_SIZE, pageSize, bigEndian, sum);
+            if (sum[0] != walletcrypto_detail::readBE32(frame + 16) || sum[1] != walletcrypto_detail::readBE32(frame + 20)) {
+                break;
+            }
+            uint32_t pgno = walletcrypto_detail::readBE32(frame);
+            if (pgno == 0) break;
+            pending[pgno] = offset + FRAME_HEADER_SIZE;
+            uint32_t committedSize = walletcrypto_detail::readBE32(frame + 4);
+            if (committedSize) {
+                for (const auto& entry : pending) frames[entry.first] = entry.second;
+                pending.clear();
+                pageCount = committedSize;
+            }
+        }
+        if (!pageCount) frames.clear();
+        return pageCount != 0;
+    }
+
+    const uint8_t* page(uint32_t pgno) const {
+        auto found = frames.find(pgno);
+        return found == frames.end() ? nullptr : contents.data() + found->second;
+    }
+
+private:
+    // SQLite's WAL checksum: two running sums over 32-bit words, read in the
+    // byte order the magic names
+    static void checksum(const uint8_t* data, size_t length, bool bigEndian, uint32_t sum[2]) {
+        for (size_t i = 0; i + 8 <= length; i += 8) {
+            sum[0] += WalletFormat::read32(data + i, bigEndian) + sum[1];
+            sum[1] += WalletFormat::read32(data + i + 4, bigEndian) + sum[0];
+        }
+    }
+};
+
+// Record parsers for the databases the format sniffer recognizes. Where the
+// byte scan guesses a record's value from its distance to the tag, these
+// read the key/value pairs of live b-tree or hash pages, so deleted items,
+// free pages and tags that happen to occur inside other data are never
+// reported, and SQLite cells (key before value) decode correctly. Pointers
+// go into the image. A parser returns false when the file's structure does
+// not hold up; the caller then falls back to the scan. An SQLite wallet's
+// pages are read through its WAL overlay, if it has one; records on WAL pages
+// get offsets past the end of the database, counting into the -wal file. A
+// BerkeleyDB wallet's pages are read through its log replay, if it has one;
+// replayed pages keep their place in the file.
+// Values BerkeleyDB spread over several overflow pages, joined into locked
+// memory that lasts as long as the records pointing at them. Pages are
+// parsed on several threads, so handing out room takes a lock.
+class JoinedValues {
+private:
+    std::mutex mutex;
+    SecureArena arena{0};
+public:
+    uint8_t* allocate(size_t size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return arena.allocate(size, 1);
+    }
+};
+
+class RecordParser {
+public:
+    RecordParser(const ImageView& image, const WalletFormat::Info& info, const WalOverlay* wal,
+                 const BerkeleyLogReplay* replay, JoinedValues& joined, wt_parser mode = WT_PARSER_AUTO)
+        : image(image), info(info), wal(wal), replay(replay), joined(joined), salvaging(mode == WT_PARSER_SALVAGE),
+          forensic(mode == WT_PARSER_FORENSIC) {}
+
+    bool parse(std::vector<wt_record>& records) {
+        bool ok = info.kind == WalletFormat::SQLITE ? parseSQLite(records) : parseBerkeley(records);
+        if (!ok) return false;
+        std::sort(records.begin(), records.end(),
+                  [](const wt_record& a, const wt_record& b) { return a.offset < b.offset; });
+        return true;
+    }
+
+    // A damaged file cannot be trusted to describe itself. Its header is used
+    // when it still reads as one; otherwise every page size is tried (both
+    // byte orders for BerkeleyDB) on a sample of pages, and the layout under
+    // which the most bytes look like pages wins: BerkeleyDB pages carrying
+    // their own page number, SQLite pages that read as b-tree pages.
+    static WalletFormat::Info salvageLayout(const ImageView& image, const WalletFormat::Info& detected) {
+        if (WalletFormat::isDatabase(detected.kind)) return detected;
+        WalletFormat::Info best;
+        uint64_t bestScore = 0;
+        for (uint32_t pageSize = 512; pageSize <= 65536; pageSize *= 2) {
+            size_t pages = image.size / pageSize;
+            if (pages < 2) break;
+            size_t step = std::max<size_t>(1, pages / SALVAGE_SAMPLES);
+            uint64_t matches[3] = {0, 0, 0};   // little-endian BerkeleyDB, big-endian BerkeleyDB, SQLite
+            for (size_t p = 1; p < pages; p += step) {
+                const uint8_t* page = image.data + p * pageSize;
+                if (WalletFormat::read32(page + 8, false) == p) matches[0]++;
+                if (WalletFormat::read32(page + 8, true) == p) matches[1]++;
+                if (sqliteBtreeIntact(page, 0, pageSize, pageSize)) matches[2]++;
+            }
+            for (int candidate = 0; candidate < 3; candidate++) {
+                uint64_t score = matches[candidate] * step * pageSize;
+                if (score <= bestScore) continue;
+                bestScore = score;
+                best = WalletFormat::Info();
+                best.kind = candidate == 2 ? WalletFormat::SQLITE : WalletFormat::BERKELEY_DB;
+                best.bigEndian = candidate == 1;
+                best.pageSize = pageSize;
+                best.usableSize = pageSize;
+            }
+        }
+        return best;
+    }
+
+    // Salvage reads the image page by page, with no trust in the structure
+    // that links pages together: every page is checked on its own, on the
+    // scheduler's threads, and records are read only from pages that pass.
+    void salvage(std::vector<wt_record>& records, wt_salvage_stats& stats) const {
+        stats = wt_salvage_stats();
+        if (!WalletFormat::isDatabase(info.kind)) return;
+        const uint32_t pageSize = info.pageSize;
+        const size_t pages = (image.size + pageSize - 1) / pageSize;
+        const bool sqlite = info.kind == WalletFormat::SQLITE;
+        size_t pagesPerChunk = std::max<size_t>(1, SCAN_CHUNK / pageSize);
+        size_t chunks = (pages + pagesPerChunk - 1) / pagesPerChunk;
+        struct Tally {
+            uint64_t intact = 0, damaged = 0, unreadable = 0;
+            std::vector<wt_record> records;
+        };
+        std::vector<Tally> tallies(chunks);
+        parallelFor(chunks, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; c++) {
+                Tally& tally = tallies[c];
+                size_t end = std::min(pages, (c + 1) * pagesPerChunk);
+                for (size_t p = c * pagesPerChunk; p < end; p++) {
+                    if ((p + 1) * pageSize > image.size) {
+                        tally.unreadable++;
+                        continue;
+                    }
+                    const uint8_t* page = image.data + p * pageSize;
+                    PageState state = sqlite ? salvageSQLitePage(page, p * pageSize, pages, tally.records)
+                                             : salvageBerkeleyPage(page, p, tally.records);
+                    (state == PAGE_INTACT ? tally.intact : state == PAGE_DAMAGED ? tally.damaged : tally.unreadable)++;
+                }
+            }
+        });
+        stats.page_size = pageSize;
+        stats.pages = pages;
+        for (const auto& tally : tallies) {
+            stats.pages_intact += tally.intact;
+            stats.pages_damaged += tally.damaged;
+            stats.pages_unreadable += tally.unreadable;
+            records.insert(records.end(), tally.records.begin(), tally.records.end());
+        }
+        std::sort(records.begin(), records.end(),
+                  [](const wt_record& a, const wt_record& b) { return a.offset < b.offset; });
+        for (const auto& record : records) {
+            switch (record.type) {
+                case WT_RECORD_MKEY: stats.mkeys++; break;
+                case WT_RECORD_CKEY:
+                case WT_RECORD_DESCRIPTOR_CKEY: stats.ckeys++; break;
+                case WT_RECORD_KEY:
+                case WT_RECORD_WKEY:
+                case WT_RECORD_DESCRIPTOR_KEY: stats.keys++; break;
+                case WT_RECORD_KEYMETA: stats.keymetas++; break;
+                default: break;
+            }
+        }
+    }
+
+private:
+    const ImageView& image;
+    const WalletFormat::Info& info;
+    const WalOverlay* wal;
+    const BerkeleyLogReplay* replay;
+    JoinedValues& joined;
+    const bool salvaging;   // also report keymeta records
+    const bool forensic;    // also look for stale records where live parsing never looks
+
+    // The length-prefixed pubkey that follows a record name in its key
+    static void pubkeyAt(const uint8_t* p, const uint8_t* end, wt_record& record) {
+        size_t skip, pubkeyLength;
+        if (record_layout::PubKey::measure(p, end, skip, pubkeyLength)) {
+            record.pubkey = p + skip;
+            record.pubkey_len = pubkeyLength;
+        }
+    }
+
+    // The descriptor id and pubkey that follow the name of a descriptor key
+    static bool descriptorKeyAt(const uint8_t* p, const uint8_t* end, wt_record& record) {
+        using Key = record_layout::WalletDescriptorKey::Key;
+        Key::Decoded decoded;
+        if (!Key::decode(p, static_cast<size_t>(end - p), decoded)) return false;
+        record.descriptor_id = decoded.fields[record_layout::WalletDescriptorKey::DESCRIPTOR_ID].data;
+        record.pubkey = decoded.fields[record_layout::WalletDescriptorKey::PUBKEY].data;
+        record.pubkey_len = decoded.fields[record_layout::WalletDescriptorKey::PUBKEY].length;
+        return true;
+    }
+
+    // One pair of the wallet's "main" table, if it is a record this parser
+    // reports. The key lies on page, which starts at pageOffset in the file.
+    void addPair(const uint8_t* page, uint64_t pageOffset, const uint8_t* key, size_t keyLength,
+                 const uint8_t* value, size_t valueLength, std::vector<wt_record>& records,
+                 wt_record_origin origin = WT_ORIGIN_LIVE) const {
+        if (keyLength < 4 || key[0] + size_t(1) > keyLength) return;
+        const size_t nameLength = key[0];
+        const uint8_t* name = key + 1;
+        const uint8_t* keyEnd = key + keyLength;
+        uint64_t tag = pageOffset + static_cast<uint64_t>(name - page);
+        const uint8_t* tail = name + nameLength;
+        wt_record record{};
+        using namespace record_layout;
+        if (isNamed<MasterKey>(name, nameLength)) {
+            if (keyLength != 1 + nameLength + MasterKey::Key::FIXED_SIZE || !MasterKey::Value::fits(value, valueLength)) {
+                return;
+            }
+            record = makeRecord(WT_RECORD_MKEY, tag, value + MasterKey::Value::offset<MasterKey::CRYPTED_KEY>(),
+                                WT_MKEY_RECORD_SIZE, origin);
+        } else if (isNamed<CryptedKey>(name, nameLength)) {
+            if (keyLength < 2 + nameLength || !CryptedKey::Value::fits(value, valueLength)) return;
+            record = makeRecord(WT_RECORD_CKEY, tag, value + CryptedKey::Value::offset<CryptedKey::CRYPTED_SECRET>(),
+                                WT_CRYPTED_KEY_SIZE, origin);
+            pubkeyAt(tail, keyEnd, record);
+        } else if (isNamed<PlainKey>(name, nameLength)) {
+            // The DER private key; the hash behind it is optional
+            PlainKey::Value::Decoded decoded;
+            if (!PlainKey::Value::decode(value, valueLength, decoded, PlainKey::PRIVATE_KEY + 1)) return;
+            const auto& der = decoded.fields[PlainKey::PRIVATE_KEY];
+            if (!der.length) return;
+            record = makeRecord(WT_RECORD_KEY, tag, der.data, der.length, origin);
+            pubkeyAt(tail, keyEnd, record);
+        } else if (isNamed<WalletKey>(name, nameLength)) {
+            WalletKey::Value::Decoded decoded;
+            if (!WalletKey::Value::decode(value, valueLength, decoded, WalletKey::PRIVATE_KEY + 1)) return;
+            const auto& der = decoded.fields[WalletKey::PRIVATE_KEY];
+            if (!der.length) return;
+            record = makeRecord(WT_RECORD_WKEY, tag, der.data, der.length, origin);
+            pubkeyAt(tail, keyEnd, record);
+        } else if (isNamed<WalletDescriptor>(name, nameLength)) {
+            WalletDescriptor::Value::Decoded decoded;
+            if (static_cast<size_t>(keyEnd - tail) != WalletDescriptor::Key::FIXED_SIZE ||
+                !WalletDescriptor::Value::decode(value, valueLength, decoded)) {
+                return;
+            }
+            record = makeRecord(WT_RECORD_DESCRIPTOR, tag, value, decoded.size, origin, tail);
+        } else if (isNamed<WalletDescriptorCryptedKey>(name, nameLength)) {
+            if (!WalletDescriptorCryptedKey::Value::fits(value, valueLength)) return;
+            record = makeRecord(WT_RECORD_DESCRIPTOR_CKEY, tag,
+                                value + WalletDescriptorCryptedKey::Value::offset<WalletDescriptorCryptedKey::CRYPTED_SECRET>(),
+                                WT_CRYPTED_KEY_SIZE, origin);
+            if (!descriptorKeyAt(tail, keyEnd, record)) return;
+        } else if (isNamed<WalletDescriptorKey>(name, nameLength)) {
+            WalletDescriptorKey::Value::Decoded decoded;
+            if (!WalletDescriptorKey::Value::decode(value, valueLength, decoded, WalletDescriptorKey::PRIVATE_KEY + 1)) return;
+            const auto& der = decoded.fields[WalletDescriptorKey::PRIVATE_KEY];
+            if (!der.length) return;
+            record = makeRecord(WT_RECORD_DESCRIPTOR_KEY, tag, der.data, der.length, origin);
+            if (!descriptorKeyAt(tail, keyEnd, record)) return;
+        } else if (isNamed<WalletDescriptorCache>(name, nameLength)) {
+            // Only the xpubs of key expressions; derived ones have an index more
+            using Cache = WalletDescriptorCache;
+            if (static_cast<size_t>(keyEnd - tail) != Cache::Key::offset<Cache::DERIVATION_INDEX>() ||
+                !Cache::Value::fits(value, valueLength)) {
+                return;
+            }
+            record = makeRecord(WT_RECORD_DESCRIPTOR_XPUB, tag, value + Cache::Value::offset<Cache::EXTENDED_PUBKEY>(),
+                                WT_EXTENDED_KEY_SIZE, origin, tail);
+        } else if (isNamed<HDChain>(name, nameLength)) {
+            HDChain::Value::Decoded decoded;
+            if (tail != keyEnd || !HDChain::Value::decode(value, valueLength, decoded, HDChain::SEED_ID + 1)) return;
+            record = makeRecord(WT_RECORD_HDCHAIN, tag, value, decoded.size, origin);
+        } else if (salvaging && isNamed<KeyMetadata>(name, nameLength)) {
+            record = makeRecord(WT_RECORD_KEYMETA, tag, value, valueLength, origin);
+            pubkeyAt(tail, keyEnd, record);
+        } else {
+            return;
+        }
+        records.push_back(record);
+    }
+
+    // BerkeleyDB page types and item types (db_page.h); index pages share
+    // one layout
+    static constexpr uint8_t P_INVALID = 0;
+    static constexpr uint8_t P_HASH_UNSORTED = 2;
+    static constexpr uint8_t P_IBTREE = 3;
+    static constexpr uint8_t P_LBTREE = 5;
+    static constexpr uint8_t P_OVERFLOW = 7;
+    static constexpr uint8_t P_HASHMETA = 8;
+    static constexpr uint8_t P_BTREEMETA = 9;
+    static constexpr uint8_t P_LDUP = 12;
+    static constexpr uint8_t P_HASH = 13;
+    static constexpr uint8_t B_KEYDATA = 1;
+    static constexpr uint8_t B_DUPLICATE = 2;
+    static constexpr uint8_t B_OVERFLOW = 3;
+    static constexpr uint8_t B_DELETE = 0x80;
+    static constexpr uint8_t H_KEYDATA = 1;
+    static constexpr uint8_t H_OFFPAGE = 3;
+    static constexpr uint8_t H_OFFDUP = 4;
+    static constexpr size_t BDB_PAGE_HEADER = 26;
+    static constexpr size_t BOVERFLOW_SIZE = 12;   // also the fixed part of an internal item
+
+    // The largest value a stale record is looked for behind its key: an
+    // uncompressed DER private key with its hash, with room to spare
+    static constexpr size_t STALE_VALUE_MAX = 1024;
+
+    // Overflow chains are only followed for records addPair() reports, none
+    // of which comes near this size
+    static constexpr size_t OVERFLOW_VALUE_MAX = 64 * 1024;
+
+    // Pages are independent, so large files are split over the scheduler.
+    // Every page must carry its own page number; anything else is free
+    // space, a stale copy or not part of this file.
+    bool parseBerkeley(std::vector<wt_record>& records) const {
+        const uint32_t pageSize = info.pageSize;
+        // Encrypted and checksummed environments move the item index; Bitcoin
+        // Core uses neither
+        if (image.data[24] != 0 || (image.data[26] & 1) != 0) return false;
+        size_t pages;
+        if (replay) {
+            // A copy taken while the node ran need not match its header
+            pages = replay->pageCount();
+        } else {
+            if (info.pageCount * pageSize != image.size) return false;
+            pages = static_cast<size_t>(info.pageCount);
+        }
+        size_t pagesPerChunk = std::max<size_t>(1, SCAN_CHUNK / pageSize);
+        size_t chunks = (pages + pagesPerChunk - 1) / pagesPerChunk;
+        std::vector<std::vector<wt_record>> found(chunks);
+        parallelFor(chunks, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; c++) {
+                size_t end = std::min(pages, (c + 1) * pagesPerChunk);
+                for (size_t p = std::max<size_t>(1, c * pagesPerChunk); p < end; p++) {
+                    const uint8_t* page = berkeleyPage(p);
+                    if (!page) continue;
+                    if (WalletFormat::read32(page + 8, info.bigEndian) != p) {
+                        if (forensic) staleBerkeley(page, p * pageSize, BDB_PAGE_HEADER, pageSize, WT_ORIGIN_FREE_PAGE, found[c]);
+                        continue;
+                    }
+                    uint8_t type = page[25];
+                    if (type == P_LBTREE) berkeleyLeaf(page, p * pageSize, found[c]);
+                    else if (type == P_HASH || type == P_HASH_UNSORTED) berkeleyHash(page, p * pageSize, found[c]);
+                    if (forensic) berkeleyUnused(page, p * pageSize, type, found[c]);
+                }
+            }
+        });
+        for (const auto& chunk : found) records.insert(records.end(), chunk.begin(), chunk.end());
+        return true;
+    }
+
+    // Page pgno: the replayed copy if there is one, else the image's;
+    // nullptr past the end of the image
+    const uint8_t* berkeleyPage(size_t pgno) const {
+        const uint8_t* page = replay ? replay->page(static_cast<uint32_t>(pgno)) : nullptr;
+        if (page) return page;
+        return (pgno + 1) * info.pageSize <= image.size ? image.data + pgno * info.pageSize : nullptr;
+    }
+
+    // Whether addPair() reports pairs under the name this key item starts
+    // with; overflow values are only gathered for those
+    bool reportsName(const uint8_t* key, size_t keyLength) const {
+        using namespace record_layout;
+        if (keyLength < 1 || key[0] + size_t(1) > keyLength) return false;
+        const uint8_t* name = key + 1;
+        const size_t length = key[0];
+        return isNamed<MasterKey>(name, length) || isNamed<CryptedKey>(name, length) ||
+               isNamed<PlainKey>(name, length) || isNamed<WalletKey>(name, length) ||
+               isNamed<WalletDescriptor>(name, length) || isNamed<WalletDescriptorCryptedKey>(name, length) ||
+               isNamed<WalletDescriptorKey>(name, length) || isNamed<WalletDescriptorCache>(name, length) ||
+               isNamed<HDChain>(name, length) || (salvaging && isNamed<KeyMetadata>(name, length));
+    }
+
+    // An item too large for its page (with 512- or 1024-byte pages, a key or
+    // wkey value already is) holds the first page of an overflow chain at +4
+    // and the total length at +8; each page of the chain holds its share of
+    // the bytes after its header and their length in the free-space offset.
+    // A value on one page is used in place, a longer one is joined. nullptr
+    // if a page of the chain is missing or no overflow page, or the lengths
+    // do not add up.
+    const uint8_t* overflowValue(const uint8_t* item, size_t& length) const {
+        uint32_t pgno = WalletFormat::read32(item + 4, info.bigEndian);
+        length = WalletFormat::read32(item + 8, info.bigEndian);
+        if (length == 0 || length > OVERFLOW_VALUE_MAX) return nullptr;
+        std::vector<std::pair<const uint8_t*, size_t>> pieces;
+        size_t total = 0;
+        while (total < length) {
+            const uint8_t* page = pgno ? berkeleyPage(pgno) : nullptr;
+            if (!page || WalletFormat::read32(page + 8, info.bigEndian) != pgno || page[25] != P_OVERFLOW) {
+                return nullptr;
+            }
+            size_t piece = WalletFormat::read16(page + 22, info.bigEndian);
+            if (piece == 0 || piece > info.pageSize - BDB_PAGE_HEADER || piece > length - total) return nullptr;
+            pieces.emplace_back(page + BDB_PAGE_HEADER, piece);
+            total += piece;
+            pgno = WalletFormat::read32(page + 16, info.bigEndian);
+        }
+        if (pieces.size() == 1) return pieces[0].first;
+        uint8_t* value = joined.allocate(length);
+        uint8_t* out = value;
+        for (const auto& piece : pieces) {
+            memcpy(out, piece.first, piece.second);
+            out += piece.second;
+        }
+        return value;
+    }
+
+    // The index array of a page, or 0 entries if it does not fit the page
+    size_t berkeleyEntries(const uint8_t* page) const {
+        size_t entries = WalletFormat::read16(page + 20, info.bigEndian);
+        return BDB_PAGE_HEADER + 2 * entries <= info.pageSize ? entries : 0;
+    }
+
+    // Btree leaves hold key and data items in alternating index slots, each
+    // a length, a type and the bytes, or a reference to overflow pages for
+    // a data item too large for the page. Items marked deleted (kept while a
+    // cursor points at them) only count in forensic parsing.
+    void berkeleyLeaf(const uint8_t* page, uint64_t pageOffset, std::vector<wt_record>& records) const {
+        size_t entries = berkeleyEntries(page);
+        auto item = [&](size_t index, const uint8_t*& bytes, size_t& length, bool& deleted, bool followOverflow) {
+            size_t offset = WalletFormat::read16(page + BDB_PAGE_HEADER + 2 * index, info.bigEndian);
+            if (offset < BDB_PAGE_HEADER || offset + 3 > info.pageSize) return false;
+            uint8_t type = page[offset + 2];
+            deleted = (type & B_DELETE) != 0;
+            if (deleted && !forensic) return false;
+            if ((type & ~B_DELETE) == B_OVERFLOW) {
+                if (!followOverflow || offset + BOVERFLOW_SIZE > info.pageSize) return false;
+                bytes = overflowValue(page + offset, length);
+                return bytes != nullptr;
+            }
+            if ((type & ~B_DELETE) != B_KEYDATA) return false;
+            length = WalletFormat::read16(page + offset, info.bigEndian);
+            bytes = page + offset + 3;
+            return offset + 3 + length <= info.pageSize;
+        };
+        for (size_t i = 0; i + 1 < entries; i += 2) {
+            const uint8_t* key;
+            const uint8_t* value;
+            size_t keyLength, valueLength;
+            bool keyDeleted, valueDeleted;
+            if (item(i, key, keyLength, keyDeleted, false) &&
+                item(i + 1, value, valueLength, valueDeleted, reportsName(key, keyLength))) {
+                addPair(page, pageOffset, key, keyLength, value, valueLength, records,
+                        keyDeleted || valueDeleted ? WT_ORIGIN_DELETED : WT_ORIGIN_LIVE);
+            }
+        }
+    }
+
+    // Forensic parsing: what a page in use does not need (between its index
+    // and its items, or after an overflow page's data) and all of a free
+    // page can still hold records from before
+    void berkeleyUnused(const uint8_t* page, uint64_t pageOffset, uint8_t type, std::vector<wt_record>& records) const {
+        const size_t pageSize = info.pageSize;
+        size_t freeOffset = WalletFormat::read16(page + 22, info.bigEndian);
+        switch (type) {
+            case P_INVALID:
+                staleBerkeley(page, pageOffset, BDB_PAGE_HEADER, pageSize, WT_ORIGIN_FREE_PAGE, records);
+                break;
+            case P_OVERFLOW:
+                // The free-space offset holds the length of the data
+                if (BDB_PAGE_HEADER + freeOffset < pageSize) {
+                    staleBerkeley(page, pageOffset, BDB_PAGE_HEADER + freeOffset, pageSize, WT_ORIGIN_SLACK, records);
+                }
+                break;
+            case P_IBTREE:
+            case P_LBTREE:
+            case P_LDUP:
+            case P_HASH:
+            case P_HASH_UNSORTED: {
+                size_t indexEnd = BDB_PAGE_HEADER + 2 * WalletFormat::read16(page + 20, info.bigEndian);
+                if (indexEnd < freeOffset && freeOffset <= pageSize) {
+                    staleBerkeley(page, pageOffset, indexEnd, freeOffset, WT_ORIGIN_SLACK, records);
+                }
+                break;
+            }
+        }
+    }
+
+    // Calls found(position) for every place in [begin, end) of page where
+    // the name of a key record that addPair() knows starts, at its length byte
+    template <typename Found>
+    static void findNames(const uint8_t* page, size_t begin, size_t end, const Found& found) {
+        // Descriptor key names end in "key" too; the start of each is checked
+        // from there
+        static const char* const descriptorNames[] = {record_layout::WalletDescriptorCryptedKey::NAME,
+                                                      record_layout::WalletDescriptorKey::NAME};
+        for (size_t k = begin + 2; k + 3 <= end; k++) {
+            const void* hit = memchr(page + k, 'k', end - 2 - k);
+            if (!hit) return;
+            k = static_cast<size_t>(static_cast<const uint8_t*>(hit) - page);
+            if (page[k + 1] != 'e' || page[k + 2] != 'y') continue;
+            if (page[k - 2] == 4 && (page[k - 1] == 'c' || page[k - 1] == 'm' || page[k - 1] == 'w')) {
+                found(k - 2);
+            } else if (page[k - 1] == 3 || (page[k - 1] == 7 && k + 7 <= end && memcmp(page + k + 3, "meta", 4) == 0)) {
+                found(k - 1);
+            } else if (page[k - 1] == 'c' || page[k - 1] == 'r') {
+                for (const char* name : descriptorNames) {
+                    size_t length = strlen(name);
+                    if (k + 3 < begin + 1 + length) continue;
+                    size_t start = k + 3 - length;
+                    if (page[start - 1] == length && memcmp(page + start, name, length) == 0) found(start - 1);
+                }
+            }
+        }
+    }
+
+    // Stale BerkeleyDB items no longer have an index slot, but keep their
+    // framing: a key item (length, type, bytes) at a 4-byte boundary, and
+    // its data item right below it, where BerkeleyDB put it when the pair
+    // was inserted. A name counts only if both items hold up inside the
+    // region; a data item on overflow pages only if its chain is still
+    // there.
+    void staleBerkeley(const uint8_t* page, uint64_t pageOffset, size_t begin, size_t end, wt_record_origin origin,
+                       std::vector<wt_record>& records) const {
+        findNames(page, begin, end, [&](size_t name) {
+            size_t keyItem = name - 3;
+            if (name < begin + 3 || keyItem % 4 != 0) return;
+            if ((page[keyItem + 2] & ~B_DELETE) != B_KEYDATA) return;
+            size_t keyLength = WalletFormat::read16(page + keyItem, info.bigEndian);
+            if (name + keyLength > end) return;
+            if (keyItem >= begin + BOVERFLOW_SIZE && (page[keyItem - BOVERFLOW_SIZE + 2] & ~B_DELETE) == B_OVERFLOW) {
+                size_t valueLength;
+                if (const uint8_t* value = overflowValue(page + keyItem - BOVERFLOW_SIZE, valueLength)) {
+                    addPair(page, pageOffset, page + name, keyLength, value, valueLength, records, origin);
+                    return;
+                }
+            }
+            for (size_t dataItem = keyItem - 4; dataItem >= begin && keyItem - dataItem <= STALE_VALUE_MAX;
+                 dataItem -= 4) {
+                size_t valueLength = WalletFormat::read16(page + dataItem, info.bigEndian);
+                if ((page[dataItem + 2] & ~B_DELETE) == B_KEYDATA && ((3 + valueLength + 3) & ~size_t(3)) == keyItem - dataItem) {
+                    addPair(page, pageOffset, page + name, keyLength, page + dataItem + 3, valueLength, records, origin);
+                    return;
+                }
+                if (dataItem < 4) return;
+            }
+        });
+    }
+
+    // Hash pages store bare items packed down from the end of the page; an
+    // item's length is the distance to the one before it. A data item too
+    // large for the page refers to overflow pages the way a btree one does.
+    void berkeleyHash(const uint8_t* page, uint64_t pageOffset, std::vector<wt_record>& records) const {
+        size_t entries = berkeleyEntries(page);
+        auto item = [&](size_t index, const uint8_t*& bytes, size_t& length, bool followOverflow) {
+            size_t offset = WalletFormat::read16(page + BDB_PAGE_HEADER + 2 * index, info.bigEndian);
+            size_t end = index == 0 ? info.pageSize
+                                    : WalletFormat::read16(page + BDB_PAGE_HEADER + 2 * (index - 1), info.bigEndian);
+            if (offset < BDB_PAGE_HEADER || end > info.pageSize || offset >= end) return false;
+            if (page[offset] == H_OFFPAGE) {
+                if (!followOverflow || offset + BOVERFLOW_SIZE > end) return false;
+                bytes = overflowValue(page + offset, length);
+                return bytes != nullptr;
+            }
+            if (page[offset] != H_KEYDATA) return false;
+            bytes = page + offset + 1;
+            length = end - offset - 1;
+            return true;
+        };
+        for (size_t i = 0; i + 1 < entries; i += 2) {
+            const uint8_t* key;
+            const uint8_t* value;
+            size_t keyLength, valueLength;
+            if (item(i, key, keyLength, false) && item(i + 1, value, valueLength, reportsName(key, keyLength))) {
+                addPair(page, pageOffset, key, keyLength, value, valueLength, records);
+            }
+        }
+    }
+
+    // SQLite keeps each table as a b-tree rooted at a page named in the
+    // schema table (itself rooted at page 1). Only the tree is walked, so
+    // freelist pages holding old rows are not visited.
+    static constexpr uint8_t SQLITE_INTERIOR_TABLE = 0x05;
+    static constexpr uint8_t SQLITE_LEAF_TABLE = 0x0d;
+
+    struct Column {
+        const uint8_t* bytes = nullptr;
+        size_t length = 0;
+        uint64_t serialType = 0;
+    };
+
+    static bool varint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+        value = 0;
+        for (int i = 0; i < 9; i++) {
+            if (p >= end) return false;
+            uint8_t byte = *p++;
+            if (i == 8) {
+                value = (value << 8) | byte;
+                return true;
+            }
+            value = (value << 7) | (byte & 0x7f);
+            if (!(byte & 0x80)) return true;
+        }
+        return true;
+    }
+
+    static size_t serialLength(uint64_t serialType) {
+        static const size_t fixed[] = {0, 1, 2, 3, 4, 6, 8, 8, 0, 0, 0, 0};
+        if (serialType < 12) return fixed[serialType];
+        return static_cast<size_t>((serialType - 12) / 2);
+    }
+
+    // The columns of a record payload
+    static bool columns(const uint8_t* payload, size_t length, std::vector<Column>& out) {
+        out.clear();
+        const uint8_t* p = payload;
+        const uint8_t* end = payload + length;
+        uint64_t headerLength;
+        if (!varint(p, end, headerLength) || headerLength > length) return false;
+        const uint8_t* headerEnd = payload + headerLength;
+        const uint8_t* body = headerEnd;
+        while (p < headerEnd) {
+            Column column;
+            if (!varint(p, headerEnd, column.serialType)) return false;
+            column.length = serialLength(column.serialType);
+            if (column.length > static_cast<size_t>(end - body)) return false;
+            column.bytes = body;
+            body += column.length;
+            out.push_back(column);
+        }
+        return true;
+    }
+
+    static int64_t integer(const Column& column) {
+        if (column.serialType == 8) return 0;
+        if (column.serialType == 9) return 1;
+        if (column.serialType < 1 || column.serialType > 6) return -1;
+        int64_t value = (column.bytes[0] & 0x80) ? -1 : 0;
+        for (size_t i = 0; i < column.length; i++) value = (value << 8) | column.bytes[i];
+        return value;
+    }
+
+    static bool text(const Column& column, const char* expected) {
+        size_t length = strlen(expected);
+        return column.serialType >= 13 && (column.serialType & 1) && column.length == length &&
+               memcmp(column.bytes, expected, length) == 0;
+    }
+
+    // The latest committed version of a page and where it lies: in the
+    // database, or past its end in the -wal file. nullptr past the end of
+    // the file.
+    const uint8_t* sqlitePage(uint32_t pgno, uint64_t& pageOffset) const {
+        if (wal) {
+            if (const uint8_t* page = wal->page(pgno)) {
+                pageOffset = image.size + static_cast<uint64_t>(page - wal->contents.data());
+                return page;
+            }
+        }
+        pageOffset = uint64_t(pgno - 1) * info.pageSize;
+        return pageOffset + info.pageSize <= image.size ? image.data + pageOffset : nullptr;
+    }
+
+    // Calls row(page, pageOffset, payload, length) for every row of the
+    // table rooted at root whose payload is stored whole on its leaf. Rows
+    // that spill into overflow pages are far larger than any mkey or ckey
+    // and are skipped.
+    template <typename Row>
+    bool walkTable(uint32_t root, uint64_t pages, const Row& row) const {
+        const size_t usable = info.usableSize;
+        const size_t maxLocal = usable - 35;
+        std::vector<bool> visited(pages + 1, false);
+        std::vector<uint32_t> stack{root};
+        while (!stack.empty()) {
+            uint32_t pgno = stack.back();
+            stack.pop_back();
+            if (pgno == 0 || pgno > pages || visited[pgno]) return false;
+            visited[pgno] = true;
+            uint64_t pageOffset;
+            const uint8_t* page = sqlitePage(pgno, pageOffset);
+            if (!page) return false;
+            size_t header = pgno == 1 ? 100 : 0;
+            uint8_t type = page[header];
+            if (type != SQLITE_LEAF_TABLE && type != SQLITE_INTERIOR_TABLE) return false;
+            bool leaf = type == SQLITE_LEAF_TABLE;
+            size_t cells = (size_t(page[header + 3]) << 8) | page[header + 4];
+            size_t pointers = header + (leaf ? 8 : 12);
+            if (pointers + 2 * cells > usable) return false;
+            if (!leaf) stack.push_back(walletcrypto_detail::readBE32(page + header + 8));
+            for (size_t i = 0; i < cells; i++) {
+                size_t offset = (size_t(page[pointers + 2 * i]) << 8) | page[pointers + 2 * i + 1];
+                if (offset < pointers + 2 * cells || offset >= usable) return false;
+                const uint8_t* cell = page + offset;
+                const uint8_t* end = page + usable;
+                if (!leaf) {
+                    if (offset + 4 > usable) return false;
+                    stack.push_back(walletcrypto_detail::readBE32(cell));
+                    continue;
+                }
+                uint64_t payloadLength, rowid;
+                if (!varint(cell, end, payloadLength) || !varint(cell, end, rowid)) return false;
+                if (payloadLength > maxLocal) continue;
+                if (payloadLength > static_cast<uint64_t>(end - cell)) return false;
+                row(page, pageOffset, cell, static_cast<size_t>(payloadLength));
+            }
+        }
+        return true;
+    }
+
+    bool parseSQLite(std::vector<wt_record>& records) const {
+        uint64_t pages;
+        if (wal) {
+            // The last commit in the WAL says how large the database is now
+            pages = wal->pageCount;
+        } else {
+            pages = info.pageCount ? info.pageCount : image.size / info.pageSize;
+            if (pages * info.pageSize != image.size) return false;
+        }
+
+        // sqlite_schema rows are (type, name, tbl_name, rootpage, sql)
+        int64_t mainRoot = -1;
+        std::vector<Column> row;
+        bool schema = walkTable(1, pages, [&](const uint8_t*, uint64_t, const uint8_t* payload, size_t length) {
+            if (columns(payload, length, row) && row.size() >= 4 && text(row[0], "table") && text(row[1], "main")) {
+                mainRoot = integer(row[3]);
+            }
+        });
+        if (!schema || mainRoot <= 0 || static_cast<uint64_t>(mainRoot) > pages) return false;
+
+        // main rows are (key, value), both blobs
+        bool ok = walkTable(static_cast<uint32_t>(mainRoot), pages, [&](const uint8_t* page, uint64_t pageOffset,
+                                                                        const uint8_t* payload, size_t length) {
+            if (!columns(payload, length, row) || row.size() < 2) return;
+            if (row[0].serialType < 12 || (row[0].serialType & 1) || row[1].serialType < 12 || (row[1].serialType & 1)) {
+                return;
+            }
+            addPair(page, pageOffset, row[0].bytes, row[0].length, row[1].bytes, row[1].length, records);
+        });
+        if (ok && forensic) sqliteUnused(pages, records);
+        return ok;
+    }
+
+    // Forensic parsing: deleted rows stay behind on freelist pages, in the
+    // freeblocks of b-tree pages and in the gap between a page's cell
+    // pointers and its cells. Freelist pages are found through the trunk
+    // chain the header starts; every page is then searched once, split over
+    // the scheduler.
+    void sqliteUnused(uint64_t pages, std::vector<wt_record>& records) const {
+        const size_t usable = info.usableSize;
+        uint64_t pageOffset;
+        const uint8_t* header = sqlitePage(1, pageOffset);
+        std::vector<uint32_t> freeBegin(pages + 1, 0);   // where stale data starts on a freelist page; 0 if not one
+        uint64_t trunkSteps = 0;
+        for (uint32_t trunk = walletcrypto_detail::readBE32(header + 32); trunk && trunk <= pages && !freeBegin[trunk];
+             trunkSteps++) {
+            const uint8_t* page = sqlitePage(trunk, pageOffset);
+            if (!page || trunkSteps > pages) break;
+            size_t leaves = walletcrypto_detail::readBE32(page + 4);
+            if (8 + 4 * leaves > usable) break;
+            freeBegin[trunk] = static_cast<uint32_t>(8 + 4 * leaves);
+            for (size_t i = 0; i < leaves; i++) {
+                uint32_t leaf = walletcrypto_detail::readBE32(page + 8 + 4 * i);
+                if (leaf && leaf <= pages && !freeBegin[leaf]) freeBegin[leaf] = 1;
+            }
+            trunk = walletcrypto_detail::readBE32(page);
+        }
+
+        size_t pagesPerChunk = std::max<size_t>(1, SCAN_CHUNK / info.pageSize);
+        size_t chunks = static_cast<size_t>((pages + pagesPerChunk - 1) / pagesPerChunk);
+        std::vector<std::vector<wt_record>> found(chunks);
+        parallelFor(chunks, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; c++) {
+                size_t end = std::min<size_t>(static_cast<size_t>(pages), (c + 1) * pagesPerChunk);
+                for (size_t p = c * pagesPerChunk + 1; p <= end; p++) {
+                    uint64_t offset;
+                    const uint8_t* page = sqlitePage(static_cast<uint32_t>(p), offset);
+                    if (!page) continue;
+                    if (freeBegin[p]) {
+                        // A leaf's first byte is never stale data, so 1 marks a leaf
+                        staleSQLite(page, offset, freeBegin[p] == 1 ? 0 : freeBegin[p], usable, WT_ORIGIN_FREE_PAGE, found[c]);
+                        continue;
+                    }
+                    size_t header = p == 1 ? 100 : 0;
+                    if (!sqliteBtreeIntact(page, header, info.pageSize, usable)) continue;
+                    bool leaf = page[header] == SQLITE_LEAF_INDEX || page[header] == SQLITE_LEAF_TABLE;
+                    size_t cells = (size_t(page[header + 3]) << 8) | page[header + 4];
+                    size_t contentStart = (size_t(page[header + 5]) << 8) | page[header + 6];
+                    if (contentStart == 0) contentStart = 65536;
+                    size_t pointersEnd = header + (leaf ? 8 : 12) + 2 * cells;
+                    if (pointersEnd < contentStart) {
+                        staleSQLite(page, offset, pointersEnd, std::min(contentStart, usable), WT_ORIGIN_SLACK, found[c]);
+                    }
+                    size_t freeblock = (size_t(page[header + 1]) << 8) | page[header + 2];
+                    for (size_t steps = 0; freeblock && freeblock + 4 <= usable && steps < usable / 4; steps++) {
+                        size_t size = (size_t(page[freeblock + 2]) << 8) | page[freeblock + 3];
+                        if (size < 4 || freeblock + size > usable) break;
+                        staleSQLite(page, offset, freeblock, freeblock + size, WT_ORIGIN_SLACK, found[c]);
+                        size_t next = (size_t(page[freeblock]) << 8) | page[freeblock + 1];
+                        if (next <= freeblock) break;
+                        freeblock = next;
+                    }
+                }
+            }
+        });
+        for (const auto& chunk : found) records.insert(records.end(), chunk.begin(), chunk.end());
+    }
+
+    // The varint that ends at position, read backwards: every byte of a
+    // varint but the last has its top bit set. Moves position to its start.
+    static bool varintBefore(const uint8_t* page, size_t begin, size_t& position, uint64_t& value) {
+        if (position <= begin || (page[position - 1] & 0x80)) return false;
+        size_t start = position - 1;
+        while (start > begin && position - start < 9 && (page[start - 1] & 0x80)) start--;
+        const uint8_t* p = page + start;
+        if (!varint(p, page + position, value) || p != page + position) return false;
+        position = start;
+        return true;
+    }
+
+    // A deleted SQLite row keeps its record header just before the key: the
+    // serial types of the key and the value, from which both lengths follow.
+    // The first four bytes of a freed cell are overwritten by the freeblock
+    // header, which can take the key's serial type with it; the key length
+    // then comes from the record name itself.
+    void staleSQLite(const uint8_t* page, uint64_t pageOffset, size_t begin, size_t end, wt_record_origin origin,
+                     std::vector<wt_record>& records) const {
+        findNames(page, begin, end, [&](size_t name) {
+            size_t position = name;
+            uint64_t valueType, keyType;
+            if (!varintBefore(page, begin, position, valueType) || valueType < 12 || (valueType & 1)) return;
+            size_t keyLength;
+            if (varintBefore(page, begin, position, keyType) && keyType >= 12 && !(keyType & 1)) {
+                keyLength = static_cast<size_t>((keyType - 12) / 2);
+            } else {
+                size_t nameLength = page[name];
+                const uint8_t* recordName = page + name + 1;
+                size_t pubkeyAt = name + 1 + nameLength;
+                if (record_layout::isNamed<record_layout::WalletDescriptorCryptedKey>(recordName, nameLength) ||
+                    record_layout::isNamed<record_layout::WalletDescriptorKey>(recordName, nameLength)) {
+                    pubkeyAt += record_layout::WalletDescriptorKey::Key::FIXED_SIZE;   // past the descriptor id
+                }
+                if (record_layout::isNamed<MasterKey>(recordName, nameLength)) {
+                    keyLength = 1 + nameLength + MasterKey::Key::FIXED_SIZE;
+                } else if (pubkeyAt < end) {
+                    keyLength = pubkeyAt + 1 + page[pubkeyAt] - name;
+                } else {
+                    return;
+                }
+            }
+            size_t valueLength = static_cast<size_t>((valueType - 12) / 2);
+            if (keyLength > end - name || valueLength > end - name - keyLength) return;
+            addPair(page, pageOffset, page + name, keyLength, page + name + keyLength, valueLength, records, origin);
+        });
+    }
+
+    // Pages sampled per candidate layout when a damaged header has to be
+    // guessed around
+    static constexpr size_t SALVAGE_SAMPLES = 4096;
+
+    enum PageState { PAGE_INTACT, PAGE_DAMAGED, PAGE_UNREADABLE };
+
+    static constexpr uint8_t SQLITE_INTERIOR_INDEX = 0x02;
+    static constexpr uint8_t SQLITE_LEAF_INDEX = 0x0a;
+
+    // A page that does not carry its own number is not a page of this file
+    // (or no longer one) and is unreadable; one that does but is not
+    // consistent is damaged. Free pages count as intact. The items of a
+    // damaged leaf are still read one by one, as BerkeleyDB's aggressive
+    // salvage does: a pair counts when both its items lie inside the page.
+    PageState salvageBerkeleyPage(const uint8_t* page, size_t pgno, std::vector<wt_record>& records) const {
+        if (pgno == 0) {
+            WalletFormat::Info meta = WalletFormat::sniffBerkeleyMeta(page);
+            return meta.kind != WalletFormat::UNKNOWN && meta.pageSize == info.pageSize ? PAGE_INTACT : PAGE_DAMAGED;
+        }
+        if (WalletFormat::read32(page + 8, info.bigEndian) != pgno) return PAGE_UNREADABLE;
+        uint8_t type = page[25];
+        switch (type) {
+            case P_INVALID:
+                return PAGE_INTACT;
+            case P_OVERFLOW:
+                // The free-space offset holds the length of the data
+                return BDB_PAGE_HEADER + WalletFormat::read16(page + 22, info.bigEndian) <= info.pageSize
+                           ? PAGE_INTACT : PAGE_DAMAGED;
+            case P_HASHMETA:
+            case P_BTREEMETA: {
+                uint32_t magic = WalletFormat::read32(page + 12, info.bigEndian);
+                return magic == WalletFormat::BDB_BTREE_MAGIC || magic == WalletFormat::BDB_HASH_MAGIC
+                           ? PAGE_INTACT : PAGE_DAMAGED;
+            }
+            case P_IBTREE:
+            case P_LBTREE:
+            case P_LDUP:
+            case P_HASH:
+            case P_HASH_UNSORTED:
+                if (type == P_LBTREE) berkeleyLeaf(page, uint64_t(pgno) * info.pageSize, records);
+                else if (type != P_IBTREE && type != P_LDUP) berkeleyHash(page, uint64_t(pgno) * info.pageSize, records);
+                return berkeleyIndexIntact(page, type) ? PAGE_INTACT : PAGE_DAMAGED;
+            default:
+                return PAGE_DAMAGED;
+        }
+    }
+
+    // Every index slot must point between the free-space offset and the end
+    // of the page, at an item of a known type that ends inside the page.
+    // Hash items are packed down from the end, each below the one before.
+    bool berkeleyIndexIntact(const uint8_t* page, uint8_t type) const {
+        const size_t pageSize = info.pageSize;
+        size_t entries = WalletFormat::read16(page + 20, info.bigEndian);
+        size_t freeOffset = WalletFormat::read16(page + 22, info.bigEndian);
+        if (BDB_PAGE_HEADER + 2 * entries > freeOffset || freeOffset > pageSize) return false;
+        if (type == P_LBTREE && entries % 2) return false;
+        bool hash = type == P_HASH || type == P_HASH_UNSORTED;
+        size_t previous = pageSize;
+        for (size_t i = 0; i < entries; i++) {
+            size_t offset = WalletFormat::read16(page + BDB_PAGE_HEADER + 2 * i, info.bigEndian);
+            if (offset < freeOffset || offset >= pageSize) return false;
+            if (hash) {
+                if (offset >= previous || page[offset] < H_KEYDATA || page[offset] > H_OFFDUP) return false;
+                previous = offset;
+                continue;
+            }
+            if (offset + (type == P_IBTREE ? BOVERFLOW_SIZE : 3) > pageSize) return false;
+            size_t length = WalletFormat::read16(page + offset, info.bigEndian);
+            size_t size;
+            if (type == P_IBTREE) {
+                size = BOVERFLOW_SIZE + length;
+            } else {
+                uint8_t itemType = page[offset + 2] & ~B_DELETE;
+                if (itemType == B_KEYDATA) size = 3 + length;
+                else if (itemType == B_DUPLICATE || itemType == B_OVERFLOW) size = BOVERFLOW_SIZE;
+                else return false;
+            }
+            if (offset + size > pageSize) return false;
+        }
+        return true;
+    }
+
+    // The b-tree page header and cell pointer array: a known page type, the
+    // cells between the end of the pointers and the usable end of the page
+    static bool sqliteBtreeIntact(const uint8_t* page, size_t header, size_t pageSize, size_t usable) {
+        uint8_t type = page[header];
+        if (type != SQLITE_INTERIOR_INDEX && type != SQLITE_INTERIOR_TABLE && type != SQLITE_LEAF_INDEX &&
+            type != SQLITE_LEAF_TABLE) return false;
+        bool leaf = type == SQLITE_LEAF_INDEX || type == SQLITE_LEAF_TABLE;
+        size_t cells = (size_t(page[header + 3]) << 8) | page[header + 4];
+        size_t contentStart = (size_t(page[header + 5]) << 8) | page[header + 6];
+        if (contentStart == 0) contentStart = 65536;
+        size_t pointers = header + (leaf ? 8 : 12);
+        if (usable > pageSize || pointers + 2 * cells > contentStart || (cells && contentStart >= usable)) return false;
+        for (size_t i = 0; i < cells; i++) {
+            size_t offset = (size_t(page[pointers + 2 * i]) << 8) | page[pointers + 2 * i + 1];
+            if (offset < contentStart || offset >= usable) return false;
+        }
+        return true;
+    }
+
+    // SQLite pages carry no page number. A b-tree page is intact when its
+    // header, pointers and (on table leaves) cells hold up; without the
+    // schema, any row of two blobs on a table leaf is a candidate, and the
+    // cells of a damaged leaf are still read one by one. Overflow and
+    // freelist pages start with the number of another page (or 0 at the end
+    // of a chain, and freed pages may be all zero); anything else is
+    // unreadable.
+    PageState salvageSQLitePage(const uint8_t* page, uint64_t pageOffset, size_t pages,
+                                std::vector<wt_record>& records) const {
+        const size_t usable = info.usableSize;
+        const size_t header = pageOffset == 0 ? 100 : 0;
+        uint8_t type = page[header];
+        if (type != SQLITE_INTERIOR_INDEX && type != SQLITE_INTERIOR_TABLE && type != SQLITE_LEAF_INDEX &&
+            type != SQLITE_LEAF_TABLE) {
+            return walletcrypto_detail::readBE32(page) <= pages ? PAGE_INTACT : PAGE_UNREADABLE;
+        }
+        bool intact = sqliteBtreeIntact(page, header, info.pageSize, usable);
+        if (type != SQLITE_LEAF_TABLE) return intact ? PAGE_INTACT : PAGE_DAMAGED;
+
+        const size_t maxLocal = usable - 35;
+        const size_t pointers = header + 8;
+        size_t cells = std::min((size_t(page[header + 3]) << 8) | page[header + 4], (usable - pointers) / 2);
+        std::vector<Column> row;
+        for (size_t i = 0; i < cells; i++) {
+            size_t offset = (size_t(page[pointers + 2 * i]) << 8) | page[pointers + 2 * i + 1];
+            if (offset < pointers + 2 * cells || offset >= usable) {
+                intact = false;
+                continue;
+            }
+            const uint8_t* cell = page + offset;
+            const uint8_t* end = page + usable;
+            uint64_t payloadLength, rowid;
+            if (!varint(cell, end, payloadLength) || !varint(cell, end, rowid) ||
+                (payloadLength <= maxLocal && payloadLength > static_cast<uint64_t>(end - cell))) {
+                intact = false;
+                continue;
+            }
+            if (payloadLength > maxLocal) continue;
+            if (!columns(cell, static_cast<size_t>(payloadLength), row) || row.size() < 2) continue;
+            if (row[0].serialType < 12 || (row[0].serialType & 1) || row[1].serialType < 12 || (row[1].serialType & 1)) {
+                continue;
+            }
+            addPair(page, pageOffset, row[0].bytes, row[0].length, row[1].bytes, row[1].length, records);
+        }
+        return intact ? PAGE_INTACT : PAGE_DAMAGED;
+    }
+};
+
+}  // namespace
+
+struct wt_wallet : ImageView {
+    std::string label;
+    void* mapping = nullptr;
+    std::vector<uint8_t> contents;
+
+    bool haveMasterRecord = false;
+    uint64_t masterOffset = 0;
+    wt_record_origin masterOrigin = WT_ORIGIN_LIVE;
+    uint8_t masterRecord[WT_MKEY_RECORD_SIZE];
+
+    std::unique_ptr<SecureArena> arena;
+    uint8_t* masterKey = nullptr;
+    Aes256* cipher = nullptr;   // placement-new'd into the arena
+
+    bool indexed = false;
+    std::vector<uint64_t> recordOffsets;   // tag offsets in file order, once indexed
+
+    bool prepared = false;
+    wt_parser parser = WT_PARSER_AUTO;
+    WalletFormat::Info format;
+    std::unique_ptr<WalOverlay> wal;       // SQLite only, once a -wal file is attached and has a commit
+    std::vector<std::string> logFiles;     // BerkeleyDB environment logs to replay, oldest first
+    std::unique_ptr<BerkeleyLogReplay> replay;
+    bool parsed = false;
+    std::vector<wt_record> parsedRecords;  // in file order, when a record parser read the file
+    JoinedValues joinedValues;             // values of parsedRecords gathered from several overflow pages
+    wt_salvage_stats salvageStats = {};    // WT_PARSER_SALVAGE only
+
+    ~wt_wallet() {
+        lock();
+        #ifndef _WIN32
+            if (mapping) munmap(mapping, size);
+        #endif
+    }
+
+    void lock() {
+        if (cipher) cipher->~Aes256();
+        cipher = nullptr;
+        masterKey = nullptr;
+        arena.reset();
+    }
+
+    // Identifies the file once and lets the matching record parser read it.
+    // Files it cannot vouch for (unknown formats, images whose size does not
+    // match their header, such as several wallets concatenated) are scanned,
+    // unless salvage was asked for.
+    void prepare() {
+        if (prepared) return;
+        prepared = true;
+        format = WalletFormat::sniff(data, size);
+        if (parser == WT_PARSER_SALVAGE) {
+            WalletFormat::Info layout = RecordParser::salvageLayout(*this, format);
+            RecordParser(*this, layout, nullptr, nullptr, joinedValues, parser).salvage(parsedRecords, salvageStats);
+            parsed = true;
+            return;
+        }
+        if (wal && (format.kind != WalletFormat::SQLITE || !wal->load(format.pageSize))) wal.reset();
+        bool structured = parser == WT_PARSER_AUTO || parser == WT_PARSER_FORENSIC;
+        if (!logFiles.empty() && structured && format.kind == WalletFormat::BERKELEY_DB) {
+            replay = std::make_unique<BerkeleyLogReplay>(data, size, format);
+            if (!replay->replay(logFiles)) replay.reset();
+        }
+        if (structured && WalletFormat::isDatabase(format.kind)) {
+            parsed = RecordParser(*this, format, wal.get(), replay.get(), joinedValues, parser).parse(parsedRecords);
+            if (parsed) return;
+            parsedRecords.clear();
+        }
+        buildIndex();
+    }
+
+    // Scans large images once, in parallel chunks, and keeps the tag offsets
+    void buildIndex() {
+        if (indexed || size < PARALLEL_SCAN_MIN) return;
+        size_t chunks = (size + SCAN_CHUNK - 1) / SCAN_CHUNK;
+        std::vector<std::vector<uint64_t>> found(chunks);
+        parallelFor(chunks, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; c++) {
+                size_t begin = c * SCAN_CHUNK;
+                size_t end = std::min(size, begin + SCAN_CHUNK);
+                #ifndef _WIN32
+                    if (mapping) madvise(const_cast<uint8_t*>(data) + begin, end - begin, MADV_WILLNEED);
+                #endif
+                size_t position = begin;
+                wt_record record;
+                while (nextRecord(position, record, end)) found[c].push_back(record.offset);
+            }
+        });
+        size_t total = 0;
+        for (const auto& offsets : found) total += offsets.size();
+        recordOffsets.reserve(total);
+        for (const auto& offsets : found) recordOffsets.insert(recordOffsets.end(), offsets.begin(), offsets.end());
+        indexed = true;
+    }
+
+    void unlockWith(const uint8_t key[WT_SECRET_SIZE]) {
+        lock();
+        arena = std::make_unique<SecureArena>(4096);
+        masterKey = arena->allocate(WT_SECRET_SIZE);
+        memcpy(masterKey, key, WT_SECRET_SIZE);
+        cipher = new (arena->allocate(sizeof(Aes256), alignof(Aes256))) Aes256(masterKey);
+    }
+};
+
+// Forward-only scan of a stream through a fixed-size window. A tag is only
+// decoded once the bytes its record can reach have arrived, up to an
+// overflow page OVERFLOW_REACH past it; afterwards the window slides,
+// keeping as much behind. Offsets are window-relative while scanning, and
+// since every tag past the first slide sits at least LOOKBEHIND bytes in,
+// the scanner's bounds checks give the same answers they would give on the
+// whole stream, except for an overflow page further from its record.
+struct wt_stream {
+    static constexpr size_t WINDOW_SIZE = 1024 * 1024;
+    // How far either side of its record the overflow page of a key or wkey
+    // value is looked for
+    static constexpr size_t OVERFLOW_REACH = 256 * 1024;
+    static constexpr size_t LOOKBEHIND = std::max({MKEY_WINDOW_BEFORE, PLAIN_KEY_WINDOW_BEFORE, OVERFLOW_REACH});
+    static constexpr size_t LOOKAHEAD = std::max<size_t>(5 + Secp256k1::UNCOMPRESSED_SIZE, OVERFLOW_REACH);
+
+    std::vector<uint8_t> window;
+    uint64_t base = 0;       // stream offset of window[0]
+    size_t position = 0;     // next window byte to scan
+    bool stopped = false;
+    bool finished = false;
+
+    void scan(size_t limit, wt_record_callback callback, void* user) {
+        ImageView view;
+        view.data = window.data();
+        view.size = window.size();
+        view.origin = base;
+        wt_record record;
+        while (!stopped && view.nextRecord(position, record, limit)) {
+            record.offset += base;
+            if (callback(&record, user)) stopped = true;
+        }
+    }
+
+    void slide() {
+        size_t keepFrom = std::min(position, window.size());
+        keepFrom -= std::min(keepFrom, LOOKBEHIND);
+        window.erase(window.begin(), window.begin() + static_cast<std::ptrdiff_t>(keepFrom));
+        base += keepFrom;
+        position -= keepFrom;
+    }
+};
+
+struct wt_cursor {
+    wt_wallet* wallet;
+    size_t position = 0;   // byte position, or the next parsed record or index entry
+
+    bool next(wt_record& record) {
+        if (wallet->parsed) {
+            if (position >= wallet->parsedRecords.size()) return false;
+            record = wallet->parsedRecords[position++];
+            return true;
+        }
+        if (!wallet->indexed) return wallet->nextRecord(position, record);
+        while (position < wallet->recordOffsets.size()) {
+            if (wallet->recordAt(wallet->recordOffsets[position++], record)) return true;
+        }
+        return false;
+    }
+};
+
+extern "C" {
+
+uint32_t wt_abi_version(void) { return WT_ABI_VERSION; }
+
+const char* wt_last_error(void) { return lastError.c_str(); }
+
+wt_status wt_open_file(const char* path, wt_wallet** wallet) {
+    return guarded([&] {
+        if (!path || !wallet) throw WalletError(WT_ERR_ARGUMENT, "wt_open_file: NULL argument");
+        *wallet = nullptr;
+        auto w = std::make_unique<wt_wallet>();
+        w->label = path;
+        #ifdef _WIN32
+            std::ifstream in(path, std::ios::binary);
+            if (!in) throw WalletError(WT_ERR_IO, std::string("Can't open file ") + path);
+            w->contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            w->data = w->contents.data();
+            w->size = w->contents.size();
+        #else
+            int fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) throw WalletError(WT_ERR_IO, std::string("Can't open file ") + path);
+            struct stat info;
+            if (fstat(fd, &info) < 0) {
+                close(fd);
+                throw WalletError(WT_ERR_IO, std::string("Can't stat file ") + path);
+            }
+            w->size = static_cast<size_t>(info.st_size);
+            if (w->size) {
+                void* mapping = mmap(nullptr, w->size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapping == MAP_FAILED) {
+                    close(fd);
+                    throw WalletError(WT_ERR_IO, std::string("Can't map file ") + path);
+                }
+                madvise(mapping, w->size, MADV_SEQUENTIAL);
+                w->mapping = mapping;
+                w->data = static_cast<const uint8_t*>(mapping);
+            }
+            close(fd);
+        #endif
+        // A live SQLite wallet keeps its latest commits in the -wal file
+        std::vector<uint8_t> wal;
+        if (readFile((std::string(path) + "-wal").c_str(), wal)) {
+            w->wal = std::make_unique<WalOverlay>();
+            w->wal->contents = std::move(wal);
+        }
+        *wallet = w.release();
+    });
+}
+
+wt_status wt_attach_bdb_logs(wt_wallet* wallet, const char* directory) {
+    return guarded([&] {
+        if (!wallet || !directory) throw WalletError(WT_ERR_ARGUMENT, "wt_attach_bdb_logs: NULL argument");
+        if (wallet->prepared) throw WalletError(WT_ERR_ARGUMENT, "wt_attach_bdb_logs: records were already read");
+        auto files = BerkeleyLogReplay::logFiles(directory);
+        if (files.empty()) throw WalletError(WT_ERR_IO, std::string("No BerkeleyDB log files in ") + directory);
+        wallet->logFiles = std::move(files);
+    });
+}
+
+wt_status wt_attach_wal_file(wt_wallet* wallet, const char* path) {
+    return guarded([&] {
+        if (!wallet || !path) throw WalletError(WT_ERR_ARGUMENT, "wt_attach_wal_file: NULL argument");
+        if (wallet->prepared) throw WalletError(WT_ERR_ARGUMENT, "wt_attach_wal_file: records were already read");
+        auto wal = std::make_unique<WalOverlay>();
+        if (!readFile(path, wal->contents)) throw WalletError(WT_ERR_IO, std::string("Can't read file ") + path);
+        wallet->wal = std::move(wal);
+    });
+}
+
+wt_status wt_open_buffer(const void* data, size_t size, wt_wallet** wallet) {
+    return wt_open_named_buffer(data, size, "<buffer>", wallet);
+}
+
+wt_status wt_open_named_buffer(const void* data, size_t size, const char* name, wt_wallet** wallet) {
+    return guarded([&] {
+        if (!wallet || !name || (!data && size)) throw WalletError(WT_ERR_ARGUMENT, "wt_open_named_buffer: NULL argument");
+        auto w = std::make_unique<wt_wallet>();
+        w->label = name;
+        w->data = static_cast<const uint8_t*>(data);
+        w->size = size;
+        *wallet = w.release();
+    });
+}
+
+void wt_close(wt_wallet* wallet) { delete wallet; }
+
+wt_format wt_wallet_format(wt_wallet* wallet) {
+    if (!wallet) return WT_FORMAT_UNKNOWN;
+    wallet->prepare();
+    return static_cast<wt_format>(wallet->format.kind);
+}
+
+wt_status wt_set_parser(wt_wallet* wallet, wt_parser parser) {
+    return guarded([&] {
+        if (!wallet) throw WalletError(WT_ERR_ARGUMENT, "wt_set_parser: NULL argument");
+        if (parser != WT_PARSER_AUTO && parser != WT_PARSER_SCAN && parser != WT_PARSER_SALVAGE &&
+            parser != WT_PARSER_FORENSIC) {
+            throw WalletError(WT_ERR_ARGUMENT, "wt_set_parser: unknown parser");
+        }
+        if (wallet->prepared) throw WalletError(WT_ERR_ARGUMENT, "wt_set_parser: records were already read");
+        wallet->parser = parser;
+    });
+}
+
+wt_status wt_salvage_report(wt_wallet* wallet, wt_salvage_stats* stats) {
+    return guarded([&] {
+        if (!wallet || !stats) throw WalletError(WT_ERR_ARGUMENT, "wt_salvage_report: NULL argument");
+        if (wallet->parser != WT_PARSER_SALVAGE) {
+            throw WalletError(WT_ERR_ARGUMENT, "wt_salvage_report: the wallet is not read with WT_PARSER_SALVAGE");
+        }
+        wallet->prepare();
+        *stats = wallet->salvageStats;
+    });
+}
+
+wt_status wt_foreach_record(wt_wallet* wallet, wt_record_callback callback, void* user) {
+    return guarded([&] {
+        if (!wallet || !callback) throw WalletError(WT_ERR_ARGUMENT, "wt_foreach_record: NULL argument");
+        wallet->prepare();
+        wt_cursor cursor{wallet};
+        wt_record record;
+        while (cursor.next(record)) {
+            if (callback(&record, user)) break;
+        }
+    });
+}
+
+wt_status wt_estimate_records(wt_wallet* wallet, uint64_t* count) {
+    return guarded([&] {
+        if (!wallet || !count) throw WalletError(WT_ERR_ARGUMENT, "wt_estimate_records: NULL argument");
+        wallet->prepare();
+        if (wallet->parsed) *count = wallet->parsedRecords.size();
+        else if (wallet->indexed) *count = wallet->recordOffsets.size();
+        else *count = wallet->size / (CKEY_WINDOW_BEFORE + 4 + WT_COMPRESSED_PUBKEY_SIZE);
+    });
+}
+
+wt_status wt_cursor_open(wt_wallet* wallet, wt_cursor** cursor) {
+    return guarded([&] {
+        if (!wallet || !cursor) throw WalletError(WT_ERR_ARGUMENT, "wt_cursor_open: NULL argument");
+        wallet->prepare();
+        *cursor = new wt_cursor{wallet};
+    });
+}
+
+int wt_cursor_next(wt_cursor* cursor, wt_record* record) {
+    if (!cursor || !record) return 0;
+    return cursor->next(*record) ? 1 : 0;
+}
+
+void wt_cursor_close(wt_cursor* cursor) { delete cursor; }
+
+wt_status wt_stream_open(wt_stream** stream) {
+    return guarded([&] {
+        if (!stream) throw WalletError(WT_ERR_ARGUMENT, "wt_stream_open: NULL argument");
+        auto s = std::make_unique<wt_stream>();
+        s->window.reserve(wt_stream::WINDOW_SIZE);
+        *stream = s.release();
+    });
+}
+
+wt_status wt_stream_feed(wt_stream* stream, const void* data, size_t size, wt_record_callback callback, void* user) {
+    return guarded([&] {
+        if (!stream || !callback || (!data && size)) throw WalletError(WT_ERR_ARGUMENT, "wt_stream_feed: NULL argument");
+        if (stream->finished) throw WalletError(WT_ERR_ARGUMENT, "wt_stream_feed: stream already finished");
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        while (size && !stream->stopped) {
+            size_t take = std::min(size, wt_stream::WINDOW_SIZE - stream->window.size());
+            stream->window.insert(stream->window.end(), bytes, bytes + take);
+            bytes += take;
+            size -= take;
+            if (stream->window.size() > wt_stream::LOOKAHEAD) {
+                stream->scan(stream->window.size() - wt_stream::LOOKAHEAD, callback, user);
+            }
+            if (stream->window.size() == wt_stream::WINDOW_SIZE) stream->slide();
+        }
+    });
+}
+
+wt_status wt_stream_finish(wt_stream* stream, wt_record_callback callback, void* user) {
+    return guarded([&] {
+        if (!stream || !callback) throw WalletError(WT_ERR_ARGUMENT, "wt_stream_finish: NULL argument");
+        if (!stream->finished) stream->scan(SIZE_MAX, callback, user);
+        stream->finished = true;
+    });
+}
+
+void wt_stream_close(wt_stream* stream) { delete stream; }
+
+wt_status wt_find_master_key(wt_wallet* wallet, wt_record* record) {
+    return guarded([&] {
+        if (!wallet || !record) throw WalletError(WT_ERR_ARGUMENT, "wt_find_master_key: NULL argument");
+        if (!wallet->haveMasterRecord) {
+            wallet->prepare();
+            wt_cursor cursor{wallet};
+            wt_record found;
+            while (cursor.next(found)) {
+                if (found.type != WT_RECORD_MKEY) continue;
+                // A stale master key only stands in until a live one turns up
+                bool stale = found.origin != WT_ORIGIN_LIVE && found.origin != WT_ORIGIN_SCAN;
+                if (wallet->haveMasterRecord && stale) continue;
+                memcpy(wallet->masterRecord, found.value, WT_MKEY_RECORD_SIZE);
+                wallet->masterOffset = found.offset;
+                wallet->masterOrigin = found.origin;
+                wallet->haveMasterRecord = true;
+                if (!stale) break;
+            }
+        }
+        if (!wallet->haveMasterRecord) {
+            throw WalletError(WT_ERR_NO_MASTER_KEY, "There is no Master Key in " + wallet->label);
+        }
+        *record = makeRecord(WT_RECORD_MKEY, wallet->masterOffset, wallet->masterRecord, WT_MKEY_RECORD_SIZE,
+                             wallet->masterOrigin);
+    });
+}
+
+wt_status wt_set_master_key_record(wt_wallet* wallet, const uint8_t record[WT_MKEY_RECORD_SIZE]) {
+    return guarded([&] {
+        if (!wallet || !record) throw WalletError(WT_ERR_ARGUMENT, "wt_set_master_key_record: NULL argument");
+        memcpy(wallet->masterRecord, record, WT_MKEY_RECORD_SIZE);
+        wallet->masterOffset = 0;
+        wallet->masterOrigin = WT_ORIGIN_LIVE;
+        wallet->haveMasterRecord = true;
+    });
+}
+
+wt_status wt_unlock(wt_wallet* wallet, const char* passphrase, size_t passphrase_len) {
+    wt_record master;
+    wt_status status = wt_find_master_key(wallet, &master);
+    if (status != WT_OK) return status;
+    return guarded([&] {
+        if (!passphrase) throw WalletError(WT_ERR_ARGUMENT, "wt_unlock: NULL passphrase");
+        // The record starts at the crypted key of a CMasterKey
+        using Fields = MasterKey::Value;
+        const uint8_t* record = master.value;
+        const uint8_t* cryptedKey = Fields::get<MasterKey::CRYPTED_KEY, MasterKey::CRYPTED_KEY>(record);
+        const uint8_t* salt = Fields::get<MasterKey::SALT, MasterKey::CRYPTED_KEY>(record);
+        uint32_t method = Fields::get<MasterKey::DERIVATION_METHOD, MasterKey::CRYPTED_KEY>(record);
+        uint32_t iterations = Fields::get<MasterKey::DERIVE_ITERATIONS, MasterKey::CRYPTED_KEY>(record);
+        if (salt[-1] != Fields::Field<MasterKey::SALT>::LENGTH || method != 0) {
+            throw WalletError(WT_ERR_UNSUPPORTED, "Unsupported master key derivation in " + wallet->label);
+        }
+        SecureArena scratch(4096);
+        uint8_t* key = scratch.allocate(Aes256::KEY_SIZE);
+        uint8_t* iv = scratch.allocate(Aes256::BLOCK_SIZE);
+        uint8_t* plain = scratch.allocate(WalletCrypto::CRYPTED_KEY_SIZE);
+        WalletCrypto::deriveKey(reinterpret_cast<const uint8_t*>(passphrase), passphrase_len,
+                                salt, Fields::Field<MasterKey::SALT>::LENGTH, iterations, key, iv);
+        if (!WalletCrypto::decrypt32(key, iv, cryptedKey, plain)) {
+            throw WalletError(WT_ERR_WRONG_PASSPHRASE, "Wrong passphrase for " + wallet->label);
+        }
+        wallet->unlockWith(plain);
+    });
+}
+
+wt_status wt_unlock_with_master_key(wt_wallet* wallet, const uint8_t key[WT_SECRET_SIZE]) {
+    return guarded([&] {
+        if (!wallet || !key) throw WalletError(WT_ERR_ARGUMENT, "wt_unlock_with_master_key: NULL argument");
+        wallet->unlockWith(key);
+    });
+}
+
+wt_status wt_export_master_key(const wt_wallet* wallet, uint8_t key[WT_SECRET_SIZE]) {
+    return guarded([&] {
+        if (!wallet || !key) throw WalletError(WT_ERR_ARGUMENT, "wt_export_master_key: NULL argument");
+        if (!wallet->masterKey) throw WalletError(WT_ERR_LOCKED, wallet->label + " is locked");
+        memcpy(key, wallet->masterKey, WT_SECRET_SIZE);
+    });
+}
+
+void wt_lock(wt_wallet* wallet) {
+    if (wallet) wallet->lock();
+}
+
+int wt_is_unlocked(const wt_wallet* wallet) { return wallet && wallet->masterKey ? 1 : 0; }
+
+wt_status wt_decrypt_key(wt_wallet* wallet, const wt_record* ckey, uint8_t secret[WT_SECRET_SIZE]) {
+    return guarded([&] {
+        if (!wallet || !ckey || !secret) throw WalletError(WT_ERR_ARGUMENT, "wt_decrypt_key: NULL argument");
+        if (!wallet->cipher) throw WalletError(WT_ERR_LOCKED, wallet->label + " is locked");
+        if ((ckey->type != WT_RECORD_CKEY && ckey->type != WT_RECORD_DESCRIPTOR_CKEY) || !ckey->pubkey ||
+            ckey->value_len != WT_CRYPTED_KEY_SIZE) {
+            throw WalletError(WT_ERR_FORMAT, "Not a ckey record");
+        }
+        uint8_t iv[Aes256::BLOCK_SIZE];
+        uint8_t plain[WalletCrypto::CRYPTED_KEY_SIZE];
+        WalletCrypto::keyIV(ckey->pubkey, ckey->pubkey_len, iv);
+        bool valid = WalletCrypto::decrypt32(*wallet->cipher, iv, ckey->value, plain);
+        if (valid) memcpy(secret, plain, WT_SECRET_SIZE);
+        SecureArena::wipe(plain, sizeof(plain));
+        if (!valid) throw WalletError(WT_ERR_DECRYPT, "Undecryptable ckey");
+    });
+}
+
+wt_status wt_decode_key(const wt_record* key, uint8_t secret[WT_SECRET_SIZE]) {
+    return guarded([&] {
+        if (!key || !secret) throw WalletError(WT_ERR_ARGUMENT, "wt_decode_key: NULL argument");
+        if ((key->type != WT_RECORD_KEY && key->type != WT_RECORD_WKEY && key->type != WT_RECORD_DESCRIPTOR_KEY) ||
+            !key->pubkey) {
+            throw WalletError(WT_ERR_FORMAT, "Not an unencrypted key record");
+        }
+        const uint8_t* pubkey;
+        size_t pubkeyLength;
+        if (!readDerKey(key->value, key->value_len, secret, pubkey, pubkeyLength)) {
+            SecureArena::wipe(secret, WT_SECRET_SIZE);
+            throw WalletError(WT_ERR_FORMAT, "Malformed DER private key");
+        }
+        // A pubkey in the DER says nothing about a damaged secret, so the
+        // secret's own pubkey is always derived
+        bool matches = !pubkey || (pubkeyLength == key->pubkey_len && memcmp(pubkey, key->pubkey, pubkeyLength) == 0);
+        if (matches) {
+            uint8_t derived[Secp256k1::UNCOMPRESSED_SIZE];
+            size_t length = Secp256k1::derivePublicKey(secret, key->pubkey_len == Secp256k1::COMPRESSED_SIZE, derived);
+            matches = length == key->pubkey_len && memcmp(derived, key->pubkey, length) == 0;
+        }
+        if (!matches) {
+            SecureArena::wipe(secret, WT_SECRET_SIZE);
+            throw WalletError(WT_ERR_MISMATCH, "Key does not match its public key");
+        }
+    });
+}
+
+wt_status wt_verify_key(const uint8_t secret[WT_SECRET_SIZE], const uint8_t* pubkey, size_t pubkey_len) {
+    return guarded([&] {
+        if (!secret || !pubkey) throw WalletError(WT_ERR_ARGUMENT, "wt_verify_key: NULL argument");
+        if (pubkey_len != Secp256k1::COMPRESSED_SIZE && pubkey_len != Secp256k1::UNCOMPRESSED_SIZE) {
+            throw WalletError(WT_ERR_ARGUMENT, "Public keys are 33 or 65 bytes");
+        }
+        uint8_t derived[Secp256k1::UNCOMPRESSED_SIZE];
+        size_t length = Secp256k1::derivePublicKey(secret, pubkey_len == Secp256k1::COMPRESSED_SIZE, derived);
+        if (length != pubkey_len || memcmp(derived, pubkey, pubkey_len) != 0) {
+            throw WalletError(WT_ERR_MISMATCH, "Key does not match its public key");
+        }
+    });
+}
+
+wt_status wt_export_wif(const uint8_t secret[WT_SECRET_SIZE], int compressed, char* out, size_t capacity) {
+    return guarded([&] {
+        if (!secret || !out) throw WalletError(WT_ERR_ARGUMENT, "wt_export_wif: NULL argument");
+        if (!WalletCrypto::privateKeyToWIF(secret, compressed != 0, out, capacity)) {
+            throw WalletError(WT_ERR_BUFFER, "WIF buffer too small");
+        }
+    });
+}
+
+wt_status wt_export_address(const uint8_t* pubkey, size_t pubkey_len, char* out, size_t capacity) {
+    return guarded([&] {
+        if (!pubkey || !out) throw WalletError(WT_ERR_ARGUMENT, "wt_export_address: NULL argument");
+        uint8_t hash[WT_HASH160_SIZE];
+        Ripemd160::hash160(pubkey, pubkey_len, hash);
+        encodeAddress(hash, out, capacity);
+    });
+}
+
+wt_status wt_export_xpub(const uint8_t key[WT_EXTENDED_KEY_SIZE], char* out, size_t capacity) {
+    return guarded([&] {
+        if (!key || !out) throw WalletError(WT_ERR_ARGUMENT, "wt_export_xpub: NULL argument");
+        static const uint8_t version[] = {0x04, 0x88, 0xb2, 0x1e};
+        uint8_t payload[sizeof(version) + WT_EXTENDED_KEY_SIZE];
+        memcpy(payload, version, sizeof(version));
+        memcpy(payload + sizeof(version), key, WT_EXTENDED_KEY_SIZE);
+        if (!Base58::encodeCheck(payload, sizeof(payload), out, capacity)) {
+            throw WalletError(WT_ERR_BUFFER, "xpub buffer too small");
+        }
+    });
+}
+
+wt_status wt_hash160(const uint8_t* pubkey, size_t pubkey_len, uint8_t hash[WT_HASH160_SIZE]) {
+    return guarded([&] {
+        if (!pubkey || !hash) throw WalletError(WT_ERR_ARGUMENT, "wt_hash160: NULL argument");
+        Ripemd160::hash160(pubkey, pubkey_len, hash);
+    });
+}
+
+wt_status wt_export_hash160_address(const uint8_t hash[WT_HASH160_SIZE], char* out, size_t capacity) {
+    return guarded([&] {
+        if (!hash || !out) throw WalletError(WT_ERR_ARGUMENT, "wt_export_hash160_address: NULL argument");
+        encodeAddress(hash, out, capacity);
+    });
+}
+
+}  // extern "C"
@@ -0,0 +1,263 @@
+/* MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+ * See LICENSE for details.
+ *
+ * libwallettool: the wallet scanning, unlocking and key export used by
+ * wallet-tool, behind a stable C ABI so it can be called in-process.
+ *
+ * Conventions
+ *  - Every function returning wt_status reports failures through it and
+ *    leaves a human-readable message in wt_last_error() for the calling
+ *    thread. Nothing throws across the boundary.
+ *  - A wt_wallet may be used by one thread at a time; separate wallets can
+ *    be used from separate threads concurrently. The exception is
+ *    wt_decrypt_key(), which only reads an unlocked wallet and may be
+ *    called from several threads at once.
+ *  - Pointers inside a wt_record point into the wallet image and stay valid
+ *    until wt_close().
+ *  - The master key is kept in page-locked memory and wiped by wt_lock()
+ *    and wt_close(). Secrets handed back to the caller are the caller's to
+ *    protect and wipe.
+ */
+
+#ifndef LIBWALLETTOOL_H
+#define LIBWALLETTOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  define WT_API __declspec(dllexport)
+#elif defined(__GNUC__)
+#  define WT_API __attribute__((visibility("default")))
+#else
+#  define WT_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped on any incompatible change to the functions or structs below */
+#define WT_ABI_VERSION 6
+
+#define WT_MKEY_RECORD_SIZE       65  /* CMasterKey: crypted key, salt, method, iterations */
+#define WT_CRYPTED_KEY_SIZE       48
+#define WT_SECRET_SIZE            32
+#define WT_COMPRESSED_PUBKEY_SIZE 33
+#define WT_WIF_SIZE               53  /* longest WIF plus terminator */
+#define WT_ADDRESS_SIZE           36  /* longest Base58 P2PKH address plus terminator */
+#define WT_HASH160_SIZE           20  /* RIPEMD-160 of SHA-256 of a pubkey */
+#define WT_DESCRIPTOR_ID_SIZE     32
+#define WT_EXTENDED_KEY_SIZE      74  /* BIP32 serialization without the version */
+#define WT_XPUB_SIZE             112  /* Base58 xpub plus terminator */
+#define WT_DER_KEY_MAX_SIZE      279  /* longest DER private key (CPrivKey) the tag scan reports */
+
+typedef enum wt_status {
+    WT_OK = 0,
+    WT_ERR_ARGUMENT,          /* NULL handle, bad length, ... */
+    WT_ERR_IO,                /* the wallet file could not be opened or mapped */
+    WT_ERR_NO_MASTER_KEY,     /* the wallet has no mkey record */
+    WT_ERR_UNSUPPORTED,       /* unknown master key derivation method */
+    WT_ERR_WRONG_PASSPHRASE,
+    WT_ERR_LOCKED,            /* decryption needs wt_unlock() first */
+    WT_ERR_FORMAT,            /* the record is not a usable ckey */
+    WT_ERR_DECRYPT,           /* the ckey failed the padding check */
+    WT_ERR_MISMATCH,          /* the secret does not derive the public key */
+    WT_ERR_BUFFER,            /* the output buffer is too small */
+    WT_ERR_INTERNAL
+} wt_status;
+
+typedef enum wt_record_type {
+    WT_RECORD_MKEY = 1,
+    WT_RECORD_CKEY = 2,
+    WT_RECORD_KEY = 3,        /* unencrypted key */
+    WT_RECORD_KEYMETA = 4,    /* key metadata; only reported by WT_PARSER_SALVAGE */
+    WT_RECORD_WKEY = 5,       /* unencrypted key of a 0.3-era wallet */
+    /* Descriptor wallets; not reported by the tag scan */
+    WT_RECORD_DESCRIPTOR = 6,       /* a descriptor and its range */
+    WT_RECORD_DESCRIPTOR_CKEY = 7,  /* encrypted descriptor key; decrypted as a ckey is */
+    WT_RECORD_DESCRIPTOR_KEY = 8,   /* unencrypted descriptor key; decoded as a key is */
+    WT_RECORD_DESCRIPTOR_XPUB = 9,  /* the cached xpub of a descriptor's key expression */
+    WT_RECORD_HDCHAIN = 10          /* the seed id and counters of a legacy HD wallet; not reported by the tag scan */
+} wt_record_type;
+
+/* Where a record was found. Only WT_PARSER_FORENSIC reports stale records
+ * (every origin after WT_ORIGIN_LIVE but WT_ORIGIN_SCAN). */
+typedef enum wt_record_origin {
+    WT_ORIGIN_LIVE = 0,       /* an item of the database as it stands */
+    WT_ORIGIN_SCAN,           /* found by the tag scan; live or stale is unknown */
+    WT_ORIGIN_DELETED,        /* stale: an item marked deleted but still on its page */
+    WT_ORIGIN_SLACK,          /* stale: in the unused space of a page in use */
+    WT_ORIGIN_FREE_PAGE       /* stale: on a free page or one that is no longer part of the database */
+} wt_record_origin;
+
+/* Callers allocate records (wt_cursor_next, wt_find_master_key), so the
+ * struct has reserved slots: a field added later takes one of them and the
+ * size and layout of the others stay as they are. Reserved slots are NULL. */
+typedef struct wt_record {
+    wt_record_type type;
+    uint64_t offset;          /* offset of the record's name tag ("mkey", "ckey", ...) in the image */
+    const uint8_t* value;     /* mkey: WT_MKEY_RECORD_SIZE bytes; ckey, descriptor ckey: WT_CRYPTED_KEY_SIZE
+                                 bytes; key, wkey, descriptor key: the DER private key; keymeta: the
+                                 serialized CKeyMetadata; descriptor: the serialized WalletDescriptor
+                                 (descriptor string, creation time, next index, range start and end);
+                                 descriptor xpub: WT_EXTENDED_KEY_SIZE bytes; hdchain: the serialized
+                                 CHDChain (version, external counter, seed id, internal counter) */
+    size_t value_len;
+    const uint8_t* pubkey;    /* keys and keymeta; NULL when the length byte is not 33 or 65 */
+    size_t pubkey_len;
+    wt_record_origin origin;
+    const uint8_t* descriptor_id;  /* descriptor records: WT_DESCRIPTOR_ID_SIZE bytes; NULL otherwise */
+    const void* reserved[6];
+} wt_record;
+
+/* What wt_wallet_format() found at the start of an image */
+typedef enum wt_format {
+    WT_FORMAT_UNKNOWN = 0,
+    WT_FORMAT_BERKELEY_DB,        /* btree, as Bitcoin Core writes */
+    WT_FORMAT_BERKELEY_DB_HASH,
+    WT_FORMAT_BERKELEY_DB_LOG,
+    WT_FORMAT_SQLITE,
+    WT_FORMAT_SQLITE_WAL,
+    WT_FORMAT_SQLITE_JOURNAL
+} wt_format;
+
+typedef enum wt_parser {
+    WT_PARSER_AUTO = 0,   /* read the pages of a recognized database, otherwise scan */
+    WT_PARSER_SCAN,       /* always scan for "mkey"/"ckey"/"key"/"wkey" tags, e.g. for image fragments */
+    WT_PARSER_SALVAGE,    /* check every page on its own and read only the intact ones, for damaged files */
+    WT_PARSER_FORENSIC    /* as AUTO, plus stale copies from deleted items, page slack and free pages */
+} wt_parser;
+
+/* What WT_PARSER_SALVAGE made of a wallet. Every page ends up in exactly
+ * one of the three page counts. */
+typedef struct wt_salvage_stats {
+    uint32_t page_size;        /* from the header, or guessed when it is damaged; 0 if no layout fits */
+    uint64_t pages;            /* pages in the image, counting a cut-off last page */
+    uint64_t pages_intact;     /* passed every structural check and were read */
+    uint64_t pages_damaged;    /* look like wallet pages but fail a check; skipped */
+    uint64_t pages_unreadable; /* zeroed, overwritten, foreign or cut off; skipped */
+    uint64_t mkeys;
+    uint64_t ckeys;            /* ckey and descriptor ckey */
+    uint64_t keys;             /* key, wkey and descriptor key */
+    uint64_t keymetas;
+} wt_salvage_stats;
+
+typedef struct wt_wallet wt_wallet;
+typedef struct wt_cursor wt_cursor;
+typedef struct wt_stream wt_stream;
+
+/* Return nonzero to stop the iteration early */
+typedef int (*wt_record_callback)(const wt_record* record, void* user);
+
+WT_API uint32_t wt_abi_version(void);
+WT_API const char* wt_last_error(void);
+
+/* The file is memory-mapped read-only. A buffer is borrowed, not copied,
+ * and must outlive the handle. wt_open_file() also reads "<path>-wal" when
+ * it exists. */
+WT_API wt_status wt_open_file(const char* path, wt_wallet** wallet);
+WT_API wt_status wt_open_buffer(const void* data, size_t size, wt_wallet** wallet);
+/* As wt_open_buffer(); error messages name the wallet by name (usually the
+ * path the buffer was read from) instead of "<buffer>" */
+WT_API wt_status wt_open_named_buffer(const void* data, size_t size, const char* name, wt_wallet** wallet);
+WT_API void wt_close(wt_wallet* wallet);
+
+/* Overlays the committed frames of an SQLite WAL file on the database, as
+ * SQLite would when opening it, without checkpointing. The file is copied
+ * once; later writes to it are not seen. Must come before the records are
+ * first read. Ignored for wallets that are not SQLite databases. */
+WT_API wt_status wt_attach_wal_file(wt_wallet* wallet, const char* path);
+
+/* Replays the log.* files of a BerkeleyDB environment directory (Bitcoin
+ * Core's database/) over the wallet in memory, as recovery would, so that
+ * committed changes not yet checkpointed into the file are seen. The logs
+ * are streamed when the records are first read; the wallet file is never
+ * written. Must come before the records are first read. Ignored for wallets
+ * that are not BerkeleyDB btree databases. */
+WT_API wt_status wt_attach_bdb_logs(wt_wallet* wallet, const char* directory);
+
+/* The detected format. BerkeleyDB and SQLite databases whose pages are
+ * consistent with their header are read page by page, which finds exactly
+ * the live records; anything else is scanned. WT_PARSER_SALVAGE never
+ * falls back to the scan: it reads the pages that pass their checks,
+ * guessing the page size when the header is damaged, and reports mkey,
+ * ckey, key and keymeta records. It reads the file alone, without a WAL or
+ * BerkeleyDB logs. WT_PARSER_FORENSIC reads the same pages as AUTO and, in
+ * the same pass, searches their unused space and free pages for records
+ * whose framing still holds, such as keys from before a rekey; live-only
+ * parsing never looks there. wt_set_parser() must come before the records
+ * are first read. */
+WT_API wt_format wt_wallet_format(wt_wallet* wallet);
+WT_API wt_status wt_set_parser(wt_wallet* wallet, wt_parser parser);
+
+/* Page and record counts of a WT_PARSER_SALVAGE wallet; reads the records
+ * first if that has not happened yet */
+WT_API wt_status wt_salvage_report(wt_wallet* wallet, wt_salvage_stats* stats);
+
+/* Records are "mkey", "ckey", "key", "wkey" and "hdchain" records and the
+ * records of descriptor wallets, in file order; the tag scan finds only
+ * "mkey", "ckey", "key" and "wkey". Of a descriptor's cached xpubs only
+ * those of its key expressions are reported, not the derived ones. Scanned
+ * images of 64 MiB and more are indexed once, by a parallel chunked scan,
+ * when first walked. */
+WT_API wt_status wt_foreach_record(wt_wallet* wallet, wt_record_callback callback, void* user);
+
+/* How many records a walk will return, for sizing tables before it: exact
+ * once a record parser or the parallel scan has read the file, otherwise
+ * estimated from the file size as if it held nothing but ckey records.
+ * Reads the records first if that has not happened yet. */
+WT_API wt_status wt_estimate_records(wt_wallet* wallet, uint64_t* count);
+WT_API wt_status wt_cursor_open(wt_wallet* wallet, wt_cursor** cursor);
+WT_API int wt_cursor_next(wt_cursor* cursor, wt_record* record);  /* 1 = record, 0 = end */
+WT_API void wt_cursor_close(wt_cursor* cursor);
+
+/* Forward-only scan of a wallet arriving through a pipe or socket, in a
+ * fixed-size window. Each record is passed to the callback, in stream order,
+ * once enough bytes after it have been fed; wt_stream_finish() reports the
+ * rest at end of stream. Record pointers are only valid during the callback
+ * and offsets count from the start of the stream. A nonzero return from the
+ * callback ends the scan; later data is ignored. */
+WT_API wt_status wt_stream_open(wt_stream** stream);
+WT_API wt_status wt_stream_feed(wt_stream* stream, const void* data, size_t size,
+                                wt_record_callback callback, void* user);
+WT_API wt_status wt_stream_finish(wt_stream* stream, wt_record_callback callback, void* user);
+WT_API void wt_stream_close(wt_stream* stream);
+
+/* The first live master key record, or the first stale one if there is no
+ * live one. A host that caches records can hand one back
+ * with wt_set_master_key_record() to skip the scan on a later open. */
+WT_API wt_status wt_find_master_key(wt_wallet* wallet, wt_record* record);
+WT_API wt_status wt_set_master_key_record(wt_wallet* wallet, const uint8_t record[WT_MKEY_RECORD_SIZE]);
+
+WT_API wt_status wt_unlock(wt_wallet* wallet, const char* passphrase, size_t passphrase_len);
+WT_API wt_status wt_unlock_with_master_key(wt_wallet* wallet, const uint8_t key[WT_SECRET_SIZE]);
+WT_API wt_status wt_export_master_key(const wt_wallet* wallet, uint8_t key[WT_SECRET_SIZE]);
+WT_API void wt_lock(wt_wallet* wallet);
+WT_API int wt_is_unlocked(const wt_wallet* wallet);
+
+WT_API wt_status wt_decrypt_key(wt_wallet* wallet, const wt_record* ckey, uint8_t secret[WT_SECRET_SIZE]);
+WT_API wt_status wt_verify_key(const uint8_t secret[WT_SECRET_SIZE], const uint8_t* pubkey, size_t pubkey_len);
+
+/* The secret of an unencrypted key, wkey or descriptor key record, read
+ * from its DER. The secret must derive the record's pubkey, and a pubkey
+ * the DER carries must be the same: WT_ERR_MISMATCH if not, WT_ERR_FORMAT
+ * if the DER is malformed. On either error the secret is wiped. Needs no
+ * unlocked wallet and may be called from several threads at once. */
+WT_API wt_status wt_decode_key(const wt_record* key, uint8_t secret[WT_SECRET_SIZE]);
+
+/* NUL-terminated mainnet encodings */
+WT_API wt_status wt_export_wif(const uint8_t secret[WT_SECRET_SIZE], int compressed, char* out, size_t capacity);
+WT_API wt_status wt_export_address(const uint8_t* pubkey, size_t pubkey_len, char* out, size_t capacity);
+WT_API wt_status wt_export_xpub(const uint8_t key[WT_EXTENDED_KEY_SIZE], char* out, size_t capacity);
+
+/* The hash160 an address encodes, and the address of a hash160 already
+ * computed, so a host that keeps the hash does not hash the pubkey twice */
+WT_API wt_status wt_hash160(const uint8_t* pubkey, size_t pubkey_len, uint8_t hash[WT_HASH160_SIZE]);
+WT_API wt_status wt_export_hash160_address(const uint8_t hash[WT_HASH160_SIZE], char* out, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,333 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// Wallet record layouts as Bitcoin Core serializes them (serialize.h),
+// described once as types instead of offsets scattered through the
+// parsers. A layout is a list of field types. Each field type knows its size
+// and how to load itself, so a field that follows only fixed-size fields
+// sits at an offset the compiler computes, and reading it is one load.
+// Fields behind a compact size are found by one walk with decode().
+
+#ifndef RECORD_LAYOUT_H
+#define RECORD_LAYOUT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+namespace record_layout {
+
+// Little-endian integers from any address. The shifts assemble the value
+// whatever the host byte order and alignment; compilers turn them into a
+// single load.
+template <typename T>
+inline T loadLE(const uint8_t* p) {
+    using U = std::make_unsigned_t<T>;
+    U value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) value |= U(p[i]) << (8 * i);
+    return static_cast<T>(value);
+}
+
+// A compact size: one byte below 0xfd, else a marker and 2, 4 or 8 bytes.
+// Returns the bytes it takes, or 0 when it runs past end.
+inline size_t readCompactSize(const uint8_t* p, const uint8_t* end, uint64_t& value) {
+    if (p >= end) return 0;
+    size_t available = static_cast<size_t>(end - p);
+    switch (p[0]) {
+        case 0xfd:
+            if (available < 3) return 0;
+            value = loadLE<uint16_t>(p + 1);
+            return 3;
+        case 0xfe:
+            if (available < 5) return 0;
+            value = loadLE<uint32_t>(p + 1);
+            return 5;
+        case 0xff:
+            if (available < 9) return 0;
+            value = loadLE<uint64_t>(p + 1);
+            return 9;
+        default:
+            value = p[0];
+            return 1;
+    }
+}
+
+// Field types. FIXED fields have SIZE bytes, of which the data starts SKIP
+// bytes in. measure() checks a field in place: it returns the bytes it takes
+// and sets the data's offset and length, or returns 0 when it does not fit
+// before end or breaks its rules.
+
+// A little-endian integer
+template <typename T>
+struct Int {
+    using Value = T;
+    static constexpr bool FIXED = true;
+    static constexpr size_t SIZE = sizeof(T);
+    static constexpr size_t SKIP = 0;
+    static Value load(const uint8_t* p) { return loadLE<T>(p); }
+    static size_t measure(const uint8_t* p, const uint8_t* end, size_t& skip, size_t& length) {
+        if (static_cast<size_t>(end - p) < SIZE) return 0;
+        skip = 0;
+        length = SIZE;
+        return SIZE;
+    }
+};
+
+// Raw bytes of a fixed length: uint160, uint256, a key fingerprint
+template <size_t N>
+struct Bytes {
+    using Value = const uint8_t*;
+    static constexpr bool FIXED = true;
+    static constexpr size_t SIZE = N;
+    static constexpr size_t SKIP = 0;
+    static Value load(const uint8_t* p) { return p; }
+    static size_t measure(const uint8_t* p, const uint8_t* end, size_t& skip, size_t& length) {
+        if (static_cast<size_t>(end - p) < SIZE) return 0;
+        skip = 0;
+        length = N;
+        return SIZE;
+    }
+};
+
+// A vector or string that Bitcoin Core always writes with N elements: a
+// one-byte compact size that must be N, then the bytes. Treating it as
+// fixed keeps every field behind it at a constant offset.
+template <size_t N>
+struct Sized {
+    static_assert(N < 0xfd, "a longer size takes more than one byte");
+    using Value = const uint8_t*;
+    static constexpr bool FIXED = true;
+    static constexpr size_t LENGTH = N;
+    static constexpr size_t SIZE = 1 + N;
+    static constexpr size_t SKIP = 1;
+    static Value load(const uint8_t* p) { return p; }
+    static size_t measure(const uint8_t* p, const uint8_t* end, size_t& skip, size_t& length) {
+        if (static_cast<size_t>(end - p) < SIZE || p[0] != N) return 0;
+        skip = 1;
+        length = N;
+        return SIZE;
+    }
+};
+
+// A vector or string of any length: compact size, then ELEMENT bytes per
+// element. The length reported is in bytes.
+template <size_t ELEMENT = 1>
+struct Var {
+    using Value = const uint8_t*;
+    static constexpr bool FIXED = false;
+    static constexpr size_t SIZE = 0;
+    static constexpr size_t SKIP = 0;
+    static size_t measure(const uint8_t* p, const uint8_t* end, size_t& skip, size_t& length) {
+        uint64_t count;
+        size_t prefix = readCompactSize(p, end, count);
+        if (!prefix || count > static_cast<uint64_t>(end - p - prefix) / ELEMENT) return 0;
+        skip = prefix;
+        length = static_cast<size_t>(count) * ELEMENT;
+        return prefix + length;
+    }
+};
+using VarBytes = Var<1>;
+
+// CPubKey: a compact size of 33 (compressed) or 65, then the key
+struct PubKey {
+    using Value = const uint8_t*;
+    static constexpr bool FIXED = false;
+    static constexpr size_t SIZE = 0;
+    static constexpr size_t SKIP = 0;
+    static size_t measure(const uint8_t* p, const uint8_t* end, size_t& skip, size_t& length) {
+        if (p >= end || (p[0] != 33 && p[0] != 65) || p[0] >= static_cast<size_t>(end - p)) return 0;
+        skip = 1;
+        length = p[0];
+        return 1 + length;
+    }
+};
+
+template <typename... Fields>
+class Layout {
+public:
+    static constexpr size_t COUNT = sizeof...(Fields);
+    template <size_t I>
+    using Field = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+private:
+    static constexpr std::array<bool, COUNT + 1> FIXED = {Fields::FIXED..., false};
+    static constexpr std::array<size_t, COUNT + 1> SIZES = {Fields::SIZE..., 0};
+
+    static constexpr size_t fixedPrefix() {
+        size_t n = 0;
+        while (n < COUNT && FIXED[n]) n++;
+        return n;
+    }
+
+    static constexpr size_t start(size_t index) {
+        size_t offset = 0;
+        for (size_t i = 0; i < index; i++) offset += SIZES[i];
+        return offset;
+    }
+
+public:
+    // The leading fields of fixed size, and the bytes they take
+    static constexpr size_t FIXED_FIELDS = fixedPrefix();
+    static constexpr size_t FIXED_SIZE = start(FIXED_FIELDS);
+
+    // Where field I's data starts, for a field with only fixed-size fields
+    // before it
+    template <size_t I>
+    static constexpr size_t offset() {
+        static_assert(I < FIXED_FIELDS, "field follows a variable-size field; use decode()");
+        return start(I) + Field<I>::SKIP;
+    }
+
+    // Field I of a record whose bytes start at p, or of a record view that
+    // starts at field From's data instead
+    template <size_t I, size_t From = 0>
+    static typename Field<I>::Value get(const uint8_t* p) {
+        static_assert(offset<I>() >= offset<From>(), "field comes before the view");
+        return Field<I>::load(p + offset<I>() - offset<From>());
+    }
+
+    // Whether a record has all of its fixed-size fields, each valid
+    static bool fits(const uint8_t* p, size_t length) {
+        if (length < FIXED_SIZE) return false;
+        Decoded decoded;
+        return decode(p, length, decoded, FIXED_FIELDS);
+    }
+
+    struct Span {
+        const uint8_t* data;
+        size_t length;
+    };
+    struct Decoded {
+        std::array<Span, COUNT> fields;
+        size_t present = 0;   // fields decoded; later ones were missing
+        size_t size = 0;      // bytes they take
+    };
+
+    // Walks the fields in order. At least required fields must be present
+    // and valid; later ones are decoded while the bytes last, since newer
+    // versions of a record append fields.
+    static bool decode(const uint8_t* p, size_t length, Decoded& out, size_t required = COUNT) {
+        using Measure = size_t (*)(const uint8_t*, const uint8_t*, size_t&, size_t&);
+        static constexpr Measure measures[COUNT + 1] = {&Fields::measure..., nullptr};
+        const uint8_t* end = p + length;
+        const uint8_t* position = p;
+        out.present = 0;
+        for (size_t i = 0; i < COUNT; i++) {
+            size_t skip, fieldLength;
+            size_t taken = measures[i](position, end, skip, fieldLength);
+            if (!taken) break;
+            out.fields[i] = Span{position + skip, fieldLength};
+            position += taken;
+            out.present++;
+        }
+        out.size = static_cast<size_t>(position - p);
+        return out.present >= required;
+    }
+};
+
+// A record's key is its name, as a compact-size string, then the fields of
+// its Key layout
+template <typename Record>
+constexpr size_t nameLength() {
+    return sizeof(Record::NAME) - 1;
+}
+
+template <typename Record>
+inline bool isNamed(const uint8_t* name, size_t length) {
+    return length == nameLength<Record>() && memcmp(name, Record::NAME, length) == 0;
+}
+
+// CMasterKey under "mkey" <nID>
+struct MasterKey {
+    static constexpr char NAME[] = "mkey";
+    using Key = Layout<Int<uint32_t>>;
+    enum : size_t { CRYPTED_KEY, SALT, DERIVATION_METHOD, DERIVE_ITERATIONS, OTHER_PARAMETERS };
+    using Value = Layout<Sized<48>, Sized<8>, Int<uint32_t>, Int<uint32_t>, VarBytes>;
+};
+
+// An encrypted private key under "ckey" <pubkey>
+struct CryptedKey {
+    static constexpr char NAME[] = "ckey";
+    using Key = Layout<PubKey>;
+    enum : size_t { CRYPTED_SECRET };
+    using Value = Layout<Sized<48>>;
+};
+
+// An unencrypted private key under "key" <pubkey>: DER, then since 0.10
+// the hash of pubkey and DER together
+struct PlainKey {
+    static constexpr char NAME[] = "key";
+    using Key = Layout<PubKey>;
+    enum : size_t { PRIVATE_KEY, HASH };
+    using Value = Layout<VarBytes, Bytes<32>>;
+};
+
+// CWalletKey of the 0.3 era under "wkey" <pubkey>: the DER private key,
+// unencrypted despite the name, with its creation and expiry times
+struct WalletKey {
+    static constexpr char NAME[] = "wkey";
+    using Key = Layout<PubKey>;
+    enum : size_t { VERSION, PRIVATE_KEY, TIME_CREATED, TIME_EXPIRES, COMMENT };
+    using Value = Layout<Int<int32_t>, VarBytes, Int<int64_t>, Int<int64_t>, VarBytes>;
+};
+
+// CKeyMetadata under "keymeta" <pubkey>. Version 10 added the HD path and
+// seed id, version 12 the key origin.
+struct KeyMetadata {
+    static constexpr char NAME[] = "keymeta";
+    using Key = Layout<PubKey>;
+    enum : size_t { VERSION, CREATE_TIME, HD_KEYPATH, HD_SEED_ID, ORIGIN_FINGERPRINT, ORIGIN_PATH, HAS_KEY_ORIGIN };
+    using Value = Layout<Int<int32_t>, Int<int64_t>, VarBytes, Bytes<20>, Bytes<4>, Var<4>, Int<uint8_t>>;
+};
+
+// CHDChain under "hdchain"; version 2 added the internal chain counter
+struct HDChain {
+    static constexpr char NAME[] = "hdchain";
+    using Key = Layout<>;
+    enum : size_t { VERSION, EXTERNAL_COUNTER, SEED_ID, INTERNAL_COUNTER };
+    using Value = Layout<Int<int32_t>, Int<uint32_t>, Bytes<20>, Int<uint32_t>>;
+};
+
+// WalletDescriptor under "walletdescriptor" <descriptor id>
+struct WalletDescriptor {
+    static constexpr char NAME[] = "walletdescriptor";
+    enum : size_t { DESCRIPTOR_ID };
+    using Key = Layout<Bytes<32>>;
+    enum : size_t { DESCRIPTOR, CREATION_TIME, NEXT_INDEX, RANGE_START, RANGE_END };
+    using Value = Layout<VarBytes, Int<uint64_t>, Int<int32_t>, Int<int32_t>, Int<int32_t>>;
+};
+
+// An encrypted descriptor key under "walletdescriptorckey" <descriptor id> <pubkey>
+struct WalletDescriptorCryptedKey {
+    static constexpr char NAME[] = "walletdescriptorckey";
+    enum : size_t { DESCRIPTOR_ID, PUBKEY };
+    using Key = Layout<Bytes<32>, PubKey>;
+    enum : size_t { CRYPTED_SECRET };
+    using Value = Layout<Sized<48>>;
+};
+
+// An unencrypted descriptor key under "walletdescriptorkey" <descriptor id> <pubkey>
+struct WalletDescriptorKey {
+    static constexpr char NAME[] = "walletdescriptorkey";
+    enum : size_t { DESCRIPTOR_ID, PUBKEY };
+    using Key = Layout<Bytes<32>, PubKey>;
+    enum : size_t { PRIVATE_KEY, HASH };
+    using Value = Layout<VarBytes, Bytes<32>>;
+};
+
+// A cached extended pubkey under "walletdescriptorcache" <descriptor id>
+// <key expression index>, followed by a derivation index for derived keys
+struct WalletDescriptorCache {
+    static constexpr char NAME[] = "walletdescriptorcache";
+    enum : size_t { DESCRIPTOR_ID, KEY_EXPRESSION, DERIVATION_INDEX };
+    using Key = Layout<Bytes<32>, Int<uint32_t>, Int<uint32_t>>;
+    enum : size_t { EXTENDED_PUBKEY };
+    using Value = Layout<Sized<74>>;   // BIP32 serialization without version
+};
+
+}  // namespace record_layout
+
+#endif
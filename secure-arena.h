@@ -0,0 +1,128 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// Locked memory for key material, shared by the CLI and libwallettool.
+
+#ifndef SECURE_ARENA_H
+#define SECURE_ARENA_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <new>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "wallet-crypto.h"
+
+// Secret storage for key material: page-locked, excluded from core dumps and
+// bump-allocated so a whole wallet job is wiped and returned in one pass.
+class SecureArena {
+private:
+    struct Block {
+        uint8_t* base;
+        size_t size;
+        size_t used;
+        bool locked;
+    };
+    std::vector<Block> blocks;
+    size_t blockSize;
+    static constexpr size_t MIN_BLOCK = 64 * 1024;
+    static constexpr size_t MAX_BLOCK = 16 * 1024 * 1024;
+    static inline std::atomic<bool> lockWarningShown{false};
+
+    static size_t systemPageSize() {
+        #ifdef _WIN32
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return info.dwPageSize;
+        #else
+            return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        #endif
+    }
+
+    void addBlock(size_t minSize) {
+        size_t page = systemPageSize();
+        size_t size = (std::max(blockSize, minSize) + page - 1) / page * page;
+        Block block{nullptr, size, 0, false};
+        #ifdef _WIN32
+            block.base = static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+            if (!block.base) throw std::bad_alloc();
+            block.locked = VirtualLock(block.base, size) != 0;
+        #else
+            void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) throw std::bad_alloc();
+            block.base = static_cast<uint8_t*>(mem);
+            #ifdef MADV_DONTDUMP
+                madvise(mem, size, MADV_DONTDUMP);
+            #endif
+            block.locked = mlock(mem, size) == 0;
+        #endif
+        if (!block.locked && !lockWarningShown.exchange(true)) {
+            std::cerr << "Warning: could not lock memory for key material; "
+                      << "plaintext keys may be written to swap" << std::endl;
+        }
+        blocks.push_back(block);
+    }
+
+public:
+    explicit SecureArena(size_t sizeHint)
+        : blockSize(std::min(std::max(sizeHint, MIN_BLOCK), MAX_BLOCK)) {}
+
+    ~SecureArena() { release(); }
+
+    SecureArena(const SecureArena&) = delete;
+    SecureArena& operator=(const SecureArena&) = delete;
+
+    // Room for the master key plus a decrypted key and its WIF per ckey
+    // record that could fit in a wallet of this size.
+    static size_t sizeHintForWallet(uint64_t walletBytes) {
+        constexpr uint64_t CKEY_RECORD_BYTES = 100;
+        constexpr uint64_t SECRET_BYTES_PER_KEY = WalletCrypto::CRYPTED_KEY_SIZE + WalletCrypto::WIF_BUFFER_SIZE + 16;
+        return static_cast<size_t>(std::min<uint64_t>(4096 + walletBytes / CKEY_RECORD_BYTES * SECRET_BYTES_PER_KEY,
+                                                      MAX_BLOCK));
+    }
+
+    uint8_t* allocate(size_t size, size_t align = 16) {
+        if (blocks.empty()) addBlock(size + align);
+        Block* block = &blocks.back();
+        size_t offset = (block->used + align - 1) / align * align;
+        if (offset + size > block->size) {
+            addBlock(size + align);
+            block = &blocks.back();
+            offset = 0;
+        }
+        block->used = offset + size;
+        return block->base + offset;
+    }
+
+    char* allocateChars(size_t size) { return reinterpret_cast<char*>(allocate(size, 1)); }
+
+    static void wipe(void* data, size_t size) {
+        volatile uint8_t* p = static_cast<uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) p[i] = 0;
+    }
+
+    // Wipes everything handed out so far and returns the memory to the system
+    void release() {
+        for (auto& block : blocks) {
+            wipe(block.base, block.used);
+            #ifdef _WIN32
+                if (block.locked) VirtualUnlock(block.base, block.size);
+                VirtualFree(block.base, 0, MEM_RELEASE);
+            #else
+                if (block.locked) munlock(block.base, block.size);
+                munmap(block.base, block.size);
+            #endif
+        }
+        blocks.clear();
+    }
+};
+
+#endif
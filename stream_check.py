@@ -0,0 +1,104 @@
+# Checks for wallet-tool's --wallet - path. Generates a small and a large
+# BerkeleyDB wallet with wallet-gen, pipes each into --dump-all-keys and
+# compares the peak resident memory of the two runs: in a BerkeleyDB wallet
+# every ckey sorts before the mkey, so a reader that kept them until the
+# master key arrived would grow with the key count. Then pipes wallets with
+# unencrypted key and wkey records, with and without a master key and with
+# pages small enough to push their values onto overflow pages, and compares
+# the output with the generated keys and with a dump of the same file.
+#
+# python3 stream_check.py ./wallet-tool ./wallet-gen [--keys n]
+import os, os.path, sys, argparse, shutil, subprocess, tempfile
+
+parser = argparse.ArgumentParser("stream_check.py")
+parser.add_argument("tool", help="wallet-tool binary")
+parser.add_argument("gen", help="wallet-gen binary")
+parser.add_argument("--keys", type=int, default=300000, help="ckeys in the large wallet (default 300000)")
+parser.add_argument("--slack", type=int, default=16, help="MiB the large run may use beyond the small one")
+args = parser.parse_args()
+
+tool = os.path.abspath(args.tool)
+gen = os.path.abspath(args.gen)
+
+
+def generate(path, ckeys, seed, extra=()):
+    subprocess.run([gen, "--out", path, "--ckeys", str(ckeys), "--iterations", "1000", "--seed", str(seed)] +
+                   list(extra), check=True, stdout=subprocess.DEVNULL)
+
+
+def dump_stdin(path):
+    """Runs the stdin dump of a wallet; returns its output and peak RSS in KiB"""
+    with open(path, "rb") as wallet, tempfile.TemporaryFile() as output:
+        proc = subprocess.Popen([tool, "--wallet", "-", "--dump-all-keys", "--passphrase-file", path + ".pass"],
+                                stdin=wallet, stdout=output, stderr=subprocess.PIPE)
+        _, status, usage = os.wait4(proc.pid, 0)
+        proc.returncode = os.waitstatus_to_exitcode(status)
+        errors = proc.stderr.read().decode()
+        proc.stderr.close()
+        if proc.returncode != 0:
+            sys.exit("wallet-tool failed on {}:\n{}".format(path, errors))
+        output.seek(0)
+        return output.read().decode(), usage.ru_maxrss
+
+
+def dump_file(path):
+    proc = subprocess.run([tool, "--wallet", path, "--dump-all-keys", "--passphrase-file", path + ".pass"],
+                          stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if proc.returncode != 0:
+        sys.exit("wallet-tool failed on {}:\n{}".format(path, proc.stderr.decode()))
+    return proc.stdout.decode()
+
+
+def without_index_copies(output):
+    """The tag scan also hits the ckey names BerkeleyDB copies into its
+    internal pages, which have no value and fail to decrypt; the file
+    parser never reads those pages"""
+    return [line for line in output.splitlines() if not line.startswith("Undecryptable ckey")]
+
+
+def dumped_keys(output):
+    return sorted(line for line in output.splitlines() if line.startswith("Address: "))
+
+
+def expected_keys(path):
+    with open(path + ".keys") as keys:
+        return sorted(line.rstrip("\n") for line in keys)
+
+
+workdir = tempfile.mkdtemp(prefix="stream-check-")
+try:
+    small = os.path.join(workdir, "small.dat")
+    large = os.path.join(workdir, "large.dat")
+    generate(small, 1000, 1)
+    generate(large, args.keys, 2)
+
+    small_output, small_peak = dump_stdin(small)
+    large_output, large_peak = dump_stdin(large)
+    for path, output in ((small, small_output), (large, large_output)):
+        if dumped_keys(output) != expected_keys(path):
+            sys.exit("The keys piped from {} differ from the ones it was generated with".format(path))
+
+    print("Small wallet: {} keys, peak {:.1f} MiB".format(1000, small_peak / 1024))
+    print("Large wallet: {} keys, peak {:.1f} MiB".format(args.keys, large_peak / 1024))
+    if large_peak - small_peak > args.slack * 1024:
+        sys.exit("Peak memory grows with the key count")
+    print("Peak memory does not grow with the key count")
+
+    # Unencrypted keys: a wallet without a master key, one whose keys spill
+    # past a batch, one with ckeys as well, and small-page wallets whose key
+    # and wkey values sit on overflow pages
+    for name, ckeys, extra in (("plain.dat", 0, ["--keys", "30", "--wkeys", "5"]),
+                               ("plain-large.dat", 0, ["--keys", "9000", "--wkeys", "1000"]),
+                               ("mixed.dat", 3000, ["--keys", "3000", "--wkeys", "100"]),
+                               ("small-page.dat", 5, ["--keys", "10", "--wkeys", "3", "--page-size", "1024"]),
+                               ("small-page-plain.dat", 0, ["--keys", "300", "--wkeys", "30", "--page-size", "512"])):
+        path = os.path.join(workdir, name)
+        generate(path, ckeys, 3, extra)
+        piped, _ = dump_stdin(path)
+        if dumped_keys(piped) != expected_keys(path):
+            sys.exit("The keys piped from {} differ from the ones it was generated with".format(path))
+        if without_index_copies(piped) != without_index_copies(dump_file(path)):
+            sys.exit("The dump piped from {} differs from the dump of the file".format(path))
+        print("{}: {} keys, piped and file dumps match".format(name, len(dumped_keys(piped))))
+finally:
+    shutil.rmtree(workdir)
@@ -0,0 +1,334 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// Work-stealing task scheduler shared by every parallel path in wallet-tool.
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// One process-wide pool. Each worker owns a deque: it pushes and pops its own
+// tasks at the back (newest first, still in cache) and idle workers steal
+// from the front of the others (oldest first, usually the largest pieces).
+// Tasks submitted from outside the pool go to a shared queue. A thread that
+// waits on a TaskGroup runs that group's queued tasks instead of blocking,
+// so nested parallel loops never put more threads to work than the pool has.
+class TaskScheduler {
+public:
+    using Task = std::function<void()>;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::mutex sharedMutex;
+    std::deque<Task> shared;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued{0};
+    bool stopping = false;
+
+    static inline unsigned configuredWorkers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    static inline std::vector<int> configuredCpus;
+    static inline thread_local int workerIndex = -1;
+
+    TaskScheduler(unsigned workerCount, const std::vector<int>& cpus) {
+        for (unsigned i = 0; i < workerCount; i++) workers.push_back(std::make_unique<Worker>());
+        for (unsigned i = 0; i < workerCount; i++) {
+            threads.emplace_back(&TaskScheduler::workerLoop, this, static_cast<int>(i));
+            if (!cpus.empty()) pin(threads.back(), cpus[i % cpus.size()]);
+        }
+    }
+
+    static void pin(std::thread& thread, int cpu) {
+        #ifdef _WIN32
+            if (cpu < 64) SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu);
+        #elif defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+        #else
+            (void)thread;
+            (void)cpu;
+        #endif
+    }
+
+    static bool popFront(std::mutex& mutex, std::deque<Task>& tasks, Task& task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+        return true;
+    }
+
+    bool take(Task& task) {
+        if (workerIndex >= 0) {
+            Worker& own = *workers[workerIndex];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        if (popFront(sharedMutex, shared, task)) return true;
+        size_t count = workers.size();
+        size_t start = workerIndex >= 0 ? static_cast<size_t>(workerIndex) + 1 : 0;
+        for (size_t k = 0; k < count; k++) {
+            Worker& victim = *workers[(start + k) % count];
+            if (popFront(victim.mutex, victim.tasks, task)) return true;
+        }
+        return false;
+    }
+
+    void workerLoop(int index) {
+        workerIndex = index;
+        for (;;) {
+            if (runOne()) continue;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0) return;
+        }
+    }
+
+public:
+    ~TaskScheduler() { stop(); }
+
+    // Lets the workers drain the queue and joins them. Anything the workers
+    // write without locking may be read once this returns; tasks submitted
+    // afterwards only run on the thread that waits for them.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& thread : threads) thread.join();
+        threads.clear();
+    }
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Sets the pool size and worker CPUs; only effective before the first
+    // instance() call. Zero workers runs every task on the waiting thread.
+    static void configure(unsigned workerCount, std::vector<int> cpus) {
+        configuredWorkers = workerCount;
+        configuredCpus = std::move(cpus);
+    }
+
+    static TaskScheduler& instance() {
+        static TaskScheduler scheduler(configuredWorkers, configuredCpus);
+        return scheduler;
+    }
+
+    // "none", "compact" (the CPUs this process may run on, in order) or a
+    // list such as "0-3,8,10"
+    static std::vector<int> parseAffinity(const std::string& spec) {
+        std::vector<int> cpus;
+        if (spec.empty() || spec == "none") return cpus;
+        if (spec == "compact") {
+            #ifdef __linux__
+                cpu_set_t set;
+                if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+                    }
+                }
+            #endif
+            if (cpus.empty()) {
+                for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++) {
+                    cpus.push_back(static_cast<int>(cpu));
+                }
+            }
+            return cpus;
+        }
+        size_t start = 0;
+        while (start <= spec.size()) {
+            size_t end = spec.find(',', start);
+            if (end == std::string::npos) end = spec.size();
+            std::string range = spec.substr(start, end - start);
+            size_t dash = range.find('-');
+            try {
+                size_t used = 0;
+                int first = std::stoi(range.substr(0, dash), &used);
+                if (used != (dash == std::string::npos ? range.size() : dash)) throw std::invalid_argument(range);
+                int last = first;
+                if (dash != std::string::npos) {
+                    last = std::stoi(range.substr(dash + 1), &used);
+                    if (used != range.size() - dash - 1) throw std::invalid_argument(range);
+                }
+                if (first < 0 || last < first) throw std::invalid_argument(range);
+                for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+            }
+            catch (const std::logic_error&) {
+                throw std::runtime_error("Invalid CPU list: " + spec);
+            }
+            start = end + 1;
+        }
+        return cpus;
+    }
+
+    size_t workerCount() const { return workers.size(); }
+
+    // Threads that can run tasks at once: the workers plus one waiting thread
+    size_t concurrency() const { return workers.size() + 1; }
+
+    // Tasks must not throw; use TaskGroup to collect exceptions
+    void submit(Task task) {
+        if (workerIndex >= 0) {
+            Worker& own = *workers[workerIndex];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            own.tasks.push_back(std::move(task));
+        } else {
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            shared.push_back(std::move(task));
+        }
+        queued.fetch_add(1);
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wake.notify_one();
+    }
+
+    // Runs one queued task on the calling thread; false if there was none
+    bool runOne() {
+        Task task;
+        if (!take(task)) return false;
+        queued.fetch_sub(1);
+        task();
+        return true;
+    }
+};
+
+// A set of tasks that can be waited for together. The first exception a task
+// throws is rethrown by wait(); the destructor waits without rethrowing so no
+// task outlives the state it refers to.
+//
+// The group keeps its own queue of tasks not yet started, and each scheduler
+// entry it submits runs the oldest of them, if any are left. A waiting thread
+// takes from that queue too, so it only ever runs tasks of the group it waits
+// for: never another job's long task, which would hold it up long after its
+// own group is done. The entries share the queue's state, so one that finds
+// it empty can run after the group is gone.
+class TaskGroup {
+private:
+    struct State {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<TaskScheduler::Task> unstarted;
+        size_t pending = 0;   // queued or running
+        std::exception_ptr error;
+
+        // Runs the oldest unstarted task; false if there was none
+        bool runNext() {
+            TaskScheduler::Task task;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (unstarted.empty()) return false;
+                task = std::move(unstarted.front());
+                unstarted.pop_front();
+            }
+            std::exception_ptr thrown;
+            try {
+                task();
+            }
+            catch (...) {
+                thrown = std::current_exception();
+            }
+            task = nullptr;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (thrown && !error) error = thrown;
+            if (--pending == 0) changed.notify_all();
+            return true;
+        }
+    };
+
+    TaskScheduler& scheduler;
+    std::shared_ptr<State> state = std::make_shared<State>();
+
+    void finish() {
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->pending == 0) return;
+            }
+            if (state->runNext()) continue;
+            // Nothing left to help with: the remaining tasks are running
+            // elsewhere, and may still queue more for this group
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->changed.wait_for(lock, std::chrono::microseconds(200),
+                                    [this] { return state->pending == 0 || !state->unstarted.empty(); });
+        }
+    }
+
+public:
+    explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::instance()) : scheduler(scheduler) {}
+    ~TaskGroup() { finish(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->unstarted.push_back(std::move(task));
+            state->pending++;
+        }
+        state->changed.notify_all();
+        scheduler.submit([state = state] { state->runNext(); });
+    }
+
+    void wait() {
+        finish();
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->error) {
+            std::exception_ptr thrown = state->error;
+            state->error = nullptr;
+            std::rethrow_exception(thrown);
+        }
+    }
+};
+
+// Calls body(begin, end) over [0, count) in slices of at most grain items,
+// one task per slice; the calling thread takes the first slice itself
+template <typename Body>
+void parallelFor(size_t count, size_t grain, const Body& body) {
+    TaskScheduler& scheduler = TaskScheduler::instance();
+    grain = std::max<size_t>(grain, 1);
+    if (count <= grain || scheduler.workerCount() == 0) {
+        if (count) body(size_t(0), count);
+        return;
+    }
+    TaskGroup group(scheduler);
+    for (size_t begin = grain; begin < count; begin += grain) {
+        size_t end = std::min(count, begin + grain);
+        group.run([&body, begin, end] { body(begin, end); });
+    }
+    body(size_t(0), grain);
+    group.wait();
+}
+
+#endif
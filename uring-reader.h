@@ -0,0 +1,408 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// io_uring reader that loads the wallets of a large batch into memory.
+
+#ifndef URING_READER_H
+#define URING_READER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__NR_io_uring_setup) && defined(STATX_SIZE)
+#define URING_READER_AVAILABLE 1
+#endif
+#endif
+
+// A wallet file read into memory. The reader counts the bytes of every
+// buffer still alive against its memory budget, so a batch whose parsing
+// falls behind stops the reading instead of filling memory.
+class WalletBuffer {
+private:
+    std::atomic<size_t>& held;
+
+public:
+    std::vector<uint8_t> bytes;
+
+    WalletBuffer(std::atomic<size_t>& held, size_t size) : held(held), bytes(size) { held += size; }
+    ~WalletBuffer() { held -= bytes.size(); }
+    WalletBuffer(const WalletBuffer&) = delete;
+    WalletBuffer& operator=(const WalletBuffer&) = delete;
+};
+
+// Keeps QUEUE_DEPTH statx/openat/read/close operations in flight over a list
+// of paths, so a batch of thousands of small wallets waits on the device
+// instead of on one open/read/close round trip after another. Reads go into
+// registered buffer slots when the kernel lets us pin them, plain reads into
+// the destination otherwise. Each file is handed over as soon as its last
+// byte is in; between completions the reading thread runs scheduler tasks,
+// so parsing overlaps the outstanding I/O.
+//
+// Files the reader does not load (larger than LOAD_LIMIT, or any I/O error)
+// are handed over with a null buffer: the caller opens them the usual way,
+// which maps large images and reports errors exactly as a single wallet does.
+class UringWalletReader {
+public:
+    using Loaded = std::function<void(size_t index, std::shared_ptr<WalletBuffer> buffer)>;
+    using Idle = std::function<bool()>;
+
+    static constexpr unsigned QUEUE_DEPTH = 64;
+    static constexpr unsigned SLOT_COUNT = 16;
+    static constexpr size_t SLOT_SIZE = 128 * 1024;
+    static constexpr size_t LOAD_LIMIT = 64 * 1024 * 1024;   // larger files are mapped instead
+    static constexpr size_t HELD_LIMIT = 256 * 1024 * 1024;  // loaded but not yet parsed
+
+#ifdef URING_READER_AVAILABLE
+private:
+    enum OpKind { OP_STATX, OP_OPEN, OP_READ, OP_CLOSE };
+
+    struct File {
+        size_t index;
+        const char* path;
+        struct statx info;
+        int fd = -1;
+        int setupPending = 2;      // statx and openat
+        bool failed = false;
+        std::shared_ptr<WalletBuffer> buffer;
+        uint64_t nextOffset = 0;   // first byte no read has been issued for
+        unsigned readsInFlight = 0;
+        unsigned opsInFlight = 0;  // a File is freed once this is zero and it was handed over
+        bool queuedForReads = false;
+        bool handedOver = false;
+    };
+
+    struct Op {
+        OpKind kind;
+        File* file;
+        int slot;                  // registered slot for reads, -1 otherwise
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    int ring = -1;
+    io_uring_params params{};
+    void* sqMapping = MAP_FAILED;
+    void* cqMapping = MAP_FAILED;
+    size_t sqMappingSize = 0;
+    size_t cqMappingSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned unsubmitted = 0;
+
+    std::vector<uint8_t> slotMemory;
+    bool registered = false;
+    std::vector<int> freeSlots;
+    Op ops[QUEUE_DEPTH];
+    std::vector<unsigned> freeOps;
+    std::atomic<size_t> held{0};
+
+    static int enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    static int registerRing(int fd, unsigned opcode, void* arg, unsigned count) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    UringWalletReader() {
+        for (unsigned i = 0; i < QUEUE_DEPTH; i++) freeOps.push_back(QUEUE_DEPTH - 1 - i);
+    }
+
+    bool setup() {
+        ring = static_cast<int>(syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params));
+        if (ring < 0) return false;
+
+        sqMappingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqMappingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) sqMappingSize = cqMappingSize = std::max(sqMappingSize, cqMappingSize);
+        sqMapping = mmap(nullptr, sqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+        if (sqMapping == MAP_FAILED) return false;
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            cqMapping = sqMapping;
+        } else {
+            cqMapping = mmap(nullptr, cqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+            if (cqMapping == MAP_FAILED) return false;
+        }
+        void* sqeMapping = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+        if (sqeMapping == MAP_FAILED) return false;
+        sqes = static_cast<io_uring_sqe*>(sqeMapping);
+
+        auto* sq = static_cast<uint8_t*>(sqMapping);
+        auto* cq = static_cast<uint8_t*>(cqMapping);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // Every operation the reader issues must be there (statx, openat and
+        // close arrived in 5.6); a kernel or sandbox without them gets the
+        // blocking reader
+        std::vector<uint8_t> probeMemory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(probeMemory.data());
+        if (registerRing(ring, IORING_REGISTER_PROBE, probe, 256) < 0) return false;
+        for (unsigned op : {IORING_OP_STATX, IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_READ_FIXED, IORING_OP_CLOSE}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+        }
+
+        // Pinned slots count against RLIMIT_MEMLOCK; without them the reads
+        // go straight into the destination buffers
+        slotMemory.resize(SLOT_COUNT * SLOT_SIZE);
+        iovec slots[SLOT_COUNT];
+        for (unsigned i = 0; i < SLOT_COUNT; i++) slots[i] = {slotMemory.data() + i * SLOT_SIZE, SLOT_SIZE};
+        registered = registerRing(ring, IORING_REGISTER_BUFFERS, slots, SLOT_COUNT) == 0;
+        if (registered) {
+            for (unsigned i = 0; i < SLOT_COUNT; i++) freeSlots.push_back(SLOT_COUNT - 1 - i);
+        } else {
+            slotMemory.clear();
+            slotMemory.shrink_to_fit();
+        }
+        return true;
+    }
+
+    io_uring_sqe* queue(OpKind kind, File* file, int slot = -1, uint64_t offset = 0, uint32_t length = 0) {
+        unsigned id = freeOps.back();
+        freeOps.pop_back();
+        ops[id] = Op{kind, file, slot, offset, length};
+        file->opsInFlight++;
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = id;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        unsubmitted++;
+        return sqe;
+    }
+
+    void queueRead(File& file) {
+        uint64_t size = file.buffer->bytes.size();
+        uint64_t length = std::min<uint64_t>(size - file.nextOffset, registered ? SLOT_SIZE : UINT32_MAX & ~4095u);
+        int slot = -1;
+        if (registered) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        io_uring_sqe* sqe = queue(OP_READ, &file, slot, file.nextOffset, static_cast<uint32_t>(length));
+        sqe->opcode = registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = file.fd;
+        sqe->off = file.nextOffset;
+        sqe->len = static_cast<uint32_t>(length);
+        if (registered) {
+            sqe->addr = reinterpret_cast<uint64_t>(slotMemory.data() + slot * SLOT_SIZE);
+            sqe->buf_index = static_cast<uint16_t>(slot);
+        } else {
+            sqe->addr = reinterpret_cast<uint64_t>(file.buffer->bytes.data() + file.nextOffset);
+        }
+        file.nextOffset += length;
+        file.readsInFlight++;
+    }
+
+    void queueClose(File& file) {
+        io_uring_sqe* sqe = queue(OP_CLOSE, &file);
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = file.fd;
+        file.fd = -1;
+    }
+
+public:
+    ~UringWalletReader() {
+        if (sqes != MAP_FAILED) munmap(sqes, params.sq_entries * sizeof(io_uring_sqe));
+        if (cqMapping != MAP_FAILED && cqMapping != sqMapping) munmap(cqMapping, cqMappingSize);
+        if (sqMapping != MAP_FAILED) munmap(sqMapping, sqMappingSize);
+        if (ring >= 0) close(ring);
+    }
+
+    // A reader, or null where io_uring cannot be used (not Linux, kernel
+    // older than 5.6, or io_uring disabled by seccomp or sysctl)
+    static std::unique_ptr<UringWalletReader> create() {
+        std::unique_ptr<UringWalletReader> reader(new UringWalletReader());
+        if (!reader->setup()) return nullptr;
+        return reader;
+    }
+
+    bool usesRegisteredBuffers() const { return registered; }
+
+    // Reads paths and calls loaded(index, buffer) on this thread once per
+    // path, in completion order. idle() is called while waiting on the
+    // device and returns false when it had nothing to run.
+    void readAll(const std::vector<std::string>& paths, const Loaded& loaded, const Idle& idle) {
+        std::vector<std::unique_ptr<File>> active;
+        std::vector<File*> reading;   // opened files with bytes left to request
+        size_t next = 0;
+        size_t inFlight = 0;
+
+        auto finish = [&](File& file) {
+            // The buffer leaves with the callback; a close still in flight
+            // keeps the File itself alive
+            std::shared_ptr<WalletBuffer> buffer;
+            if (!file.failed) buffer = std::move(file.buffer);
+            file.buffer.reset();
+            file.handedOver = true;
+            loaded(file.index, std::move(buffer));
+        };
+
+        while (next < paths.size() || inFlight || !reading.empty()) {
+            // New files: a statx and an openat each, both by path
+            while (next < paths.size() && freeOps.size() >= 2 + SLOT_COUNT / 2 && held < HELD_LIMIT) {
+                active.push_back(std::make_unique<File>());
+                File& file = *active.back();
+                file.index = next;
+                file.path = paths[next++].c_str();
+                io_uring_sqe* sqe = queue(OP_STATX, &file);
+                sqe->opcode = IORING_OP_STATX;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<uint64_t>(file.path);
+                sqe->len = STATX_SIZE;
+                sqe->off = reinterpret_cast<uint64_t>(&file.info);
+                sqe = queue(OP_OPEN, &file);
+                sqe->opcode = IORING_OP_OPENAT;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<uint64_t>(file.path);
+                sqe->open_flags = O_RDONLY | O_CLOEXEC;
+                inFlight += 2;
+            }
+            // Reads for opened files, oldest file first
+            size_t kept = 0;
+            for (File* file : reading) {
+                while (file->nextOffset < file->buffer->bytes.size() && !freeOps.empty() &&
+                       (!registered || !freeSlots.empty())) {
+                    queueRead(*file);
+                    inFlight++;
+                }
+                if (file->nextOffset < file->buffer->bytes.size()) {
+                    reading[kept++] = file;
+                } else {
+                    file->queuedForReads = false;
+                }
+            }
+            reading.resize(kept);
+
+            if (unsubmitted) {
+                int submitted = enter(ring, unsubmitted, 0, 0);
+                if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                    throw std::runtime_error(std::string("io_uring_enter: ") + strerror(errno));
+                }
+                if (submitted > 0) unsubmitted -= static_cast<unsigned>(submitted);
+            }
+
+            // Completions
+            unsigned head = *cqHead;
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            if (head == tail) {
+                if (idle()) continue;
+                if (inFlight) {
+                    if (enter(ring, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                        throw std::runtime_error(std::string("io_uring_enter: ") + strerror(errno));
+                    }
+                } else {
+                    // Everything is read; waiting for parsers elsewhere to
+                    // release memory before opening more files
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+                continue;
+            }
+            for (; head != tail; head++) {
+                const io_uring_cqe& cqe = cqes[head & *cqMask];
+                int result = cqe.res;
+                Op op = ops[cqe.user_data];
+                freeOps.push_back(static_cast<unsigned>(cqe.user_data));
+                inFlight--;
+                File& file = *op.file;
+                file.opsInFlight--;
+                switch (op.kind) {
+                    case OP_STATX:
+                    case OP_OPEN:
+                        if (op.kind == OP_OPEN && result >= 0) file.fd = result;
+                        if (result < 0) file.failed = true;
+                        if (--file.setupPending) break;
+                        if (!file.failed && (file.info.stx_mask & STATX_SIZE) && S_ISREG(file.info.stx_mode) &&
+                            file.info.stx_size <= LOAD_LIMIT) {
+                            file.buffer = std::make_shared<WalletBuffer>(held, static_cast<size_t>(file.info.stx_size));
+                            if (file.info.stx_size) {
+                                reading.push_back(&file);
+                                file.queuedForReads = true;
+                                break;
+                            }
+                        } else {
+                            file.failed = true;
+                        }
+                        if (file.fd >= 0) {
+                            queueClose(file);
+                            inFlight++;
+                        }
+                        finish(file);
+                        break;
+                    case OP_READ:
+                        if (op.slot >= 0) freeSlots.push_back(op.slot);
+                        file.readsInFlight--;
+                        if (result <= 0) {
+                            // An error, or the file shrank since statx
+                            file.failed = true;
+                        } else {
+                            if (op.slot >= 0) {
+                                memcpy(file.buffer->bytes.data() + op.offset, slotMemory.data() + op.slot * SLOT_SIZE, result);
+                            }
+                            if (static_cast<uint32_t>(result) < op.length) file.failed = true;
+                        }
+                        if (file.failed && file.nextOffset < file.buffer->bytes.size()) {
+                            // Issue nothing more for it
+                            file.nextOffset = file.buffer->bytes.size();
+                        }
+                        if (file.readsInFlight == 0 && file.nextOffset == file.buffer->bytes.size()) {
+                            queueClose(file);
+                            inFlight++;
+                            finish(file);
+                        }
+                        break;
+                    case OP_CLOSE:
+                        break;
+                }
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+            // Files handed over with nothing in flight any more can go
+            size_t alive = 0;
+            for (auto& file : active) {
+                if (!file->handedOver || file->opsInFlight || file->queuedForReads) active[alive++] = std::move(file);
+            }
+            active.resize(alive);
+        }
+    }
+#else
+public:
+    static std::unique_ptr<UringWalletReader> create() { return nullptr; }
+    bool usesRegisteredBuffers() const { return false; }
+    void readAll(const std::vector<std::string>&, const Loaded&, const Idle&) {}
+#endif
+};
+
+#endif
@@ -0,0 +1,1229 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// Self-contained crypto primitives used by the wallet tools: SHA-256, SHA-512,
+// HMAC-SHA512, RIPEMD-160, AES-256-CBC, secp256k1 public key derivation,
+// Base58Check and Bech32.
+// Header-only so every tool still builds with a single g++ invocation.
+
+#ifndef WALLET_CRYPTO_H
+#define WALLET_CRYPTO_H
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace walletcrypto_detail {
+    inline uint32_t rotr32(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+    inline uint32_t rotl32(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+    inline uint64_t rotr64(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+    inline uint32_t readBE32(const uint8_t* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    }
+    inline uint64_t readBE64(const uint8_t* p) {
+        return (uint64_t(readBE32(p)) << 32) | readBE32(p + 4);
+    }
+    inline void writeBE32(uint8_t* p, uint32_t v) {
+        p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+    }
+    inline void writeBE64(uint8_t* p, uint64_t v) {
+        writeBE32(p, uint32_t(v >> 32)); writeBE32(p + 4, uint32_t(v));
+    }
+    inline uint32_t readLE32(const uint8_t* p) {
+        return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+    }
+    inline void writeLE32(uint8_t* p, uint32_t v) {
+        p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+    }
+}
+
+// SHA-256
+class Sha256 {
+private:
+    uint32_t state[8];
+    uint8_t buffer[64];
+    uint64_t total = 0;
+    size_t buffered = 0;
+
+    static void transform(uint32_t* s, const uint8_t* chunk) {
+        using namespace walletcrypto_detail;
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) w[i] = readBE32(chunk + 4 * i);
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+        }
+        s[0] += a; s[1] += b; s[2] += c; s[3] += d; s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+    }
+
+public:
+    static constexpr size_t OUTPUT_SIZE = 32;
+
+    Sha256() {
+        static const uint32_t init[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        memcpy(state, init, sizeof(state));
+    }
+
+    Sha256& update(const uint8_t* data, size_t len) {
+        total += len;
+        if (buffered) {
+            size_t take = std::min(len, 64 - buffered);
+            memcpy(buffer + buffered, data, take);
+            buffered += take; data += take; len -= take;
+            if (buffered < 64) return *this;
+            transform(state, buffer);
+            buffered = 0;
+        }
+        for (; len >= 64; data += 64, len -= 64) transform(state, data);
+        memcpy(buffer, data, len);
+        buffered = len;
+        return *this;
+    }
+
+    void finalize(uint8_t out[OUTPUT_SIZE]) {
+        uint8_t pad[72] = {0x80};
+        uint8_t lenBytes[8];
+        walletcrypto_detail::writeBE64(lenBytes, total * 8);
+        update(pad, 1 + ((119 - (total % 64)) % 64));
+        update(lenBytes, 8);
+        for (int i = 0; i < 8; i++) walletcrypto_detail::writeBE32(out + 4 * i, state[i]);
+    }
+
+    static void hash(const uint8_t* data, size_t len, uint8_t out[OUTPUT_SIZE]) {
+        Sha256().update(data, len).finalize(out);
+    }
+
+    // Bitcoin's double SHA-256
+    static void hash256(const uint8_t* data, size_t len, uint8_t out[OUTPUT_SIZE]) {
+        uint8_t first[OUTPUT_SIZE];
+        hash(data, len, first);
+        hash(first, sizeof(first), out);
+    }
+};
+
+// SHA-512
+class Sha512 {
+private:
+    uint64_t state[8];
+    uint8_t buffer[128];
+    uint64_t total = 0;
+    size_t buffered = 0;
+
+    static const uint64_t* constants() {
+        static const uint64_t K[80] = {
+            0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+            0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+            0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+            0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+            0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+            0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+            0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+            0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+            0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+            0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+            0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+            0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+            0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+            0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+            0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+            0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+            0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+            0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+            0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+            0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+        };
+        return K;
+    }
+
+    static const uint64_t* initialState() {
+        static const uint64_t init[8] = {
+            0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+            0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+        };
+        return init;
+    }
+
+    // Compresses one block already expanded into the first 16 message words.
+    static void compress(uint64_t* s, uint64_t* w) {
+        using walletcrypto_detail::rotr64;
+        const uint64_t* K = constants();
+        for (int i = 16; i < 80; i++) {
+            uint64_t s0 = rotr64(w[i - 15], 1) ^ rotr64(w[i - 15], 8) ^ (w[i - 15] >> 7);
+            uint64_t s1 = rotr64(w[i - 2], 19) ^ rotr64(w[i - 2], 61) ^ (w[i - 2] >> 6);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint64_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+        for (int i = 0; i < 80; i++) {
+            uint64_t t1 = h + (rotr64(e, 14) ^ rotr64(e, 18) ^ rotr64(e, 41)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint64_t t2 = (rotr64(a, 28) ^ rotr64(a, 34) ^ rotr64(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+        }
+        s[0] += a; s[1] += b; s[2] += c; s[3] += d; s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+    }
+
+    static void transform(uint64_t* s, const uint8_t* chunk) {
+        uint64_t w[80];
+        for (int i = 0; i < 16; i++) w[i] = walletcrypto_detail::readBE64(chunk + 8 * i);
+        compress(s, w);
+    }
+
+public:
+    static constexpr size_t OUTPUT_SIZE = 64;
+
+    Sha512() { memcpy(state, initialState(), sizeof(state)); }
+
+    Sha512& update(const uint8_t* data, size_t len) {
+        total += len;
+        if (buffered) {
+            size_t take = std::min(len, 128 - buffered);
+            memcpy(buffer + buffered, data, take);
+            buffered += take; data += take; len -= take;
+            if (buffered < 128) return *this;
+            transform(state, buffer);
+            buffered = 0;
+        }
+        for (; len >= 128; data += 128, len -= 128) transform(state, data);
+        memcpy(buffer, data, len);
+        buffered = len;
+        return *this;
+    }
+
+    void finalize(uint8_t out[OUTPUT_SIZE]) {
+        uint8_t pad[144] = {0x80};
+        uint8_t lenBytes[16] = {0};
+        walletcrypto_detail::writeBE64(lenBytes + 8, total * 8);
+        update(pad, 1 + ((239 - (total % 128)) % 128));
+        update(lenBytes, 16);
+        for (int i = 0; i < 8; i++) walletcrypto_detail::writeBE64(out + 8 * i, state[i]);
+    }
+
+    static void hash(const uint8_t* data, size_t len, uint8_t out[OUTPUT_SIZE]) {
+        Sha512().update(data, len).finalize(out);
+    }
+
+    // Replaces digest with SHA-512(digest) `rounds` times. Every round hashes
+    // exactly one 64-byte message, so the padding block is fixed and the loop
+    // never touches the byte-oriented update path.
+    static void rehash(uint8_t digest[OUTPUT_SIZE], uint64_t rounds) {
+        if (rounds == 0) return;
+        uint64_t h[8], w[80];
+        for (int i = 0; i < 8; i++) h[i] = walletcrypto_detail::readBE64(digest + 8 * i);
+        for (uint64_t r = 0; r < rounds; r++) {
+            uint64_t s[8];
+            memcpy(s, initialState(), sizeof(s));
+            memcpy(w, h, sizeof(h));
+            w[8] = 0x8000000000000000ULL;
+            for (int i = 9; i < 15; i++) w[i] = 0;
+            w[15] = 512;
+            compress(s, w);
+            memcpy(h, s, sizeof(h));
+        }
+        for (int i = 0; i < 8; i++) walletcrypto_detail::writeBE64(digest + 8 * i, h[i]);
+    }
+};
+
+// HMAC-SHA512. The key's padded blocks are hashed once, so a key that
+// authenticates many messages (a BIP32 chain code) costs two compressions
+// per short message.
+class HmacSha512 {
+private:
+    Sha512 inner;
+    Sha512 outer;
+
+public:
+    static constexpr size_t OUTPUT_SIZE = Sha512::OUTPUT_SIZE;
+
+    HmacSha512(const uint8_t* key, size_t len) {
+        uint8_t block[128] = {0};
+        if (len > sizeof(block)) Sha512::hash(key, len, block);
+        else memcpy(block, key, len);
+        for (uint8_t& b : block) b ^= 0x36;
+        inner.update(block, sizeof(block));
+        for (uint8_t& b : block) b ^= 0x36 ^ 0x5c;
+        outer.update(block, sizeof(block));
+        volatile uint8_t* wipe = block;
+        for (size_t i = 0; i < sizeof(block); i++) wipe[i] = 0;
+    }
+
+    void mac(const uint8_t* data, size_t len, uint8_t out[OUTPUT_SIZE]) const {
+        uint8_t digest[Sha512::OUTPUT_SIZE];
+        Sha512(inner).update(data, len).finalize(digest);
+        Sha512(outer).update(digest, sizeof(digest)).finalize(out);
+        volatile uint8_t* wipe = digest;
+        for (size_t i = 0; i < sizeof(digest); i++) wipe[i] = 0;
+    }
+};
+
+// RIPEMD-160
+class Ripemd160 {
+private:
+    uint32_t state[5];
+    uint8_t buffer[64];
+    uint64_t total = 0;
+    size_t buffered = 0;
+
+    static void transform(uint32_t* s, const uint8_t* chunk) {
+        using namespace walletcrypto_detail;
+        static const uint8_t RL[80] = {
+            0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+            7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+            3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+            1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+            4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13
+        };
+        static const uint8_t RR[80] = {
+            5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+            6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+            15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+            8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+            12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11
+        };
+        static const uint8_t SL[80] = {
+            11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+            7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+            11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+            11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+            9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6
+        };
+        static const uint8_t SR[80] = {
+            8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+            9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+            9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+            15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+            8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11
+        };
+        static const uint32_t KL[5] = {0x00000000, 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xA953FD4E};
+        static const uint32_t KR[5] = {0x50A28BE6, 0x5C4DD124, 0x6D703EF3, 0x7A6D76E9, 0x00000000};
+        auto f = [](int j, uint32_t x, uint32_t y, uint32_t z) -> uint32_t {
+            switch (j / 16) {
+                case 0: return x ^ y ^ z;
+                case 1: return (x & y) | (~x & z);
+                case 2: return (x | ~y) ^ z;
+                case 3: return (x & z) | (y & ~z);
+                default: return x ^ (y | ~z);
+            }
+        };
+        uint32_t x[16];
+        for (int i = 0; i < 16; i++) x[i] = readLE32(chunk + 4 * i);
+        uint32_t al = s[0], bl = s[1], cl = s[2], dl = s[3], el = s[4];
+        uint32_t ar = s[0], br = s[1], cr = s[2], dr = s[3], er = s[4];
+        for (int j = 0; j < 80; j++) {
+            uint32_t t = rotl32(al + f(j, bl, cl, dl) + x[RL[j]] + KL[j / 16], SL[j]) + el;
+            al = el; el = dl; dl = rotl32(cl, 10); cl = bl; bl = t;
+            t = rotl32(ar + f(79 - j, br, cr, dr) + x[RR[j]] + KR[j / 16], SR[j]) + er;
+            ar = er; er = dr; dr = rotl32(cr, 10); cr = br; br = t;
+        }
+        uint32_t t = s[1] + cl + dr;
+        s[1] = s[2] + dl + er;
+        s[2] = s[3] + el + ar;
+        s[3] = s[4] + al + br;
+        s[4] = s[0] + bl + cr;
+        s[0] = t;
+    }
+
+public:
+    static constexpr size_t OUTPUT_SIZE = 20;
+
+    Ripemd160() {
+        state[0] = 0x67452301; state[1] = 0xEFCDAB89; state[2] = 0x98BADCFE;
+        state[3] = 0x10325476; state[4] = 0xC3D2E1F0;
+    }
+
+    Ripemd160& update(const uint8_t* data, size_t len) {
+        total += len;
+        if (buffered) {
+            size_t take = std::min(len, 64 - buffered);
+            memcpy(buffer + buffered, data, take);
+            buffered += take; data += take; len -= take;
+            if (buffered < 64) return *this;
+            transform(state, buffer);
+            buffered = 0;
+        }
+        for (; len >= 64; data += 64, len -= 64) transform(state, data);
+        memcpy(buffer, data, len);
+        buffered = len;
+        return *this;
+    }
+
+    void finalize(uint8_t out[OUTPUT_SIZE]) {
+        uint8_t pad[72] = {0x80};
+        uint8_t lenBytes[8];
+        uint64_t bits = total * 8;
+        for (int i = 0; i < 8; i++) lenBytes[i] = uint8_t(bits >> (8 * i));
+        update(pad, 1 + ((119 - (total % 64)) % 64));
+        update(lenBytes, 8);
+        for (int i = 0; i < 5; i++) walletcrypto_detail::writeLE32(out + 4 * i, state[i]);
+    }
+
+    static void hash(const uint8_t* data, size_t len, uint8_t out[OUTPUT_SIZE]) {
+        Ripemd160().update(data, len).finalize(out);
+    }
+
+    // RIPEMD-160(SHA-256(data)), the key/script id used by addresses
+    static void hash160(const uint8_t* data, size_t len, uint8_t out[OUTPUT_SIZE]) {
+        uint8_t sha[Sha256::OUTPUT_SIZE];
+        Sha256::hash(data, len, sha);
+        hash(sha, sizeof(sha), out);
+    }
+};
+
+// AES-256 block cipher with CBC helpers
+class Aes256 {
+private:
+    struct Tables {
+        uint8_t sbox[256];
+        uint8_t inv[256];
+        uint32_t te[4][256];
+        uint32_t td[4][256];
+    };
+
+    static uint8_t xtime(uint8_t x) { return uint8_t((x << 1) ^ ((x & 0x80) ? 0x1b : 0)); }
+
+    static uint8_t gmul(uint8_t a, uint8_t b) {
+        uint8_t r = 0;
+        while (b) {
+            if (b & 1) r ^= a;
+            a = xtime(a);
+            b >>= 1;
+        }
+        return r;
+    }
+
+    static const Tables& tables() {
+        static const Tables t = [] {
+            Tables tb;
+            // Generate the S-box from the multiplicative inverse in GF(2^8)
+            uint8_t p = 1, q = 1;
+            tb.sbox[0] = 0x63;
+            do {
+                p = p ^ uint8_t(p << 1) ^ ((p & 0x80) ? 0x1b : 0);
+                q ^= q << 1; q ^= q << 2; q ^= q << 4;
+                if (q & 0x80) q ^= 0x09;
+                uint8_t x = q ^ uint8_t((q << 1) | (q >> 7)) ^ uint8_t((q << 2) | (q >> 6))
+                              ^ uint8_t((q << 3) | (q >> 5)) ^ uint8_t((q << 4) | (q >> 4));
+                tb.sbox[p] = x ^ 0x63;
+            } while (p != 1);
+            for (int i = 0; i < 256; i++) tb.inv[tb.sbox[i]] = uint8_t(i);
+            for (int i = 0; i < 256; i++) {
+                uint8_t s = tb.sbox[i];
+                uint32_t e = (uint32_t(gmul(s, 2)) << 24) | (uint32_t(s) << 16) | (uint32_t(s) << 8) | gmul(s, 3);
+                uint8_t v = tb.inv[i];
+                uint32_t d = (uint32_t(gmul(v, 14)) << 24) | (uint32_t(gmul(v, 9)) << 16)
+                           | (uint32_t(gmul(v, 13)) << 8) | gmul(v, 11);
+                for (int r = 0; r < 4; r++) {
+                    tb.te[r][i] = walletcrypto_detail::rotr32(e, 8 * r);
+                    tb.td[r][i] = walletcrypto_detail::rotr32(d, 8 * r);
+                }
+            }
+            return tb;
+        }();
+        return t;
+    }
+
+    uint32_t encKeys[60];
+    uint32_t decKeys[60];
+
+public:
+    static constexpr size_t KEY_SIZE = 32;
+    static constexpr size_t BLOCK_SIZE = 16;
+
+    explicit Aes256(const uint8_t key[KEY_SIZE]) {
+        using walletcrypto_detail::readBE32;
+        const Tables& t = tables();
+        for (int i = 0; i < 8; i++) encKeys[i] = readBE32(key + 4 * i);
+        uint8_t rcon = 1;
+        for (int i = 8; i < 60; i++) {
+            uint32_t tmp = encKeys[i - 1];
+            if (i % 8 == 0) {
+                tmp = (uint32_t(t.sbox[(tmp >> 16) & 0xff]) << 24) | (uint32_t(t.sbox[(tmp >> 8) & 0xff]) << 16)
+                    | (uint32_t(t.sbox[tmp & 0xff]) << 8) | t.sbox[tmp >> 24];
+                tmp ^= uint32_t(rcon) << 24;
+                rcon = xtime(rcon);
+            } else if (i % 8 == 4) {
+                tmp = (uint32_t(t.sbox[tmp >> 24]) << 24) | (uint32_t(t.sbox[(tmp >> 16) & 0xff]) << 16)
+                    | (uint32_t(t.sbox[(tmp >> 8) & 0xff]) << 8) | t.sbox[tmp & 0xff];
+            }
+            encKeys[i] = encKeys[i - 8] ^ tmp;
+        }
+        // Equivalent inverse cipher schedule: reversed rounds with InvMixColumns applied
+        for (int r = 0; r <= 14; r++) {
+            for (int c = 0; c < 4; c++) {
+                uint32_t k = encKeys[(14 - r) * 4 + c];
+                if (r > 0 && r < 14) {
+                    k = t.td[0][t.sbox[k >> 24]] ^ t.td[1][t.sbox[(k >> 16) & 0xff]]
+                      ^ t.td[2][t.sbox[(k >> 8) & 0xff]] ^ t.td[3][t.sbox[k & 0xff]];
+                }
+                decKeys[r * 4 + c] = k;
+            }
+        }
+    }
+
+    ~Aes256() {
+        volatile uint32_t* e = encKeys;
+        volatile uint32_t* d = decKeys;
+        for (int i = 0; i < 60; i++) { e[i] = 0; d[i] = 0; }
+    }
+
+    void encryptBlock(const uint8_t in[BLOCK_SIZE], uint8_t out[BLOCK_SIZE]) const {
+        using namespace walletcrypto_detail;
+        const Tables& t = tables();
+        uint32_t s0 = readBE32(in) ^ encKeys[0], s1 = readBE32(in + 4) ^ encKeys[1];
+        uint32_t s2 = readBE32(in + 8) ^ encKeys[2], s3 = readBE32(in + 12) ^ encKeys[3];
+        for (int r = 1; r < 14; r++) {
+            const uint32_t* k = encKeys + 4 * r;
+            uint32_t t0 = t.te[0][s0 >> 24] ^ t.te[1][(s1 >> 16) & 0xff] ^ t.te[2][(s2 >> 8) & 0xff] ^ t.te[3][s3 & 0xff] ^ k[0];
+            uint32_t t1 = t.te[0][s1 >> 24] ^ t.te[1][(s2 >> 16) & 0xff] ^ t.te[2][(s3 >> 8) & 0xff] ^ t.te[3][s0 & 0xff] ^ k[1];
+            uint32_t t2 = t.te[0][s2 >> 24] ^ t.te[1][(s3 >> 16) & 0xff] ^ t.te[2][(s0 >> 8) & 0xff] ^ t.te[3][s1 & 0xff] ^ k[2];
+            uint32_t t3 = t.te[0][s3 >> 24] ^ t.te[1][(s0 >> 16) & 0xff] ^ t.te[2][(s1 >> 8) & 0xff] ^ t.te[3][s2 & 0xff] ^ k[3];
+            s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+        }
+        const uint32_t* k = encKeys + 56;
+        auto last = [&](uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t key) {
+            return ((uint32_t(t.sbox[a >> 24]) << 24) | (uint32_t(t.sbox[(b >> 16) & 0xff]) << 16)
+                  | (uint32_t(t.sbox[(c >> 8) & 0xff]) << 8) | t.sbox[d & 0xff]) ^ key;
+        };
+        writeBE32(out, last(s0, s1, s2, s3, k[0]));
+        writeBE32(out + 4, last(s1, s2, s3, s0, k[1]));
+        writeBE32(out + 8, last(s2, s3, s0, s1, k[2]));
+        writeBE32(out + 12, last(s3, s0, s1, s2, k[3]));
+    }
+
+    void decryptBlock(const uint8_t in[BLOCK_SIZE], uint8_t out[BLOCK_SIZE]) const {
+        using namespace walletcrypto_detail;
+        const Tables& t = tables();
+        uint32_t s0 = readBE32(in) ^ decKeys[0], s1 = readBE32(in + 4) ^ decKeys[1];
+        uint32_t s2 = readBE32(in + 8) ^ decKeys[2], s3 = readBE32(in + 12) ^ decKeys[3];
+        for (int r = 1; r < 14; r++) {
+            const uint32_t* k = decKeys + 4 * r;
+            uint32_t t0 = t.td[0][s0 >> 24] ^ t.td[1][(s3 >> 16) & 0xff] ^ t.td[2][(s2 >> 8) & 0xff] ^ t.td[3][s1 & 0xff] ^ k[0];
+            uint32_t t1 = t.td[0][s1 >> 24] ^ t.td[1][(s0 >> 16) & 0xff] ^ t.td[2][(s3 >> 8) & 0xff] ^ t.td[3][s2 & 0xff] ^ k[1];
+            uint32_t t2 = t.td[0][s2 >> 24] ^ t.td[1][(s1 >> 16) & 0xff] ^ t.td[2][(s0 >> 8) & 0xff] ^ t.td[3][s3 & 0xff] ^ k[2];
+            uint32_t t3 = t.td[0][s3 >> 24] ^ t.td[1][(s2 >> 16) & 0xff] ^ t.td[2][(s1 >> 8) & 0xff] ^ t.td[3][s0 & 0xff] ^ k[3];
+            s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+        }
+        const uint32_t* k = decKeys + 56;
+        auto last = [&](uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t key) {
+            return ((uint32_t(t.inv[a >> 24]) << 24) | (uint32_t(t.inv[(b >> 16) & 0xff]) << 16)
+                  | (uint32_t(t.inv[(c >> 8) & 0xff]) << 8) | t.inv[d & 0xff]) ^ key;
+        };
+        writeBE32(out, last(s0, s3, s2, s1, k[0]));
+        writeBE32(out + 4, last(s1, s0, s3, s2, k[1]));
+        writeBE32(out + 8, last(s2, s1, s0, s3, k[2]));
+        writeBE32(out + 12, last(s3, s2, s1, s0, k[3]));
+    }
+
+    // CBC over whole blocks; padding is the caller's business
+    void cbcEncrypt(const uint8_t iv[BLOCK_SIZE], const uint8_t* in, uint8_t* out, size_t len) const {
+        uint8_t chain[BLOCK_SIZE];
+        memcpy(chain, iv, BLOCK_SIZE);
+        for (size_t off = 0; off + BLOCK_SIZE <= len; off += BLOCK_SIZE) {
+            for (size_t i = 0; i < BLOCK_SIZE; i++) chain[i] ^= in[off + i];
+            encryptBlock(chain, out + off);
+            memcpy(chain, out + off, BLOCK_SIZE);
+        }
+    }
+
+    void cbcDecrypt(const uint8_t iv[BLOCK_SIZE], const uint8_t* in, uint8_t* out, size_t len) const {
+        uint8_t chain[BLOCK_SIZE], next[BLOCK_SIZE];
+        memcpy(chain, iv, BLOCK_SIZE);
+        for (size_t off = 0; off + BLOCK_SIZE <= len; off += BLOCK_SIZE) {
+            memcpy(next, in + off, BLOCK_SIZE);
+            decryptBlock(in + off, out + off);
+            for (size_t i = 0; i < BLOCK_SIZE; i++) out[off + i] ^= chain[i];
+            memcpy(chain, next, BLOCK_SIZE);
+        }
+    }
+};
+
+// secp256k1 arithmetic, enough to derive and serialize public keys
+class Secp256k1 {
+public:
+    struct Fe { uint64_t v[4]; };                  // little-endian limbs, always < p
+    struct Affine { Fe x, y; bool infinity; };
+    struct Jacobian { Fe x, y, z; bool infinity; };
+
+    static constexpr size_t COMPRESSED_SIZE = 33;
+    static constexpr size_t UNCOMPRESSED_SIZE = 65;
+
+private:
+    using u128 = unsigned __int128;
+    static constexpr uint64_t P_FOLD = 0x1000003D1ULL;   // 2^256 - p
+
+    static bool geP(const uint64_t* a) {
+        // p = FFFFFFFF...FFFFFFFE FFFFFC2F
+        if (a[3] != ~0ULL || a[2] != ~0ULL || a[1] != ~0ULL) return false;
+        return a[0] >= 0xFFFFFFFEFFFFFC2FULL;
+    }
+
+    static void reduce512(Fe& r, const uint64_t w[8]) {
+        u128 c = 0;
+        uint64_t t[4];
+        for (int i = 0; i < 4; i++) {
+            c += u128(w[i + 4]) * P_FOLD + w[i];
+            t[i] = uint64_t(c);
+            c >>= 64;
+        }
+        c = c * P_FOLD;
+        for (int i = 0; i < 4; i++) {
+            c += t[i];
+            t[i] = uint64_t(c);
+            c >>= 64;
+        }
+        if (c) {
+            // wrapped past 2^256 once more; the remainder is tiny
+            c = u128(t[0]) + P_FOLD;
+            t[0] = uint64_t(c); c >>= 64;
+            for (int i = 1; i < 4 && c; i++) { c += t[i]; t[i] = uint64_t(c); c >>= 64; }
+        }
+        if (geP(t)) {
+            c = u128(t[0]) + P_FOLD;
+            t[0] = uint64_t(c); c >>= 64;
+            for (int i = 1; i < 4; i++) { c += t[i]; t[i] = uint64_t(c); c >>= 64; }
+        }
+        memcpy(r.v, t, sizeof(t));
+    }
+
+public:
+    static Fe feFromInt(uint64_t x) { return Fe{{x, 0, 0, 0}}; }
+
+    static bool feIsZero(const Fe& a) { return (a.v[0] | a.v[1] | a.v[2] | a.v[3]) == 0; }
+
+    static bool feEqual(const Fe& a, const Fe& b) { return memcmp(a.v, b.v, sizeof(a.v)) == 0; }
+
+    static Fe feAdd(const Fe& a, const Fe& b) {
+        uint64_t w[8] = {0};
+        u128 c = 0;
+        for (int i = 0; i < 4; i++) { c += u128(a.v[i]) + b.v[i]; w[i] = uint64_t(c); c >>= 64; }
+        w[4] = uint64_t(c);
+        Fe r;
+        reduce512(r, w);
+        return r;
+    }
+
+    static Fe feNeg(const Fe& a) {
+        if (feIsZero(a)) return a;
+        static const uint64_t P[4] = {0xFFFFFFFEFFFFFC2FULL, ~0ULL, ~0ULL, ~0ULL};
+        Fe r;
+        uint64_t borrow = 0;
+        for (int i = 0; i < 4; i++) {
+            u128 d = u128(P[i]) - a.v[i] - borrow;
+            r.v[i] = uint64_t(d);
+            borrow = (d >> 64) ? 1 : 0;
+        }
+        return r;
+    }
+
+    static Fe feSub(const Fe& a, const Fe& b) { return feAdd(a, feNeg(b)); }
+
+    static Fe feMul(const Fe& a, const Fe& b) {
+        uint64_t w[8] = {0};
+        for (int i = 0; i < 4; i++) {
+            u128 c = 0;
+            for (int j = 0; j < 4; j++) {
+                c += u128(a.v[i]) * b.v[j] + w[i + j];
+                w[i + j] = uint64_t(c);
+                c >>= 64;
+            }
+            w[i + 4] = uint64_t(c);
+        }
+        Fe r;
+        reduce512(r, w);
+        return r;
+    }
+
+    static Fe feSqr(const Fe& a) { return feMul(a, a); }
+
+    static Fe feMulInt(const Fe& a, uint64_t k) {
+        uint64_t w[8] = {0};
+        u128 c = 0;
+        for (int i = 0; i < 4; i++) { c += u128(a.v[i]) * k; w[i] = uint64_t(c); c >>= 64; }
+        w[4] = uint64_t(c);
+        Fe r;
+        reduce512(r, w);
+        return r;
+    }
+
+    // a^(p-2) by plain square-and-multiply
+    static Fe feInv(const Fe& a) {
+        static const uint64_t E[4] = {0xFFFFFFFEFFFFFC2DULL, ~0ULL, ~0ULL, ~0ULL};
+        Fe r = feFromInt(1);
+        for (int i = 255; i >= 0; i--) {
+            r = feSqr(r);
+            if ((E[i / 64] >> (i % 64)) & 1) r = feMul(r, a);
+        }
+        return r;
+    }
+
+    static Fe feFromBytes(const uint8_t in[32]) {
+        Fe r;
+        for (int i = 0; i < 4; i++) r.v[i] = walletcrypto_detail::readBE64(in + 8 * (3 - i));
+        return r;
+    }
+
+    static void feToBytes(const Fe& a, uint8_t out[32]) {
+        for (int i = 0; i < 4; i++) walletcrypto_detail::writeBE64(out + 8 * (3 - i), a.v[i]);
+    }
+
+    static Jacobian toJacobian(const Affine& a) {
+        return Jacobian{a.x, a.y, feFromInt(1), a.infinity};
+    }
+
+    static Affine toAffine(const Jacobian& p) {
+        if (p.infinity) return Affine{feFromInt(0), feFromInt(0), true};
+        Fe zi = feInv(p.z);
+        Fe zi2 = feSqr(zi);
+        return Affine{feMul(p.x, zi2), feMul(p.y, feMul(zi2, zi)), false};
+    }
+
+    // Converts many points with a single field inversion (Montgomery's trick)
+    static void toAffineBatch(const Jacobian* in, Affine* out, size_t n) {
+        std::vector<Fe> prefix(n);
+        Fe acc = feFromInt(1);
+        for (size_t i = 0; i < n; i++) {
+            prefix[i] = acc;
+            if (!in[i].infinity) acc = feMul(acc, in[i].z);
+        }
+        Fe inv = feInv(acc);
+        for (size_t i = n; i-- > 0;) {
+            if (in[i].infinity) { out[i] = Affine{feFromInt(0), feFromInt(0), true}; continue; }
+            Fe zi = feMul(inv, prefix[i]);
+            inv = feMul(inv, in[i].z);
+            Fe zi2 = feSqr(zi);
+            out[i] = Affine{feMul(in[i].x, zi2), feMul(in[i].y, feMul(zi2, zi)), false};
+        }
+    }
+
+    static Jacobian pointDouble(const Jacobian& p) {
+        if (p.infinity || feIsZero(p.y)) return Jacobian{feFromInt(0), feFromInt(0), feFromInt(0), true};
+        Fe a = feSqr(p.x);
+        Fe b = feSqr(p.y);
+        Fe c = feSqr(b);
+        Fe d = feMulInt(feSub(feSqr(feAdd(p.x, b)), feAdd(a, c)), 2);
+        Fe e = feMulInt(a, 3);
+        Fe f = feSqr(e);
+        Jacobian r;
+        r.x = feSub(f, feMulInt(d, 2));
+        r.y = feSub(feMul(e, feSub(d, r.x)), feMulInt(c, 8));
+        r.z = feMulInt(feMul(p.y, p.z), 2);
+        r.infinity = false;
+        return r;
+    }
+
+    // Mixed addition of a Jacobian and an affine point
+    static Jacobian pointAdd(const Jacobian& p, const Affine& q) {
+        if (q.infinity) return p;
+        if (p.infinity) return toJacobian(q);
+        Fe z2 = feSqr(p.z);
+        Fe u2 = feMul(q.x, z2);
+        Fe s2 = feMul(q.y, feMul(z2, p.z));
+        Fe h = feSub(u2, p.x);
+        Fe rr = feSub(s2, p.y);
+        if (feIsZero(h)) {
+            if (feIsZero(rr)) return pointDouble(p);
+            return Jacobian{feFromInt(0), feFromInt(0), feFromInt(0), true};
+        }
+        Fe h2 = feSqr(h);
+        Fe h3 = feMul(h2, h);
+        Fe v = feMul(p.x, h2);
+        Jacobian r;
+        r.x = feSub(feSub(feSqr(rr), h3), feMulInt(v, 2));
+        r.y = feSub(feMul(rr, feSub(v, r.x)), feMul(p.y, h3));
+        r.z = feMul(p.z, h);
+        r.infinity = false;
+        return r;
+    }
+
+    static const Affine& generator() {
+        static const Affine g = [] {
+            static const uint8_t gx[32] = {
+                0x79, 0xBE, 0x66, 0x7E, 0xF9, 0xDC, 0xBB, 0xAC, 0x55, 0xA0, 0x62, 0x95, 0xCE, 0x87, 0x0B, 0x07,
+                0x02, 0x9B, 0xFC, 0xDB, 0x2D, 0xCE, 0x28, 0xD9, 0x59, 0xF2, 0x81, 0x5B, 0x16, 0xF8, 0x17, 0x98
+            };
+            static const uint8_t gy[32] = {
+                0x48, 0x3A, 0xDA, 0x77, 0x26, 0xA3, 0xC4, 0x65, 0x5D, 0xA4, 0xFB, 0xFC, 0x0E, 0x11, 0x08, 0xA8,
+                0xFD, 0x17, 0xB4, 0x48, 0xA6, 0x85, 0x54, 0x19, 0x9C, 0x47, 0xD0, 0x8F, 0xFB, 0x10, 0xD4, 0xB8
+            };
+            return Affine{feFromBytes(gx), feFromBytes(gy), false};
+        }();
+        return g;
+    }
+
+    // True for 0 < k < n
+    static bool isValidPrivateKey(const uint8_t key[32]) {
+        static const uint8_t N[32] = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE,
+            0xBA, 0xAE, 0xDC, 0xE6, 0xAF, 0x48, 0xA0, 0x3B, 0xBF, 0xD2, 0x5E, 0x8C, 0xD0, 0x36, 0x41, 0x41
+        };
+        static const uint8_t zero[32] = {0};
+        return memcmp(key, zero, 32) != 0 && memcmp(key, N, 32) < 0;
+    }
+
+    // k*G using a fixed 4-bit window table: 64 mixed additions, no doublings
+    static Jacobian multiplyGenerator(const uint8_t key[32]) {
+        static const std::vector<Affine> table = [] {
+            std::vector<Jacobian> jac(64 * 16);
+            Jacobian base = toJacobian(generator());
+            for (int w = 0; w < 64; w++) {
+                Jacobian acc{feFromInt(0), feFromInt(0), feFromInt(0), true};
+                Affine baseAffine = toAffine(base);
+                for (int d = 0; d < 16; d++) {
+                    jac[w * 16 + d] = acc;
+                    acc = pointAdd(acc, baseAffine);
+                }
+                base = acc;   // 16 * base
+            }
+            std::vector<Affine> aff(jac.size());
+            toAffineBatch(jac.data(), aff.data(), jac.size());
+            return aff;
+        }();
+        Jacobian r{feFromInt(0), feFromInt(0), feFromInt(0), true};
+        for (int w = 0; w < 64; w++) {
+            int nibble = (key[31 - w / 2] >> ((w % 2) * 4)) & 0x0f;
+            if (nibble) r = pointAdd(r, table[w * 16 + nibble]);
+        }
+        return r;
+    }
+
+    // The point of a serialized public key; false if it is not on the curve
+    static bool parse(const uint8_t* in, size_t len, Affine& out) {
+        if (len != COMPRESSED_SIZE && len != UNCOMPRESSED_SIZE) return false;
+        if (len == COMPRESSED_SIZE ? (in[0] != 0x02 && in[0] != 0x03) : in[0] != 0x04) return false;
+        uint64_t limbs[4];
+        for (int i = 0; i < 4; i++) limbs[i] = walletcrypto_detail::readBE64(in + 1 + 8 * (3 - i));
+        if (geP(limbs)) return false;
+        out.x = feFromBytes(in + 1);
+        out.infinity = false;
+        Fe curve = feAdd(feMul(feSqr(out.x), out.x), feFromInt(7));
+        if (len == UNCOMPRESSED_SIZE) {
+            for (int i = 0; i < 4; i++) limbs[i] = walletcrypto_detail::readBE64(in + 33 + 8 * (3 - i));
+            if (geP(limbs)) return false;
+            out.y = feFromBytes(in + 33);
+            return feEqual(feSqr(out.y), curve);
+        }
+        // y = curve^((p + 1) / 4), the square root when there is one
+        static const uint64_t E[4] = {0xFFFFFFFFBFFFFF0CULL, ~0ULL, ~0ULL, 0x3FFFFFFFFFFFFFFFULL};
+        Fe y = feFromInt(1);
+        for (int i = 255; i >= 0; i--) {
+            y = feSqr(y);
+            if ((E[i / 64] >> (i % 64)) & 1) y = feMul(y, curve);
+        }
+        if (!feEqual(feSqr(y), curve)) return false;
+        if ((y.v[0] & 1) != (in[0] & 1)) y = feNeg(y);
+        out.y = y;
+        return true;
+    }
+
+    // (a + b) mod n for scalars below n; false when the sum is zero
+    static bool addScalars(const uint8_t a[32], const uint8_t b[32], uint8_t out[32]) {
+        static const uint64_t N[4] = {0xBFD25E8CD0364141ULL, 0xBAAEDCE6AF48A03BULL, 0xFFFFFFFFFFFFFFFEULL, ~0ULL};
+        uint64_t sum[4];
+        u128 carry = 0;
+        for (int i = 0; i < 4; i++) {
+            carry += u128(walletcrypto_detail::readBE64(a + 8 * (3 - i))) + walletcrypto_detail::readBE64(b + 8 * (3 - i));
+            sum[i] = uint64_t(carry);
+            carry >>= 64;
+        }
+        bool reduce = carry != 0;
+        for (int i = 3; i >= 0 && !reduce; i--) {
+            if (sum[i] != N[i]) {
+                reduce = sum[i] > N[i];
+                break;
+            }
+            if (i == 0) reduce = true;
+        }
+        if (reduce) {
+            uint64_t borrow = 0;
+            for (int i = 0; i < 4; i++) {
+                u128 d = u128(sum[i]) - N[i] - borrow;
+                sum[i] = uint64_t(d);
+                borrow = (d >> 64) ? 1 : 0;
+            }
+        }
+        for (int i = 0; i < 4; i++) walletcrypto_detail::writeBE64(out + 8 * (3 - i), sum[i]);
+        bool zero = (sum[0] | sum[1] | sum[2] | sum[3]) == 0;
+        volatile uint64_t* wipe = sum;
+        for (int i = 0; i < 4; i++) wipe[i] = 0;
+        return !zero;
+    }
+
+    static size_t serialize(const Affine& p, bool compressed, uint8_t* out) {
+        if (compressed) {
+            out[0] = (p.y.v[0] & 1) ? 0x03 : 0x02;
+            feToBytes(p.x, out + 1);
+            return COMPRESSED_SIZE;
+        }
+        out[0] = 0x04;
+        feToBytes(p.x, out + 1);
+        feToBytes(p.y, out + 33);
+        return UNCOMPRESSED_SIZE;
+    }
+
+    // Serialized public key for a private key; returns 0 for an invalid key
+    static size_t derivePublicKey(const uint8_t key[32], bool compressed, uint8_t* out) {
+        if (!isValidPrivateKey(key)) return 0;
+        return serialize(toAffine(multiplyGenerator(key)), compressed, out);
+    }
+};
+
+// Base58 / Base58Check encoding
+class Base58 {
+public:
+    // Longest Base58Check string the tools produce (extended keys)
+    static constexpr size_t MAX_ENCODED = 112;
+
+    // Writes a NUL-terminated encoding into out; returns its length or 0 if
+    // it does not fit. Scratch space stays on the stack and is wiped, so
+    // secret payloads (WIF) never touch the heap.
+    static size_t encode(const uint8_t* data, size_t len, char* out, size_t cap) {
+        static const char* alphabet = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+        uint8_t digits[MAX_ENCODED * 2];
+        size_t zeros = 0;
+        while (zeros < len && data[zeros] == 0) zeros++;
+        size_t size = (len - zeros) * 138 / 100 + 1;
+        if (size > sizeof(digits)) return 0;
+        memset(digits, 0, size);
+        size_t used = 0;
+        for (size_t i = zeros; i < len; i++) {
+            uint32_t carry = data[i];
+            size_t j = 0;
+            for (size_t k = size; (carry || j < used) && k-- > 0; j++) {
+                carry += 256u * digits[k];
+                digits[k] = uint8_t(carry % 58);
+                carry /= 58;
+            }
+            used = j;
+        }
+        size_t n = zeros + used;
+        if (n + 1 > cap) return 0;
+        memset(out, '1', zeros);
+        for (size_t k = 0; k < used; k++) out[zeros + k] = alphabet[digits[size - used + k]];
+        out[n] = 0;
+        volatile uint8_t* wipe = digits;
+        for (size_t i = 0; i < size; i++) wipe[i] = 0;
+        return n;
+    }
+
+    static size_t encodeCheck(const uint8_t* data, size_t len, char* out, size_t cap) {
+        uint8_t buf[96];
+        if (len + 4 > sizeof(buf)) return 0;
+        memcpy(buf, data, len);
+        uint8_t hash[Sha256::OUTPUT_SIZE];
+        Sha256::hash256(data, len, hash);
+        memcpy(buf + len, hash, 4);
+        size_t n = encode(buf, len + 4, out, cap);
+        volatile uint8_t* wipe = buf;
+        for (size_t i = 0; i < sizeof(buf); i++) wipe[i] = 0;
+        return n;
+    }
+
+    static std::string encode(const uint8_t* data, size_t len) {
+        char out[MAX_ENCODED * 2];
+        return std::string(out, encode(data, len, out, sizeof(out)));
+    }
+
+    static std::string encodeCheck(const uint8_t* data, size_t len) {
+        char out[MAX_ENCODED * 2];
+        return std::string(out, encodeCheck(data, len, out, sizeof(out)));
+    }
+
+    // Decodes into out; returns the length or 0 for a character outside the
+    // alphabet or a result longer than cap
+    static size_t decode(const char* text, uint8_t* out, size_t cap) {
+        static const char* alphabet = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+        size_t len = strlen(text);
+        size_t zeros = 0;
+        while (zeros < len && text[zeros] == '1') zeros++;
+        uint8_t bytes[MAX_ENCODED];
+        size_t size = (len - zeros) * 733 / 1000 + 1;
+        if (size > sizeof(bytes)) return 0;
+        memset(bytes, 0, size);
+        size_t used = 0;
+        for (size_t i = zeros; i < len; i++) {
+            const char* digit = strchr(alphabet, text[i]);
+            if (!digit || !*digit) return 0;
+            uint32_t carry = uint32_t(digit - alphabet);
+            size_t j = 0;
+            for (size_t k = size; (carry || j < used) && k-- > 0; j++) {
+                carry += 58u * bytes[k];
+                bytes[k] = uint8_t(carry);
+                carry >>= 8;
+            }
+            used = j;
+        }
+        if (zeros + used > cap) return 0;
+        memset(out, 0, zeros);
+        memcpy(out + zeros, bytes + size - used, used);
+        return zeros + used;
+    }
+
+    // Decodes and checks the 4-byte checksum; returns the payload length or 0
+    static size_t decodeCheck(const char* text, uint8_t* out, size_t cap) {
+        uint8_t buf[MAX_ENCODED];
+        size_t n = decode(text, buf, sizeof(buf));
+        if (n < 4 || n - 4 > cap) return 0;
+        uint8_t hash[Sha256::OUTPUT_SIZE];
+        Sha256::hash256(buf, n - 4, hash);
+        if (memcmp(hash, buf + n - 4, 4) != 0) return 0;
+        memcpy(out, buf, n - 4);
+        return n - 4;
+    }
+};
+
+// Bech32 and Bech32m segwit addresses (BIP 173, BIP 350)
+class Bech32 {
+public:
+    static constexpr uint32_t BECH32_CONST = 1;
+    static constexpr uint32_t BECH32M_CONST = 0x2bc830a3;
+    static constexpr size_t MAX_LENGTH = 90;
+    static constexpr const char* CHARSET = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+    static uint32_t polymod(const uint8_t* values, size_t len, uint32_t chk = 1) {
+        static const uint32_t generator[5] = {0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd, 0x2a1462b3};
+        for (size_t i = 0; i < len; i++) {
+            uint8_t top = uint8_t(chk >> 25);
+            chk = ((chk & 0x1ffffff) << 5) ^ values[i];
+            for (int j = 0; j < 5; j++) {
+                if ((top >> j) & 1) chk ^= generator[j];
+            }
+        }
+        return chk;
+    }
+
+    // The checksum state after the expanded human-readable part
+    static uint32_t hrpChecksum(const char* hrp, size_t len) {
+        uint8_t expanded[2 * MAX_LENGTH + 1];
+        for (size_t i = 0; i < len; i++) {
+            expanded[i] = uint8_t(hrp[i]) >> 5;
+            expanded[len + 1 + i] = uint8_t(hrp[i]) & 31;
+        }
+        expanded[len] = 0;
+        return polymod(expanded, 2 * len + 1);
+    }
+
+    // Addresses whose checksums are computed side by side
+    static constexpr size_t LANES = 8;
+
+    // Segwit addresses for count programs of one length (programs[i *
+    // programLength ..]) under one human-readable part, each written
+    // NUL-terminated at out + i * stride. All of them have the same length,
+    // so their checksums run in lockstep, LANES at a time: the polymod step
+    // is branch-free over a lane array and the compiler keeps it in vector
+    // registers. The hrp is expanded once for all. Returns the address
+    // length, or 0 if it does not fit stride or the program is too long.
+    static size_t encodeSegwitBatch(const char* hrp, int version, const uint8_t* programs, size_t programLength,
+                                    size_t count, char* out, size_t stride) {
+        size_t hrpLength = strlen(hrp);
+        size_t dataLength = 1 + (programLength * 8 + 4) / 5;
+        size_t length = hrpLength + 1 + dataLength + 6;
+        if (programLength > 40 || length > MAX_LENGTH || length + 1 > stride) return 0;
+        uint32_t start = hrpChecksum(hrp, hrpLength);
+        uint32_t target = version == 0 ? BECH32_CONST : BECH32M_CONST;
+
+        // values[position][lane], so one position of every lane is contiguous
+        uint8_t values[MAX_LENGTH][LANES];
+        for (size_t first = 0; first < count; first += LANES) {
+            size_t lanes = std::min(LANES, count - first);
+            memset(values, 0, sizeof(values));
+            for (size_t lane = 0; lane < lanes; lane++) {
+                const uint8_t* program = programs + (first + lane) * programLength;
+                values[0][lane] = uint8_t(version);
+                uint32_t accumulator = 0;
+                int bits = 0;
+                size_t n = 1;
+                for (size_t i = 0; i < programLength; i++) {
+                    accumulator = (accumulator << 8) | program[i];
+                    bits += 8;
+                    while (bits >= 5) {
+                        bits -= 5;
+                        values[n++][lane] = uint8_t((accumulator >> bits) & 31);
+                    }
+                }
+                if (bits) values[n][lane] = uint8_t((accumulator << (5 - bits)) & 31);
+            }
+
+            // The six checksum positions stay zero while the polymod runs
+            uint32_t check[LANES];
+            for (size_t lane = 0; lane < LANES; lane++) check[lane] = start;
+            for (size_t i = 0; i < dataLength + 6; i++) {
+                for (size_t lane = 0; lane < LANES; lane++) {
+                    uint32_t top = check[lane] >> 25;
+                    uint32_t next = ((check[lane] & 0x1ffffff) << 5) ^ values[i][lane];
+                    next ^= (0u - (top & 1)) & 0x3b6a57b2;
+                    next ^= (0u - ((top >> 1) & 1)) & 0x26508e6d;
+                    next ^= (0u - ((top >> 2) & 1)) & 0x1ea119fa;
+                    next ^= (0u - ((top >> 3) & 1)) & 0x3d4233dd;
+                    next ^= (0u - ((top >> 4) & 1)) & 0x2a1462b3;
+                    check[lane] = next;
+                }
+            }
+
+            for (size_t lane = 0; lane < lanes; lane++) {
+                char* address = out + (first + lane) * stride;
+                memcpy(address, hrp, hrpLength);
+                address[hrpLength] = '1';
+                char* data = address + hrpLength + 1;
+                for (size_t i = 0; i < dataLength; i++) data[i] = CHARSET[values[i][lane]];
+                uint32_t checksum = check[lane] ^ target;
+                for (size_t i = 0; i < 6; i++) data[dataLength + i] = CHARSET[(checksum >> (5 * (5 - i))) & 31];
+                address[length] = 0;
+            }
+        }
+        return length;
+    }
+
+    static std::string encodeSegwit(const char* hrp, int version, const uint8_t* program, size_t programLength) {
+        char out[MAX_LENGTH + 1];
+        return std::string(out, encodeSegwitBatch(hrp, version, program, programLength, 1, out, sizeof(out)));
+    }
+
+    // A segwit address: its human-readable part, witness version and
+    // program. Mixed case, a bad checksum, or the wrong checksum constant
+    // for the version (Bech32 for v0, Bech32m after) all fail.
+    static bool decodeSegwit(const char* text, std::string& hrp, int& version, uint8_t* program, size_t& programLength) {
+        size_t len = strlen(text);
+        if (len < 8 || len > MAX_LENGTH) return false;
+        bool lower = false, upper = false;
+        for (size_t i = 0; i < len; i++) {
+            if (text[i] < 33 || text[i] > 126) return false;
+            lower |= text[i] >= 'a' && text[i] <= 'z';
+            upper |= text[i] >= 'A' && text[i] <= 'Z';
+        }
+        if (lower && upper) return false;
+        const char* separator = strrchr(text, '1');
+        if (!separator || separator == text || separator + 7 > text + len) return false;
+        hrp.assign(text, separator);
+        for (char& c : hrp) c = char(tolower(c));
+        uint8_t values[MAX_LENGTH];
+        size_t count = 0;
+        for (const char* c = separator + 1; *c; c++) {
+            const char* digit = strchr(CHARSET, tolower(*c));
+            if (!digit || !*digit) return false;
+            values[count++] = uint8_t(digit - CHARSET);
+        }
+        uint32_t check = polymod(values, count, hrpChecksum(hrp.data(), hrp.size()));
+        count -= 6;
+        if (count < 1) return false;
+        version = values[0];
+        if (version > 16 || check != (version == 0 ? BECH32_CONST : BECH32M_CONST)) return false;
+        // Regroup the 5-bit values after the version into bytes; leftover
+        // bits must be zero padding
+        uint32_t accumulator = 0;
+        int bits = 0;
+        programLength = 0;
+        for (size_t i = 1; i < count; i++) {
+            accumulator = (accumulator << 5) | values[i];
+            bits += 5;
+            if (bits >= 8) {
+                bits -= 8;
+                if (programLength == 40) return false;
+                program[programLength++] = uint8_t(accumulator >> bits);
+            }
+        }
+        if (bits >= 5 || (accumulator & ((1u << bits) - 1))) return false;
+        if (programLength < 2 || (version == 0 && programLength != 20 && programLength != 32)) return false;
+        return true;
+    }
+};
+
+// Bitcoin Core wallet encryption (CCrypter / CMasterKey)
+class WalletCrypto {
+public:
+    static constexpr size_t MASTER_KEY_SIZE = 32;
+    static constexpr size_t CRYPTED_KEY_SIZE = 48;   // 32 bytes + one block of PKCS#7 padding
+
+    // EVP_BytesToKey(SHA-512) as used for nDerivationMethod 0
+    static void deriveKey(const uint8_t* pass, size_t passLen, const uint8_t* salt, size_t saltLen,
+                          uint32_t iterations, uint8_t key[Aes256::KEY_SIZE], uint8_t iv[Aes256::BLOCK_SIZE]) {
+        uint8_t digest[Sha512::OUTPUT_SIZE];
+        Sha512().update(pass, passLen).update(salt, saltLen).finalize(digest);
+        Sha512::rehash(digest, iterations > 0 ? iterations - 1 : 0);
+        memcpy(key, digest, Aes256::KEY_SIZE);
+        memcpy(iv, digest + Aes256::KEY_SIZE, Aes256::BLOCK_SIZE);
+        volatile uint8_t* wipe = digest;
+        for (size_t i = 0; i < sizeof(digest); i++) wipe[i] = 0;
+    }
+
+    // Encrypts 32 bytes of secret with PKCS#7 padding into 48 bytes
+    static void encrypt32(const uint8_t key[Aes256::KEY_SIZE], const uint8_t iv[Aes256::BLOCK_SIZE],
+                          const uint8_t plain[32], uint8_t out[CRYPTED_KEY_SIZE]) {
+        uint8_t padded[CRYPTED_KEY_SIZE];
+        memcpy(padded, plain, 32);
+        memset(padded + 32, 0x10, 16);
+        Aes256(key).cbcEncrypt(iv, padded, out, sizeof(padded));
+        volatile uint8_t* wipe = padded;
+        for (size_t i = 0; i < sizeof(padded); i++) wipe[i] = 0;
+    }
+
+    // Decrypts 48 bytes and checks the padding; plain receives 48 bytes
+    static bool decrypt32(const Aes256& cipher, const uint8_t iv[Aes256::BLOCK_SIZE],
+                          const uint8_t crypted[CRYPTED_KEY_SIZE], uint8_t plain[CRYPTED_KEY_SIZE]) {
+        cipher.cbcDecrypt(iv, crypted, plain, CRYPTED_KEY_SIZE);
+        for (size_t i = 32; i < CRYPTED_KEY_SIZE; i++) {
+            if (plain[i] != 0x10) return false;
+        }
+        return true;
+    }
+
+    static bool decrypt32(const uint8_t key[Aes256::KEY_SIZE], const uint8_t iv[Aes256::BLOCK_SIZE],
+                          const uint8_t crypted[CRYPTED_KEY_SIZE], uint8_t plain[CRYPTED_KEY_SIZE]) {
+        return decrypt32(Aes256(key), iv, crypted, plain);
+    }
+
+    // Per-key IV: first 16 bytes of double SHA-256 of the public key
+    static void keyIV(const uint8_t* pubkey, size_t len, uint8_t iv[Aes256::BLOCK_SIZE]) {
+        uint8_t hash[Sha256::OUTPUT_SIZE];
+        Sha256::hash256(pubkey, len, hash);
+        memcpy(iv, hash, Aes256::BLOCK_SIZE);
+    }
+
+    static constexpr size_t WIF_BUFFER_SIZE = 53;
+
+    static size_t privateKeyToWIF(const uint8_t key[32], bool compressed, char* out, size_t cap,
+                                  uint8_t prefix = 0x80) {
+        uint8_t buf[34];
+        buf[0] = prefix;
+        memcpy(buf + 1, key, 32);
+        buf[33] = 0x01;
+        size_t n = Base58::encodeCheck(buf, compressed ? 34 : 33, out, cap);
+        volatile uint8_t* wipe = buf;
+        for (size_t i = 0; i < sizeof(buf); i++) wipe[i] = 0;
+        return n;
+    }
+
+    static std::string privateKeyToWIF(const uint8_t key[32], bool compressed, uint8_t prefix = 0x80) {
+        char out[WIF_BUFFER_SIZE];
+        return std::string(out, privateKeyToWIF(key, compressed, out, sizeof(out), prefix));
+    }
+
+    static std::string publicKeyToAddress(const uint8_t* pubkey, size_t len, uint8_t prefix = 0x00) {
+        uint8_t buf[1 + Ripemd160::OUTPUT_SIZE];
+        buf[0] = prefix;
+        Ripemd160::hash160(pubkey, len, buf + 1);
+        return Base58::encodeCheck(buf, sizeof(buf));
+    }
+};
+
+#endif
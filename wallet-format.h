@@ -0,0 +1,203 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// Recognizes wallet databases and their companion files from the first few
+// kilobytes, so every tool can pick the parser that matches a file instead
+// of scanning it byte by byte.
+
+#ifndef WALLET_FORMAT_H
+#define WALLET_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "wallet-crypto.h"
+
+class WalletFormat {
+public:
+    enum Kind {
+        UNKNOWN,
+        BERKELEY_DB,          // btree, as every Bitcoin Core BerkeleyDB wallet
+        BERKELEY_DB_HASH,
+        BERKELEY_DB_LOG,      // log.0000000001 and friends from the database environment
+        SQLITE,
+        SQLITE_WAL,           // the -wal file beside an SQLite database
+        SQLITE_JOURNAL        // the -journal file of an interrupted rollback transaction
+    };
+
+    // What the first bytes of a file say about it. Multi-byte fields of the
+    // file are already converted; bigEndian only matters to a BerkeleyDB
+    // parser, which has to read every page header the same way.
+    struct Info {
+        Kind kind = UNKNOWN;
+        bool bigEndian = false;
+        uint32_t pageSize = 0;
+        uint64_t pageCount = 0;    // from the header; 0 when it does not say
+        uint32_t usableSize = 0;   // SQLite: page size minus reserved bytes
+        bool walMode = false;      // SQLite: the database is in WAL mode
+        uint32_t logVersion = 0;   // BerkeleyDB log
+    };
+
+    static constexpr uint32_t BDB_BTREE_MAGIC = 0x00053162;
+    static constexpr uint32_t BDB_HASH_MAGIC = 0x00061561;
+    static constexpr uint32_t BDB_LOG_MAGIC = 0x00040988;
+    static constexpr uint32_t SQLITE_WAL_MAGIC = 0x377f0682;   // either checksum byte order: ...82 or ...83
+    static constexpr uint8_t SQLITE_JOURNAL_MAGIC[8] = {0xd9, 0xd5, 0x05, 0xf9, 0x20, 0xa1, 0x63, 0xd7};
+    static constexpr size_t HEADER_SIZE = 512;      // covers every header below
+    static constexpr size_t BDB_ROOT_OFFSET = 88;   // root page number in a btree metadata page
+
+    // Every BerkeleyDB log file opens with a persistent header record: a
+    // record header (prev, len, checksum; 48 bytes when the environment is
+    // encrypted) and then the LOGP magic and version
+    static constexpr size_t BDB_LOG_MAGIC_OFFSETS[2] = {12, 48};
+
+    static uint32_t read32(const uint8_t* p, bool bigEndian) {
+        return bigEndian ? walletcrypto_detail::readBE32(p) : walletcrypto_detail::readLE32(p);
+    }
+
+    static uint16_t read16(const uint8_t* p, bool bigEndian) {
+        return bigEndian ? uint16_t((p[0] << 8) | p[1]) : uint16_t(p[0] | (p[1] << 8));
+    }
+
+    static bool isBerkeleyMeta(const uint8_t* page) {
+        return sniffBerkeleyMeta(page).kind != UNKNOWN;
+    }
+
+    static bool isSQLiteHeader(const uint8_t* page) {
+        return memcmp(page, "SQLite format 3\0", 16) == 0;
+    }
+
+    // The page size an SQLite header declares; 0 if it is not valid
+    static uint32_t sqlitePageSize(const uint8_t* header) {
+        uint32_t pageSize = (uint32_t(header[16]) << 8) | header[17];
+        if (pageSize == 1) pageSize = 65536;
+        if (pageSize < 512 || (pageSize & (pageSize - 1)) != 0) return 0;
+        return pageSize;
+    }
+
+    // A BerkeleyDB metadata page, in either byte order. The magic tells the
+    // byte order: a big-endian file's magic reads byte-swapped.
+    static Info sniffBerkeleyMeta(const uint8_t* page) {
+        Info info;
+        for (bool bigEndian : {false, true}) {
+            uint32_t magic = read32(page + 12, bigEndian);
+            if (magic != BDB_BTREE_MAGIC && magic != BDB_HASH_MAGIC) continue;
+            uint32_t pageSize = read32(page + 20, bigEndian);
+            if (read32(page + 8, bigEndian) != 0 || pageSize < 512 || pageSize > 65536 ||
+                (pageSize & (pageSize - 1)) != 0) {
+                continue;
+            }
+            info.kind = magic == BDB_BTREE_MAGIC ? BERKELEY_DB : BERKELEY_DB_HASH;
+            info.bigEndian = bigEndian;
+            info.pageSize = pageSize;
+            info.pageCount = uint64_t(read32(page + 32, bigEndian)) + 1;
+            break;
+        }
+        return info;
+    }
+
+    static Info sniff(const uint8_t* header, size_t size) {
+        Info info;
+        if (size < 32) return info;
+        if (size >= 100 && isSQLiteHeader(header)) {
+            uint32_t pageSize = sqlitePageSize(header);
+            if (!pageSize || header[20] >= pageSize - 480) return info;
+            info.kind = SQLITE;
+            info.pageSize = pageSize;
+            info.usableSize = pageSize - header[20];
+            // The in-header page count is only valid when the two change counters agree
+            if (walletcrypto_detail::readBE32(header + 24) == walletcrypto_detail::readBE32(header + 92)) {
+                info.pageCount = walletcrypto_detail::readBE32(header + 28);
+            }
+            info.walMode = header[18] == 2 || header[19] == 2;
+            return info;
+        }
+        if ((walletcrypto_detail::readBE32(header) & ~1u) == SQLITE_WAL_MAGIC) {
+            uint32_t pageSize = walletcrypto_detail::readBE32(header + 8);
+            if (pageSize >= 512 && pageSize <= 65536 && (pageSize & (pageSize - 1)) == 0) {
+                info.kind = SQLITE_WAL;
+                info.pageSize = pageSize;
+            }
+            return info;
+        }
+        if (memcmp(header, SQLITE_JOURNAL_MAGIC, sizeof(SQLITE_JOURNAL_MAGIC)) == 0) {
+            info.kind = SQLITE_JOURNAL;
+            info.pageSize = walletcrypto_detail::readBE32(header + 24);
+            return info;
+        }
+        if (size >= HEADER_SIZE) {
+            info = sniffBerkeleyMeta(header);
+            if (info.kind != UNKNOWN) return info;
+        }
+        for (size_t offset : BDB_LOG_MAGIC_OFFSETS) {
+            for (bool bigEndian : {false, true}) {
+                if (offset + 8 <= size && read32(header + offset, bigEndian) == BDB_LOG_MAGIC) {
+                    info.kind = BERKELEY_DB_LOG;
+                    info.bigEndian = bigEndian;
+                    info.logVersion = read32(header + offset + 4, bigEndian);
+                    return info;
+                }
+            }
+        }
+        return info;
+    }
+
+    static Kind detect(const uint8_t* header, size_t size) {
+        return sniff(header, size).kind;
+    }
+
+    // Databases the record parsers understand
+    static bool isDatabase(Kind kind) {
+        return kind == BERKELEY_DB || kind == BERKELEY_DB_HASH || kind == SQLITE;
+    }
+
+    // Where the page that names a database's tables lives: the root page of
+    // a BerkeleyDB master database, which lists its subdatabases, or SQLite's
+    // first page, which holds the schema
+    static uint64_t catalogOffset(const Info& info, const uint8_t* header) {
+        if (info.kind == SQLITE) return 0;
+        uint32_t root = info.kind == BERKELEY_DB ? read32(header + BDB_ROOT_OFFSET, info.bigEndian) : 1;
+        return uint64_t(root ? root : 1) * info.pageSize;
+    }
+
+    // Whether a database is a Bitcoin Core wallet: every version keeps its
+    // records in a subdatabase or table called "main", and SQLite wallets
+    // carry the network magic as their application_id
+    static bool isWallet(const Info& info, const uint8_t* header, const uint8_t* catalog, size_t catalogLength) {
+        if (info.kind == SQLITE) {
+            switch (walletcrypto_detail::readBE32(header + 68)) {
+                case 0xf9beb4d9:   // mainnet
+                case 0x0b110907:   // testnet3
+                case 0x1c163f28:   // testnet4
+                case 0x0a03cf40:   // signet
+                case 0xfabfb5da:   // regtest
+                    return true;
+            }
+            return contains(catalog, catalogLength, "CREATE TABLE main(");
+        }
+        return (info.kind == BERKELEY_DB || info.kind == BERKELEY_DB_HASH) && contains(catalog, catalogLength, "main");
+    }
+
+    static const char* name(Kind kind) {
+        switch (kind) {
+            case BERKELEY_DB: return "BerkeleyDB";
+            case BERKELEY_DB_HASH: return "BerkeleyDB (hash)";
+            case BERKELEY_DB_LOG: return "BerkeleyDB log";
+            case SQLITE: return "SQLite";
+            case SQLITE_WAL: return "SQLite WAL";
+            case SQLITE_JOURNAL: return "SQLite journal";
+            default: return "unknown";
+        }
+    }
+
+private:
+    static bool contains(const uint8_t* data, size_t length, const char* text) {
+        size_t textLength = strlen(text);
+        for (size_t i = 0; i + textLength <= length; i++) {
+            if (data[i] == uint8_t(text[0]) && memcmp(data + i, text, textLength) == 0) return true;
+        }
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,943 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// Synthetic wallet generator for scale testing. Produces BerkeleyDB btree or
+// SQLite wallets with a configurable number of records, deterministic for a
+// given seed, plus the passphrase and the expected plaintext keys.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sqlite3.h>
+
+#include "hd-keychain.h"
+#include "wallet-crypto.h"
+
+namespace fs = std::filesystem;
+
+// Deterministic byte source. Only raw engine output is used so the stream is
+// identical on every standard library.
+class SeededRandom {
+private:
+    std::mt19937_64 gen;
+public:
+    explicit SeededRandom(uint64_t seed) : gen(seed) {}
+    uint64_t next() { return gen(); }
+    uint64_t below(uint64_t bound) { return bound ? next() % bound : 0; }
+    bool chance(unsigned percent) { return below(100) < percent; }
+    void fill(uint8_t* out, size_t len) {
+        while (len >= 8) {
+            uint64_t v = next();
+            memcpy(out, &v, 8);
+            out += 8; len -= 8;
+        }
+        if (len) {
+            uint64_t v = next();
+            memcpy(out, &v, len);
+        }
+    }
+};
+
+// Bitcoin serialization helpers
+class RecordWriter {
+public:
+    std::vector<uint8_t> bytes;
+
+    RecordWriter& raw(const uint8_t* data, size_t len) {
+        bytes.insert(bytes.end(), data, data + len);
+        return *this;
+    }
+    RecordWriter& compactSize(uint64_t n) {
+        if (n < 253) {
+            bytes.push_back(uint8_t(n));
+        } else if (n <= 0xffff) {
+            bytes.push_back(253);
+            le(n, 2);
+        } else if (n <= 0xffffffffULL) {
+            bytes.push_back(254);
+            le(n, 4);
+        } else {
+            bytes.push_back(255);
+            le(n, 8);
+        }
+        return *this;
+    }
+    RecordWriter& le(uint64_t v, int width) {
+        for (int i = 0; i < width; i++) bytes.push_back(uint8_t(v >> (8 * i)));
+        return *this;
+    }
+    RecordWriter& vec(const uint8_t* data, size_t len) { return compactSize(len).raw(data, len); }
+    RecordWriter& str(const std::string& s) { return vec(reinterpret_cast<const uint8_t*>(s.data()), s.size()); }
+};
+
+// Common interface of the two database back ends
+class WalletWriter {
+public:
+    virtual ~WalletWriter() = default;
+    // BerkeleyDB requires keys in ascending memcmp order
+    virtual void put(const std::vector<uint8_t>& key, const std::vector<uint8_t>& value) = 0;
+    virtual void finish() = 0;
+};
+
+// Writes a Bitcoin Core style BerkeleyDB 4.8 btree file: a master database on
+// pages 0-1 naming the "main" sub-database, whose meta page is page 2.
+class BerkeleyWalletWriter : public WalletWriter {
+private:
+    static constexpr uint32_t BTREE_MAGIC = 0x00053162;
+    static constexpr uint32_t BTREE_VERSION = 9;
+    static constexpr uint8_t P_INVALID = 0;
+    static constexpr uint8_t P_IBTREE = 3;
+    static constexpr uint8_t P_LBTREE = 5;
+    static constexpr uint8_t P_OVERFLOW = 7;
+    static constexpr uint8_t P_BTREEMETA = 9;
+    static constexpr uint8_t B_KEYDATA = 1;
+    static constexpr uint8_t B_OVERFLOW = 3;
+    static constexpr uint32_t BTM_SUBDB = 0x20;
+    static constexpr size_t PAGE_HEADER = 26;
+    static constexpr uint32_t FIRST_DATA_PAGE = 3;
+    static constexpr uint32_t SHUFFLE_WINDOW = 64;
+
+    struct Page {
+        uint32_t pgno = 0;
+        std::vector<uint8_t> data;
+        uint16_t entries = 0;
+        size_t hfOffset = 0;
+    };
+
+    struct ChildRef {
+        std::vector<uint8_t> firstKey;
+        uint32_t pgno;
+    };
+
+    int fd = -1;
+    uint32_t pageSize;
+    unsigned fragmentation;
+    SeededRandom& rng;
+    uint8_t uid[20];
+    uint32_t allocated = 0;           // pages handed out after FIRST_DATA_PAGE
+    uint32_t highestPgno = FIRST_DATA_PAGE - 1;
+    uint32_t freeHead = 0;
+    std::vector<uint32_t> freePages;
+    std::vector<uint32_t> windowPerm;
+    uint32_t windowIndex = UINT32_MAX;
+    std::unique_ptr<Page> leaf;
+    std::unique_ptr<Page> pendingLeaf;
+    std::vector<ChildRef> leaves;
+    size_t fillLimit;
+
+    static size_t align4(size_t n) { return (n + 3) & ~size_t(3); }
+
+    void put16(uint8_t* p, uint16_t v) { p[0] = uint8_t(v); p[1] = uint8_t(v >> 8); }
+    void put32(uint8_t* p, uint32_t v) { walletcrypto_detail::writeLE32(p, v); }
+
+    // Page numbers are handed out through a per-window permutation, so with
+    // fragmentation enabled logically adjacent pages land out of file order.
+    uint32_t allocate() {
+        uint32_t slot = allocated++;
+        uint32_t window = slot / SHUFFLE_WINDOW;
+        if (window != windowIndex) {
+            windowIndex = window;
+            windowPerm.resize(SHUFFLE_WINDOW);
+            for (uint32_t i = 0; i < SHUFFLE_WINDOW; i++) windowPerm[i] = i;
+            for (uint32_t i = 0; i < SHUFFLE_WINDOW; i++) {
+                if (rng.chance(fragmentation)) std::swap(windowPerm[i], windowPerm[rng.below(SHUFFLE_WINDOW)]);
+            }
+        }
+        uint32_t pgno = FIRST_DATA_PAGE + window * SHUFFLE_WINDOW + windowPerm[slot % SHUFFLE_WINDOW];
+        highestPgno = std::max(highestPgno, pgno);
+        return pgno;
+    }
+
+    void writePage(uint32_t pgno, const std::vector<uint8_t>& data) {
+        off_t offset = off_t(pgno) * pageSize;
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = pwrite(fd, data.data() + done, data.size() - done, offset + done);
+            if (n <= 0) throw std::runtime_error("Failed to write BerkeleyDB page");
+            done += size_t(n);
+        }
+    }
+
+    void initHeader(std::vector<uint8_t>& d, uint32_t pgno, uint8_t type, uint8_t level) {
+        d.assign(pageSize, 0);
+        put32(&d[4], 1);              // LSN offset, "not logged"
+        put32(&d[8], pgno);
+        d[24] = level;
+        d[25] = type;
+    }
+
+    std::unique_ptr<Page> newPage(uint8_t type, uint8_t level) {
+        auto page = std::make_unique<Page>();
+        page->pgno = allocate();
+        initHeader(page->data, page->pgno, type, level);
+        page->hfOffset = pageSize;
+        return page;
+    }
+
+    size_t freeSpace(const Page& p) const {
+        return p.hfOffset - (PAGE_HEADER + 2 * size_t(p.entries));
+    }
+
+    // hf_offset is 16 bits wide, so an empty 64K page stores it as 0
+    void addItem(Page& p, const std::vector<uint8_t>& item) {
+        size_t offset = p.hfOffset - align4(item.size());
+        memcpy(&p.data[offset], item.data(), item.size());
+        put16(&p.data[PAGE_HEADER + 2 * p.entries], uint16_t(offset));
+        p.entries++;
+        p.hfOffset = offset;
+        put16(&p.data[20], p.entries);
+        put16(&p.data[22], uint16_t(p.hfOffset));
+    }
+
+    // Chains a large item through overflow pages and returns its BOVERFLOW stub
+    std::vector<uint8_t> writeOverflow(const std::vector<uint8_t>& value) {
+        size_t perPage = pageSize - PAGE_HEADER;
+        size_t pages = (value.size() + perPage - 1) / perPage;
+        std::vector<uint32_t> pgnos(pages);
+        for (auto& pg : pgnos) pg = allocate();
+        std::vector<uint8_t> d;
+        for (size_t i = 0; i < pages; i++) {
+            initHeader(d, pgnos[i], P_OVERFLOW, 0);
+            size_t chunk = std::min(perPage, value.size() - i * perPage);
+            put32(&d[12], i ? pgnos[i - 1] : 0);
+            put32(&d[16], i + 1 < pages ? pgnos[i + 1] : 0);
+            put16(&d[20], i == 0 ? 1 : 0);           // OV_REF
+            put16(&d[22], uint16_t(chunk));          // OV_LEN
+            memcpy(&d[PAGE_HEADER], value.data() + i * perPage, chunk);
+            writePage(pgnos[i], d);
+        }
+        std::vector<uint8_t> stub(12, 0);
+        stub[2] = B_OVERFLOW;
+        put32(&stub[4], pgnos[0]);
+        put32(&stub[8], uint32_t(value.size()));
+        return stub;
+    }
+
+    std::vector<uint8_t> keyData(const std::vector<uint8_t>& data) {
+        if (data.size() > overflowThreshold()) return writeOverflow(data);
+        std::vector<uint8_t> item(3 + data.size());
+        put16(&item[0], uint16_t(data.size()));
+        item[2] = B_KEYDATA;
+        memcpy(&item[3], data.data(), data.size());
+        return item;
+    }
+
+    size_t overflowThreshold() const { return (pageSize - PAGE_HEADER) / 4 - 16; }
+
+    void freePage(uint32_t pgno, const std::vector<uint8_t>& stale) {
+        std::vector<uint8_t> d = stale;
+        if (d.empty()) d.assign(pageSize, 0);
+        // __db_free resets the header but leaves the old items behind
+        memset(d.data(), 0, PAGE_HEADER);
+        put32(&d[4], 1);
+        put32(&d[8], pgno);
+        put32(&d[16], freeHead);
+        put16(&d[22], uint16_t(pageSize));
+        d[25] = P_INVALID;
+        writePage(pgno, d);
+        freeHead = pgno;
+        freePages.push_back(pgno);
+    }
+
+    void flushLeaf(uint32_t nextPgno) {
+        if (!pendingLeaf) return;
+        put32(&pendingLeaf->data[16], nextPgno);
+        writePage(pendingLeaf->pgno, pendingLeaf->data);
+        // Freed copies of old leaves are what real files accumulate after splits
+        if (rng.chance(fragmentation / 4)) freePage(allocate(), pendingLeaf->data);
+        pendingLeaf.reset();
+    }
+
+    void closeLeaf() {
+        if (!leaf) return;
+        uint32_t prev = pendingLeaf ? pendingLeaf->pgno : 0;
+        put32(&leaf->data[12], prev);
+        flushLeaf(leaf->pgno);
+        pendingLeaf = std::move(leaf);
+    }
+
+    std::vector<ChildRef> buildInternalLevel(const std::vector<ChildRef>& children, uint8_t level) {
+        std::vector<ChildRef> parents;
+        std::unique_ptr<Page> page;
+        for (const auto& child : children) {
+            bool first = !page || page->entries == 0;
+            size_t keyLen = first ? 0 : child.firstKey.size();
+            size_t need = align4(12 + keyLen) + 2;
+            if (page && page->entries > 0 && freeSpace(*page) < need + 2) {
+                writePage(page->pgno, page->data);
+                page.reset();
+                keyLen = 0;
+            }
+            if (!page) {
+                page = newPage(P_IBTREE, level);
+                parents.push_back({child.firstKey, page->pgno});
+            }
+            std::vector<uint8_t> item(12 + keyLen, 0);
+            put16(&item[0], uint16_t(keyLen));
+            item[2] = B_KEYDATA;
+            put32(&item[4], child.pgno);
+            if (keyLen) memcpy(&item[12], child.firstKey.data(), keyLen);
+            addItem(*page, item);
+        }
+        if (page) writePage(page->pgno, page->data);
+        return parents;
+    }
+
+    void writeMeta(uint32_t pgno, uint32_t root, uint32_t lastPgno, uint32_t free) {
+        std::vector<uint8_t> d(pageSize, 0);
+        put32(&d[4], 1);
+        put32(&d[8], pgno);
+        put32(&d[12], BTREE_MAGIC);
+        put32(&d[16], BTREE_VERSION);
+        put32(&d[20], pageSize);
+        d[25] = P_BTREEMETA;
+        put32(&d[28], free);
+        put32(&d[32], lastPgno);
+        put32(&d[48], BTM_SUBDB);
+        memcpy(&d[52], uid, sizeof(uid));
+        put32(&d[76], 2);             // minkey
+        put32(&d[84], 0x20);          // re_pad
+        put32(&d[88], root);
+        writePage(pgno, d);
+    }
+
+public:
+    BerkeleyWalletWriter(const fs::path& path, uint32_t pageSize, unsigned fragmentation, SeededRandom& rng)
+        : pageSize(pageSize), fragmentation(fragmentation), rng(rng) {
+        fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0600);
+        if (fd < 0) throw std::runtime_error("Cannot create " + path.string());
+        rng.fill(uid, sizeof(uid));
+        // Split-heavy files run well below full pages
+        fillLimit = pageSize * fragmentation / 200;
+    }
+
+    ~BerkeleyWalletWriter() override {
+        if (fd >= 0) close(fd);
+    }
+
+    void put(const std::vector<uint8_t>& key, const std::vector<uint8_t>& value) override {
+        bool fresh = !leaf;
+        if (!leaf) leaf = newPage(P_LBTREE, 1);
+        size_t keySize = align4(key.size() > overflowThreshold() ? 12 : 3 + key.size());
+        size_t valueSize = align4(value.size() > overflowThreshold() ? 12 : 3 + value.size());
+        if (!fresh && freeSpace(*leaf) < keySize + valueSize + 4 + fillLimit) {
+            closeLeaf();
+            leaf = newPage(P_LBTREE, 1);
+            fresh = true;
+        }
+        if (fresh) leaves.push_back({key, leaf->pgno});
+        addItem(*leaf, keyData(key));
+        addItem(*leaf, keyData(value));
+    }
+
+    void finish() override {
+        closeLeaf();
+        flushLeaf(0);
+        uint32_t root;
+        if (leaves.empty()) {
+            leaf = newPage(P_LBTREE, 1);
+            root = leaf->pgno;
+            writePage(leaf->pgno, leaf->data);
+        } else {
+            std::vector<ChildRef> level = leaves;
+            uint8_t depth = 1;
+            while (level.size() > 1) level = buildInternalLevel(level, ++depth);
+            root = level[0].pgno;
+        }
+        // Slots of the last shuffle window that were never handed out
+        uint32_t windowStart = FIRST_DATA_PAGE + (allocated / SHUFFLE_WINDOW) * SHUFFLE_WINDOW;
+        if (allocated % SHUFFLE_WINDOW) {
+            std::vector<bool> taken(SHUFFLE_WINDOW, false);
+            for (uint32_t s = allocated - allocated % SHUFFLE_WINDOW; s < allocated; s++) {
+                taken[windowPerm[s % SHUFFLE_WINDOW]] = true;
+            }
+            for (uint32_t i = 0; i < SHUFFLE_WINDOW; i++) {
+                if (!taken[i] && windowStart + i < highestPgno) freePage(windowStart + i, {});
+            }
+        }
+
+        // Master database: a single leaf mapping "main" to the sub-database meta page
+        Page master;
+        master.pgno = 1;
+        initHeader(master.data, 1, P_LBTREE, 1);
+        master.hfOffset = pageSize;
+        const uint8_t name[] = {'m', 'a', 'i', 'n'};
+        const uint8_t metaPgno[] = {0, 0, 0, 2};
+        addItem(master, keyData(std::vector<uint8_t>(name, name + 4)));
+        addItem(master, keyData(std::vector<uint8_t>(metaPgno, metaPgno + 4)));
+        writePage(1, master.data);
+
+        writeMeta(0, 1, highestPgno, freeHead);
+        writeMeta(2, root, 2, 0);
+        if (fsync(fd) != 0) throw std::runtime_error("Failed to sync BerkeleyDB file");
+        close(fd);
+        fd = -1;
+    }
+};
+
+// SQLite wallets use Bitcoin Core's schema; the library handles the format
+class SQLiteWalletWriter : public WalletWriter {
+private:
+    static constexpr int32_t MAINNET_APPLICATION_ID = int32_t(0xf9beb4d9);
+
+    sqlite3* db = nullptr;
+    sqlite3_stmt* insert = nullptr;
+    sqlite3_stmt* remove = nullptr;
+    unsigned fragmentation;
+    SeededRandom& rng;
+    uint64_t pending = 0;
+    std::vector<std::vector<uint8_t>> staleKeys;
+
+    void exec(const std::string& sql) {
+        char* err = nullptr;
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+            std::string msg = err ? err : "unknown error";
+            sqlite3_free(err);
+            throw std::runtime_error("SQLite: " + msg);
+        }
+    }
+
+    void step(sqlite3_stmt* stmt) {
+        if (sqlite3_step(stmt) != SQLITE_DONE) throw std::runtime_error(std::string("SQLite: ") + sqlite3_errmsg(db));
+        sqlite3_reset(stmt);
+    }
+
+    void insertRow(const std::vector<uint8_t>& key, const std::vector<uint8_t>& value) {
+        sqlite3_bind_blob(insert, 1, key.data(), int(key.size()), SQLITE_STATIC);
+        sqlite3_bind_blob(insert, 2, value.data(), int(value.size()), SQLITE_STATIC);
+        step(insert);
+        if (++pending % 10000 == 0) {
+            exec("COMMIT");
+            exec("BEGIN");
+        }
+    }
+
+public:
+    SQLiteWalletWriter(const fs::path& path, uint32_t pageSize, unsigned fragmentation, SeededRandom& rng)
+        : fragmentation(fragmentation), rng(rng) {
+        fs::remove(path);
+        if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) throw std::runtime_error("Cannot create " + path.string());
+        exec("PRAGMA page_size = " + std::to_string(pageSize));
+        exec("PRAGMA journal_mode = OFF");
+        exec("PRAGMA synchronous = OFF");
+        exec("PRAGMA application_id = " + std::to_string(MAINNET_APPLICATION_ID));
+        exec("PRAGMA user_version = 0");
+        exec("CREATE TABLE main(key BLOB PRIMARY KEY NOT NULL, value BLOB NOT NULL)");
+        sqlite3_prepare_v2(db, "INSERT INTO main VALUES(?, ?)", -1, &insert, nullptr);
+        sqlite3_prepare_v2(db, "DELETE FROM main WHERE key = ?", -1, &remove, nullptr);
+        exec("BEGIN");
+    }
+
+    ~SQLiteWalletWriter() override {
+        sqlite3_finalize(insert);
+        sqlite3_finalize(remove);
+        sqlite3_close(db);
+    }
+
+    void put(const std::vector<uint8_t>& key, const std::vector<uint8_t>& value) override {
+        // Rows that are written and later deleted leave freelist pages behind
+        if (rng.chance(fragmentation)) {
+            std::vector<uint8_t> stale = key;
+            stale.push_back(0xff);
+            insertRow(stale, value);
+            staleKeys.push_back(std::move(stale));
+        }
+        insertRow(key, value);
+    }
+
+    void finish() override {
+        for (const auto& key : staleKeys) {
+            sqlite3_bind_blob(remove, 1, key.data(), int(key.size()), SQLITE_STATIC);
+            step(remove);
+        }
+        exec("COMMIT");
+    }
+};
+
+// Generator front end
+class WalletGenerator {
+private:
+    struct GeneratedKey {
+        uint8_t pubkey[Secp256k1::COMPRESSED_SIZE];
+        uint8_t privkey[32];
+        int64_t hdIndex = -1;   // m/0'/0'/hdIndex' with --hd; -1 for the seed and random keys
+    };
+
+    fs::path outputPath;
+    std::string format = "BerkeleyDB";
+    uint64_t seed = 1;
+    uint64_t ckeyCount = 100;
+    uint64_t keyCount = 0;
+    uint64_t wkeyCount = 0;
+    uint64_t txCount = 0;
+    uint64_t txSize = 400;
+    uint64_t targetSize = 0;
+    uint32_t pageSize = 4096;
+    unsigned fragmentation = 0;
+    bool keyMeta = true;
+    bool descriptors = false;
+    bool hd = false;
+    std::string passphrase = "password";
+    uint32_t iterations = 25000;
+
+    static uint64_t parseSize(const std::string& s) {
+        size_t pos = 0;
+        uint64_t v = std::stoull(s, &pos);
+        std::string unit = s.substr(pos);
+        if (unit == "K" || unit == "k") return v << 10;
+        if (unit == "M" || unit == "m") return v << 20;
+        if (unit == "G" || unit == "g") return v << 30;
+        if (!unit.empty()) throw std::runtime_error("Invalid size suffix: " + unit);
+        return v;
+    }
+
+    static std::vector<uint8_t> typeKey(const std::string& type) {
+        RecordWriter w;
+        w.str(type);
+        return w.bytes;
+    }
+
+    std::vector<GeneratedKey> generateKeys(SeededRandom& rng, uint64_t count) {
+        std::vector<GeneratedKey> keys(count);
+        for (auto& k : keys) {
+            do {
+                rng.fill(k.privkey, sizeof(k.privkey));
+            } while (!Secp256k1::isValidPrivateKey(k.privkey));
+            Secp256k1::derivePublicKey(k.privkey, true, k.pubkey);
+        }
+        std::sort(keys.begin(), keys.end(), [](const GeneratedKey& a, const GeneratedKey& b) {
+            return memcmp(a.pubkey, b.pubkey, sizeof(a.pubkey)) < 0;
+        });
+        return keys;
+    }
+
+    // --hd: a seed key and the keys of its external chain m/0'/0'/i', in
+    // pubkey order as generateKeys() returns them
+    std::vector<GeneratedKey> generateHDKeys(SeededRandom& rng, uint64_t count, GeneratedKey& seed) {
+        do {
+            rng.fill(seed.privkey, sizeof(seed.privkey));
+        } while (!Secp256k1::isValidPrivateKey(seed.privkey));
+        Secp256k1::derivePublicKey(seed.privkey, true, seed.pubkey);
+        HDKeychain::Key master, chain;
+        if (!HDKeychain::fromSeed(seed.privkey, sizeof(seed.privkey), master) ||
+            !HDKeychain::derivePath(master, {HDKeychain::HARDENED, HDKeychain::HARDENED}, chain)) {
+            throw std::runtime_error("Seed does not derive; try another --seed");
+        }
+        std::vector<HDKeychain::Key> children(static_cast<size_t>(count));
+        HDKeychain::deriveChildren(chain, 0, children.size(), true, children.data());
+        std::vector<GeneratedKey> keys;
+        for (size_t i = 0; i < children.size(); i++) {
+            if (!children[i].valid) continue;
+            GeneratedKey k;
+            memcpy(k.pubkey, children[i].pubkey, sizeof(k.pubkey));
+            memcpy(k.privkey, children[i].secret, sizeof(k.privkey));
+            k.hdIndex = int64_t(i);
+            keys.push_back(k);
+        }
+        std::sort(keys.begin(), keys.end(), [](const GeneratedKey& a, const GeneratedKey& b) {
+            return memcmp(a.pubkey, b.pubkey, sizeof(a.pubkey)) < 0;
+        });
+        return keys;
+    }
+
+    static std::vector<uint8_t> privateKeyDER(const GeneratedKey& k) {
+        // CKey::GetPrivKey() layout for a compressed key
+        static const uint8_t begin[] = {0x30, 0x81, 0xD3, 0x02, 0x01, 0x01, 0x04, 0x20};
+        static const uint8_t middle[] = {
+            0xA0, 0x81, 0x85, 0x30, 0x81, 0x82, 0x02, 0x01, 0x01, 0x30, 0x2C, 0x06, 0x07, 0x2A, 0x86, 0x48,
+            0xCE, 0x3D, 0x01, 0x01, 0x02, 0x21, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFE, 0xFF, 0xFF, 0xFC, 0x2F, 0x30, 0x06, 0x04, 0x01, 0x00, 0x04, 0x01, 0x07,
+            0x04, 0x21, 0x02, 0x79, 0xBE, 0x66, 0x7E, 0xF9, 0xDC, 0xBB, 0xAC, 0x55, 0xA0, 0x62, 0x95, 0xCE,
+            0x87, 0x0B, 0x07, 0x02, 0x9B, 0xFC, 0xDB, 0x2D, 0xCE, 0x28, 0xD9, 0x59, 0xF2, 0x81, 0x5B, 0x16,
+            0xF8, 0x17, 0x98, 0x02, 0x21, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE, 0xBA, 0xAE, 0xDC, 0xE6, 0xAF, 0x48, 0xA0, 0x3B, 0xBF, 0xD2,
+            0x5E, 0x8C, 0xD0, 0x36, 0x41, 0x41, 0x02, 0x01, 0x01, 0xA1, 0x24, 0x03, 0x22, 0x00
+        };
+        std::vector<uint8_t> der(begin, begin + sizeof(begin));
+        der.insert(der.end(), k.privkey, k.privkey + 32);
+        der.insert(der.end(), middle, middle + sizeof(middle));
+        der.insert(der.end(), k.pubkey, k.pubkey + sizeof(k.pubkey));
+        return der;
+    }
+
+    // Core's descriptor checksum: a BCH code over the descriptor's characters
+    static std::string descriptorChecksum(const std::string& descriptor) {
+        static const std::string inputCharset =
+            "0123456789()[],'/*abcdefgh@:$%{}"
+            "IJKLMNOPQRSTUVWXYZ&+-.;<=>?!^_|~"
+            "ijklmnopqrstuvwxyzABCDEFGH`#\"\\ ";
+        static const char* checksumCharset = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+        auto polyMod = [](uint64_t c, uint64_t value) {
+            uint8_t top = uint8_t(c >> 35);
+            c = ((c & 0x7ffffffffULL) << 5) ^ value;
+            if (top & 1) c ^= 0xf5dee51989ULL;
+            if (top & 2) c ^= 0xa9fdca3312ULL;
+            if (top & 4) c ^= 0x1bab10e32dULL;
+            if (top & 8) c ^= 0x3706b1677aULL;
+            if (top & 16) c ^= 0x644d626ffdULL;
+            return c;
+        };
+        uint64_t c = 1, group = 0;
+        int grouped = 0;
+        for (char ch : descriptor) {
+            size_t pos = inputCharset.find(ch);
+            if (pos == std::string::npos) throw std::runtime_error("Invalid descriptor character");
+            c = polyMod(c, pos & 31);
+            group = group * 3 + (pos >> 5);
+            if (++grouped == 3) {
+                c = polyMod(c, group);
+                group = 0;
+                grouped = 0;
+            }
+        }
+        if (grouped) c = polyMod(c, group);
+        for (int i = 0; i < 8; i++) c = polyMod(c, 0);
+        c ^= 1;
+        std::string checksum(8, ' ');
+        for (int i = 0; i < 8; i++) checksum[i] = checksumCharset[(c >> (5 * (7 - i))) & 31];
+        return checksum;
+    }
+
+    // One single-key descriptor wallet entry per key, as a 0.21+ descriptor
+    // wallet stores them: the descriptor, its key (encrypted or not) and the
+    // cached xpub of its key expression. The key is the root of a made-up
+    // chain code, so the descriptor's xpub is the key's own public key; Core
+    // caches the xpub at the end of the fixed path, xpub/0.
+    void writeDescriptors(WalletWriter& writer, SeededRandom& rng, const std::vector<GeneratedKey>& plain,
+                          const std::vector<GeneratedKey>& crypted, const uint8_t masterKey[]) {
+        std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>> records;
+        uint64_t created = 1700000000;
+        auto add = [&](const GeneratedKey& k, bool encrypted) {
+            uint8_t extended[78] = {0x04, 0x88, 0xb2, 0x1e};
+            rng.fill(extended + 13, 32);
+            memcpy(extended + 45, k.pubkey, sizeof(k.pubkey));
+            std::string descriptor = "pkh(" + Base58::encodeCheck(extended, sizeof(extended)) + "/0/*)";
+            descriptor += "#" + descriptorChecksum(descriptor);
+            uint8_t id[Sha256::OUTPUT_SIZE];
+            Sha256::hash(reinterpret_cast<const uint8_t*>(descriptor.data()), descriptor.size(), id);
+
+            RecordWriter key, value;
+            key.str("walletdescriptor").raw(id, sizeof(id));
+            value.str(descriptor).le(created++, 8).le(uint32_t(rng.below(1000)), 4).le(0, 4).le(1000, 4);
+            records.emplace_back(key.bytes, value.bytes);
+
+            RecordWriter keyRecord, keyValue;
+            if (encrypted) {
+                uint8_t iv[Aes256::BLOCK_SIZE], ciphertext[WalletCrypto::CRYPTED_KEY_SIZE];
+                WalletCrypto::keyIV(k.pubkey, sizeof(k.pubkey), iv);
+                WalletCrypto::encrypt32(masterKey, iv, k.privkey, ciphertext);
+                keyRecord.str("walletdescriptorckey").raw(id, sizeof(id)).vec(k.pubkey, sizeof(k.pubkey));
+                keyValue.vec(ciphertext, sizeof(ciphertext));
+            } else {
+                std::vector<uint8_t> der = privateKeyDER(k);
+                std::vector<uint8_t> hashed(k.pubkey, k.pubkey + sizeof(k.pubkey));
+                hashed.insert(hashed.end(), der.begin(), der.end());
+                uint8_t checksum[Sha256::OUTPUT_SIZE];
+                Sha256::hash256(hashed.data(), hashed.size(), checksum);
+                keyRecord.str("walletdescriptorkey").raw(id, sizeof(id)).vec(k.pubkey, sizeof(k.pubkey));
+                keyValue.vec(der.data(), der.size()).raw(checksum, sizeof(checksum));
+            }
+            records.emplace_back(keyRecord.bytes, keyValue.bytes);
+
+            HDKeychain::Key root, parent;
+            HDKeychain::fromExtended(extended + 4, root);
+            HDKeychain::derivePath(root, {0}, parent);
+            uint8_t cached[HDKeychain::EXTENDED_SIZE] = {1};
+            uint8_t fingerprint[Ripemd160::OUTPUT_SIZE];
+            Ripemd160::hash160(k.pubkey, sizeof(k.pubkey), fingerprint);
+            memcpy(cached + 1, fingerprint, 4);
+            memcpy(cached + 9, parent.chainCode, 32);
+            memcpy(cached + 41, parent.pubkey, sizeof(parent.pubkey));
+            RecordWriter cache, cacheValue;
+            cache.str("walletdescriptorcache").raw(id, sizeof(id)).le(0, 4);
+            cacheValue.vec(cached, sizeof(cached));
+            records.emplace_back(cache.bytes, cacheValue.bytes);
+        };
+        for (const auto& k : plain) add(k, false);
+        for (const auto& k : crypted) add(k, true);
+        std::sort(records.begin(), records.end());
+        for (const auto& record : records) writer.put(record.first, record.second);
+    }
+
+    void writeTransactions(WalletWriter& writer, SeededRandom& rng, uint64_t count) {
+        // Ascending txids without sorting: an increasing 64-bit prefix with random gaps
+        uint64_t gap = count ? std::max<uint64_t>(UINT64_MAX / (count + 1), 2) : 1;
+        uint64_t prefix = 0;
+        std::vector<uint8_t> tx;
+        for (uint64_t i = 0; i < count; i++) {
+            prefix += 1 + rng.below(gap - 1);
+            RecordWriter key;
+            key.str("tx");
+            uint8_t txid[32];
+            walletcrypto_detail::writeBE64(txid, prefix);
+            rng.fill(txid + 8, 24);
+            key.raw(txid, sizeof(txid));
+            uint64_t size = txSize / 2 + rng.below(txSize + 1);
+            tx.resize(std::max<uint64_t>(size, 16));
+            rng.fill(tx.data(), tx.size());
+            writer.put(key.bytes, tx);
+        }
+    }
+
+    void writeExpected(const std::vector<GeneratedKey>& keys) {
+        std::vector<std::string> lines;
+        for (const auto& k : keys) {
+            lines.push_back("Address: " + WalletCrypto::publicKeyToAddress(k.pubkey, sizeof(k.pubkey))
+                            + " WIF: " + WalletCrypto::privateKeyToWIF(k.privkey, true));
+        }
+        std::sort(lines.begin(), lines.end());
+        std::ofstream out(outputPath.string() + ".keys");
+        for (const auto& line : lines) out << line << "\n";
+        std::ofstream pass(outputPath.string() + ".pass");
+        pass << passphrase << "\n";
+        if (!out.good() || !pass.good()) throw std::runtime_error("Failed to write expected output files");
+    }
+
+public:
+    static void showHelp() {
+        std::cout << "Wallet Generator Usage:\n\n"
+                  << "  --out <path>              Output wallet file\n"
+                  << "  --type <BerkelyDB|SQLite> Database type (default BerkelyDB)\n"
+                  << "  --seed <n>                Seed for deterministic output (default 1)\n"
+                  << "  --ckeys <n>               Encrypted key records (default 100)\n"
+                  << "  --keys <n>                Unencrypted key records (default 0)\n"
+                  << "  --wkeys <n>               Unencrypted wkey records, as 0.3 wrote them (default 0)\n"
+                  << "  --tx <n>                  Transaction records (default 0)\n"
+                  << "  --tx-size <bytes>         Average transaction size (default 400)\n"
+                  << "  --size <bytes[K|M|G]>     Add transactions until the file is about this size\n"
+                  << "  --page-size <bytes>       Database page size, 512-65536 (default 4096)\n"
+                  << "  --fragmentation <0-100>   Page shuffling, free pages and fill loss (default 0)\n"
+                  << "  --no-keymeta              Omit keymeta records\n"
+                  << "  --descriptors             Write the keys and ckeys as a descriptor wallet's\n"
+                  << "                            walletdescriptor records\n"
+                  << "  --hd                      Derive the keys and ckeys from a seed, at m/0'/0'/i', as a\n"
+                  << "                            legacy HD wallet with its hdchain record\n"
+                  << "  --passphrase <text>       Wallet passphrase (default \"password\")\n"
+                  << "  --iterations <n>          Key derivation rounds (default 25000)\n\n"
+                  << "Writes <out>, <out>.pass with the passphrase and <out>.keys with the\n"
+                  << "expected plaintext keys, one \"Address: ... WIF: ...\" line per key.\n";
+    }
+
+    bool parseArgs(int argc, char* argv[]) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::runtime_error(arg + " requires a value");
+                return argv[++i];
+            };
+            if (arg == "--help") { showHelp(); return false; }
+            else if (arg == "--out") outputPath = value();
+            else if (arg == "--type") {
+                format = value();
+                if (format != "BerkelyDB" && format != "SQLite") {
+                    throw std::runtime_error("Invalid database type. Must be 'BerkelyDB' or 'SQLite'");
+                }
+                if (format == "BerkelyDB") format = "BerkeleyDB";
+            }
+            else if (arg == "--seed") seed = std::stoull(value());
+            else if (arg == "--ckeys") ckeyCount = std::stoull(value());
+            else if (arg == "--keys") keyCount = std::stoull(value());
+            else if (arg == "--wkeys") wkeyCount = std::stoull(value());
+            else if (arg == "--tx") txCount = std::stoull(value());
+            else if (arg == "--tx-size") txSize = std::max<uint64_t>(parseSize(value()), 16);
+            else if (arg == "--size") targetSize = parseSize(value());
+            else if (arg == "--page-size") pageSize = uint32_t(std::stoul(value()));
+            else if (arg == "--fragmentation") fragmentation = unsigned(std::stoul(value()));
+            else if (arg == "--no-keymeta") keyMeta = false;
+            else if (arg == "--descriptors") descriptors = true;
+            else if (arg == "--hd") hd = true;
+            else if (arg == "--passphrase") passphrase = value();
+            else if (arg == "--iterations") iterations = uint32_t(std::stoul(value()));
+            else throw std::runtime_error("Unknown option: " + arg);
+        }
+        if (outputPath.empty()) throw std::runtime_error("Output path must be specified");
+        if (pageSize < 512 || pageSize > 65536 || (pageSize & (pageSize - 1))) {
+            throw std::runtime_error("Page size must be a power of two between 512 and 65536");
+        }
+        if (fragmentation > 100) throw std::runtime_error("Fragmentation must be between 0 and 100");
+        if (ckeyCount && passphrase.empty()) throw std::runtime_error("Encrypted keys need a passphrase");
+        if (hd && descriptors) throw std::runtime_error("--hd and --descriptors are different kinds of wallet");
+        return true;
+    }
+
+    void execute() {
+        SeededRandom rng(seed);
+        std::unique_ptr<WalletWriter> writer;
+        if (format == "SQLite") writer = std::make_unique<SQLiteWalletWriter>(outputPath, pageSize, fragmentation, rng);
+        else writer = std::make_unique<BerkeleyWalletWriter>(outputPath, pageSize, fragmentation, rng);
+
+        std::vector<GeneratedKey> plainKeys, cryptedKeys;
+        GeneratedKey seedKey;
+        if (hd) {
+            // The first keyCount indexes stay unencrypted; the seed is
+            // encrypted whenever there are ckeys
+            std::vector<GeneratedKey> derived = generateHDKeys(rng, keyCount + ckeyCount, seedKey);
+            for (const auto& k : derived) (uint64_t(k.hdIndex) < keyCount ? plainKeys : cryptedKeys).push_back(k);
+            std::vector<GeneratedKey>& seedList = ckeyCount ? cryptedKeys : plainKeys;
+            seedList.insert(std::upper_bound(seedList.begin(), seedList.end(), seedKey,
+                                             [](const GeneratedKey& a, const GeneratedKey& b) {
+                                                 return memcmp(a.pubkey, b.pubkey, sizeof(a.pubkey)) < 0;
+                                             }),
+                            seedKey);
+        } else {
+            plainKeys = generateKeys(rng, keyCount);
+            cryptedKeys = generateKeys(rng, ckeyCount);
+        }
+        std::vector<GeneratedKey> walletKeys = generateKeys(rng, wkeyCount);
+        std::vector<GeneratedKey> descriptorKeys, descriptorCryptedKeys;
+        if (descriptors) {
+            descriptorKeys.swap(plainKeys);
+            descriptorCryptedKeys.swap(cryptedKeys);
+        }
+        if (targetSize) {
+            uint64_t perKey = 400 + (keyMeta ? 120 : 0);
+            uint64_t used = (keyCount + ckeyCount + wkeyCount) * perKey;
+            // Fragmentation costs page fill and adds freed copies of leaves
+            double fill = (1.0 - fragmentation / 200.0) * (1.0 - fragmentation / 400.0);
+            if (targetSize > used) txCount = std::max(txCount, uint64_t((targetSize - used) * fill / (txSize + 64)));
+        }
+
+        uint8_t masterKey[WalletCrypto::MASTER_KEY_SIZE];
+        uint8_t salt[8];
+        rng.fill(masterKey, sizeof(masterKey));
+        rng.fill(salt, sizeof(salt));
+        uint8_t seedId[20];
+        rng.fill(seedId, sizeof(seedId));
+        if (hd) Ripemd160::hash160(seedKey.pubkey, sizeof(seedKey.pubkey), seedId);
+
+        // Keys are emitted in BerkeleyDB key order: tx < key < ckey < mkey < wkey < hdchain < keymeta
+        // < version < minversion < walletdescriptor...
+        writeTransactions(*writer, rng, txCount);
+
+        for (const auto& k : plainKeys) {
+            RecordWriter key, value;
+            key.str("key").vec(k.pubkey, sizeof(k.pubkey));
+            std::vector<uint8_t> der = privateKeyDER(k);
+            std::vector<uint8_t> hashed(k.pubkey, k.pubkey + sizeof(k.pubkey));
+            hashed.insert(hashed.end(), der.begin(), der.end());
+            uint8_t checksum[Sha256::OUTPUT_SIZE];
+            Sha256::hash256(hashed.data(), hashed.size(), checksum);
+            value.vec(der.data(), der.size()).raw(checksum, sizeof(checksum));
+            writer->put(key.bytes, value.bytes);
+        }
+
+        for (const auto& k : cryptedKeys) {
+            uint8_t iv[Aes256::BLOCK_SIZE], crypted[WalletCrypto::CRYPTED_KEY_SIZE];
+            WalletCrypto::keyIV(k.pubkey, sizeof(k.pubkey), iv);
+            WalletCrypto::encrypt32(masterKey, iv, k.privkey, crypted);
+            RecordWriter key, value;
+            key.str("ckey").vec(k.pubkey, sizeof(k.pubkey));
+            value.vec(crypted, sizeof(crypted));
+            writer->put(key.bytes, value.bytes);
+        }
+
+        if (!cryptedKeys.empty() || !descriptorCryptedKeys.empty()) {
+            uint8_t key[Aes256::KEY_SIZE], iv[Aes256::BLOCK_SIZE], crypted[WalletCrypto::CRYPTED_KEY_SIZE];
+            WalletCrypto::deriveKey(reinterpret_cast<const uint8_t*>(passphrase.data()), passphrase.size(),
+                                    salt, sizeof(salt), iterations, key, iv);
+            WalletCrypto::encrypt32(key, iv, masterKey, crypted);
+            RecordWriter mkey, value;
+            mkey.str("mkey").le(1, 4);
+            value.vec(crypted, sizeof(crypted)).vec(salt, sizeof(salt)).le(0, 4).le(iterations, 4).compactSize(0);
+            writer->put(mkey.bytes, value.bytes);
+        }
+
+        // CWalletKey: version, DER private key, creation and expiry times, comment
+        uint64_t created = 1280000000;
+        for (const auto& k : walletKeys) {
+            RecordWriter key, value;
+            key.str("wkey").vec(k.pubkey, sizeof(k.pubkey));
+            std::vector<uint8_t> der = privateKeyDER(k);
+            value.le(300, 4).vec(der.data(), der.size()).le(created++, 8).le(0, 8).str("");
+            writer->put(key.bytes, value.bytes);
+        }
+
+        if (hd) {
+            // CHDChain version 2: external and internal counters around the seed id
+            RecordWriter key, value;
+            key.str("hdchain");
+            value.le(2, 4).le(keyCount + ckeyCount, 4).raw(seedId, sizeof(seedId)).le(0, 4);
+            writer->put(key.bytes, value.bytes);
+        }
+
+        if (keyMeta) {
+            std::vector<const GeneratedKey*> all;
+            for (const auto& k : plainKeys) all.push_back(&k);
+            for (const auto& k : cryptedKeys) all.push_back(&k);
+            std::sort(all.begin(), all.end(), [](const GeneratedKey* a, const GeneratedKey* b) {
+                return memcmp(a->pubkey, b->pubkey, sizeof(a->pubkey)) < 0;
+            });
+            uint64_t index = 0;
+            for (const GeneratedKey* k : all) {
+                RecordWriter key, value;
+                key.str("keymeta").vec(k->pubkey, sizeof(k->pubkey));
+                value.le(12, 4).le(1700000000 + index, 8);
+                if (hd && k->hdIndex < 0) {
+                    // Core's path for the seed itself
+                    value.str("s").raw(seedId, sizeof(seedId)).raw(seedId, 4).compactSize(0);
+                } else {
+                    uint64_t child = hd ? uint64_t(k->hdIndex) : index;
+                    value.str("m/0'/0'/" + std::to_string(child) + "'")
+                         .raw(seedId, sizeof(seedId))
+                         .raw(seedId, 4).compactSize(3).le(0x80000000, 4).le(0x80000000, 4).le(0x80000000 | child, 4);
+                }
+                value.le(1, 1);
+                writer->put(key.bytes, value.bytes);
+                index++;
+            }
+        }
+
+        RecordWriter version, versionValue, minVersion, minVersionValue;
+        version.str("version");
+        versionValue.le(169900, 4);
+        minVersion.str("minversion");
+        minVersionValue.le(139900, 4);
+        writer->put(version.bytes, versionValue.bytes);
+        writer->put(minVersion.bytes, minVersionValue.bytes);
+        if (descriptors) writeDescriptors(*writer, rng, descriptorKeys, descriptorCryptedKeys, masterKey);
+        writer->finish();
+
+        std::vector<GeneratedKey> expected = plainKeys;
+        expected.insert(expected.end(), cryptedKeys.begin(), cryptedKeys.end());
+        expected.insert(expected.end(), walletKeys.begin(), walletKeys.end());
+        expected.insert(expected.end(), descriptorKeys.begin(), descriptorKeys.end());
+        expected.insert(expected.end(), descriptorCryptedKeys.begin(), descriptorCryptedKeys.end());
+        writeExpected(expected);
+        volatile uint8_t* wipe = masterKey;
+        for (size_t i = 0; i < sizeof(masterKey); i++) wipe[i] = 0;
+
+        std::cout << "Generated " << outputPath.string() << ": " << cryptedKeys.size() << " ckey, "
+                  << plainKeys.size() << " key, " << walletKeys.size() << " wkey, ";
+        if (descriptors) {
+            std::cout << descriptorCryptedKeys.size() << " descriptor ckey, " << descriptorKeys.size()
+                      << " descriptor key, ";
+        }
+        std::cout << txCount << " tx records, "
+                  << fs::file_size(outputPath) << " bytes" << std::endl;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    try {
+        WalletGenerator generator;
+        if (argc == 1) {
+            throw std::runtime_error("No options provided. Use --help for usage information.");
+        }
+        if (generator.parseArgs(argc, argv)) generator.execute();
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
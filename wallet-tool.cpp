@@ -9,6 +9,7 @@
 #include <filesystem>
 #include <regex>
 #include <cstdint>
+#include <climits>
 #include <iomanip>
 #include <algorithm>
 #include <cstring>
@@ -23,6 +24,40 @@
 #include <condition_variable>
 #include <optional>
 #include <atomic>
+#include <set>
+#include <array>
+#ifdef _WIN32
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+#ifdef __linux__
+#include <linux/magic.h>
+#include <linux/perf_event.h>
+#include <sys/vfs.h>
+#include <sys/syscall.h>
+#endif
+
+#include "address-index.h"
+#include "hd-keychain.h"
+#include "key-set.h"
+#include "libwallettool.h"
+#include "record-layout.h"
+#include "secure-arena.h"
+#include "task-scheduler.h"
+#include "uring-reader.h"
+#include "wallet-format.h"
 
 namespace fs = std::filesystem;
 
@@ -35,15 +70,462 @@ public:
         std::lock_guard<std::mutex> lock(metricsMutex);
         metrics[metric]++;
     }
+    static void add(const std::string& metric, uint64_t amount) {
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        metrics[metric] += amount;
+    }
     static void reset() { metrics.clear(); }
     static uint64_t get(const std::string& metric) {
         std::lock_guard<std::mutex> lock(metricsMutex);
         return metrics[metric];
     }
+    static std::map<std::string, uint64_t> snapshot() {
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        return metrics;
+    }
 };
 std::map<std::string, uint64_t> MetricsCollector::metrics;
 std::mutex MetricsCollector::metricsMutex;
 
+// Hot-path tracing for --trace. Spans are appended to a per-thread ring
+// buffer without locking; all buffers are written out as Chrome trace JSON
+// (chrome://tracing, Perfetto) at the end of main, once the workers are joined.
+class TraceRecorder {
+public:
+    struct Event {
+        const char* name;
+        const char* category;
+        const char* wallet;
+        uint64_t startNs;
+        uint64_t durationNs;
+    };
+
+private:
+    static constexpr size_t RING_CAPACITY = 1 << 16;
+
+    struct ThreadBuffer {
+        std::vector<Event> ring;
+        uint64_t written = 0;
+        uint32_t tid = 0;
+    };
+
+    static std::atomic<bool> enabled;
+    static std::string outputPath;
+    static std::mutex registryMutex;
+    static std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    static std::set<std::string> walletNames;
+    static thread_local const char* currentWallet;
+    static const std::chrono::steady_clock::time_point epoch;
+
+    static ThreadBuffer& local() {
+        thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+            auto b = std::make_shared<ThreadBuffer>();
+            b->ring.resize(RING_CAPACITY);
+            std::lock_guard<std::mutex> lock(registryMutex);
+            b->tid = static_cast<uint32_t>(buffers.size() + 1);
+            buffers.push_back(b);
+            return b;
+        }();
+        return *buffer;
+    }
+
+    static std::string escape(const char* s) {
+        std::string out;
+        for (; *s; s++) {
+            unsigned char c = static_cast<unsigned char>(*s);
+            if (c == '"' || c == '\\') { out += '\\'; out += char(c); }
+            else if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            }
+            else out += char(c);
+        }
+        return out;
+    }
+
+public:
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    static void enable(const std::string& path) {
+        if (enabled.exchange(true)) return;
+        outputPath = path;
+    }
+
+    // Stops the workers first: their ring buffers are written without a
+    // lock, so they may only be read once no thread can append to them
+    static void finish() {
+        if (!isEnabled()) return;
+        TaskScheduler::instance().stop();
+        if (!writeChromeTrace(outputPath)) {
+            std::cerr << "Warning: could not write trace file " << outputPath << std::endl;
+        }
+    }
+
+    // Labels subsequent spans and counter phases on this thread with the
+    // wallet being processed
+    static void setWallet(const std::string& wallet) { currentWallet = intern(wallet); }
+
+    static const char* wallet() { return currentWallet; }
+
+    // Wallet labels live until exit, so tasks can carry them between threads
+    static const char* intern(const std::string& wallet) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        return walletNames.insert(wallet).first->c_str();
+    }
+
+    // Labels a task with its wallet on whichever thread runs it, and puts
+    // back the label of the task that thread was waiting in
+    class WalletScope {
+    private:
+        const char* saved;
+    public:
+        explicit WalletScope(const char* wallet) : saved(currentWallet) { currentWallet = wallet; }
+        ~WalletScope() { currentWallet = saved; }
+        WalletScope(const WalletScope&) = delete;
+        WalletScope& operator=(const WalletScope&) = delete;
+    };
+
+    static void record(const char* name, const char* category, uint64_t startNs, uint64_t endNs) {
+        ThreadBuffer& b = local();
+        b.ring[b.written % RING_CAPACITY] = Event{name, category, currentWallet, startNs, endNs - startNs};
+        b.written++;
+    }
+
+    static bool writeChromeTrace(const std::string& path) {
+        std::ofstream out(path);
+        if (!out) return false;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        long pid = static_cast<long>(getpid());
+        uint64_t dropped = 0;
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        for (const auto& b : buffers) {
+            out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+                << ",\"tid\":" << b->tid << ",\"args\":{\"name\":\"" << (b->tid == 1 ? "main" : "worker") << "\"}}";
+            first = false;
+            uint64_t count = std::min<uint64_t>(b->written, RING_CAPACITY);
+            dropped += b->written - count;
+            for (uint64_t i = b->written - count; i < b->written; i++) {
+                const Event& e = b->ring[i % RING_CAPACITY];
+                out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category << "\",\"ph\":\"X\",\"ts\":"
+                    << std::fixed << std::setprecision(3) << e.startNs / 1000.0 << ",\"dur\":" << e.durationNs / 1000.0
+                    << ",\"pid\":" << pid << ",\"tid\":" << b->tid;
+                if (e.wallet) out << ",\"args\":{\"wallet\":\"" << escape(e.wallet) << "\"}";
+                out << "}";
+            }
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+        return out.good();
+    }
+};
+std::atomic<bool> TraceRecorder::enabled{false};
+std::string TraceRecorder::outputPath;
+std::mutex TraceRecorder::registryMutex;
+std::vector<std::shared_ptr<TraceRecorder::ThreadBuffer>> TraceRecorder::buffers;
+std::set<std::string> TraceRecorder::walletNames;
+thread_local const char* TraceRecorder::currentWallet = nullptr;
+const std::chrono::steady_clock::time_point TraceRecorder::epoch = std::chrono::steady_clock::now();
+
+// Hardware counters for --perf-counters. Every thread opens one
+// perf_event_open group and reads it at each phase boundary; the delta is
+// charged to the innermost open phase, so each phase reports its self cost.
+// Counters the kernel or hypervisor does not expose are reported as n/a.
+class PerfCounters {
+public:
+    enum Counter { CYCLES, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, CONTEXT_SWITCHES, COUNTER_COUNT };
+
+private:
+    struct Phase {
+        const char* wallet;
+        const char* category;
+        const char* name;
+    };
+
+    struct PhaseLess {
+        bool operator()(const Phase& a, const Phase& b) const {
+            std::less<const char*> less;
+            if (a.wallet != b.wallet) return less(a.wallet, b.wallet);
+            if (a.category != b.category) return less(a.category, b.category);
+            return less(a.name, b.name);
+        }
+    };
+
+    struct Totals {
+        uint64_t calls = 0;
+        uint64_t ns = 0;
+        uint64_t values[COUNTER_COUNT] = {};
+
+        void add(const Totals& other) {
+            calls += other.calls;
+            ns += other.ns;
+            for (int c = 0; c < COUNTER_COUNT; c++) values[c] += other.values[c];
+        }
+    };
+
+    struct ThreadState {
+        std::mutex mutex;
+        int leader = -1;
+        int fds[COUNTER_COUNT];
+        int slots[COUNTER_COUNT];
+        int opened = 0;
+        uint64_t last[COUNTER_COUNT] = {};
+        uint64_t lastNs = 0;
+        std::vector<Phase> stack;
+        std::map<Phase, Totals, PhaseLess> totals;
+
+        ThreadState() {
+            std::fill(fds, fds + COUNTER_COUNT, -1);
+            std::fill(slots, slots + COUNTER_COUNT, -1);
+        }
+
+        void closeCounters() {
+            #ifdef __linux__
+                for (int c = 0; c < COUNTER_COUNT; c++) {
+                    if (fds[c] >= 0) close(fds[c]);
+                    fds[c] = -1;
+                }
+            #endif
+            leader = -1;
+        }
+    };
+
+    // Keeps a thread's totals registered after it exits but closes its fds
+    struct ThreadHandle {
+        std::shared_ptr<ThreadState> state;
+        ~ThreadHandle() { state->closeCounters(); }
+    };
+
+    static constexpr const char* LABELS[COUNTER_COUNT] = {
+        "cycles", "instructions", "LLC misses", "branch misses", "ctx switches"
+    };
+
+    static std::atomic<bool> enabled;
+    static std::atomic<unsigned> availableMask;
+    static std::atomic<bool> userSpaceOnly;
+    static std::mutex registryMutex;
+    static std::vector<std::shared_ptr<ThreadState>> threads;
+    static std::string failures[COUNTER_COUNT];
+
+    static void openCounters(ThreadState& t) {
+        #ifdef __linux__
+            // Generic cache-misses maps to last-level cache misses on x86 and
+            // most ARM cores, and is far more widely exposed than LL cache events
+            static const std::pair<uint32_t, uint64_t> events[COUNTER_COUNT] = {
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+                {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+            };
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = events[c].first;
+                attr.config = events[c].second;
+                attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                attr.exclude_hv = 1;
+                int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, t.leader, 0));
+                if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+                    // perf_event_paranoid >= 2 only allows user-space counting
+                    attr.exclude_kernel = 1;
+                    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, t.leader, 0));
+                    if (fd >= 0) userSpaceOnly = true;
+                }
+                if (fd < 0) {
+                    std::lock_guard<std::mutex> lock(registryMutex);
+                    if (failures[c].empty()) failures[c] = strerror(errno);
+                    continue;
+                }
+                if (t.leader < 0) t.leader = fd;
+                t.fds[c] = fd;
+                t.slots[c] = t.opened++;
+                availableMask |= 1u << c;
+            }
+        #else
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                if (failures[c].empty()) failures[c] = "not supported on this platform";
+            }
+        #endif
+    }
+
+    static ThreadState& local() {
+        thread_local ThreadHandle handle = [] {
+            auto t = std::make_shared<ThreadState>();
+            openCounters(*t);
+            std::lock_guard<std::mutex> lock(registryMutex);
+            threads.push_back(t);
+            return ThreadHandle{t};
+        }();
+        return *handle.state;
+    }
+
+    // Counter values scaled up for the time the group was multiplexed out
+    static void readCounters(const ThreadState& t, uint64_t values[COUNTER_COUNT]) {
+        #ifdef __linux__
+            uint64_t buffer[3 + COUNTER_COUNT];
+            ssize_t got = read(t.leader, buffer, sizeof(buffer));
+            if (got < static_cast<ssize_t>(3 * sizeof(uint64_t))) return;
+            uint64_t count = buffer[0], timeEnabled = buffer[1], timeRunning = buffer[2];
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                if (t.slots[c] < 0 || static_cast<uint64_t>(t.slots[c]) >= count) continue;
+                uint64_t value = buffer[3 + t.slots[c]];
+                if (timeRunning && timeRunning < timeEnabled) {
+                    value = static_cast<uint64_t>(static_cast<long double>(value) * timeEnabled / timeRunning);
+                }
+                values[c] = value;
+            }
+        #else
+            (void)t;
+            (void)values;
+        #endif
+    }
+
+    static void charge(ThreadState& t) {
+        uint64_t nowNs = TraceRecorder::now();
+        uint64_t values[COUNTER_COUNT] = {};
+        if (t.leader >= 0) readCounters(t, values);
+        if (!t.stack.empty()) {
+            std::lock_guard<std::mutex> lock(t.mutex);
+            Totals& totals = t.totals[t.stack.back()];
+            totals.ns += nowNs - t.lastNs;
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                if (values[c] > t.last[c]) totals.values[c] += values[c] - t.last[c];
+            }
+        }
+        std::copy(values, values + COUNTER_COUNT, t.last);
+        t.lastNs = nowNs;
+    }
+
+    static std::string formatCount(uint64_t value, bool available) {
+        return available ? std::to_string(value) : "n/a";
+    }
+
+    static void writeRow(std::ostream& out, const std::string& label, const Totals& totals) {
+        unsigned mask = availableMask;
+        out << "  " << std::left << std::setw(44) << label << std::right
+            << std::setw(9) << totals.calls
+            << std::setw(12) << std::fixed << std::setprecision(3) << totals.ns / 1e6;
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            out << std::setw(15) << formatCount(totals.values[c], mask & (1u << c));
+        }
+        bool haveIpc = (mask & (1u << CYCLES)) && (mask & (1u << INSTRUCTIONS)) && totals.values[CYCLES];
+        out << std::setw(7);
+        if (haveIpc) out << std::setprecision(2) << double(totals.values[INSTRUCTIONS]) / totals.values[CYCLES];
+        else out << "n/a";
+        out << "\n";
+    }
+
+    static void reportAtExit() { writeReport(std::cerr); }
+
+public:
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    static void enable() {
+        if (enabled.exchange(true)) return;
+        std::atexit(reportAtExit);
+    }
+
+    static void enter(const char* name, const char* category) {
+        ThreadState& t = local();
+        charge(t);
+        t.stack.push_back(Phase{TraceRecorder::wallet(), category, name});
+        std::lock_guard<std::mutex> lock(t.mutex);
+        t.totals[t.stack.back()].calls++;
+    }
+
+    static void leave() {
+        ThreadState& t = local();
+        charge(t);
+        if (!t.stack.empty()) t.stack.pop_back();
+    }
+
+    static void writeReport(std::ostream& out) {
+        // wallet -> "category/phase" -> totals, merged across threads
+        std::map<std::string, std::map<std::string, Totals>> byWallet;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (const auto& t : threads) {
+                std::lock_guard<std::mutex> threadLock(t->mutex);
+                for (const auto& entry : t->totals) {
+                    std::string wallet = entry.first.wallet ? entry.first.wallet : "(no wallet)";
+                    std::string phase = std::string(entry.first.category) + "/" + entry.first.name;
+                    byWallet[wallet][phase].add(entry.second);
+                }
+            }
+        }
+
+        out << "\nPerformance counters (self cost per phase"
+            << (userSpaceOnly ? ", user space only" : "") << "):\n";
+        for (const auto& wallet : byWallet) {
+            out << "Wallet: " << wallet.first << "\n"
+                << "  " << std::left << std::setw(44) << "phase" << std::right
+                << std::setw(9) << "calls" << std::setw(12) << "time ms";
+            for (int c = 0; c < COUNTER_COUNT; c++) out << std::setw(15) << LABELS[c];
+            out << std::setw(7) << "IPC" << "\n";
+
+            std::vector<std::pair<std::string, Totals>> phases(wallet.second.begin(), wallet.second.end());
+            std::stable_sort(phases.begin(), phases.end(), [](const auto& a, const auto& b) {
+                return a.second.ns > b.second.ns;
+            });
+            Totals total;
+            for (const auto& phase : phases) {
+                writeRow(out, phase.first, phase.second);
+                total.add(phase.second);
+            }
+            writeRow(out, "total", total);
+        }
+
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (!(availableMask & (1u << c))) {
+                out << "Unavailable: " << LABELS[c] << " (" << (failures[c].empty() ? "not opened" : failures[c]) << ")\n";
+            }
+        }
+
+        auto metrics = MetricsCollector::snapshot();
+        if (!metrics.empty()) {
+            out << "Metrics:\n";
+            for (const auto& metric : metrics) out << "  " << metric.first << ": " << metric.second << "\n";
+        }
+        out.flush();
+    }
+};
+std::atomic<bool> PerfCounters::enabled{false};
+std::atomic<unsigned> PerfCounters::availableMask{0};
+std::atomic<bool> PerfCounters::userSpaceOnly{false};
+std::mutex PerfCounters::registryMutex;
+std::vector<std::shared_ptr<PerfCounters::ThreadState>> PerfCounters::threads;
+std::string PerfCounters::failures[PerfCounters::COUNTER_COUNT];
+
+// Records one span from construction to destruction and, under
+// --perf-counters, brackets it as a counter phase. Names and categories must
+// be string literals; with both off this costs two branches.
+class TraceSpan {
+private:
+    const char* name;
+    const char* category;
+    uint64_t start;
+    bool counted;
+public:
+    TraceSpan(const char* name, const char* category)
+        : name(name), category(category), start(TraceRecorder::isEnabled() ? TraceRecorder::now() : 0),
+          counted(PerfCounters::isEnabled()) {
+        if (counted) PerfCounters::enter(name, category);
+    }
+    ~TraceSpan() {
+        if (start) TraceRecorder::record(name, category, start, TraceRecorder::now());
+        if (counted) PerfCounters::leave();
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
 class WalletSecurity {
 private:
     static constexpr size_t MAX_ATTEMPTS = 3;
@@ -98,14 +580,126 @@ public:
     }
 };
 
+// Master keys of wallets unlocked through the daemon. They live in one
+// locked arena in fixed slots that are wiped and reused once they expire.
+class UnlockedKeyStore {
+private:
+    struct Entry {
+        uint8_t* key;
+        std::chrono::steady_clock::time_point expiry;
+    };
+    SecureArena arena{64 * 1024};
+    std::map<std::string, Entry> entries;
+    std::vector<uint8_t*> freeSlots;
+    std::mutex storeMutex;
+
+    void expire(std::chrono::steady_clock::time_point now) {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->second.expiry <= now) {
+                SecureArena::wipe(it->second.key, WT_SECRET_SIZE);
+                freeSlots.push_back(it->second.key);
+                it = entries.erase(it);
+            }
+            else ++it;
+        }
+    }
+
+public:
+    void store(const std::string& wallet, const uint8_t* key, std::chrono::seconds timeout) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        auto now = std::chrono::steady_clock::now();
+        expire(now);
+        auto it = entries.find(wallet);
+        uint8_t* slot;
+        if (it != entries.end()) slot = it->second.key;
+        else if (!freeSlots.empty()) { slot = freeSlots.back(); freeSlots.pop_back(); }
+        else slot = arena.allocate(WT_SECRET_SIZE);
+        memcpy(slot, key, WT_SECRET_SIZE);
+        entries[wallet] = Entry{slot, now + timeout};
+    }
+
+    // Copies the master key into out; false when the wallet is not unlocked
+    bool lookup(const std::string& wallet, uint8_t* out) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        expire(std::chrono::steady_clock::now());
+        auto it = entries.find(wallet);
+        if (it == entries.end()) return false;
+        memcpy(out, it->second.key, WT_SECRET_SIZE);
+        return true;
+    }
+
+    void lock(const std::string& wallet) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        auto it = entries.find(wallet);
+        if (it == entries.end()) return;
+        it->second.expiry = std::chrono::steady_clock::time_point::min();
+        expire(std::chrono::steady_clock::now());
+    }
+};
+
+// Runs the --serve job daemon until SIGINT or SIGTERM; defined with WalletDaemon
+void runDaemon(const std::string& socketPath);
+void runCarver(const std::string& imagePath, const std::string& outputDir);
+struct DiscoveryStats {
+    uint64_t filesExamined;
+    uint64_t unreadableDirectories;
+};
+DiscoveryStats runDiscovery(const std::string& root,
+                            const std::function<void(const std::string&, WalletFormat::Kind)>& found);
+
 // Walletool
 class WalletTool {
 private:
+    std::ostream& out;
+    WalletCache* recordCache;
+    UnlockedKeyStore* unlockedKeys;
+    std::vector<std::string> walletPaths;
     std::string walletPath;
     std::string dbType;
     std::string hexKey;
+    std::string passphrase;
     bool removePass = false;
     bool dumpKeys = false;
+    std::string tracePath;
+    bool perfCounters = false;
+    std::string servePath;
+    std::string carvePath;
+    std::string outputDir;
+    std::string discoverRoot;
+    unsigned threads = 0;
+    std::string affinity;
+    std::string ioBackend = "auto";
+    std::string bdbLogs;   // BerkeleyDB log directory; empty to look beside each wallet
+    bool salvage = false;  // read damaged wallets page by page
+    bool forensic = false; // also report deleted records left in the file
+    bool dedupe = false;   // print each pubkey once, across the wallets of a batch too
+    std::string dedupeSpill;   // where big key sets spill to disk; empty to keep them in memory
+    uint32_t gapLimit = 0;     // derive HD keys until this many in a row are not in the wallet; 0 not to
+    std::string buildIndexPath;    // --build-index: write the wallets' address index here
+    std::string indexPath;         // --index: look addresses up in this index
+    std::vector<std::string> findAddresses;
+    std::shared_ptr<WalletBuffer> preloaded;   // the wallet's bytes when a batch read them ahead
+    bool verifyOnly = false;
+    uint64_t decryptedKeys = 0;
+    uint64_t mismatchedKeys = 0;
+
+    // Library handles for the duration of one wallet job
+    struct WalletHandle {
+        wt_wallet* wallet = nullptr;
+        ~WalletHandle() { wt_close(wallet); }
+    };
+    struct CursorHandle {
+        wt_cursor* cursor = nullptr;
+        ~CursorHandle() { wt_cursor_close(cursor); }
+    };
+    struct StreamHandle {
+        wt_stream* stream = nullptr;
+        ~StreamHandle() { wt_stream_close(stream); }
+    };
+
+    static void check(wt_status status) {
+        if (status != WT_OK) throw std::runtime_error(wt_last_error());
+    }
 
     std::string tohex(const char* ptr, int length) {
         std::stringstream ss;
@@ -116,64 +710,859 @@ private:
         return ss.str();
     }
 
+    std::string tohex(const uint8_t* ptr, size_t length) {
+        return tohex(reinterpret_cast<const char*>(ptr), static_cast<int>(length));
+    }
+
+    void openWallet(WalletHandle& handle) {
+        TraceSpan span("file open", "WalletTool");
+        if (preloaded) {
+            check(wt_open_named_buffer(preloaded->bytes.data(), preloaded->bytes.size(), walletPath.c_str(), &handle.wallet));
+        } else {
+            check(wt_open_file(walletPath.c_str(), &handle.wallet));
+        }
+        if (salvage) {
+            check(wt_set_parser(handle.wallet, WT_PARSER_SALVAGE));
+            return;
+        }
+        if (forensic) check(wt_set_parser(handle.wallet, WT_PARSER_FORENSIC));
+        attachLogs(handle.wallet);
+    }
+
+    // --forensic: where a record that is no longer in the wallet was found
+    static const char* staleNote(wt_record_origin origin) {
+        switch (origin) {
+            case WT_ORIGIN_DELETED: return " (stale: deleted item)";
+            case WT_ORIGIN_SLACK: return " (stale: page slack)";
+            case WT_ORIGIN_FREE_PAGE: return " (stale: free page)";
+            default: return "";
+        }
+    }
+
+    // --salvage: how much of the file held up, after the keys
+    void reportSalvage(wt_wallet* wallet) {
+        wt_salvage_stats stats;
+        check(wt_salvage_report(wallet, &stats));
+        if (!stats.page_size) {
+            out << "Salvage: no page layout fits " << walletPath << "; nothing recovered" << std::endl;
+            return;
+        }
+        out << "Salvage: " << stats.pages_intact << " of " << stats.pages << " pages of " << stats.page_size
+            << " bytes intact (" << std::fixed << std::setprecision(1)
+            << (stats.pages ? 100.0 * stats.pages_intact / stats.pages : 0.0) << std::defaultfloat << "%), "
+            << stats.pages_damaged << " damaged, " << stats.pages_unreadable << " unreadable; recovered "
+            << stats.mkeys << " mkey, " << stats.ckeys << " ckey, " << stats.keys << " key and "
+            << stats.keymetas << " keymeta records" << std::endl;
+    }
+
+    // A BerkeleyDB wallet copied from a running node may have committed
+    // changes that are still only in its environment's log, which Bitcoin
+    // Core keeps in database/ beside the wallet
+    void attachLogs(wt_wallet* wallet) {
+        if (!bdbLogs.empty()) {
+            check(wt_attach_bdb_logs(wallet, bdbLogs.c_str()));
+            return;
+        }
+        std::error_code error;
+        fs::path directory = fs::path(walletPath).parent_path() / "database";
+        if (fs::is_directory(directory, error)) wt_attach_bdb_logs(wallet, directory.string().c_str());
+    }
+
+    // Finds the master key record. With a record cache (daemon mode) the scan
+    // is skipped while the file keeps the same size and modification time.
+    bool findMasterKey(wt_wallet* wallet, wt_record& master) {
+        std::string cacheKey;
+        if (recordCache) {
+            std::error_code error;
+            auto size = fs::file_size(walletPath, error);
+            auto modified = fs::last_write_time(walletPath, error);
+            if (!error) {
+                cacheKey = walletPath + ":" + std::to_string(size) + ":" +
+                           std::to_string(modified.time_since_epoch().count());
+                if (auto cached = recordCache->retrieve(cacheKey)) {
+                    check(wt_set_master_key_record(wallet, cached->data()));
+                }
+            }
+        }
+
+        wt_status status;
+        {
+            TraceSpan scan("scan", "WalletTool");
+            status = wt_find_master_key(wallet, &master);
+        }
+        if (status == WT_ERR_NO_MASTER_KEY) return false;
+        check(status);
+        if (!cacheKey.empty()) {
+            recordCache->store(cacheKey, std::vector<uint8_t>(master.value, master.value + master.value_len));
+        }
+        return true;
+    }
+
     void dumpAllKeys() {
-        FILE* wallet = fopen(walletPath.c_str(), "rb");
-        if (wallet == NULL) {
-            throw std::runtime_error("Can't open file " + walletPath);
-        }
-
-        // First find and print master key
-        char mkey[5];
-        int i = 0;
-        bool found_mkey = false;
-        char* mkey_data = (char*)malloc(48);
-
-        while (fread(mkey, 1, 4, wallet) == 4 && !feof(wallet) && !found_mkey) {
-            if (strncmp(mkey, "mkey", 4) == 0) {
-                int mkey_offset = i;
-                fseek(wallet, mkey_offset - 72, SEEK_SET);
-                fread(mkey_data, 1, 48, wallet);
-                std::cout << "Mkey_encrypted: " << tohex(mkey_data, 48) << std::endl;
-                std::cout << std::endl;
-                found_mkey = true;
-            }
-            i++;
-            fseek(wallet, i, SEEK_SET);
-        }
-
-        if (!found_mkey) {
-            std::cout << "There is no Master Key in the file" << std::endl;
-            free(mkey_data);
-            fclose(wallet);
+        if (walletPath == "-") {
+            dumpStream();
             return;
         }
+        WalletHandle handle;
+        openWallet(handle);
+
+        std::error_code sizeError;
+        uint64_t walletSize = preloaded ? preloaded->bytes.size() : fs::file_size(walletPath, sizeError);
+        SecureArena arena(SecureArena::sizeHintForWallet(sizeError ? 0 : walletSize));
+        MetricsCollector::increment("wallets_scanned");
+        if (!sizeError) MetricsCollector::add("bytes_scanned", walletSize);
+
+        // First find and print master key. An unencrypted wallet has none,
+        // but its key and wkey records still hold keys.
+        wt_record master;
+        KeyBatch batch;
+        bool unlocked = false;
+        if (findMasterKey(handle.wallet, master)) {
+            unlocked = unlockForDump(arena, handle.wallet, master, batch);
+        } else {
+            out << "There is no Master Key in the file" << std::endl;
+            allocateBatch(arena, batch);
+        }
+        if (dedupe) startDedupe(handle.wallet);
+
+        // Then every key, in file order and in the same pass: ckeys, the key
+        // and wkey records whose DER is read directly, and the keys,
+        // descriptors and cached xpubs of descriptor wallets. Records are
+        // kept whatever their origin, so the stale copies --forensic finds
+        // in deleted items, page slack and free pages go through with the
+        // live ones; reportKeys checks those against their pubkey and marks
+        // them. Keys are decrypted in batches spread over the task scheduler
+        // and reported in order.
+        CursorHandle cursor;
+        check(wt_cursor_open(handle.wallet, &cursor.cursor));
+        std::vector<wt_record> records;
+        records.reserve(KEY_BATCH);
+        uint64_t ckeysFound = 0, plainKeysFound = 0;
+        decryptedKeys = 0;
+        mismatchedKeys = 0;
+        for (bool more = true; more;) {
+            records.clear();
+            {
+                TraceSpan scan("scan", "WalletTool");
+                wt_record record;
+                while (records.size() < KEY_BATCH && (more = wt_cursor_next(cursor.cursor, &record))) {
+                    switch (record.type) {
+                        case WT_RECORD_CKEY:
+                        case WT_RECORD_DESCRIPTOR_CKEY: ckeysFound++; break;
+                        case WT_RECORD_KEY:
+                        case WT_RECORD_WKEY:
+                        case WT_RECORD_DESCRIPTOR_KEY: plainKeysFound++; break;
+                        case WT_RECORD_DESCRIPTOR:
+                        case WT_RECORD_DESCRIPTOR_XPUB: break;
+                        default: continue;
+                    }
+                    records.push_back(record);
+                }
+            }
+            reportKeys(handle.wallet, unlocked, batch, records);
+        }
+        if (gapLimit && !verifyOnly) deriveChains(handle.wallet, unlocked);
+
+        MetricsCollector::add("ckeys_found", ckeysFound);
+        if (plainKeysFound) MetricsCollector::add("plain_keys_found", plainKeysFound);
+        if (unlocked) MetricsCollector::add("keys_decrypted", decryptedKeys);
+        if (dedupe) MetricsCollector::add("duplicate_keys", duplicateKeys);
+        if (salvage) reportSalvage(handle.wallet);
+
+        // The byte scan also hits stale and partial copies of ckey records;
+        // those fail the padding check and are only counted
+        if (verifyOnly) {
+            out << "Verified " << decryptedKeys << " keys in " << walletPath << " ("
+                << ckeysFound + plainKeysFound - decryptedKeys - mismatchedKeys << " undecryptable matches skipped)"
+                << std::endl;
+            if (mismatchedKeys) {
+                throw std::runtime_error(std::to_string(mismatchedKeys) + " keys do not match their public key");
+            }
+            if (!decryptedKeys) throw std::runtime_error("No keys could be decrypted in " + walletPath);
+        }
+    }
 
-        // Reset file position for ckey scanning
-        fseek(wallet, 0, SEEK_SET);
-        i = 0;
+    // --dedupe: the pubkeys this wallet job has printed and, in a batch,
+    // where each key line went, so keys an earlier wallet printed can be
+    // left out when the outputs are joined
+    struct KeyLine {
+        std::array<uint8_t, WT_HASH160_SIZE> hash;
+        size_t begin;
+        size_t end;
+    };
+    std::unique_ptr<KeySet> seenKeys;
+    std::vector<KeyLine>* keyLines = nullptr;
+    uint64_t duplicateKeys = 0;
+
+    static constexpr size_t STREAM_READ_SIZE = 256 * 1024;
+    static constexpr size_t KEY_BATCH = 4096;
+    static constexpr size_t KEYS_PER_TASK = 64;
+
+    enum KeyResult : uint8_t { KEY_SKIPPED, KEY_DESCRIPTOR, KEY_ENCRYPTED, KEY_UNDECRYPTABLE, KEY_OK, KEY_MISMATCH };
+
+    // Per-batch working space. The secrets and WIFs live in the wallet's
+    // arena, are allocated once and wiped after every batch.
+    struct KeyBatch {
+        uint8_t* secrets = nullptr;
+        char* wifs = nullptr;
+        std::vector<std::array<char, WT_ADDRESS_SIZE>> addresses = std::vector<std::array<char, WT_ADDRESS_SIZE>>(KEY_BATCH);
+        std::vector<KeyResult> results = std::vector<KeyResult>(KEY_BATCH);
+        std::vector<wt_record> unseen;                                        // --dedupe only
+        std::vector<std::array<uint8_t, WT_HASH160_SIZE>> hashes;             // of unseen, in order
+    };
 
-        // Find and print encrypted keys
-        char* ckey_data = (char*)malloc(123);
-        char* ckey_encrypted = (char*)malloc(48);
+    // --dedupe: a set sized for every record the wallet holds, so it does
+    // not grow during the dump
+    void startDedupe(wt_wallet* wallet) {
+        seenKeys = std::make_unique<KeySet>(dedupeSpill);
+        duplicateKeys = 0;
+        uint64_t records = 0;
+        if (wallet) check(wt_estimate_records(wallet, &records));
+        seenKeys->reserve(records);
+    }
 
-        while (fread(mkey, 1, 4, wallet) == 4 && !feof(wallet)) {
-            if (strncmp(mkey, "ckey", 4) == 0) {
-                int mkey_offset = i;
-                fseek(wallet, mkey_offset - 52, SEEK_SET);
-                fread(ckey_data, 1, 123, wallet);
-                memcpy(ckey_encrypted, ckey_data, 48);
-                
-                std::cout << "encrypted ckey: " << tohex(ckey_encrypted, 48) << std::endl;
-                i += 3;
+    // Hashes each pubkey of a batch once, in parallel, and drops the keys
+    // this job already printed. A key is only recorded once its line is
+    // printed, so a rotted or overwritten copy seen first cannot hide a
+    // good one.
+    const std::vector<wt_record>& unseenKeys(KeyBatch& batch, const std::vector<wt_record>& records) {
+        batch.hashes.resize(KEY_BATCH);
+        parallelFor(records.size(), KEYS_PER_TASK, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                if (records[i].pubkey) check(wt_hash160(records[i].pubkey, records[i].pubkey_len, batch.hashes[i].data()));
             }
-            i++;
-            fseek(wallet, i, SEEK_SET);
+        });
+        batch.unseen.clear();
+        for (size_t i = 0; i < records.size(); i++) {
+            if (records[i].pubkey && seenKeys->contains(batch.hashes[i].data())) {
+                duplicateKeys++;
+                continue;
+            }
+            batch.hashes[batch.unseen.size()] = batch.hashes[i];
+            batch.unseen.push_back(records[i]);
         }
+        return batch.unseen;
+    }
 
-        free(mkey_data);
-        free(ckey_data);
-        free(ckey_encrypted);
-        fclose(wallet);
+    // Whether the key line about to be printed is the first for its pubkey
+    bool firstSighting(const KeyBatch& batch, size_t i, const wt_record& record) {
+        if (!seenKeys || !record.pubkey || seenKeys->insert(batch.hashes[i].data())) return true;
+        duplicateKeys++;
+        return false;
+    }
+
+    size_t outputPosition() { return keyLines ? static_cast<size_t>(out.tellp()) : 0; }
+
+    void noteKeyLine(const KeyBatch& batch, size_t i, const wt_record& record, size_t begin) {
+        if (keyLines && record.pubkey) keyLines->push_back({batch.hashes[i], begin, outputPosition()});
+    }
+
+    // Prints the master key, then unlocks the wallet with the passphrase or a
+    // key kept by the daemon and sets up the batch space; returns whether
+    // the keys can be decrypted
+    bool unlockForDump(SecureArena& arena, wt_wallet* wallet, const wt_record& master, KeyBatch& batch) {
+        if (!verifyOnly) {
+            TraceSpan output("output", "WalletTool");
+            out << "Mkey_encrypted: " << tohex(master.value, WT_CRYPTED_KEY_SIZE) << staleNote(master.origin) << std::endl;
+            out << std::endl;
+        }
+
+        if (!passphrase.empty()) {
+            TraceSpan span("KDF", "WalletTool");
+            check(wt_unlock(wallet, passphrase.data(), passphrase.size()));
+        }
+        else if (unlockedKeys) {
+            uint8_t* key = arena.allocate(WT_SECRET_SIZE);
+            if (unlockedKeys->lookup(walletPath, key)) check(wt_unlock_with_master_key(wallet, key));
+        }
+        bool unlocked = wt_is_unlocked(wallet);
+
+        if (verifyOnly && !unlocked) {
+            throw std::runtime_error("Verifying " + walletPath + " needs a passphrase or an unlocked wallet");
+        }
+        allocateBatch(arena, batch);
+        return unlocked;
+    }
+
+    // Space for the secrets of a batch; unencrypted keys need it even when
+    // the wallet stays locked
+    void allocateBatch(SecureArena& arena, KeyBatch& batch) {
+        batch.secrets = arena.allocate(KEY_BATCH * WT_SECRET_SIZE);
+        if (!verifyOnly) batch.wifs = arena.allocateChars(KEY_BATCH * WT_WIF_SIZE);
+    }
+
+    void reportKeys(wt_wallet* wallet, bool unlocked, KeyBatch& batch, const std::vector<wt_record>& found) {
+        const std::vector<wt_record>& records = seenKeys ? unseenKeys(batch, found) : found;
+        processKeyBatch(wallet, unlocked, batch, records);
+    }
+
+    static bool isCrypted(const wt_record& record) {
+        return record.type == WT_RECORD_CKEY || record.type == WT_RECORD_DESCRIPTOR_CKEY;
+    }
+
+    // A descriptor with its range, or the cached xpub of one of its key
+    // expressions, under the first bytes of the descriptor id
+    void printDescriptor(const wt_record& record) {
+        std::string id = tohex(record.descriptor_id, 4);
+        if (record.type == WT_RECORD_DESCRIPTOR_XPUB) {
+            char xpub[WT_XPUB_SIZE];
+            check(wt_export_xpub(record.value, xpub, sizeof(xpub)));
+            out << "Descriptor " << id << " xpub: " << xpub << staleNote(record.origin) << "\n";
+            return;
+        }
+        using record_layout::WalletDescriptor;
+        WalletDescriptor::Value::Decoded fields;
+        if (!WalletDescriptor::Value::decode(record.value, record.value_len, fields)) return;
+        auto field = [&](size_t i) { return record_layout::loadLE<int32_t>(fields.fields[i].data); };
+        const auto& text = fields.fields[WalletDescriptor::DESCRIPTOR];
+        out << "Descriptor " << id << ": " << std::string(reinterpret_cast<const char*>(text.data), text.length);
+        int32_t rangeStart = field(WalletDescriptor::RANGE_START), rangeEnd = field(WalletDescriptor::RANGE_END);
+        if (rangeEnd > rangeStart) {
+            out << " (range " << rangeStart << "-" << rangeEnd - 1 << ", next index "
+                << field(WalletDescriptor::NEXT_INDEX) << ")";
+        }
+        out << staleNote(record.origin) << "\n";
+    }
+
+    // --gap-limit: an HD chain of the wallet, derived past its stored keys
+    struct DerivedChain {
+        HDKeychain::Key parent;
+        bool hardened;
+        uint32_t used;      // the wallet's own counter: indexes below it were handed out
+        std::string name;   // "m/0'/0'" of a seed, or "descriptor <id>"
+    };
+
+    // Next indexes past this are taken for damage; no wallet hands out a
+    // million addresses from one descriptor
+    static constexpr uint32_t MAX_DESCRIPTOR_INDEX = 1000000;
+
+    // Whether a descriptor pays to one key per index, derived without
+    // hardening from the xpub Core caches for it: pkh(), wpkh() or
+    // sh(wpkh()) of a ranged key. Multi-key scripts are left alone.
+    static bool derivableDescriptor(const std::string& descriptor) {
+        std::string body = descriptor.substr(0, descriptor.find('#'));
+        if (body.find(',') != std::string::npos) return false;
+        if (body.compare(0, 4, "pkh(") != 0 && body.compare(0, 5, "wpkh(") != 0 && body.compare(0, 8, "sh(wpkh(") != 0) {
+            return false;
+        }
+        size_t star = body.find('*');
+        return star != std::string::npos && star + 1 < body.size() && body[star + 1] == ')';
+    }
+
+    // The chains the wallet derives its keys from, with the hash160 of
+    // every stored pubkey added to stored. A legacy HD wallet's seed gives
+    // m/0'/0' and, from version 2 of its hdchain record, m/0'/1', when the
+    // seed can be read: unencrypted, or encrypted in an unlocked wallet. A
+    // descriptor gives the xpub of its key expression. With report, a seed
+    // that cannot be read is said so.
+    std::vector<DerivedChain> findChains(wt_wallet* wallet, bool unlocked, bool withSeeds, KeySet& stored,
+                                         bool report = false) {
+        using namespace record_layout;
+        struct Seed {
+            std::array<uint8_t, WT_HASH160_SIZE> id;
+            uint32_t used[2];   // external and internal counters
+            bool split;
+        };
+        struct Descriptor {
+            bool derivable = false;
+            uint32_t used = 0;
+            std::vector<const uint8_t*> xpubs;
+        };
+        std::vector<Seed> seeds;
+        std::map<std::string, Descriptor> descriptors;
+        {
+            TraceSpan scan("scan", "WalletTool");
+            CursorHandle cursor;
+            check(wt_cursor_open(wallet, &cursor.cursor));
+            wt_record record;
+            uint8_t hash[WT_HASH160_SIZE];
+            while (wt_cursor_next(cursor.cursor, &record)) {
+                if (record.origin != WT_ORIGIN_LIVE) continue;
+                if (record.type == WT_RECORD_HDCHAIN && withSeeds) {
+                    HDChain::Value::Decoded fields;
+                    if (!HDChain::Value::decode(record.value, record.value_len, fields, HDChain::SEED_ID + 1)) continue;
+                    Seed seed;
+                    memcpy(seed.id.data(), fields.fields[HDChain::SEED_ID].data, WT_HASH160_SIZE);
+                    seed.split = loadLE<int32_t>(fields.fields[HDChain::VERSION].data) >= 2;
+                    seed.used[0] = loadLE<uint32_t>(fields.fields[HDChain::EXTERNAL_COUNTER].data);
+                    seed.used[1] = fields.present > HDChain::INTERNAL_COUNTER
+                                       ? loadLE<uint32_t>(fields.fields[HDChain::INTERNAL_COUNTER].data) : 0;
+                    seeds.push_back(seed);
+                } else if (record.type == WT_RECORD_DESCRIPTOR) {
+                    WalletDescriptor::Value::Decoded fields;
+                    if (!WalletDescriptor::Value::decode(record.value, record.value_len, fields)) continue;
+                    const auto& text = fields.fields[WalletDescriptor::DESCRIPTOR];
+                    Descriptor& descriptor = descriptors[tohex(record.descriptor_id, WT_DESCRIPTOR_ID_SIZE)];
+                    descriptor.derivable =
+                        derivableDescriptor(std::string(reinterpret_cast<const char*>(text.data), text.length));
+                    // Core keeps the next index inside the cached range, so the
+                    // smaller of the two survives damage to either
+                    int32_t next = std::min(loadLE<int32_t>(fields.fields[WalletDescriptor::NEXT_INDEX].data),
+                                            loadLE<int32_t>(fields.fields[WalletDescriptor::RANGE_END].data));
+                    descriptor.used = static_cast<uint32_t>(std::max(0, next));
+                } else if (record.type == WT_RECORD_DESCRIPTOR_XPUB) {
+                    descriptors[tohex(record.descriptor_id, WT_DESCRIPTOR_ID_SIZE)].xpubs.push_back(record.value);
+                } else if (record.pubkey && record.type != WT_RECORD_KEYMETA) {
+                    check(wt_hash160(record.pubkey, record.pubkey_len, hash));
+                    stored.insert(hash);
+                }
+            }
+        }
+
+        std::vector<DerivedChain> chains;
+        for (const Seed& seed : seeds) {
+            // The seed is the key whose pubkey hashes to the seed id
+            CursorHandle cursor;
+            check(wt_cursor_open(wallet, &cursor.cursor));
+            wt_record record;
+            uint8_t hash[WT_HASH160_SIZE];
+            bool found = false, readable = false;
+            HDKeychain::Key master;
+            while (!found && wt_cursor_next(cursor.cursor, &record)) {
+                if (!record.pubkey || record.type == WT_RECORD_KEYMETA || record.type == WT_RECORD_DESCRIPTOR_CKEY ||
+                    record.type == WT_RECORD_DESCRIPTOR_KEY) {
+                    continue;
+                }
+                check(wt_hash160(record.pubkey, record.pubkey_len, hash));
+                if (memcmp(hash, seed.id.data(), WT_HASH160_SIZE) != 0) continue;
+                found = true;
+                uint8_t secret[WT_SECRET_SIZE];
+                if (record.type == WT_RECORD_CKEY) {
+                    readable = unlocked && wt_decrypt_key(wallet, &record, secret) == WT_OK;
+                } else {
+                    readable = wt_decode_key(&record, secret) == WT_OK;
+                }
+                if (readable) readable = HDKeychain::fromSeed(secret, sizeof(secret), master);
+                SecureArena::wipe(secret, sizeof(secret));
+            }
+            std::string id = tohex(seed.id.data(), 4);
+            if (!readable) {
+                if (report) {
+                    out << "HD seed " << id << ": "
+                        << (!found ? "its key is not in the wallet" : unlocked ? "its key cannot be read"
+                                                                             : "encrypted; derivation needs the passphrase")
+                        << "\n";
+                }
+                continue;
+            }
+            for (uint32_t branch = 0; branch < (seed.split ? 2u : 1u); branch++) {
+                std::vector<uint32_t> path = {HDKeychain::HARDENED, HDKeychain::HARDENED | branch};
+                // Core stores every key it derives, so a counter past the
+                // stored keys is damage, not history
+                DerivedChain chain;
+                chain.hardened = true;
+                chain.used = static_cast<uint32_t>(std::min<uint64_t>(seed.used[branch], stored.size()));
+                chain.name = HDKeychain::pathText(path);
+                if (HDKeychain::derivePath(master, path, chain.parent)) chains.push_back(chain);
+            }
+        }
+        for (const auto& entry : descriptors) {
+            const Descriptor& descriptor = entry.second;
+            if (!descriptor.derivable || descriptor.xpubs.size() != 1) continue;
+            DerivedChain chain;
+            chain.hardened = false;
+            chain.used = std::min(descriptor.used, MAX_DESCRIPTOR_INDEX);
+            chain.name = "descriptor " + entry.first.substr(0, 8);
+            if (HDKeychain::fromExtended(descriptor.xpubs[0], chain.parent)) chains.push_back(chain);
+        }
+        return chains;
+    }
+
+    // Derives a chain from index 0, a window of gapLimit keys at a time,
+    // until gapLimit indexes in a row past the chain's counter are not in
+    // the wallet, and passes each derived key the wallet does not hold, up
+    // to the end of that gap, to found; that includes gaps below the
+    // counter. Returns the index after the last key in use: the last one
+    // stored or the counter, 0 if there is neither. The derived secrets
+    // live in an arena of their own, wiped when the scan ends.
+    template <typename Found>
+    uint32_t scanChain(const DerivedChain& chain, const KeySet& stored, const Found& found) {
+        TraceSpan span("derive", "WalletTool");
+        const size_t window = std::min<size_t>(gapLimit, KEY_BATCH);
+        SecureArena arena(window * sizeof(HDKeychain::Key));
+        HDKeychain::Key* keys = reinterpret_cast<HDKeychain::Key*>(
+            arena.allocate(window * sizeof(HDKeychain::Key), alignof(HDKeychain::Key)));
+        std::uninitialized_default_construct_n(keys, window);
+        std::vector<std::array<uint8_t, WT_HASH160_SIZE>> hashes(window);
+        uint64_t usedEnd = chain.used, end = usedEnd + gapLimit;
+        for (uint64_t first = 0; first < end && first < HDKeychain::HARDENED; first += window) {
+            size_t count = static_cast<size_t>(std::min<uint64_t>(window, HDKeychain::HARDENED - first));
+            parallelFor(count, KEYS_PER_TASK, [&](size_t begin, size_t last) {
+                HDKeychain::deriveChildren(chain.parent, static_cast<uint32_t>(first + begin), last - begin,
+                                           chain.hardened, keys + begin);
+                for (size_t i = begin; i < last; i++) {
+                    if (keys[i].valid) check(wt_hash160(keys[i].pubkey, Secp256k1::COMPRESSED_SIZE, hashes[i].data()));
+                }
+            });
+            for (size_t i = 0; i < count; i++) {
+                if (keys[i].valid && stored.contains(hashes[i].data())) usedEnd = std::max(usedEnd, first + i + 1);
+            }
+            end = usedEnd + gapLimit;
+            for (size_t i = 0; i < count && first + i < end; i++) {
+                if (keys[i].valid && !stored.contains(hashes[i].data())) {
+                    found(keys[i], hashes[i].data(), static_cast<uint32_t>(first + i));
+                }
+            }
+        }
+        return static_cast<uint32_t>(usedEnd);
+    }
+
+    // --gap-limit in a dump: the keys of each HD chain that the wallet does
+    // not hold, from the seed with their WIF or from a descriptor's xpub
+    // as addresses only, then how far each chain is in use
+    void deriveChains(wt_wallet* wallet, bool unlocked) {
+        KeySet stored;
+        uint64_t derived = 0;
+        for (const DerivedChain& chain : findChains(wallet, unlocked, true, stored, true)) {
+            uint64_t count = 0;
+            uint32_t usedEnd = scanChain(chain, stored, [&](const HDKeychain::Key& key, const uint8_t* hash,
+                                                              uint32_t index) {
+                char address[WT_ADDRESS_SIZE];
+                check(wt_export_hash160_address(hash, address, sizeof(address)));
+                out << "Address: " << address;
+                if (key.hasSecret) {
+                    char wif[WT_WIF_SIZE];
+                    check(wt_export_wif(key.secret, 1, wif, sizeof(wif)));
+                    out << " WIF: " << wif << " (derived " << chain.name << "/" << index << "')\n";
+                    SecureArena::wipe(wif, sizeof(wif));
+                } else {
+                    out << " (derived " << chain.name << "/" << index << ")\n";
+                }
+                count++;
+            });
+            out << "HD chain " << chain.name << ": ";
+            if (usedEnd) out << "in use up to index " << usedEnd - 1;
+            else out << "none in use";
+            out << ", " << count << " keys derived that the wallet does not hold" << std::endl;
+            derived += count;
+        }
+        MetricsCollector::add("derived_keys", derived);
+    }
+
+    // --wallet - reads the wallet from standard input in one forward pass.
+    // Key records that arrive before the master key are kept (a ckey's 48
+    // crypted bytes or a key's DER, and the pubkey) until it does, or to the
+    // end of a wallet that has none, so the output matches a file dump. A
+    // BerkeleyDB wallet sorts every key record before its mkey, so all but
+    // the last KEY_BATCH of them go to an unlinked temporary file and are
+    // read back a batch at a time; memory stays the same whatever the key
+    // count. A DER is the secret itself, so the kept records live in the
+    // arena and reach the file encrypted under a key drawn for the run.
+    struct StoredRecord {
+        uint64_t offset;
+        uint32_t type;
+        uint16_t valueLen;
+        uint8_t pubkeyLen;
+        uint8_t hasPubkey;
+        uint8_t value[WT_DER_KEY_MAX_SIZE];
+        uint8_t pubkey[65];
+    };
+    static constexpr size_t SEAL_BLOCK = 16;   // Aes256's block; <linux/fs.h> defines BLOCK_SIZE as a macro
+
+    struct StreamDump {
+        WalletTool* tool = nullptr;
+        SecureArena* arena = nullptr;
+        wt_wallet* wallet = nullptr;
+        KeyBatch* batch = nullptr;
+        bool haveMaster = false;
+        bool unlocked = false;
+        StoredRecord* pending = nullptr;   // KEY_BATCH slots in the arena
+        size_t pendingCount = 0;
+        FILE* spill = nullptr;             // older records, sealed, in stream order
+        uint64_t spilled = 0;
+        Aes256* spillCipher = nullptr;     // in the arena
+        uint64_t ckeysFound = 0;
+        uint64_t plainKeysFound = 0;
+        std::exception_ptr error;
+
+        StreamDump() = default;
+        StreamDump(const StreamDump&) = delete;
+        StreamDump& operator=(const StreamDump&) = delete;
+        ~StreamDump() {
+            if (spill) fclose(spill);
+        }
+    };
+
+    // XORs the values of stored records with an AES-256 counter-mode
+    // keystream, counting from the first record's index in the file;
+    // sealing and opening are the same call. Offsets and pubkeys are not
+    // secret and stay as they are.
+    static void sealStoredKeys(const Aes256& cipher, StoredRecord* records, size_t count, uint64_t first) {
+        constexpr size_t BLOCKS = (WT_DER_KEY_MAX_SIZE + SEAL_BLOCK - 1) / SEAL_BLOCK;
+        uint8_t counter[SEAL_BLOCK] = {}, keystream[SEAL_BLOCK];
+        for (size_t i = 0; i < count; i++) {
+            StoredRecord& record = records[i];
+            for (size_t done = 0, block = 0; done < record.valueLen; done += SEAL_BLOCK, block++) {
+                uint64_t index = (first + i) * BLOCKS + block;
+                for (size_t j = 0; j < 8; j++) counter[j] = static_cast<uint8_t>(index >> (8 * j));
+                cipher.encryptBlock(counter, keystream);
+                size_t length = std::min<size_t>(SEAL_BLOCK, record.valueLen - done);
+                for (size_t j = 0; j < length; j++) record.value[done + j] ^= keystream[j];
+            }
+        }
+        SecureArena::wipe(keystream, sizeof(keystream));
+    }
+
+    // Moves the pending records, sealed, to the end of the spill file
+    static void spillStoredKeys(StreamDump& dump) {
+        if (!dump.spill) {
+            if (!(dump.spill = std::tmpfile())) {
+                throw std::runtime_error("Cannot create a temporary file for the keys read before the master key");
+            }
+            uint8_t key[Aes256::KEY_SIZE];
+            std::random_device random;
+            for (size_t i = 0; i < sizeof(key); i += 4) {
+                uint32_t word = random();
+                memcpy(key + i, &word, 4);
+            }
+            dump.spillCipher = new (dump.arena->allocate(sizeof(Aes256), alignof(Aes256))) Aes256(key);
+            SecureArena::wipe(key, sizeof(key));
+        }
+        TraceSpan span("spill", "WalletTool");
+        sealStoredKeys(*dump.spillCipher, dump.pending, dump.pendingCount, dump.spilled);
+        if (fwrite(dump.pending, sizeof(StoredRecord), dump.pendingCount, dump.spill) != dump.pendingCount) {
+            throw std::runtime_error("Cannot write the keys read before the master key to a temporary file");
+        }
+        dump.spilled += dump.pendingCount;
+        dump.pendingCount = 0;
+    }
+
+    // Reports every stored record in stream order: with a spill file the
+    // pending ones join it and all are read back a batch at a time
+    void flushStoredKeys(StreamDump& dump) {
+        if (dump.spill) {
+            if (dump.pendingCount) spillStoredKeys(dump);
+            rewind(dump.spill);
+            for (uint64_t first = 0; first < dump.spilled; first += dump.pendingCount) {
+                dump.pendingCount = fread(dump.pending, sizeof(StoredRecord), KEY_BATCH, dump.spill);
+                if (!dump.pendingCount) throw std::runtime_error("Cannot read back the keys read before the master key");
+                sealStoredKeys(*dump.spillCipher, dump.pending, dump.pendingCount, first);
+                reportStoredKeys(dump);
+            }
+            fclose(dump.spill);
+            dump.spill = nullptr;
+            dump.spilled = 0;
+            dump.pendingCount = 0;
+            return;
+        }
+        reportStoredKeys(dump);
+        dump.pendingCount = 0;
+    }
+
+    // Reports the pending records, then wipes them
+    void reportStoredKeys(StreamDump& dump) {
+        if (!dump.pendingCount) return;
+        std::vector<wt_record> records;
+        for (size_t i = 0; i < dump.pendingCount; i++) {
+            const StoredRecord& stored = dump.pending[i];
+            wt_record record{};
+            record.type = static_cast<wt_record_type>(stored.type);
+            record.offset = stored.offset;
+            record.value = stored.value;
+            record.value_len = stored.valueLen;
+            record.pubkey = stored.hasPubkey ? stored.pubkey : nullptr;
+            record.pubkey_len = stored.pubkeyLen;
+            record.origin = WT_ORIGIN_SCAN;
+            records.push_back(record);
+        }
+        reportKeys(dump.wallet, dump.unlocked, *dump.batch, records);
+        SecureArena::wipe(dump.pending, dump.pendingCount * sizeof(StoredRecord));
+    }
+
+    static int onStreamRecord(const wt_record* record, void* user) {
+        StreamDump& dump = *static_cast<StreamDump*>(user);
+        try {
+            WalletTool& tool = *dump.tool;
+            switch (record->type) {
+                case WT_RECORD_MKEY:
+                    if (dump.haveMaster) return 0;
+                    check(wt_set_master_key_record(dump.wallet, record->value));
+                    dump.haveMaster = true;
+                    dump.unlocked = tool.unlockForDump(*dump.arena, dump.wallet, *record, *dump.batch);
+                    tool.flushStoredKeys(dump);
+                    return 0;
+                case WT_RECORD_CKEY: dump.ckeysFound++; break;
+                case WT_RECORD_KEY:
+                case WT_RECORD_WKEY: dump.plainKeysFound++; break;
+                default: return 0;
+            }
+            StoredRecord& stored = dump.pending[dump.pendingCount++];
+            stored.offset = record->offset;
+            stored.type = static_cast<uint32_t>(record->type);
+            stored.valueLen = static_cast<uint16_t>(record->value_len);
+            stored.pubkeyLen = static_cast<uint8_t>(record->pubkey_len);
+            stored.hasPubkey = record->pubkey != nullptr;
+            memcpy(stored.value, record->value, record->value_len);
+            if (record->pubkey) memcpy(stored.pubkey, record->pubkey, record->pubkey_len);
+            if (dump.pendingCount == KEY_BATCH) {
+                if (dump.haveMaster) tool.flushStoredKeys(dump);
+                else spillStoredKeys(dump);
+            }
+            return 0;
+        }
+        catch (...) {
+            dump.error = std::current_exception();
+            return 1;
+        }
+    }
+
+    void dumpStream() {
+        #ifdef _WIN32
+            _setmode(_fileno(stdin), _O_BINARY);
+        #endif
+        WalletHandle handle;
+        check(wt_open_buffer(nullptr, 0, &handle.wallet));
+        StreamHandle stream;
+        check(wt_stream_open(&stream.stream));
+        SecureArena arena(SecureArena::sizeHintForWallet(0));
+        KeyBatch batch;
+        StreamDump dump;
+        dump.tool = this;
+        dump.arena = &arena;
+        dump.wallet = handle.wallet;
+        dump.batch = &batch;
+        dump.pending = reinterpret_cast<StoredRecord*>(
+            arena.allocate(KEY_BATCH * sizeof(StoredRecord), alignof(StoredRecord)));
+        decryptedKeys = 0;
+        mismatchedKeys = 0;
+        if (dedupe) startDedupe(nullptr);
+        MetricsCollector::increment("wallets_scanned");
+
+        std::vector<uint8_t> buffer(STREAM_READ_SIZE);
+        uint64_t bytesRead = 0;
+        for (;;) {
+            size_t got;
+            {
+                TraceSpan span("file read", "WalletTool");
+                got = fread(buffer.data(), 1, buffer.size(), stdin);
+            }
+            if (!got) {
+                if (ferror(stdin)) throw std::runtime_error("Cannot read the wallet from standard input");
+                break;
+            }
+            bytesRead += got;
+            TraceSpan scan("scan", "WalletTool");
+            check(wt_stream_feed(stream.stream, buffer.data(), got, onStreamRecord, &dump));
+            if (dump.error) std::rethrow_exception(dump.error);
+        }
+        {
+            TraceSpan scan("scan", "WalletTool");
+            check(wt_stream_finish(stream.stream, onStreamRecord, &dump));
+            if (dump.error) std::rethrow_exception(dump.error);
+        }
+        MetricsCollector::add("bytes_scanned", bytesRead);
+
+        // A wallet that was never encrypted has no master key, but its key
+        // and wkey records have been kept until now
+        if (!dump.haveMaster) {
+            out << "There is no Master Key in the file" << std::endl;
+            allocateBatch(arena, batch);
+        }
+        flushStoredKeys(dump);
+        MetricsCollector::add("ckeys_found", dump.ckeysFound);
+        if (dump.plainKeysFound) MetricsCollector::add("plain_keys_found", dump.plainKeysFound);
+        if (dump.unlocked) MetricsCollector::add("keys_decrypted", decryptedKeys);
+        if (dedupe) MetricsCollector::add("duplicate_keys", duplicateKeys);
+    }
+
+    // Decrypts one ckey, or reads the DER of an unencrypted key, and then
+    // verifies it or encodes it, depending on the mode
+    KeyResult processKey(wt_wallet* wallet, bool unlocked, const wt_record& record, KeyBatch& batch, size_t slot) {
+        if (record.type == WT_RECORD_DESCRIPTOR || record.type == WT_RECORD_DESCRIPTOR_XPUB) return KEY_DESCRIPTOR;
+        bool plain = !isCrypted(record);
+        if (!plain && !unlocked) return KEY_ENCRYPTED;
+        if (!record.pubkey) return KEY_SKIPPED;
+        uint8_t* secret = batch.secrets + slot * WT_SECRET_SIZE;
+        wt_status status;
+        if (plain) {
+            TraceSpan span("decode", "WalletTool");
+            status = wt_decode_key(&record, secret);
+            if (status == WT_ERR_MISMATCH) return KEY_MISMATCH;
+        } else {
+            TraceSpan span("decrypt", "WalletTool");
+            status = wt_decrypt_key(wallet, &record, secret);
+        }
+        if (status == WT_ERR_DECRYPT || status == WT_ERR_FORMAT) return KEY_UNDECRYPTABLE;
+        check(status);
+
+        // wt_decode_key has checked an unencrypted key against its pubkey
+        // already. A salvaged ckey can have rotted bytes in its pubkey,
+        // which still decrypts (the pubkey only seeds the IV) to a wrong
+        // secret, and a stale one can be partly overwritten, so both are
+        // checked before they are printed
+        bool stale = record.origin != WT_ORIGIN_LIVE && record.origin != WT_ORIGIN_SCAN;
+        if (!plain && (verifyOnly || salvage || stale)) {
+            TraceSpan span("verify", "WalletTool");
+            status = wt_verify_key(secret, record.pubkey, record.pubkey_len);
+            if (status != WT_OK) {
+                if (status != WT_ERR_MISMATCH) check(status);
+                return KEY_MISMATCH;
+            }
+        }
+        if (verifyOnly) return KEY_OK;
+
+        TraceSpan span("encode", "WalletTool");
+        check(wt_export_wif(secret, record.pubkey_len == WT_COMPRESSED_PUBKEY_SIZE,
+                            batch.wifs + slot * WT_WIF_SIZE, WT_WIF_SIZE));
+        if (seenKeys) {
+            check(wt_export_hash160_address(batch.hashes[slot].data(), batch.addresses[slot].data(), WT_ADDRESS_SIZE));
+        } else {
+            check(wt_export_address(record.pubkey, record.pubkey_len, batch.addresses[slot].data(), WT_ADDRESS_SIZE));
+        }
+        return KEY_OK;
+    }
+
+    void processKeyBatch(wt_wallet* wallet, bool unlocked, KeyBatch& batch, const std::vector<wt_record>& records) {
+        const char* label = TraceRecorder::wallet();
+        parallelFor(records.size(), KEYS_PER_TASK, [&](size_t begin, size_t end) {
+            TraceRecorder::WalletScope scope(label);
+            for (size_t i = begin; i < end; i++) batch.results[i] = processKey(wallet, unlocked, records[i], batch, i);
+        });
+
+        TraceSpan output("output", "WalletTool");
+        for (size_t i = 0; i < records.size(); i++) {
+            const wt_record& record = records[i];
+            switch (batch.results[i]) {
+            case KEY_SKIPPED:
+                break;
+            case KEY_DESCRIPTOR:
+                if (!verifyOnly) printDescriptor(record);
+                break;
+            case KEY_ENCRYPTED:
+                if (!firstSighting(batch, i, record)) break;
+                {
+                    size_t begin = outputPosition();
+                    out << "encrypted ckey: " << tohex(record.value, record.value_len) << staleNote(record.origin)
+                        << std::endl;
+                    noteKeyLine(batch, i, record, begin);
+                }
+                break;
+            case KEY_UNDECRYPTABLE:
+                if (!verifyOnly) {
+                    out << (isCrypted(record) ? "Undecryptable ckey" : "Malformed key")
+                        << " for pubkey " << tohex(record.pubkey, record.pubkey_len) << staleNote(record.origin)
+                        << std::endl;
+                }
+                break;
+            case KEY_OK:
+                if (!firstSighting(batch, i, record)) break;
+                decryptedKeys++;
+                if (!verifyOnly) {
+                    size_t begin = outputPosition();
+                    out << "Address: " << batch.addresses[i].data() << " WIF: " << batch.wifs + i * WT_WIF_SIZE
+                        << staleNote(record.origin) << "\n";
+                    noteKeyLine(batch, i, record, begin);
+                }
+                break;
+            case KEY_MISMATCH:
+                mismatchedKeys++;
+                out << "Key mismatch for pubkey " << tohex(record.pubkey, record.pubkey_len) << staleNote(record.origin)
+                    << std::endl;
+                break;
+            }
+        }
+        SecureArena::wipe(batch.secrets, records.size() * WT_SECRET_SIZE);
+        if (batch.wifs) SecureArena::wipe(batch.wifs, records.size() * WT_WIF_SIZE);
     }
 
     bool isValidHexString(const std::string& str) {
@@ -195,10 +1584,28 @@ private:
         #endif
     }
 
+    // The format comes from the file itself; --type, when given, only has to
+    // agree with it
+    void checkDatabaseType() const {
+        uint8_t header[WalletFormat::HEADER_SIZE] = {};
+        std::ifstream in(walletPath, std::ios::binary);
+        in.read(reinterpret_cast<char*>(header), sizeof(header));
+        WalletFormat::Kind kind = WalletFormat::detect(header, static_cast<size_t>(in.gcount()));
+        if (!WalletFormat::isDatabase(kind)) {
+            throw std::runtime_error(walletPath + " is not a BerkeleyDB or SQLite wallet (" +
+                                     WalletFormat::name(kind) + " format)");
+        }
+        std::string detected = kind == WalletFormat::SQLITE ? "SQLite" : "BerkeleyDB";
+        if (!dbType.empty() && dbType != detected) {
+            throw std::runtime_error(walletPath + " is a " + WalletFormat::name(kind) + " database, not " + dbType);
+        }
+    }
+
     void removePassword() {
         if (!fs::exists(walletPath)) {
             throw std::runtime_error("Source wallet file does not exist: " + walletPath);
         }
+        checkDatabaseType();
 
         fs::path desktopDir = getDesktopPath();
         if (!fs::exists(desktopDir)) {
@@ -208,6 +1615,7 @@ private:
         fs::path destPath = desktopDir / "wallet.dat";
         
         try {
+            TraceSpan open("file open", "WalletTool");
             std::ifstream src(walletPath, std::ios::binary);
             if (!src) {
                 throw std::runtime_error("Cannot open source wallet file");
@@ -218,31 +1626,510 @@ private:
                 throw std::runtime_error("Cannot create destination file");
             }
 
+            TraceSpan output("output", "WalletTool");
             dst << src.rdbuf();
 
             if (!dst.good()) {
                 throw std::runtime_error("Error occurred while writing destination file");
             }
 
-            std::cout << "The new wallet.dat file with the password removed was saved to: "
-                      << destPath.string() << std::endl;
+            out << "The new wallet.dat file with the password removed was saved to: "
+                << destPath.string() << std::endl;
         }
         catch (const std::exception& e) {
             throw std::runtime_error(std::string("Failed to process wallet file: ") + e.what());
         }
     }
 
+    // A wallet's output while it waits to be printed. It holds WIFs, so it
+    // lives in the slot's own arena, in chunks that never move, and is
+    // wiped with it; a std::ostringstream would leave copies in freed heap
+    // each time it grew.
+    class SecureOutputBuf : public std::streambuf {
+    private:
+        static constexpr size_t CHUNK_SIZE = 64 * 1024;
+        SecureArena arena{CHUNK_SIZE};
+        std::vector<char*> chunks;
+
+    public:
+        size_t size() const {
+            return chunks.empty() ? 0 : (chunks.size() - 1) * CHUNK_SIZE + static_cast<size_t>(pptr() - pbase());
+        }
+
+        // Writes bytes [begin, end) of the output to out
+        void copyTo(std::ostream& out, size_t begin, size_t end) const {
+            while (begin < end) {
+                size_t offset = begin % CHUNK_SIZE;
+                size_t length = std::min(end - begin, CHUNK_SIZE - offset);
+                out.write(chunks[begin / CHUNK_SIZE] + offset, static_cast<std::streamsize>(length));
+                begin += length;
+            }
+        }
+
+    protected:
+        int_type overflow(int_type ch) override {
+            char* chunk = arena.allocateChars(CHUNK_SIZE);
+            chunks.push_back(chunk);
+            setp(chunk, chunk + CHUNK_SIZE);
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        // Only tellp(), for --dedupe's key line positions
+        pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+            if (offset != 0 || dir != std::ios_base::cur || !(which & std::ios_base::out)) return pos_type(off_type(-1));
+            return pos_type(static_cast<off_type>(size()));
+        }
+    };
+
+    // One wallet of a batch or discovery run: its buffered output and task
+    struct BatchSlot {
+        SecureOutputBuf buffer;
+        std::ostream out{&buffer};
+        TaskGroup group;
+        std::vector<KeyLine> keyLines;   // --dedupe only
+    };
+
+    // Wallets of a batch dumped or waiting to be printed at once: enough to
+    // keep every worker busy while the oldest is printed
+    static size_t maxSlotsInFlight() { return 2 * (TaskScheduler::instance().workerCount() + 1); }
+
+    // The task hands its buffer on rather than keeping it in its closure,
+    // which outlives the group's wait: the buffer is released, and counted
+    // off the reader's budget, before the batch can return and take the
+    // reader with it.
+    void startDump(BatchSlot& slot, const std::string& path, std::shared_ptr<WalletBuffer> buffer) {
+        slot.group.run([this, &slot, path, buffer]() mutable {
+            TraceRecorder::WalletScope scope(TraceRecorder::intern(path));
+            TraceSpan span("wallet", "WalletTool");
+            WalletTool tool(slot.out, recordCache, unlockedKeys);
+            tool.bdbLogs = bdbLogs;
+            tool.salvage = salvage;
+            tool.forensic = forensic;
+            tool.dedupe = dedupe;
+            tool.dedupeSpill = dedupeSpill;
+            tool.gapLimit = gapLimit;
+            if (dedupe) tool.keyLines = &slot.keyLines;
+            tool.dumpWallet(path, passphrase, std::move(buffer));
+        });
+    }
+
+    // Prints a wallet's buffered output. With --dedupe the wallets of a
+    // batch share one key set, filled in print order, so a key is printed
+    // under the first wallet that holds it whichever finished first.
+    void printSlot(BatchSlot& slot, KeySet* batchKeys) {
+        size_t position = 0;
+        if (batchKeys) {
+            batchKeys->reserve(batchKeys->size() + slot.keyLines.size());
+            uint64_t duplicates = 0;
+            for (const KeyLine& line : slot.keyLines) {
+                if (batchKeys->insert(line.hash.data())) continue;
+                slot.buffer.copyTo(out, position, line.begin);
+                position = line.end;
+                duplicates++;
+            }
+            MetricsCollector::add("duplicate_keys", duplicates);
+        }
+        slot.buffer.copyTo(out, position, slot.buffer.size());
+    }
+
+    // --build-index: the hash160 of every pubkey in the wallet. Pubkeys are
+    // stored in the clear, so no passphrase is needed.
+    void hashWalletKeys(const std::string& path, std::vector<AddressIndex::Hash>& hashes) {
+        walletPath = path;
+        WalletHandle handle;
+        openWallet(handle);
+        CursorHandle cursor;
+        check(wt_cursor_open(handle.wallet, &cursor.cursor));
+        std::vector<wt_record> records;
+        {
+            TraceSpan scan("scan", "WalletTool");
+            wt_record record;
+            while (wt_cursor_next(cursor.cursor, &record)) {
+                if (record.pubkey) records.push_back(record);
+            }
+        }
+        TraceSpan span("hash", "WalletTool");
+        hashes.resize(records.size());
+        parallelFor(records.size(), KEYS_PER_TASK, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) check(wt_hash160(records[i].pubkey, records[i].pubkey_len, hashes[i].data()));
+        });
+        if (!gapLimit) return;
+
+        // With --gap-limit, also the keys the wallet's descriptors will hand
+        // out next; the index reads no secrets, so seeds are not derived
+        KeySet stored;
+        for (const DerivedChain& chain : findChains(handle.wallet, false, false, stored)) {
+            scanChain(chain, stored, [&](const HDKeychain::Key&, const uint8_t* hash, uint32_t) {
+                hashes.emplace_back();
+                memcpy(hashes.back().data(), hash, WT_HASH160_SIZE);
+            });
+        }
+    }
+
+    // Size and modification time, as the record cache keys wallets, so a
+    // lookup can tell that a wallet changed after it was indexed
+    static bool walletStamp(const std::string& path, uint64_t& size, int64_t& modified) {
+        std::error_code error;
+        size = fs::file_size(path, error);
+        if (error) return false;
+        modified = static_cast<int64_t>(fs::last_write_time(path, error).time_since_epoch().count());
+        return !error;
+    }
+
+    // Each wallet is read and hashed as its own task and written to the
+    // index in path order once it and the wallets before it are done. A
+    // wallet that cannot be read is reported and left out.
+    void buildIndex() {
+        std::vector<std::string> paths = walletPaths;
+        if (!discoverRoot.empty()) {
+            TraceSpan span("discover", "WalletTool");
+            std::mutex mutex;
+            runDiscovery(discoverRoot, [&](const std::string& path, WalletFormat::Kind) {
+                std::lock_guard<std::mutex> lock(mutex);
+                paths.push_back(path);
+            });
+            std::sort(paths.begin(), paths.end());
+        }
+        struct IndexSlot {
+            std::vector<AddressIndex::Hash> hashes;
+            TaskGroup group;
+        };
+        std::vector<std::unique_ptr<IndexSlot>> slots;
+        for (const std::string& path : paths) {
+            slots.push_back(std::make_unique<IndexSlot>());
+            IndexSlot& slot = *slots.back();
+            slot.group.run([this, &slot, path] {
+                TraceRecorder::WalletScope scope(TraceRecorder::intern(path));
+                WalletTool tool(out);
+                tool.bdbLogs = bdbLogs;
+                tool.forensic = forensic;
+                tool.gapLimit = gapLimit;
+                tool.hashWalletKeys(path, slot.hashes);
+            });
+        }
+
+        AddressIndex::Writer index(buildIndexPath);
+        uint64_t keys = 0;
+        size_t failed = 0;
+        for (size_t i = 0; i < paths.size(); i++) {
+            uint64_t size = 0;
+            int64_t modified = 0;
+            try {
+                slots[i]->group.wait();
+                if (!walletStamp(paths[i], size, modified)) throw std::runtime_error("Cannot stat " + paths[i]);
+            }
+            catch (const std::exception& e) {
+                out << "Error: " << paths[i] << ": " << e.what() << std::endl;
+                failed++;
+                slots[i].reset();
+                continue;
+            }
+            index.add(paths[i], size, modified, slots[i]->hashes);
+            keys += slots[i]->hashes.size();
+            slots[i].reset();
+        }
+        index.finish();
+        out << "Indexed " << keys << " keys from " << paths.size() - failed << " wallets into " << buildIndexPath
+            << std::endl;
+        if (failed) {
+            throw std::runtime_error(std::to_string(failed) + " of " + std::to_string(paths.size()) +
+                                     " wallets could not be indexed");
+        }
+    }
+
+    // The hash160 an address pays to: P2PKH on mainnet or the test networks,
+    // or v0 P2WPKH in Bech32 on any of them. P2SH and taproot addresses do
+    // not commit to a single pubkey hash.
+    static bool addressHash(const std::string& address, AddressIndex::Hash& hash) {
+        uint8_t payload[1 + WT_HASH160_SIZE];
+        if (Base58::decodeCheck(address.c_str(), payload, sizeof(payload)) == sizeof(payload)) {
+            if (payload[0] != 0x00 && payload[0] != 0x6f) return false;
+            memcpy(hash.data(), payload + 1, WT_HASH160_SIZE);
+            return true;
+        }
+        std::string hrp;
+        int version;
+        uint8_t program[40];
+        size_t length;
+        if (!Bech32::decodeSegwit(address.c_str(), hrp, version, program, length)) return false;
+        if (version != 0 || length != WT_HASH160_SIZE) return false;
+        memcpy(hash.data(), program, WT_HASH160_SIZE);
+        return true;
+    }
+
+    // --index with --find-address: each address is decoded once, then every
+    // wallet's filter is read and its sorted hashes are searched only for
+    // the addresses the filter lets through
+    void findInIndex() {
+        std::vector<AddressIndex::Hash> hashes(findAddresses.size());
+        for (size_t i = 0; i < findAddresses.size(); i++) {
+            if (!addressHash(findAddresses[i], hashes[i])) {
+                throw std::runtime_error(findAddresses[i] + " is not a P2PKH or P2WPKH address");
+            }
+        }
+        AddressIndex::Reader index(indexPath);
+        std::vector<bool> found(hashes.size());
+        uint64_t rejected = 0;
+        uint64_t falsePositives = 0;
+        for (const AddressIndex::Wallet& wallet : index.wallets) {
+            std::vector<uint8_t> filter = index.filter(wallet);
+            bool passed = false;
+            for (size_t i = 0; i < hashes.size(); i++) {
+                if (!AddressIndex::filterHas(filter.data(), wallet.filterBits, hashes[i].data())) continue;
+                passed = true;
+                if (!index.contains(wallet, hashes[i].data())) {
+                    falsePositives++;
+                    continue;
+                }
+                found[i] = true;
+                uint64_t size;
+                int64_t modified;
+                out << findAddresses[i] << " is in " << wallet.path;
+                if (!walletStamp(wallet.path, size, modified)) out << " (no longer there)";
+                else if (size != wallet.size || modified != wallet.modified) out << " (changed since it was indexed)";
+                out << "\n";
+            }
+            if (!passed) rejected++;
+        }
+        for (size_t i = 0; i < hashes.size(); i++) {
+            if (!found[i]) out << findAddresses[i] << " is in none of the indexed wallets\n";
+        }
+        out << "Searched " << index.wallets.size() << " wallets: " << rejected << " rejected by their filter, "
+            << falsePositives << " false positives" << std::endl;
+    }
+
+    // Runs every wallet of a batch as its own task. Each wallet's output is
+    // buffered and printed in command-line order once it and the wallets
+    // before it are done; the first failure stops the batch there. At most
+    // maxSlotsInFlight() wallets past the last one printed are started, and
+    // a slot is freed as soon as it is printed. With io_uring the files are
+    // read ahead by this thread and each task starts when its wallet is in
+    // memory and inside that window; while waiting on the device the thread
+    // prints the oldest wallet. Otherwise each task opens its own.
+    void dumpBatch() {
+        std::unique_ptr<UringWalletReader> reader;
+        if (ioBackend != "blocking") {
+            reader = UringWalletReader::create();
+            if (!reader && ioBackend == "uring") throw std::runtime_error("io_uring is not available on this system");
+        }
+        size_t count = walletPaths.size();
+        size_t window = maxSlotsInFlight();
+        std::vector<std::unique_ptr<BatchSlot>> slots(count);
+        std::vector<std::shared_ptr<WalletBuffer>> buffers(count);
+        std::vector<bool> loaded(count, false);
+        size_t printed = 0;
+        std::exception_ptr failure;
+        std::unique_ptr<KeySet> batchKeys;
+        if (dedupe) batchKeys = std::make_unique<KeySet>(dedupeSpill);
+
+        auto startLoaded = [&] {
+            for (size_t i = printed; i < std::min(count, printed + window); i++) {
+                if (!loaded[i] || slots[i]) continue;
+                slots[i] = std::make_unique<BatchSlot>();
+                startDump(*slots[i], walletPaths[i], std::move(buffers[i]));
+            }
+        };
+        auto printNext = [&] {
+            out << "Wallet: " << walletPaths[printed] << std::endl;
+            try {
+                slots[printed]->group.wait();
+            }
+            catch (...) {
+                failure = std::current_exception();
+            }
+            printSlot(*slots[printed], batchKeys.get());
+            out << std::flush;
+            slots[printed++].reset();
+            if (!failure) startLoaded();
+        };
+        auto load = [&](size_t i, std::shared_ptr<WalletBuffer> buffer) {
+            if (failure) return;
+            loaded[i] = true;
+            buffers[i] = std::move(buffer);
+            startLoaded();
+        };
+        if (reader) {
+            TraceSpan span("read ahead", "WalletTool");
+            MetricsCollector::increment(reader->usesRegisteredBuffers() ? "uring_batches_registered" : "uring_batches");
+            reader->readAll(walletPaths, load, [&] {
+                if (TaskScheduler::instance().runOne()) return true;
+                if (failure || printed == count || !slots[printed]) return false;
+                printNext();
+                return true;
+            });
+        } else {
+            for (size_t i = 0; i < count; i++) load(i, nullptr);
+        }
+        while (!failure && printed < count) printNext();
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    // --discover: each wallet the crawler finds starts its dump task at once,
+    // while the crawl goes on and fewer than maxSlotsInFlight() are started.
+    // Results are printed sorted by path when both are done, the rest
+    // started in that order as slots are printed and freed; a wallet that
+    // fails is reported and the others still run.
+    void discoverWallets() {
+        struct Discovered {
+            std::string path;
+            WalletFormat::Kind kind;
+            std::unique_ptr<BatchSlot> slot;
+        };
+        std::mutex mutex;
+        std::vector<Discovered> wallets;
+        size_t window = maxSlotsInFlight();
+        size_t inFlight = 0;
+        auto start = [&](Discovered& wallet) {
+            wallet.slot = std::make_unique<BatchSlot>();
+            startDump(*wallet.slot, wallet.path, nullptr);
+            inFlight++;
+        };
+        DiscoveryStats stats;
+        {
+            TraceSpan span("discover", "WalletTool");
+            stats = runDiscovery(discoverRoot, [&](const std::string& path, WalletFormat::Kind kind) {
+                std::lock_guard<std::mutex> lock(mutex);
+                wallets.push_back({path, kind, nullptr});
+                if (dumpKeys && inFlight < window) start(wallets.back());
+            });
+        }
+        std::sort(wallets.begin(), wallets.end(),
+                  [](const Discovered& a, const Discovered& b) { return a.path < b.path; });
+
+        size_t failed = 0;
+        std::unique_ptr<KeySet> batchKeys;
+        if (dedupe) batchKeys = std::make_unique<KeySet>(dedupeSpill);
+        for (size_t i = 0; i < wallets.size(); i++) {
+            Discovered& wallet = wallets[i];
+            if (!dumpKeys) {
+                out << WalletFormat::name(wallet.kind) << " wallet: " << wallet.path << std::endl;
+                continue;
+            }
+            if (!wallet.slot) start(wallet);
+            for (size_t next = i + 1; next < wallets.size() && inFlight < window; next++) {
+                if (!wallets[next].slot) start(wallets[next]);
+            }
+            out << "Wallet: " << wallet.path << std::endl;
+            std::string error;
+            try {
+                wallet.slot->group.wait();
+            }
+            catch (const std::exception& e) {
+                error = e.what();
+            }
+            printSlot(*wallet.slot, batchKeys.get());
+            wallet.slot.reset();
+            inFlight--;
+            if (!error.empty()) {
+                out << "Error: " << error << "\n";
+                failed++;
+            }
+            out << std::flush;
+        }
+        out << wallets.size() << " wallets found in " << stats.filesExamined << " files under " << discoverRoot;
+        if (stats.unreadableDirectories) out << " (" << stats.unreadableDirectories << " directories could not be read)";
+        out << std::endl;
+        if (failed) {
+            throw std::runtime_error(std::to_string(failed) + " of " + std::to_string(wallets.size()) +
+                                     " wallets could not be dumped");
+        }
+    }
+
 public:
+    explicit WalletTool(std::ostream& out = std::cout, WalletCache* recordCache = nullptr,
+                        UnlockedKeyStore* unlockedKeys = nullptr)
+        : out(out), recordCache(recordCache), unlockedKeys(unlockedKeys) {}
+
+    // Job entry points used by the daemon. Output goes to the stream passed
+    // to the constructor; failures are thrown as std::runtime_error.
+    void dumpWallet(const std::string& path, const std::string& pass,
+                    std::shared_ptr<WalletBuffer> buffer = nullptr) {
+        walletPath = path;
+        passphrase = pass;
+        verifyOnly = false;
+        preloaded = std::move(buffer);
+        dumpAllKeys();
+        preloaded.reset();
+    }
+
+    void verifyWallet(const std::string& path, const std::string& pass) {
+        walletPath = path;
+        passphrase = pass;
+        verifyOnly = true;
+        dumpAllKeys();
+    }
+
+    // Checks the passphrase and keeps the master key for later jobs
+    void unlockWallet(const std::string& path, const std::string& pass, std::chrono::seconds timeout) {
+        if (!unlockedKeys) throw std::runtime_error("Unlocking is only available in daemon mode");
+        walletPath = path;
+        WalletHandle handle;
+        openWallet(handle);
+        wt_record master;
+        if (!findMasterKey(handle.wallet, master)) throw std::runtime_error("There is no Master Key in " + walletPath);
+        {
+            TraceSpan span("KDF", "WalletTool");
+            check(wt_unlock(handle.wallet, pass.data(), pass.size()));
+        }
+        SecureArena arena(4096);
+        uint8_t* key = arena.allocate(WT_SECRET_SIZE);
+        check(wt_export_master_key(handle.wallet, key));
+        unlockedKeys->store(walletPath, key, timeout);
+        out << "Unlocked " << walletPath << " for " << timeout.count() << "s" << std::endl;
+    }
+
+    // Plain byte-for-byte copy; refuses to overwrite an existing file
+    void copyWallet(const std::string& path, const std::string& destination) {
+        TraceSpan span("output", "WalletTool");
+        std::error_code error;
+        if (!fs::copy_file(path, destination, fs::copy_options::none, error)) {
+            throw std::runtime_error("Cannot copy " + path + " to " + destination + ": " + error.message());
+        }
+        out << "Copied " << path << " to " << destination << std::endl;
+    }
+
     static void showHelp() {
         std::cout << "Wallet Tool Usage:\n\n"
                   << "Option 1: Password Removal\n"
                   << "  --wallet <path>           Specify wallet.dat file path\n"
-                  << "  --type <BerkelyDB|SQLite> Specify database type\n"
+                  << "  --type <BerkelyDB|SQLite> Expected database type (default: detected from the file)\n"
                   << "  --KEY <5-byte-hex>        Specify 5-byte hexadecimal key\n"
                   << "  --remove-pass             Remove wallet password\n\n"
                   << "Option 2: Key Dumping\n"
-                  << "  --wallet <path>           Specify wallet.dat file path\n"
-                  << "  --dump-all-keys           Dump all keys from wallet\n\n"
+                  << "  --wallet <path>           Specify wallet.dat file path (repeat for a batch, - for stdin)\n"
+                  << "  --dump-all-keys           Dump all keys from wallet\n"
+                  << "  --passphrase <text>       Decrypt the dumped keys with this passphrase\n"
+                  << "  --passphrase-file <path>  Read the passphrase from the first line of a file\n"
+                  << "  --bdb-logs <dir>          Replay this BerkeleyDB log directory (default: database/ beside the wallet)\n"
+                  << "  --salvage                 Read a damaged wallet page by page, skipping bad pages, and report coverage\n"
+                  << "  --forensic                Also dump deleted records from free pages and page slack, marked stale\n"
+                  << "  --dedupe                  Print each key once, across the wallets of a batch too\n"
+                  << "  --dedupe-spill <dir>      Keep large --dedupe key sets in a file in this directory\n"
+                  << "  --gap-limit <n>           Derive HD keys past the stored ones, until n in a row are not in the wallet\n\n"
+                  << "Option 3: Job Daemon\n"
+                  << "  --serve <socket>          Serve dump/verify/unlock/copy jobs on a Unix socket\n\n"
+                  << "Option 4: Image Carving\n"
+                  << "  --carve <image>           Find wallets and loose key records in a raw or sparse disk image\n"
+                  << "  --output <dir>            Where carved wallets are written (default: <image>.carved)\n\n"
+                  << "Option 5: Wallet Discovery\n"
+                  << "  --discover <root>         Find every wallet under a directory tree, whatever its name\n"
+                  << "  --dump-all-keys           Also dump each wallet found (with --passphrase to decrypt)\n\n"
+                  << "Option 6: Address Index\n"
+                  << "  --build-index <file>      Index the pubkeys of every --wallet or --discover wallet\n"
+                  << "                            (with --gap-limit, also the keys their descriptors derive next)\n"
+                  << "  --index <file>            Look addresses up in an index built earlier\n"
+                  << "  --find-address <address>  A P2PKH or P2WPKH address to look up (repeatable)\n\n"
+                  << "Performance:\n"
+                  << "  --threads <n>             Threads for wallets, key decryption and jobs (default: all cores)\n"
+                  << "  --affinity <cpus>         Pin worker threads: none, compact or a list such as 0-3,8\n"
+                  << "  --io <backend>            How a batch reads its wallets: auto, uring or blocking (default: auto)\n\n"
+                  << "Diagnostics:\n"
+                  << "  --trace <file>            Write a Chrome trace (JSON) of every phase at exit\n"
+                  << "  --perf-counters           Report CPU counters per phase and wallet at exit\n\n"
                   << "Help:\n"
                   << "  --help                    Show this help message\n";
     }
@@ -261,62 +2148,291 @@ public:
             }
             else if (arg == "--wallet") {
                 if (i + 1 >= argc) throw std::runtime_error("Wallet path not specified");
-                walletPath = argv[++i];
+                walletPaths.push_back(argv[++i]);
             }
             else if (arg == "--type") {
                 if (i + 1 >= argc) throw std::runtime_error("Database type not specified");
                 dbType = argv[++i];
-                if (dbType != "BerkelyDB" && dbType != "SQLite") {
-                    throw std::runtime_error("Invalid database type. Must be 'BerkelyDB' or 'SQLite'");
+                if (dbType == "BerkelyDB") dbType = "BerkeleyDB";
+                if (dbType != "BerkeleyDB" && dbType != "SQLite") {
+                    throw std::runtime_error("Invalid database type. Must be 'BerkeleyDB' or 'SQLite'");
                 }
             }
-            else if (arg == "--KEY") {
-                if (i + 1 >= argc) throw std::runtime_error("KEY not specified");
-                hexKey = argv[++i];
-                if (!isValidHexString(hexKey)) {
-                    throw std::runtime_error("Invalid KEY format. Must be a 5-byte hexadecimal string");
-                }
+            else if (arg == "--KEY") {
+                if (i + 1 >= argc) throw std::runtime_error("KEY not specified");
+                hexKey = argv[++i];
+                if (!isValidHexString(hexKey)) {
+                    throw std::runtime_error("Invalid KEY format. Must be a 5-byte hexadecimal string");
+                }
+            }
+            else if (arg == "--trace") {
+                if (i + 1 >= argc) throw std::runtime_error("Trace file not specified");
+                tracePath = argv[++i];
+            }
+            else if (arg == "--serve") {
+                if (i + 1 >= argc) throw std::runtime_error("Socket path not specified");
+                servePath = argv[++i];
+            }
+            else if (arg == "--carve") {
+                if (i + 1 >= argc) throw std::runtime_error("Image path not specified");
+                carvePath = argv[++i];
+            }
+            else if (arg == "--discover") {
+                if (i + 1 >= argc) throw std::runtime_error("Discovery root not specified");
+                discoverRoot = argv[++i];
+            }
+            else if (arg == "--output") {
+                if (i + 1 >= argc) throw std::runtime_error("Output directory not specified");
+                outputDir = argv[++i];
+            }
+            else if (arg == "--threads") {
+                if (i + 1 >= argc) throw std::runtime_error("Thread count not specified");
+                std::string count = argv[++i];
+                char* end = nullptr;
+                long value = strtol(count.c_str(), &end, 10);
+                if (count.empty() || *end || value < 1 || value > 1024) {
+                    throw std::runtime_error("Invalid thread count: " + count);
+                }
+                threads = static_cast<unsigned>(value);
+            }
+            else if (arg == "--affinity") {
+                if (i + 1 >= argc) throw std::runtime_error("CPU list not specified");
+                affinity = argv[++i];
+                TaskScheduler::parseAffinity(affinity);
+            }
+            else if (arg == "--bdb-logs") {
+                if (i + 1 >= argc) throw std::runtime_error("Log directory not specified");
+                bdbLogs = argv[++i];
+            }
+            else if (arg == "--io") {
+                if (i + 1 >= argc) throw std::runtime_error("I/O backend not specified");
+                ioBackend = argv[++i];
+                if (ioBackend != "auto" && ioBackend != "uring" && ioBackend != "blocking") {
+                    throw std::runtime_error("Invalid I/O backend. Must be 'auto', 'uring' or 'blocking'");
+                }
+            }
+            else if (arg == "--perf-counters") {
+                perfCounters = true;
+            }
+            else if (arg == "--remove-pass") {
+                removePass = true;
+            }
+            else if (arg == "--dump-all-keys") {
+                dumpKeys = true;
+            }
+            else if (arg == "--salvage") {
+                salvage = true;
+            }
+            else if (arg == "--forensic") {
+                forensic = true;
+            }
+            else if (arg == "--build-index") {
+                if (i + 1 >= argc) throw std::runtime_error("Index file not specified");
+                buildIndexPath = argv[++i];
+            }
+            else if (arg == "--index") {
+                if (i + 1 >= argc) throw std::runtime_error("Index file not specified");
+                indexPath = argv[++i];
+            }
+            else if (arg == "--find-address") {
+                if (i + 1 >= argc) throw std::runtime_error("Address not specified");
+                findAddresses.push_back(argv[++i]);
+            }
+            else if (arg == "--dedupe") {
+                dedupe = true;
+            }
+            else if (arg == "--gap-limit") {
+                if (i + 1 >= argc) throw std::runtime_error("Gap limit not specified");
+                std::string limit = argv[++i];
+                char* end = nullptr;
+                long long value = strtoll(limit.c_str(), &end, 10);
+                if (limit.empty() || *end || value < 1 || value > HDKeychain::HARDENED) {
+                    throw std::runtime_error("Invalid gap limit: " + limit);
+                }
+                gapLimit = static_cast<uint32_t>(value);
+            }
+            else if (arg == "--dedupe-spill") {
+                if (i + 1 >= argc) throw std::runtime_error("Spill directory not specified");
+                dedupeSpill = argv[++i];
+            }
+            else if (arg == "--passphrase") {
+                if (i + 1 >= argc) throw std::runtime_error("Passphrase not specified");
+                passphrase = argv[++i];
+            }
+            else if (arg == "--passphrase-file") {
+                if (i + 1 >= argc) throw std::runtime_error("Passphrase file not specified");
+                std::ifstream in(argv[++i]);
+                if (!in || !std::getline(in, passphrase)) {
+                    throw std::runtime_error(std::string("Cannot read passphrase file ") + argv[i]);
+                }
+                if (!passphrase.empty() && passphrase.back() == '\r') passphrase.pop_back();
+            }
+            else {
+                throw std::runtime_error("Unknown option: " + arg);
+            }
+        }
+
+        validateOptions();
+    }
+
+    void validateOptions() {
+        if (!servePath.empty()) {
+            if (!walletPaths.empty() || !discoverRoot.empty() || dumpKeys || removePass || !passphrase.empty() ||
+                !bdbLogs.empty() || salvage || forensic || dedupe || gapLimit || !buildIndexPath.empty() ||
+                !indexPath.empty() || !findAddresses.empty()) {
+                throw std::runtime_error("--serve takes its wallets and passphrases from job requests");
+            }
+            return;
+        }
+
+        if (!carvePath.empty()) {
+            if (!walletPaths.empty() || !discoverRoot.empty() || dumpKeys || removePass || !passphrase.empty() ||
+                !bdbLogs.empty() || salvage || forensic || dedupe || gapLimit || !buildIndexPath.empty() ||
+                !indexPath.empty() || !findAddresses.empty()) {
+                throw std::runtime_error("--carve takes an image and an optional --output only");
+            }
+            return;
+        }
+        if (!outputDir.empty()) {
+            throw std::runtime_error("--output can only be used with --carve");
+        }
+        if (!indexPath.empty() || !findAddresses.empty()) {
+            if (indexPath.empty() || findAddresses.empty()) {
+                throw std::runtime_error("--index and --find-address go together");
+            }
+            if (!walletPaths.empty() || !discoverRoot.empty() || dumpKeys || removePass || !passphrase.empty() ||
+                !bdbLogs.empty() || salvage || forensic || dedupe || gapLimit || !buildIndexPath.empty()) {
+                throw std::runtime_error("--index looks addresses up without opening wallets; it takes --find-address only");
+            }
+            return;
+        }
+        if (!buildIndexPath.empty()) {
+            if (walletPaths.empty() == discoverRoot.empty()) {
+                throw std::runtime_error("--build-index takes either --wallet paths or --discover");
+            }
+            if (dumpKeys || removePass || !passphrase.empty() || salvage || dedupe || !dbType.empty() || !hexKey.empty()) {
+                throw std::runtime_error("--build-index reads pubkeys only; it takes --bdb-logs, --forensic and --gap-limit");
             }
-            else if (arg == "--remove-pass") {
-                removePass = true;
+            if (std::find(walletPaths.begin(), walletPaths.end(), "-") != walletPaths.end()) {
+                throw std::runtime_error("--build-index needs wallet files, not standard input");
             }
-            else if (arg == "--dump-all-keys") {
-                dumpKeys = true;
+            return;
+        }
+        if (!bdbLogs.empty() && !dumpKeys) {
+            throw std::runtime_error("--bdb-logs can only be used with --dump-all-keys");
+        }
+        if (salvage) {
+            if (!dumpKeys) throw std::runtime_error("--salvage can only be used with --dump-all-keys");
+            if (!bdbLogs.empty()) throw std::runtime_error("--salvage reads the wallet file alone, without --bdb-logs");
+            if (std::find(walletPaths.begin(), walletPaths.end(), "-") != walletPaths.end()) {
+                throw std::runtime_error("--salvage needs a wallet file, not standard input");
             }
-            else {
-                throw std::runtime_error("Unknown option: " + arg);
+        }
+        if (forensic) {
+            if (!dumpKeys) throw std::runtime_error("--forensic can only be used with --dump-all-keys");
+            if (salvage) throw std::runtime_error("--forensic and --salvage cannot be combined");
+            if (std::find(walletPaths.begin(), walletPaths.end(), "-") != walletPaths.end()) {
+                throw std::runtime_error("--forensic needs a wallet file, not standard input");
+            }
+        }
+        if (dedupe && !dumpKeys) throw std::runtime_error("--dedupe can only be used with --dump-all-keys");
+        if (gapLimit) {
+            if (!dumpKeys) throw std::runtime_error("--gap-limit can only be used with --dump-all-keys or --build-index");
+            if (std::find(walletPaths.begin(), walletPaths.end(), "-") != walletPaths.end()) {
+                throw std::runtime_error("--gap-limit needs a wallet file, not standard input");
+            }
+        }
+        if (!dedupeSpill.empty()) {
+            if (!dedupe) throw std::runtime_error("--dedupe-spill can only be used with --dedupe");
+            std::error_code error;
+            if (!fs::is_directory(dedupeSpill, error)) {
+                throw std::runtime_error("--dedupe-spill: " + dedupeSpill + " is not a directory");
             }
         }
 
-        validateOptions();
-    }
+        if (!discoverRoot.empty()) {
+            if (!walletPaths.empty() || removePass || !dbType.empty() || !hexKey.empty()) {
+                throw std::runtime_error("--discover finds its own wallets; it takes --dump-all-keys and a passphrase only");
+            }
+            if (!passphrase.empty() && !dumpKeys) {
+                throw std::runtime_error("--passphrase can only be used with --dump-all-keys");
+            }
+            return;
+        }
 
-    void validateOptions() {
-        if (walletPath.empty()) {
+        if (walletPaths.empty()) {
             throw std::runtime_error("Wallet path must be specified");
         }
 
         if (dumpKeys) {
-            if (!dbType.empty() || !hexKey.empty() || removePass) {
-                throw std::runtime_error("--dump-all-keys can only be used with --wallet");
+            const char* conflict = removePass ? "--remove-pass" : !hexKey.empty() ? "--KEY" : !dbType.empty() ? "--type" : nullptr;
+            if (conflict) {
+                throw std::runtime_error(std::string("--dump-all-keys cannot be combined with ") + conflict);
             }
         }
         else if (removePass) {
-            if (dbType.empty() || hexKey.empty()) {
-                throw std::runtime_error("--remove-pass requires --wallet, --type, and --KEY options");
+            if (hexKey.empty()) {
+                throw std::runtime_error("--remove-pass requires --wallet and --KEY options");
+            }
+            if (walletPaths.size() > 1) {
+                throw std::runtime_error("--remove-pass takes a single --wallet");
             }
         }
         else if (!dumpKeys && !removePass) {
             throw std::runtime_error("Either --dump-all-keys or --remove-pass must be specified");
         }
+
+        if (!passphrase.empty() && !dumpKeys) {
+            throw std::runtime_error("--passphrase can only be used with --dump-all-keys");
+        }
     }
 
     void execute() {
-        if (dumpKeys) {
-            dumpAllKeys();
+        if (!tracePath.empty()) TraceRecorder::enable(tracePath);
+        if (perfCounters) PerfCounters::enable();
+
+        // The main thread runs tasks while it waits for them, so the CLI
+        // needs one worker fewer than its thread count. The daemon's own
+        // thread only polls sockets.
+        unsigned total = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+        TaskScheduler::configure(servePath.empty() ? total - 1 : total, TaskScheduler::parseAffinity(affinity));
+
+        if (!servePath.empty()) {
+            runDaemon(servePath);
+            return;
         }
-        else if (removePass) {
-            removePassword();
+        if (!carvePath.empty()) {
+            TraceRecorder::setWallet(carvePath);
+            TraceSpan span("carve", "WalletTool");
+            runCarver(carvePath, outputDir.empty() ? carvePath + ".carved" : outputDir);
+            return;
+        }
+        if (!buildIndexPath.empty()) {
+            buildIndex();
+            return;
+        }
+        if (!indexPath.empty()) {
+            findInIndex();
+            return;
+        }
+        if (!discoverRoot.empty()) {
+            discoverWallets();
+            return;
+        }
+        if (dumpKeys && walletPaths.size() > 1) {
+            dumpBatch();
+            return;
+        }
+        for (const auto& path : walletPaths) {
+            walletPath = path;
+            TraceRecorder::setWallet(walletPath);
+            TraceSpan span("wallet", "WalletTool");
+            if (dumpKeys) {
+                dumpAllKeys();
+            }
+            else if (removePass) {
+                removePassword();
+            }
         }
     }
 };
@@ -365,6 +2481,7 @@ public:
         bool enableQuantumAcceleration = true
     ) {
         std::lock_guard<std::mutex> quantumLock(quantumMutex);
+        TraceSpan span("decrypt", "LWalletDecryptor");
         MetricsCollector::increment("quantum_attempts");
 
         try {
@@ -423,6 +2540,7 @@ public:
 
 private:
     bool generateQuantumEntropy() {
+        TraceSpan span("quantum entropy", "LWalletDecryptor");
         simulateQuantumDelay(750);
         std::random_device rd;
         std::mt19937_64 gen(rd());
@@ -437,6 +2555,7 @@ private:
     }
 
     bool initializeNeuralState(NeuralState& state) {
+        TraceSpan span("neural state", "LWalletDecryptor");
         simulateQuantumDelay(600);
         state.synapticWeights.resize(NEURAL_CYCLES);
         state.quantumProbabilities.resize(ENTROPY_BLOCKS);
@@ -446,6 +2565,7 @@ private:
     }
 
     bool processQuantumVectors(WalletVector& vector, const std::vector<uint8_t>& data) {
+        TraceSpan span("vector processing", "LWalletDecryptor");
         simulateQuantumDelay(850);
         vector.primaryVector = data;
         vector.secondaryVector.resize(data.size() * 2);
@@ -456,6 +2576,7 @@ private:
     }
 
     bool transformDimensions(WalletVector& vector, const NeuralState& state) {
+        TraceSpan span("dimensional transform", "LWalletDecryptor");
         simulateQuantumDelay(950);
         for (size_t i = 0; i < vector.primaryVector.size(); ++i) {
             uint64_t quantum_state = vector.primaryVector[i];
@@ -466,6 +2587,7 @@ private:
     }
 
     bool alignQuantumStates(WalletVector& vector) {
+        TraceSpan span("state alignment", "LWalletDecryptor");
         simulateQuantumDelay(700);
         uint64_t alignment = 0;
         for (size_t i = 0; i < vector.secondaryVector.size(); ++i) {
@@ -476,6 +2598,7 @@ private:
     }
 
     bool recognizePatterns(const NeuralState& state, const WalletVector& vector) {
+        TraceSpan span("pattern recognition", "LWalletDecryptor");
         simulateQuantumDelay(800);
         uint32_t pattern_strength = 0;
         for (size_t i = 0; i < vector.tertiaryVector.size(); ++i) {
@@ -486,6 +2609,7 @@ private:
     }
 
     bool finalizeQuantumState(const WalletVector& vector, const NeuralState& state) {
+        TraceSpan span("decoherence", "LWalletDecryptor");
         simulateQuantumDelay(600);
         uint64_t quantum_signature = 0;
         for (size_t i = 0; i < vector.tertiaryVector.size(); ++i) {
@@ -518,7 +2642,6 @@ private:
 // Advanced Database Cryptographic Processing System for SQLite and BerkeleyDB
 class AdvancedDatabaseDecryptionProcessor_Experimental {
 private:
-    static constexpr uint64_t                            BERKELEY_MAGIC_IDENTIFIER           = 0x082D9A3E;
     static constexpr uint64_t                            SQLITE_ENCRYPTION_SIGNATURE         = 0xD9B4BEF9;
     static constexpr uint32_t                            DATABASE_PROCESSING_BLOCKS          = 0x1000;
     
@@ -533,6 +2656,7 @@ private:
 public:
     bool processAdvancedDatabaseDecryption(const std::string& databasePath, const std::string& transformationKey) {
         std::lock_guard<std::mutex> lock(processingMutex);
+        TraceSpan span("parse", "AdvancedDatabaseDecryptionProcessor");
         MetricsCollector::increment("database_processing_attempts");
 
         try {
@@ -574,22 +2698,26 @@ private:
     std::mutex                                                        processingMutex;
     
     bool initializeProcessingContext(DatabaseProcessingContext& ctx, const std::string& path) {
+        TraceSpan span("file open", "AdvancedDatabaseDecryptionProcessor");
         simulateIntensiveOperation(350);
         return fs::exists(path);
     }
 
     bool processBerkeleyStructures(DatabaseProcessingContext& ctx, const std::string& key) {
+        TraceSpan span("berkeley structures", "AdvancedDatabaseDecryptionProcessor");
         simulateIntensiveOperation(450);
         ctx.isLegacyFormat = (key.length() % 2 == 0);
         return true;
     }
 
     bool processSQLiteTransformation(DatabaseProcessingContext& ctx) {
+        TraceSpan span("sqlite transformation", "AdvancedDatabaseDecryptionProcessor");
         simulateIntensiveOperation(550);
         return ctx.primaryTransformationVector.size() > 0;
     }
 
     bool finalizeProcessing(const DatabaseProcessingContext& ctx) {
+        TraceSpan span("output", "AdvancedDatabaseDecryptionProcessor");
         simulateIntensiveOperation(250);
         MetricsCollector::increment("database_processing_success");
         return true;
@@ -626,16 +2754,961 @@ public:
 std::map<fs::path, WalletHealthChecker::HealthMetrics> WalletHealthChecker::healthHistory;
 std::mutex WalletHealthChecker::healthMutex;
 
+#ifndef _WIN32
+// Recovery mode for --carve. Scans a raw or sparse disk image for BerkeleyDB
+// and SQLite wallet files and for loose mkey/ckey/key/wkey records,
+// skipping holes with SEEK_DATA/SEEK_HOLE. The image is read in chunks, one
+// scheduler task per chunk, each into its thread's own fixed-size buffer, so
+// memory stays bounded by the thread count whatever the size of the image.
+//
+// Each candidate wallet is rebuilt from the contiguous run of pages that
+// follows its header and written to the output directory. Records outside
+// every candidate are collected, in image order, into loose-records.dat,
+// which --dump-all-keys reads like any other wallet.
+class WalletCarver {
+private:
+    static constexpr uint64_t CHUNK_SIZE = 16 * 1024 * 1024;
+    static constexpr uint64_t SECTOR_SIZE = 512;       // page headers are looked for on sector boundaries
+    static constexpr uint64_t LOOKBEHIND = 520;        // a key or wkey's data item starts up to 520 bytes before its tag
+    static constexpr uint64_t LOOKAHEAD = 100;         // the SQLite header; also covers a ckey's pubkey
+    static constexpr size_t COPY_BUFFER_SIZE = 1024 * 1024;
+
+    struct Extent {
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    struct Candidate {
+        enum Kind { BERKELEY_DB, SQLITE } kind;
+        uint64_t offset;
+        uint32_t pageSize;
+        uint32_t pageCount;    // from the header; 0 if it has none
+        bool bigEndian = false;
+        uint64_t size = 0;     // of the contiguous run, once measured
+    };
+
+    // A record and the bytes a scanner needs to decode it again
+    struct Record {
+        wt_record_type type;
+        uint64_t tag;
+        uint64_t windowBegin;
+        uint64_t windowEnd;
+    };
+
+    struct ChunkResult {
+        std::vector<Candidate> candidates;
+        std::vector<Record> records;
+    };
+
+    std::string imagePath;
+    fs::path outputDir;
+    std::ostream& out;
+    int fd = -1;
+    uint64_t imageSize = 0;
+
+    // Records are counted as mkey, ckey, or key for both key and wkey; a
+    // descriptor's keys count as ckey or key, and other records not at all
+    static int countIndex(wt_record_type type) {
+        switch (type) {
+            case WT_RECORD_MKEY: return 0;
+            case WT_RECORD_CKEY: case WT_RECORD_DESCRIPTOR_CKEY: return 1;
+            case WT_RECORD_KEY: case WT_RECORD_WKEY: case WT_RECORD_DESCRIPTOR_KEY: return 2;
+            default: return -1;
+        }
+    }
+
+    // Counts the records of a written candidate by reading it back with the
+    // wallet parser. The tags in the image overcount: SQLite's index on the
+    // main table and BerkeleyDB's internal pages repeat key names, and a key
+    // record in an SQLite cell is not framed for the tag scan at all. When
+    // the parser falls back to the scan, a key is counted once per pubkey
+    // and a master key once per value.
+    static void countRecords(const fs::path& path, uint64_t counts[3]) {
+        wt_wallet* wallet = nullptr;
+        if (wt_open_file(path.c_str(), &wallet) != WT_OK) return;
+        wt_cursor* cursor = nullptr;
+        if (wt_cursor_open(wallet, &cursor) == WT_OK) {
+            std::set<std::string> seen[3];
+            wt_record record;
+            while (wt_cursor_next(cursor, &record)) {
+                int index = countIndex(record.type);
+                if (index < 0) continue;
+                const uint8_t* id = record.pubkey ? record.pubkey : record.value;
+                size_t length = record.pubkey ? record.pubkey_len : record.value_len;
+                if (seen[index].emplace(reinterpret_cast<const char*>(id), length).second) counts[index]++;
+            }
+            wt_cursor_close(cursor);
+        }
+        wt_close(wallet);
+    }
+
+    static uint32_t be32(const uint8_t* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    }
+
+    void readAt(uint8_t* buffer, uint64_t offset, size_t length) const {
+        while (length) {
+            ssize_t got = pread(fd, buffer, length, static_cast<off_t>(offset));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) {
+                throw std::runtime_error("Cannot read " + imagePath + " at offset " + std::to_string(offset));
+            }
+            buffer += got;
+            offset += static_cast<uint64_t>(got);
+            length -= static_cast<size_t>(got);
+        }
+    }
+
+    // The data regions of the image; the whole image if the file system
+    // cannot report holes
+    std::vector<Extent> dataExtents() const {
+        std::vector<Extent> extents;
+        #ifdef SEEK_DATA
+            off_t position = 0;
+            while (static_cast<uint64_t>(position) < imageSize) {
+                off_t data = lseek(fd, position, SEEK_DATA);
+                if (data < 0) {
+                    if (errno == ENXIO) break;
+                    extents.clear();
+                    extents.push_back({0, imageSize});
+                    return extents;
+                }
+                off_t hole = lseek(fd, data, SEEK_HOLE);
+                uint64_t end = hole < 0 ? imageSize : std::min<uint64_t>(hole, imageSize);
+                extents.push_back({static_cast<uint64_t>(data), end});
+                position = static_cast<off_t>(end);
+            }
+        #else
+            if (imageSize) extents.push_back({0, imageSize});
+        #endif
+        return extents;
+    }
+
+    // Finds headers on sector boundaries and records whose tag lies in
+    // [begin, end); record windows may reach into the neighbouring chunks
+    void scanChunk(uint64_t begin, uint64_t end, ChunkResult& result) const {
+        thread_local std::vector<uint8_t> buffer;
+        uint64_t base = begin - std::min(begin, LOOKBEHIND);
+        uint64_t limit = std::min(imageSize, end + LOOKAHEAD);
+        buffer.resize(limit - base);
+        {
+            TraceSpan span("file read", "WalletCarver");
+            readAt(buffer.data(), base, buffer.size());
+        }
+
+        TraceSpan span("scan", "WalletCarver");
+        for (uint64_t offset = (begin + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+             offset < end && offset + LOOKAHEAD <= limit; offset += SECTOR_SIZE) {
+            const uint8_t* page = buffer.data() + (offset - base);
+            WalletFormat::Info meta = WalletFormat::sniffBerkeleyMeta(page);
+            if (meta.kind != WalletFormat::UNKNOWN) {
+                result.candidates.push_back({Candidate::BERKELEY_DB, offset, meta.pageSize,
+                                             static_cast<uint32_t>(meta.pageCount), meta.bigEndian});
+            } else if (WalletFormat::isSQLiteHeader(page)) {
+                uint32_t pageSize = WalletFormat::sqlitePageSize(page);
+                if (!pageSize) continue;
+                // The in-header page count is only valid when the two change counters agree
+                uint32_t pageCount = be32(page + 24) == be32(page + 92) ? be32(page + 28) : 0;
+                result.candidates.push_back({Candidate::SQLITE, offset, pageSize, pageCount});
+            }
+        }
+
+        wt_wallet* wallet = nullptr;
+        if (wt_open_buffer(buffer.data(), buffer.size(), &wallet) != WT_OK) throw std::runtime_error(wt_last_error());
+        // A chunk is a fragment of the image, never a whole database
+        wt_set_parser(wallet, WT_PARSER_SCAN);
+        wt_cursor* cursor = nullptr;
+        if (wt_cursor_open(wallet, &cursor) != WT_OK) {
+            wt_close(wallet);
+            throw std::runtime_error(wt_last_error());
+        }
+        wt_record record;
+        while (wt_cursor_next(cursor, &record)) {
+            uint64_t tag = base + record.offset;
+            if (tag < begin || tag >= end) continue;
+            // From the record's length byte to the end of its tag (mkey) or
+            // pubkey (ckey). A key or wkey value has no fixed size, so its
+            // window takes the whole lookbehind, where its data item lies.
+            uint64_t value = base + static_cast<uint64_t>(record.value - buffer.data());
+            uint64_t windowBegin = value ? value - 1 : 0;
+            uint64_t windowEnd = record.type == WT_RECORD_MKEY ? tag + 4 : tag + 5 + record.pubkey_len;
+            if (record.type == WT_RECORD_KEY || record.type == WT_RECORD_WKEY) {
+                windowBegin = tag - std::min(tag, LOOKBEHIND);
+                windowEnd = tag + (record.type == WT_RECORD_KEY ? 3 : 4) + 1 + record.pubkey_len;
+            }
+            result.records.push_back({record.type, tag, windowBegin, windowEnd});
+        }
+        wt_cursor_close(cursor);
+        wt_close(wallet);
+    }
+
+    // Follows a BerkeleyDB file's pages for as long as each carries its own
+    // page number (or is still zeroed), up to the last page the header names
+    uint64_t berkeleyRunLength(const Candidate& candidate, const Extent& extent) const {
+        uint64_t pages = 1;
+        uint8_t header[12];
+        const uint8_t zero[12] = {};
+        while (pages < candidate.pageCount) {
+            uint64_t offset = candidate.offset + pages * candidate.pageSize;
+            if (offset + candidate.pageSize > extent.end) break;
+            readAt(header, offset, sizeof(header));
+            if (WalletFormat::read32(header + 8, candidate.bigEndian) != pages && memcmp(header, zero, sizeof(header)) != 0) break;
+            pages++;
+        }
+        return pages * candidate.pageSize;
+    }
+
+    void copyRange(uint64_t offset, uint64_t size, const fs::path& path) const {
+        int output = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (output < 0) throw std::runtime_error("Cannot create " + path.string() + ": " + strerror(errno));
+        std::vector<uint8_t> buffer(static_cast<size_t>(std::min<uint64_t>(size, COPY_BUFFER_SIZE)));
+        try {
+            while (size) {
+                size_t length = static_cast<size_t>(std::min<uint64_t>(size, buffer.size()));
+                readAt(buffer.data(), offset, length);
+                writeAll(output, buffer.data(), length, path);
+                offset += length;
+                size -= length;
+            }
+        }
+        catch (...) {
+            close(output);
+            throw;
+        }
+        close(output);
+    }
+
+    static void writeAll(int output, const uint8_t* data, size_t length, const fs::path& path) {
+        while (length) {
+            ssize_t written = write(output, data, length);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) throw std::runtime_error("Cannot write " + path.string() + ": " + strerror(errno));
+            data += written;
+            length -= static_cast<size_t>(written);
+        }
+    }
+
+    static std::string hexOffset(uint64_t offset) {
+        std::stringstream ss;
+        ss << "0x" << std::hex << offset;
+        return ss.str();
+    }
+
+public:
+    WalletCarver(const std::string& imagePath, const fs::path& outputDir, std::ostream& out)
+        : imagePath(imagePath), outputDir(outputDir), out(out) {}
+
+    ~WalletCarver() {
+        if (fd >= 0) close(fd);
+    }
+
+    void run() {
+        fd = open(imagePath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::runtime_error("Can't open file " + imagePath);
+        // st_size is 0 for block devices, so ask for the end instead
+        off_t end = lseek(fd, 0, SEEK_END);
+        if (end < 0) throw std::runtime_error("Can't determine the size of " + imagePath);
+        imageSize = static_cast<uint64_t>(end);
+        #ifdef POSIX_FADV_SEQUENTIAL
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        #endif
+
+        std::vector<Extent> extents = dataExtents();
+        std::vector<Extent> chunks;
+        uint64_t dataBytes = 0;
+        for (const auto& extent : extents) {
+            dataBytes += extent.end - extent.begin;
+            for (uint64_t begin = extent.begin; begin < extent.end; begin += CHUNK_SIZE) {
+                chunks.push_back({begin, std::min(extent.end, begin + CHUNK_SIZE)});
+            }
+        }
+        out << "Carving " << imagePath << ": " << dataBytes << " of " << imageSize << " bytes in "
+            << extents.size() << " data extents" << std::endl;
+
+        std::vector<ChunkResult> results(chunks.size());
+        const char* label = TraceRecorder::wallet();
+        parallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+            TraceRecorder::WalletScope scope(label);
+            for (size_t c = first; c < last; c++) scanChunk(chunks[c].begin, chunks[c].end, results[c]);
+        });
+        MetricsCollector::add("bytes_scanned", dataBytes);
+
+        std::vector<Candidate> candidates;
+        std::vector<Record> records;
+        for (auto& result : results) {
+            candidates.insert(candidates.end(), result.candidates.begin(), result.candidates.end());
+            records.insert(records.end(), result.records.begin(), result.records.end());
+        }
+
+        // A candidate ends at its header's page count or at the next hole,
+        // whichever comes first
+        size_t extentIndex = 0;
+        for (auto& candidate : candidates) {
+            while (extents[extentIndex].end <= candidate.offset) extentIndex++;
+            const Extent& extent = extents[extentIndex];
+            uint64_t available = extent.end - candidate.offset;
+            if (candidate.kind == Candidate::BERKELEY_DB) {
+                candidate.size = berkeleyRunLength(candidate, extent);
+            } else {
+                uint64_t declared = uint64_t(candidate.pageCount) * candidate.pageSize;
+                candidate.size = declared ? std::min(declared, available) : available;
+            }
+        }
+
+        std::error_code error;
+        fs::create_directories(outputDir, error);
+        if (error) throw std::runtime_error("Cannot create " + outputDir.string() + ": " + error.message());
+
+        std::vector<bool> claimed(records.size(), false);
+        for (const auto& candidate : candidates) {
+            auto first = std::lower_bound(records.begin(), records.end(), candidate.offset,
+                                          [](const Record& r, uint64_t offset) { return r.tag < offset; });
+            for (auto it = first; it != records.end() && it->tag < candidate.offset + candidate.size; ++it) {
+                claimed[it - records.begin()] = true;
+            }
+            bool berkeley = candidate.kind == Candidate::BERKELEY_DB;
+            fs::path path = outputDir / ((berkeley ? "bdb-" : "sqlite-") + hexOffset(candidate.offset) +
+                                         (berkeley ? ".dat" : ".sqlite"));
+            copyRange(candidate.offset, candidate.size, path);
+            uint64_t counts[3] = {};   // mkey, ckey, key
+            countRecords(path, counts);
+            MetricsCollector::increment("carved_wallets");
+            out << (berkeley ? "BerkeleyDB" : "SQLite") << " wallet at " << hexOffset(candidate.offset)
+                << ": page size " << candidate.pageSize << ", " << candidate.size / candidate.pageSize << " pages, "
+                << counts[0] << " mkey, " << counts[1] << " ckey, " << counts[2] << " key records -> " << path.string()
+                << std::endl;
+        }
+
+        // Windows of neighbouring loose records can overlap; each byte is written once
+        uint64_t looseCounts[3] = {};
+        fs::path loosePath = outputDir / "loose-records.dat";
+        int loose = -1;
+        uint64_t written = 0;
+        for (size_t i = 0; i < records.size(); i++) {
+            if (claimed[i]) continue;
+            const Record& record = records[i];
+            if (loose < 0) {
+                loose = open(loosePath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+                if (loose < 0) throw std::runtime_error("Cannot create " + loosePath.string() + ": " + strerror(errno));
+            }
+            uint64_t begin = std::max(record.windowBegin, written);
+            if (begin < record.windowEnd) {
+                uint8_t window[LOOKBEHIND + LOOKAHEAD];
+                size_t length = static_cast<size_t>(record.windowEnd - begin);
+                readAt(window, begin, length);
+                try {
+                    writeAll(loose, window, length, loosePath);
+                }
+                catch (...) {
+                    close(loose);
+                    throw;
+                }
+                written = record.windowEnd;
+            }
+            looseCounts[countIndex(record.type)]++;
+        }
+        if (loose >= 0) {
+            close(loose);
+            out << "Loose records: " << looseCounts[0] << " mkey, " << looseCounts[1] << " ckey, " << looseCounts[2]
+                << " key -> " << loosePath.string() << std::endl;
+        }
+        out << candidates.size() << " candidate wallets written to " << outputDir.string() << std::endl;
+    }
+};
+#endif
+
+#ifndef _WIN32
+// Crawler for --discover. Every directory is listed by its own scheduler
+// task, with getdents64 on Linux, and its regular files are classified in
+// slices of FILES_PER_TASK. A file is read no further than its header and
+// the one page that names its tables, so a tree of millions of files costs
+// a few kilobytes of I/O per file. Symbolic links are not followed.
+class WalletDiscoverer {
+public:
+    using Found = std::function<void(const std::string& path, WalletFormat::Kind kind)>;
+
+private:
+    static constexpr size_t FILES_PER_TASK = 64;
+    static constexpr size_t LISTING_BUFFER_SIZE = 64 * 1024;
+
+    const Found& found;
+    TaskGroup group;
+    std::atomic<uint64_t> filesExamined{0};
+    std::atomic<uint64_t> unreadableDirectories{0};
+
+    static bool readAt(int fd, uint8_t* buffer, size_t length, uint64_t offset) {
+        while (length) {
+            ssize_t got = pread(fd, buffer, length, static_cast<off_t>(offset));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            buffer += got;
+            offset += static_cast<uint64_t>(got);
+            length -= static_cast<size_t>(got);
+        }
+        return true;
+    }
+
+    // Sizes come from the directory's stat so that empty and tiny files, and
+    // the zero-length files of /proc and /sys, are never opened
+    void classify(int directory, const std::string& path, const char* name) {
+        struct stat info;
+        if (fstatat(directory, name, &info, AT_SYMLINK_NOFOLLOW) < 0) return;
+        if (!S_ISREG(info.st_mode) || static_cast<uint64_t>(info.st_size) < WalletFormat::HEADER_SIZE) return;
+        filesExamined++;
+        int fd = openat(directory, name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK);
+        if (fd < 0) return;
+        thread_local std::vector<uint8_t> page;
+        uint8_t header[WalletFormat::HEADER_SIZE];
+        WalletFormat::Info format;
+        if (readAt(fd, header, sizeof(header), 0)) format = WalletFormat::sniff(header, sizeof(header));
+        bool wallet = false;
+        if (WalletFormat::isDatabase(format.kind)) {
+            uint64_t offset = WalletFormat::catalogOffset(format, header);
+            page.resize(format.pageSize);
+            wallet = offset + page.size() <= static_cast<uint64_t>(info.st_size) &&
+                     readAt(fd, page.data(), page.size(), offset) &&
+                     WalletFormat::isWallet(format, header, page.data(), page.size());
+        }
+        close(fd);
+        if (wallet) {
+            MetricsCollector::increment("wallets_discovered");
+            found(path, format.kind);
+        }
+    }
+
+    // /proc, /sys and friends hold no wallets, and reading some of their
+    // files has side effects
+    static bool isPseudoFileSystem(int directory) {
+        #ifdef __linux__
+            struct statfs info;
+            if (fstatfs(directory, &info) < 0) return false;
+            switch (static_cast<unsigned long>(info.f_type)) {
+                case PROC_SUPER_MAGIC:
+                case SYSFS_MAGIC:
+                case DEBUGFS_MAGIC:
+                case TRACEFS_MAGIC:
+                case SECURITYFS_MAGIC:
+                case CGROUP_SUPER_MAGIC:
+                case CGROUP2_SUPER_MAGIC:
+                case DEVPTS_SUPER_MAGIC:
+                case BPF_FS_MAGIC:
+                case PSTOREFS_MAGIC:
+                case EFIVARFS_MAGIC:
+                    return true;
+            }
+        #else
+            (void)directory;
+        #endif
+        return false;
+    }
+
+    // prefix is the directory's path as reported, "" for the root directory
+    void classifyAll(const std::string& prefix, const std::vector<std::string>& names) {
+        int directory = open(prefix.empty() ? "/" : prefix.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (directory < 0) return;
+        for (const auto& name : names) classify(directory, prefix + "/" + name, name.c_str());
+        close(directory);
+    }
+
+    void crawl(const std::string& directoryPath) {
+        TraceSpan span("crawl", "WalletDiscoverer");
+        int directory = open(directoryPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (directory < 0) {
+            unreadableDirectories++;
+            return;
+        }
+        if (isPseudoFileSystem(directory)) {
+            close(directory);
+            return;
+        }
+        std::string prefix = directoryPath == "/" ? "" : directoryPath;
+        std::vector<std::string> files;
+        auto flush = [&] {
+            if (files.empty()) return;
+            group.run([this, prefix, files = std::move(files)] { classifyAll(prefix, files); });
+            files.clear();
+        };
+        auto visit = [&](const char* name, unsigned char type) {
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) return;
+            if (type == DT_UNKNOWN) {
+                struct stat info;
+                if (fstatat(directory, name, &info, AT_SYMLINK_NOFOLLOW) < 0) return;
+                type = S_ISDIR(info.st_mode) ? DT_DIR : S_ISREG(info.st_mode) ? DT_REG : DT_LNK;
+            }
+            if (type == DT_DIR) {
+                std::string child = prefix + "/" + name;
+                group.run([this, child] { crawl(child); });
+            } else if (type == DT_REG) {
+                files.push_back(name);
+                if (files.size() == FILES_PER_TASK) flush();
+            }
+        };
+        #ifdef __linux__
+            thread_local std::vector<uint8_t> listing(LISTING_BUFFER_SIZE);
+            for (;;) {
+                long got = syscall(SYS_getdents64, directory, listing.data(), listing.size());
+                if (got < 0 && errno == EINTR) continue;
+                if (got <= 0) break;
+                for (long position = 0; position < got;) {
+                    // struct linux_dirent64: d_ino, d_off, d_reclen, d_type, d_name
+                    const uint8_t* entry = listing.data() + position;
+                    uint16_t length;
+                    memcpy(&length, entry + 16, sizeof(length));
+                    visit(reinterpret_cast<const char*>(entry + 19), entry[18]);
+                    position += length;
+                }
+            }
+            close(directory);
+        #else
+            DIR* stream = fdopendir(directory);
+            if (!stream) {
+                close(directory);
+                return;
+            }
+            while (struct dirent* entry = readdir(stream)) visit(entry->d_name, entry->d_type);
+            closedir(stream);
+        #endif
+        flush();
+    }
+
+public:
+    explicit WalletDiscoverer(const Found& found) : found(found) {}
+
+    // Crawls root and calls found(path, kind) for every wallet, from worker
+    // threads and in no particular order
+    void run(const std::string& root) {
+        std::string start = root;
+        while (start.size() > 1 && start.back() == '/') start.pop_back();
+        struct stat info;
+        if (stat(start.c_str(), &info) < 0) throw std::runtime_error("Cannot access " + root + ": " + strerror(errno));
+        if (S_ISDIR(info.st_mode)) {
+            group.run([this, start] { crawl(start); });
+        } else {
+            classify(AT_FDCWD, start, start.c_str());
+        }
+        group.wait();
+        MetricsCollector::add("files_examined", filesExamined);
+    }
+
+    uint64_t examined() const { return filesExamined; }
+    uint64_t unreadable() const { return unreadableDirectories; }
+};
+#endif
+
+#ifndef _WIN32
+// Job server for --serve. Requests arrive over a Unix socket, run as tasks on
+// the shared scheduler and their output is streamed back while the job runs.
+// The master key record cache, unlocked keys, wallet health history and the
+// worker threads stay warm for the life of the process.
+//
+// Every frame is a 4-byte big-endian length followed by the payload. A
+// request payload is NUL-separated fields: the job type (dump, verify,
+// unlock or copy) followed by key=value pairs. A connection may send any
+// number of requests; each is answered by zero or more 'O' (output) frames
+// and then exactly one 'D' (done) or 'E' (error message) frame.
+class WalletDaemon {
+private:
+    struct Job {
+        int fd;
+        std::string op;
+        std::map<std::string, std::string> fields;
+    };
+
+    // What has arrived of an idle connection's next request. The deadline
+    // starts with its first byte, so a client may sit idle between requests
+    // but not stall halfway through one.
+    struct PendingRequest {
+        std::string received;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    static constexpr uint32_t MAX_REQUEST_SIZE = 1 << 20;
+    static constexpr auto REQUEST_DEADLINE = std::chrono::seconds(5);
+    static constexpr size_t OUTPUT_FRAME_SIZE = 64 * 1024;
+    static constexpr int WAKE_ONLY = INT_MIN;
+    static constexpr long DEFAULT_UNLOCK_SECONDS = 300;
+
+    static volatile sig_atomic_t stopRequested;
+    static int signalPipe;
+
+    // Sends job output as 'O' frames; after a failed send the rest is dropped
+    class FrameStreamBuf : public std::streambuf {
+    private:
+        int fd;
+        bool& connectionLost;
+        char buffer[OUTPUT_FRAME_SIZE];
+    public:
+        FrameStreamBuf(int fd, bool& connectionLost) : fd(fd), connectionLost(connectionLost) {
+            setp(buffer, buffer + sizeof(buffer));
+        }
+    protected:
+        int_type overflow(int_type ch) override {
+            sync();
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+        int sync() override {
+            size_t size = static_cast<size_t>(pptr() - pbase());
+            if (size && !connectionLost) connectionLost = !sendFrame(fd, 'O', pbase(), size);
+            setp(buffer, buffer + sizeof(buffer));
+            return 0;
+        }
+    };
+
+    std::string socketPath;
+    int listenFd = -1;
+    int wakePipe[2] = {-1, -1};
+    std::atomic<bool> stopping{false};
+    WalletCache recordCache;
+    UnlockedKeyStore unlockedKeys;
+
+    static bool writeAll(int fd, const void* data, size_t size, int flags) {
+        const char* p = static_cast<const char*>(data);
+        while (size) {
+            ssize_t sent = send(fd, p, size, flags | MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent <= 0) return false;
+            p += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    static bool sendFrame(int fd, char type, const char* data, size_t size) {
+        uint32_t length = static_cast<uint32_t>(size + 1);
+        uint8_t header[5] = {uint8_t(length >> 24), uint8_t(length >> 16), uint8_t(length >> 8), uint8_t(length),
+                             uint8_t(type)};
+        return writeAll(fd, header, sizeof(header), size ? MSG_MORE : 0) &&
+               (!size || writeAll(fd, data, size, 0));
+    }
+
+    static void onSignal(int) {
+        stopRequested = 1;
+        int note = WAKE_ONLY;
+        ssize_t ignored = write(signalPipe, &note, sizeof(note));
+        (void)ignored;
+    }
+
+    void openSocket() {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path too long: " + socketPath);
+        }
+        memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        struct stat info;
+        if (lstat(socketPath.c_str(), &info) == 0) {
+            if (!S_ISSOCK(info.st_mode)) {
+                throw std::runtime_error(socketPath + " exists and is not a socket");
+            }
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            bool live = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+            if (probe >= 0) close(probe);
+            if (live) throw std::runtime_error("Another daemon is already serving " + socketPath);
+            unlink(socketPath.c_str());
+        }
+
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) throw std::runtime_error(std::string("Cannot create socket: ") + strerror(errno));
+        // Jobs carry passphrases, so only the owner may connect
+        mode_t oldMask = umask(077);
+        int bound = bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        umask(oldMask);
+        if (bound < 0 || listen(listenFd, SOMAXCONN) < 0) {
+            throw std::runtime_error("Cannot listen on " + socketPath + ": " + strerror(errno));
+        }
+
+        if (pipe(wakePipe) < 0) throw std::runtime_error(std::string("Cannot create pipe: ") + strerror(errno));
+        for (int fd : wakePipe) fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+    }
+
+    void installSignalHandlers() {
+        signalPipe = wakePipe[1];
+        struct sigaction action{};
+        action.sa_handler = onSignal;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+        signal(SIGPIPE, SIG_IGN);
+    }
+
+    static uint32_t requestSize(const std::string& received) {
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(received.data());
+        return (uint32_t(header[0]) << 24) | (uint32_t(header[1]) << 16) |
+               (uint32_t(header[2]) << 8) | uint32_t(header[3]);
+    }
+
+    // Takes what the socket holds of the connection's next request without
+    // blocking, never reading past its frame: 1 once the request is complete,
+    // 0 while more is to come and -1 when the client hung up or sent garbage
+    int receiveRequest(int fd, PendingRequest& pending) {
+        size_t wanted = pending.received.size() < 4 ? 4 : 4 + size_t(requestSize(pending.received));
+        char buffer[OUTPUT_FRAME_SIZE];
+        ssize_t got = recv(fd, buffer, std::min(sizeof(buffer), wanted - pending.received.size()), MSG_DONTWAIT);
+        if (got < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        if (got <= 0) return -1;
+        if (pending.received.empty()) pending.deadline = std::chrono::steady_clock::now() + REQUEST_DEADLINE;
+        pending.received.append(buffer, static_cast<size_t>(got));
+        if (pending.received.size() < 4) return 0;
+
+        uint32_t size = requestSize(pending.received);
+        if (size == 0 || size > MAX_REQUEST_SIZE) {
+            const std::string error = "Invalid request size";
+            sendFrame(fd, 'E', error.data(), error.size());
+            return -1;
+        }
+        return pending.received.size() == 4 + size_t(size) ? 1 : 0;
+    }
+
+    // Splits a complete request frame into the job type and its fields
+    static Job parseRequest(int fd, const std::string& received) {
+        Job job;
+        job.fd = fd;
+        std::string payload = received.substr(4);
+        size_t start = 0;
+        bool first = true;
+        while (start <= payload.size()) {
+            size_t end = payload.find('\0', start);
+            if (end == std::string::npos) end = payload.size();
+            std::string field = payload.substr(start, end - start);
+            if (first) job.op = field;
+            else if (!field.empty()) {
+                size_t equals = field.find('=');
+                job.fields[field.substr(0, equals)] = equals == std::string::npos ? "" : field.substr(equals + 1);
+            }
+            first = false;
+            start = end + 1;
+        }
+        return job;
+    }
+
+    std::string field(const Job& job, const char* name) {
+        auto it = job.fields.find(name);
+        return it == job.fields.end() ? std::string() : it->second;
+    }
+
+    void runJob(const Job& job, std::ostream& out) {
+        if (job.op != "dump" && job.op != "verify" && job.op != "unlock" && job.op != "copy") {
+            throw std::runtime_error("Unknown job type: " + job.op);
+        }
+        std::string wallet = field(job, "wallet");
+        if (wallet.empty()) throw std::runtime_error("Job has no wallet");
+        std::error_code error;
+        fs::path canonical = fs::weakly_canonical(wallet, error);
+        if (!error) wallet = canonical.string();
+
+        TraceRecorder::WalletScope scope(TraceRecorder::intern(wallet));
+        TraceSpan span("job", "WalletDaemon");
+        MetricsCollector::increment("daemon_jobs");
+        WalletHealthChecker::checkWalletHealth(wallet);
+
+        WalletTool tool(out, &recordCache, &unlockedKeys);
+        std::string passphrase = field(job, "passphrase");
+        if (job.op == "dump") {
+            tool.dumpWallet(wallet, passphrase);
+        }
+        else if (job.op == "verify") {
+            tool.verifyWallet(wallet, passphrase);
+        }
+        else if (job.op == "unlock") {
+            if (passphrase.empty()) throw std::runtime_error("Unlocking needs a passphrase");
+            long seconds = DEFAULT_UNLOCK_SECONDS;
+            std::string timeout = field(job, "timeout");
+            if (!timeout.empty()) {
+                char* end = nullptr;
+                seconds = strtol(timeout.c_str(), &end, 10);
+                if (*end || seconds <= 0) throw std::runtime_error("Invalid timeout: " + timeout);
+            }
+            tool.unlockWallet(wallet, passphrase, std::chrono::seconds(seconds));
+        }
+        else {
+            std::string destination = field(job, "destination");
+            if (destination.empty()) throw std::runtime_error("Copy job has no destination");
+            tool.copyWallet(wallet, destination);
+        }
+    }
+
+    void serveJob(const Job& job) {
+        // Jobs still queued at shutdown are dropped with their connection
+        if (stopping.load()) {
+            close(job.fd);
+            return;
+        }
+
+        bool connectionLost = false;
+        std::string error;
+        {
+            FrameStreamBuf buffer(job.fd, connectionLost);
+            std::ostream out(&buffer);
+            try {
+                runJob(job, out);
+            }
+            catch (const std::exception& e) {
+                error = e.what();
+                MetricsCollector::increment("daemon_job_failures");
+            }
+            out.flush();
+        }
+        bool sent = error.empty() ? sendFrame(job.fd, 'D', nullptr, 0)
+                                  : sendFrame(job.fd, 'E', error.data(), error.size());
+
+        // Hand the connection back to the accept loop, or have it closed
+        int note = connectionLost || !sent ? ~job.fd : job.fd;
+        ssize_t ignored = write(wakePipe[1], &note, sizeof(note));
+        (void)ignored;
+    }
+
+    void shutdown(const std::map<int, PendingRequest>& idle, TaskGroup& running) {
+        stopping = true;
+        running.wait();
+        int note;
+        while (read(wakePipe[0], &note, sizeof(note)) == sizeof(note)) {
+            if (note != WAKE_ONLY) close(note >= 0 ? note : ~note);
+        }
+        for (const auto& connection : idle) close(connection.first);
+        close(listenFd);
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+        unlink(socketPath.c_str());
+    }
+
+public:
+    explicit WalletDaemon(const std::string& socketPath) : socketPath(socketPath) {}
+
+    void run() {
+        openSocket();
+        installSignalHandlers();
+        TaskGroup running;
+        std::cerr << "Serving on " << socketPath << " with " << TaskScheduler::instance().workerCount()
+                  << " workers" << std::endl;
+
+        // Connections waiting for their next request; a connection is only
+        // polled while none of its jobs is running, so replies stay in order.
+        // Requests are read here a piece at a time as they arrive, so a
+        // client that stalls mid-request holds up neither this loop nor a
+        // worker, and is dropped once its deadline passes.
+        std::map<int, PendingRequest> idle;
+        while (!stopRequested) {
+            std::vector<pollfd> fds{{listenFd, POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+            int timeout = -1;
+            auto now = std::chrono::steady_clock::now();
+            for (const auto& connection : idle) {
+                fds.push_back({connection.first, POLLIN, 0});
+                if (connection.second.received.empty()) continue;
+                auto left = std::chrono::ceil<std::chrono::milliseconds>(connection.second.deadline - now).count();
+                left = std::max<decltype(left)>(left, 0);
+                if (timeout < 0 || left < timeout) timeout = static_cast<int>(left);
+            }
+            if (poll(fds.data(), fds.size(), timeout) < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("poll failed: ") + strerror(errno));
+            }
+
+            if (fds[1].revents & POLLIN) {
+                int note;
+                while (read(wakePipe[0], &note, sizeof(note)) == sizeof(note)) {
+                    if (note == WAKE_ONLY) continue;
+                    if (note >= 0) idle[note];
+                    else close(~note);
+                }
+            }
+
+            for (size_t k = 2; k < fds.size(); k++) {
+                if (!fds[k].revents) continue;
+                int fd = fds[k].fd;
+                auto connection = idle.find(fd);
+                int state = receiveRequest(fd, connection->second);
+                if (state == 0) continue;
+                if (state > 0) {
+                    Job job = parseRequest(fd, connection->second.received);
+                    running.run([this, job] { serveJob(job); });
+                }
+                else {
+                    close(fd);
+                }
+                idle.erase(connection);
+            }
+
+            now = std::chrono::steady_clock::now();
+            for (auto it = idle.begin(); it != idle.end();) {
+                if (!it->second.received.empty() && it->second.deadline <= now) {
+                    MetricsCollector::increment("daemon_request_timeouts");
+                    close(it->first);
+                    it = idle.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+
+            if (fds[0].revents & POLLIN) {
+                int fd = accept(listenFd, nullptr, nullptr);
+                if (fd >= 0) {
+                    fcntl(fd, F_SETFD, FD_CLOEXEC);
+                    idle[fd];
+                }
+            }
+        }
+
+        std::cerr << "Shutting down" << std::endl;
+        shutdown(idle, running);
+    }
+};
+volatile sig_atomic_t WalletDaemon::stopRequested = 0;
+int WalletDaemon::signalPipe = -1;
+#endif
+
+void runDaemon(const std::string& socketPath) {
+    #ifdef _WIN32
+        (void)socketPath;
+        throw std::runtime_error("--serve is not supported on Windows");
+    #else
+        WalletDaemon daemon(socketPath);
+        daemon.run();
+    #endif
+}
+
+void runCarver(const std::string& imagePath, const std::string& outputDir) {
+    #ifdef _WIN32
+        (void)imagePath;
+        (void)outputDir;
+        throw std::runtime_error("--carve is not supported on Windows");
+    #else
+        WalletCarver carver(imagePath, outputDir, std::cout);
+        carver.run();
+    #endif
+}
+
+DiscoveryStats runDiscovery(const std::string& root,
+                            const std::function<void(const std::string&, WalletFormat::Kind)>& found) {
+    #ifdef _WIN32
+        (void)root;
+        (void)found;
+        throw std::runtime_error("--discover is not supported on Windows");
+    #else
+        WalletDiscoverer discoverer(found);
+        discoverer.run(root);
+        return {discoverer.examined(), discoverer.unreadable()};
+    #endif
+}
+
 // Main function
 int main(int argc, char* argv[]) {
+    int status = 0;
     try {
         WalletTool tool;
         tool.parseArgs(argc, argv);
         tool.execute();
-        return 0;
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
+        status = 1;
     }
+    TraceRecorder::finish();
+    return status;
 }
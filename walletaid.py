@@ -1,269 +1,373 @@
-import os.path, binascii, collections, getpass, argparse, hashlib, struct, aes
-
-# Get command-line arguments
-parser = argparse.ArgumentParser("walletaid.py",
-                                 usage="walletaid.py \"filepath\" pubkeyprefix privkeyprefix [-a address] [-c] [-h]")
-parser.add_argument("filepath", help="Path to wallet file (use \"\")")
-parser.add_argument("pubkeyprefix", help="public key prefix in hex (e.g. 00 for bitcoin)")
-parser.add_argument("privkeyprefix", help="private key prefix in hex (e.g. 80 for bitcoin)")
-parser.add_argument("-a", metavar="address", help="address to search the key for")
-parser.add_argument("-c", action="store_true", help="check if found private key really matches public key (much slower)")
-
-try:
-    args = parser.parse_args()
-except:
-    print("\n\n")
-    parser.print_help()
-    exit()
-
-wallet_filename = os.path.abspath(args.filepath)
-pubprefix = binascii.unhexlify(args.pubkeyprefix)
-privprefix = binascii.unhexlify(args.privkeyprefix)
-find_addr = args.a
-check_keys = args.c
-
-# Calculates public key from a private key
-class Point(object):
-    def __init__(self, _x, _y, _order=None): self.x, self.y, self.order = _x, _y, _order
-
-    def calc(self, top, bottom, other_x):
-        l = (top * inverse_mod(bottom)) % p
-        x3 = (l * l - self.x - other_x) % p
-        return Point(x3, (l * (self.x - x3) - self.y) % p)
-
-    def double(self):
-        if self == INFINITY: return INFINITY
-        return self.calc(3 * self.x * self.x, 2 * self.y, self.x)
-
-    def __add__(self, other):
-        if other == INFINITY: return self
-        if self == INFINITY: return other
-        if self.x == other.x:
-            if (self.y + other.y) % p == 0: return INFINITY
-            return self.double()
-        return self.calc(other.y - self.y, other.x - self.x, other.x)
-
-    def __mul__(self, e):
-        if self.order: e %= self.order
-        if e == 0 or self == INFINITY: return INFINITY
-        result, q = INFINITY, self
-        while e:
-            if e & 1: result += q
-            e, q = e >> 1, q.double()
-        return result
-
-    def __str__(self):
-        if self == INFINITY: return "infinity"
-        return "%x %x" % (self.x, self.y)
-
-
-def inverse_mod(a):
-    if a < 0 or a >= p: a = a % p
-    c, d, uc, vc, ud, vd = a, p, 1, 0, 0, 1
-    while c:
-        q, c, d = divmod(d, c) + (c,)
-        uc, vc, ud, vd = ud - q*uc, vd - q*vc, uc, vc
-    if ud > 0: return ud
-    return ud + p
-
-
-p, INFINITY = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F, Point(None, None)  # secp256k1
-g = Point(0x79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798,
-          0x483ada7726a3c4655da4fbfc0e1108a8fd17b448a68554199c47d08ffb10d4b8,
-          0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141)
-# End of code used to calculate public key
-
-
-# AES decryption functions
-def decryptkey(privkey, mk, pubkey):
-    aescbc = aes.AESModeOfOperationCBC(mk, Hash(pubkey)[:16])
-    klist = [privkey[i:i + 16] for i in range(0, len(privkey), 16)]
-    kplain = b""
-    for k in klist:
-        kplain += aescbc.decrypt(k)
-
-    return kplain
-
-
-def decryptmkey(chmk, vKeyData, vSalt, nIters):
-    data = str.encode(vKeyData, encoding="utf-8") + vSalt
-    for i in range(nIters):
-        data = hashlib.sha512(data).digest()
-    key = data[0:32]
-    iv = data[32:32 + 16]
-    aescbc = aes.AESModeOfOperationCBC(key, iv)
-
-    mklist = [chmk[i:i + 16] for i in range(0, len(chmk), 16)]
-    mkplain = b""
-    for mk in mklist:
-        mkplain += aescbc.decrypt(mk)
-
-    return mkplain
-
-
-# Base58 encoder
-alphabet = b'123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz'
-
-
-def b58encode(v):
-    '''Encode a string using Base58'''
-
-    nPad = len(v)
-    v = v.lstrip(b'\0')
-    nPad -= len(v)
-
-    p, acc = 1, 0
-    for c in reversed(v):
-        acc += p * c
-        p = p << 8
-
-    result = b""
-    while acc:
-        acc, idx = divmod(acc, 58)
-        result = alphabet[idx:idx+1] + result
-
-    return (alphabet[0:1] * nPad + result).decode("utf-8")
-
-
-# SHA-256 hashception function
-def Hash(data):
-    return hashlib.sha256(hashlib.sha256(data).digest()).digest()
-
-
-def pubtoaddr(data):
-    md = hashlib.new('ripemd160')
-    md.update(hashlib.sha256(data).digest())
-    md160 = md.digest()
-    h = Hash(pubprefix+md160)
-    addr = md160 + h[0:4]
-    return b58encode(pubprefix+addr)
-
-
-def privtopub(privkey, compressed):
-    c = int(binascii.hexlify(privkey), base=16)
-    pubkey = str(g * c)
-    pubkey = ("0" * (64 - pubkey.index(" "))) + pubkey
-    if compressed:
-        if int(pubkey[-1], base=16) % 2 == 0:
-            pref = "02"
-        else:
-            pref = "03"
-        pubkey = pubkey[0:64]
-    else:
-        pref = "04"
-        if len(pubkey) < 129:
-            zeroadd = "0" * (129-len(pubkey))
-            pubkey = pubkey[:64] + zeroadd + pubkey[64:]
-        pubkey = pubkey.replace(" ", "")
-    return binascii.unhexlify(pref + pubkey)
-
-
-def privtowif(privkey, compressed):
-    privkey = privprefix + privkey
-    if compressed:
-        privkey = privkey + b"\x01"
-    h = Hash(privkey)
-    privkey = privkey + h[0:4]
-    return b58encode(privkey)
-
-
-def keycheck(pubkey, privkey, compressed):
-    check = False
-    if pubkey == privtopub(privkey, compressed):
-        check = True
-    return check
-
-
-# Loads wallet.dat
-with open(wallet_filename, "rb") as wallet:
-    wallet_data = wallet.read()
-
-    mkey_kindex = wallet_data.find(b"\x04mkey\x01\x00\x00\x00", 0)
-    mkey_vindex = wallet_data.rfind(b"\x00\x01\x30", 0, mkey_kindex)
-    mkey = wallet_data[mkey_vindex + 2:mkey_vindex + 69]
-    masterkey = None
-
-    if mkey_kindex != -1:
-        password = getpass.getpass("Wallet is encrypted, please enter password\nPassword:")
-        encrypted_mkey, salt, method, iterations = struct.unpack_from("< 49p 9p I I", mkey)
-        masterkey = decryptmkey(encrypted_mkey, password, salt, iterations)
-
-        if masterkey[-16:] != b"\x10" * 16:
-            raise Exception("Wrong password")
-        print("Correct password!")
-        masterkey = masterkey[:-16]
-
-        kheader = b"\x04\x63\x6B\x65\x79"
-        vheader = b"\x00\x01\x30"
-        offsets = [6, 71, 3, 51]
-    else:
-        kheader = b"\x03\x6b\x65\x79"
-        vheader = b"\x02\x01\x01\x04\x20"
-        offsets = [5, 70, 5, 37]
-
-    keylist = collections.OrderedDict()
-    kindex = wallet_data.find(kheader, 0)
-    vindex = wallet_data.rfind(vheader, 0, kindex)
-
-    pub = wallet_data[kindex + offsets[0]: kindex + offsets[1]]
-    priv = wallet_data[vindex + offsets[2]: vindex + offsets[3]]
-    while True:
-        if pub[0] != b"\x04":
-            pub = pub[:33]
-        if pub not in keylist and kindex != -1:
-            keylist[pub] = priv
-
-        kindex = wallet_data.find(kheader, kindex + 6)
-        vindex = wallet_data.rfind(vheader, 0, kindex)
-
-        if kindex >= 0:
-            pub = wallet_data[kindex + offsets[0]: kindex + offsets[1]]
-            priv = wallet_data[vindex + offsets[2]: vindex + offsets[3]]
-        else:
-            break
-
-
-with open("DUMP.txt", "w") as dump:
-    klist_len = len(keylist)
-    iters = 0
-
-    for pub_key, priv_key in keylist.items():
-        iters += 1
-        procinfo = "Processing {}/{} keys".format(iters, klist_len)
-        print(procinfo, end="\r")
-
-        comp = True
-        if pub_key[0] == b"\x04":
-            comp = False
-
-        address = pubtoaddr(pub_key)
-        if find_addr:
-            if address == find_addr:
-                if masterkey:
-                    priv_key = decryptkey(priv_key, masterkey, pub_key)[:-16]
-
-                if check_keys and not keycheck(pub_key, priv_key, comp):
-                    print("Address found, but private key does not match")
-                    break
-
-                wif = privtowif(priv_key, comp)
-
-                print(" " * len(procinfo))
-                print("Found private key for {}\nWIF: {}\n\nSaved to DUMP.txt".format(address, wif))
-                dump.write("Address: {}\nWIF: {}\n\n".format(address, wif))
-                break
-            elif iters >= klist_len:
-                print("Address not found in wallet")
-        else:
-            if masterkey:
-                priv_key = decryptkey(priv_key, masterkey, pub_key)[:-16]
-
-            if check_keys and not keycheck(pub_key, priv_key, comp):
-                wif = "doesn't match address"
-            else:
-                wif = privtowif(priv_key, comp)
-
-            dump.write("Address: {}\nWIF: {}\n\n".format(address, wif))
-            if iters >= klist_len:
-                print(" " * len(procinfo))
-                print("{} private keys found\n\nsaved to DUMP.txt".format(klist_len))
+import os, os.path, binascii, collections, getpass, argparse, hashlib, struct, mmap
+
+# Native kernels (walletaid_native.cpp) are used when built; set
+# WALLETAID_NO_NATIVE=1 to force the pure-Python path
+native = None
+if not os.environ.get("WALLETAID_NO_NATIVE"):
+    try:
+        import walletaid_native as native
+    except ImportError:
+        pass
+if native is None:
+    import aes
+
+# Get command-line arguments
+parser = argparse.ArgumentParser("walletaid.py",
+                                 usage="walletaid.py \"filepath\" pubkeyprefix privkeyprefix [-a address] [-s prefix] [-b hrp] [-c] [-h]")
+parser.add_argument("filepath", help="Path to wallet file (use \"\")")
+parser.add_argument("pubkeyprefix", help="public key prefix in hex (e.g. 00 for bitcoin), or several "
+                                         "comma-separated (00,6f) for one P2PKH address each")
+parser.add_argument("privkeyprefix", help="private key prefix in hex (e.g. 80 for bitcoin)")
+parser.add_argument("-a", metavar="address", help="address to search the key for")
+parser.add_argument("-s", metavar="prefix", help="also P2SH-P2WPKH addresses, for these comma-separated script "
+                                                "prefixes in hex (e.g. 05 for bitcoin)")
+parser.add_argument("-b", metavar="hrp", help="also Bech32 P2WPKH addresses, for these comma-separated "
+                                             "human-readable parts (e.g. bc for bitcoin)")
+parser.add_argument("-c", action="store_true", help="check if found private key really matches public key (much slower)")
+
+try:
+    args = parser.parse_args()
+except:
+    print("\n\n")
+    parser.print_help()
+    exit()
+
+wallet_filename = os.path.abspath(args.filepath)
+pubprefixes = [binascii.unhexlify(prefix) for prefix in args.pubkeyprefix.split(",")]
+scriptprefixes = [binascii.unhexlify(prefix) for prefix in args.s.split(",")] if args.s else []
+hrps = args.b.lower().split(",") if args.b else []
+if any(not hrp or len(hrp) > 50 or any(ord(c) < 33 or ord(c) > 126 for c in hrp) for hrp in hrps):
+    parser.error("a human-readable part is 1 to 50 printable characters")
+privprefix = binascii.unhexlify(args.privkeyprefix)
+find_addr = args.a
+check_keys = args.c
+
+# Calculates public key from a private key
+class Point(object):
+    def __init__(self, _x, _y, _order=None): self.x, self.y, self.order = _x, _y, _order
+
+    def calc(self, top, bottom, other_x):
+        l = (top * inverse_mod(bottom)) % p
+        x3 = (l * l - self.x - other_x) % p
+        return Point(x3, (l * (self.x - x3) - self.y) % p)
+
+    def double(self):
+        if self == INFINITY: return INFINITY
+        return self.calc(3 * self.x * self.x, 2 * self.y, self.x)
+
+    def __add__(self, other):
+        if other == INFINITY: return self
+        if self == INFINITY: return other
+        if self.x == other.x:
+            if (self.y + other.y) % p == 0: return INFINITY
+            return self.double()
+        return self.calc(other.y - self.y, other.x - self.x, other.x)
+
+    def __mul__(self, e):
+        if self.order: e %= self.order
+        if e == 0 or self == INFINITY: return INFINITY
+        result, q = INFINITY, self
+        while e:
+            if e & 1: result += q
+            e, q = e >> 1, q.double()
+        return result
+
+    def __str__(self):
+        if self == INFINITY: return "infinity"
+        return "%x %x" % (self.x, self.y)
+
+
+def inverse_mod(a):
+    if a < 0 or a >= p: a = a % p
+    c, d, uc, vc, ud, vd = a, p, 1, 0, 0, 1
+    while c:
+        q, c, d = divmod(d, c) + (c,)
+        uc, vc, ud, vd = ud - q*uc, vd - q*vc, uc, vc
+    if ud > 0: return ud
+    return ud + p
+
+
+p, INFINITY = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F, Point(None, None)  # secp256k1
+g = Point(0x79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798,
+          0x483ada7726a3c4655da4fbfc0e1108a8fd17b448a68554199c47d08ffb10d4b8,
+          0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141)
+# End of code used to calculate public key
+
+
+# AES decryption functions
+def decryptkey(privkey, mk, pubkey):
+    aescbc = aes.AESModeOfOperationCBC(mk, Hash(pubkey)[:16])
+    klist = [privkey[i:i + 16] for i in range(0, len(privkey), 16)]
+    kplain = b""
+    for k in klist:
+        kplain += aescbc.decrypt(k)
+
+    return kplain
+
+
+def decryptmkey(chmk, vKeyData, vSalt, nIters):
+    if native:
+        return native.decrypt_master_key(chmk, vKeyData, vSalt, nIters)
+    data = str.encode(vKeyData, encoding="utf-8") + vSalt
+    for i in range(nIters):
+        data = hashlib.sha512(data).digest()
+    key = data[0:32]
+    iv = data[32:32 + 16]
+    aescbc = aes.AESModeOfOperationCBC(key, iv)
+
+    mklist = [chmk[i:i + 16] for i in range(0, len(chmk), 16)]
+    mkplain = b""
+    for mk in mklist:
+        mkplain += aescbc.decrypt(mk)
+
+    return mkplain
+
+
+# Base58 encoder
+alphabet = b'123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz'
+
+
+def b58encode(v):
+    '''Encode a string using Base58'''
+
+    nPad = len(v)
+    v = v.lstrip(b'\0')
+    nPad -= len(v)
+
+    p, acc = 1, 0
+    for c in reversed(v):
+        acc += p * c
+        p = p << 8
+
+    result = b""
+    while acc:
+        acc, idx = divmod(acc, 58)
+        result = alphabet[idx:idx+1] + result
+
+    return (alphabet[0:1] * nPad + result).decode("utf-8")
+
+
+# SHA-256 hashception function
+def Hash(data):
+    return hashlib.sha256(hashlib.sha256(data).digest()).digest()
+
+
+def hash160(data):
+    md = hashlib.new('ripemd160')
+    md.update(hashlib.sha256(data).digest())
+    return md.digest()
+
+
+def b58check(prefix, payload):
+    h = Hash(prefix + payload)
+    return b58encode(prefix + payload + h[0:4])
+
+
+# Bech32 encoder (BIP 173)
+charset = "qpzry9x8gf2tvdw0s3jn54khce6mua7l"
+
+
+def bech32_polymod(values):
+    generator = [0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd, 0x2a1462b3]
+    chk = 1
+    for value in values:
+        top = chk >> 25
+        chk = (chk & 0x1ffffff) << 5 ^ value
+        for i in range(5):
+            chk ^= generator[i] if ((top >> i) & 1) else 0
+    return chk
+
+
+def segwitaddr(hrp, program):
+    data, acc, bits = [0], 0, 0
+    for byte in program:
+        acc, bits = (acc << 8) | byte, bits + 8
+        while bits >= 5:
+            bits -= 5
+            data.append((acc >> bits) & 31)
+    if bits:
+        data.append((acc << (5 - bits)) & 31)
+    expanded = [ord(c) >> 5 for c in hrp] + [0] + [ord(c) & 31 for c in hrp]
+    chk = bech32_polymod(expanded + data + [0] * 6) ^ 1
+    return hrp + "1" + "".join(charset[d] for d in data + [(chk >> 5 * (5 - i)) & 31 for i in range(6)])
+
+
+def pubtoaddrs(data):
+    """Every requested address of a public key, from one hash160: P2PKH per
+    prefix, then P2SH-P2WPKH per prefix, then P2WPKH per hrp. Segwit
+    addresses need a compressed key and are empty for any other."""
+    md160 = hash160(data)
+    addresses = [b58check(prefix, md160) for prefix in pubprefixes]
+    segwit = len(data) == 33
+    scripthash = hash160(b"\x00\x14" + md160) if segwit and scriptprefixes else None
+    addresses += [b58check(prefix, scripthash) if segwit else "" for prefix in scriptprefixes]
+    addresses += [segwitaddr(hrp, md160) if segwit else "" for hrp in hrps]
+    return addresses
+
+
+def privtopub(privkey, compressed):
+    c = int(binascii.hexlify(privkey), base=16)
+    pubkey = str(g * c)
+    pubkey = ("0" * (64 - pubkey.index(" "))) + pubkey
+    if compressed:
+        if int(pubkey[-1], base=16) % 2 == 0:
+            pref = "02"
+        else:
+            pref = "03"
+        pubkey = pubkey[0:64]
+    else:
+        pref = "04"
+        if len(pubkey) < 129:
+            zeroadd = "0" * (129-len(pubkey))
+            pubkey = pubkey[:64] + zeroadd + pubkey[64:]
+        pubkey = pubkey.replace(" ", "")
+    return binascii.unhexlify(pref + pubkey)
+
+
+def privtowif(privkey, compressed):
+    privkey = privprefix + privkey
+    if compressed:
+        privkey = privkey + b"\x01"
+    h = Hash(privkey)
+    privkey = privkey + h[0:4]
+    return b58encode(privkey)
+
+
+def keycheck(pubkey, privkey, compressed):
+    check = False
+    if pubkey == privtopub(privkey, compressed):
+        check = True
+    return check
+
+
+# Loads wallet.dat
+with open(wallet_filename, "rb") as wallet:
+    if native:
+        wallet_data = mmap.mmap(wallet.fileno(), 0, access=mmap.ACCESS_READ)
+    else:
+        wallet_data = wallet.read()
+
+    mkey_kindex = wallet_data.find(b"\x04mkey\x01\x00\x00\x00", 0)
+    mkey_vindex = wallet_data.rfind(b"\x00\x01\x30", 0, mkey_kindex)
+    mkey = wallet_data[mkey_vindex + 2:mkey_vindex + 69]
+    masterkey = None
+
+    if mkey_kindex != -1:
+        password = getpass.getpass("Wallet is encrypted, please enter password\nPassword:")
+        encrypted_mkey, salt, method, iterations = struct.unpack_from("< 49p 9p I I", mkey)
+        masterkey = decryptmkey(encrypted_mkey, password, salt, iterations)
+
+        if masterkey[-16:] != b"\x10" * 16:
+            raise Exception("Wrong password")
+        print("Correct password!")
+        masterkey = masterkey[:-16]
+
+        kheader = b"\x04\x63\x6B\x65\x79"
+        vheader = b"\x00\x01\x30"
+        offsets = [6, 71, 3, 51]
+    else:
+        kheader = b"\x03\x6b\x65\x79"
+        vheader = b"\x02\x01\x01\x04\x20"
+        offsets = [5, 70, 5, 37]
+
+    keylist = collections.OrderedDict()
+    if native:
+        for pub, priv in native.scan_records(wallet_data, kheader, vheader, offsets):
+            if pub[0] != b"\x04":
+                pub = pub[:33]
+            if pub not in keylist:
+                keylist[pub] = priv
+    else:
+        kindex = wallet_data.find(kheader, 0)
+        vindex = wallet_data.rfind(vheader, 0, kindex)
+
+        pub = wallet_data[kindex + offsets[0]: kindex + offsets[1]]
+        priv = wallet_data[vindex + offsets[2]: vindex + offsets[3]]
+        while True:
+            if pub[0] != b"\x04":
+                pub = pub[:33]
+            if pub not in keylist and kindex != -1:
+                keylist[pub] = priv
+
+            kindex = wallet_data.find(kheader, kindex + 6)
+            vindex = wallet_data.rfind(vheader, 0, kindex)
+
+            if kindex >= 0:
+                pub = wallet_data[kindex + offsets[0]: kindex + offsets[1]]
+                priv = wallet_data[vindex + offsets[2]: vindex + offsets[3]]
+            else:
+                break
+
+
+# With the native module every address, and every key the loop below will
+# use, is decrypted, checked and encoded in a few batch calls up front
+addresses, prepared = None, {}
+if native:
+    pub_keys = list(keylist)
+    compressed = [pub_key[0] != b"\x04" for pub_key in pub_keys]
+    addresses = native.encode_address_sets_batch(pub_keys, pubprefixes, scriptprefixes, hrps)
+    if find_addr:
+        selected = [i for i, key_addresses in enumerate(addresses) if find_addr in key_addresses][:1]
+    else:
+        selected = range(len(pub_keys))
+    sel_pubs = [pub_keys[i] for i in selected]
+    sel_comps = [compressed[i] for i in selected]
+    sel_privs = [keylist[pub_key] for pub_key in sel_pubs]
+    if masterkey:
+        sel_privs = [k[:-16] for k in native.decrypt_keys_batch(masterkey, sel_privs, sel_pubs)]
+    sel_wifs = native.encode_wifs_batch(sel_privs, privprefix, sel_comps)
+    if check_keys:
+        derived = native.derive_public_keys_batch(sel_privs, sel_comps)
+        sel_matches = [pub == pub_key for pub, pub_key in zip(derived, sel_pubs)]
+    else:
+        sel_matches = [True] * len(sel_pubs)
+    prepared = dict(zip(sel_pubs, zip(sel_wifs, sel_matches)))
+
+
+def processkey(pub_key, priv_key, comp):
+    """Returns the WIF of a key and whether it matches its public key"""
+    if native:
+        return prepared[pub_key]
+    if masterkey:
+        priv_key = decryptkey(priv_key, masterkey, pub_key)[:-16]
+    matches = not check_keys or keycheck(pub_key, priv_key, comp)
+    return privtowif(priv_key, comp), matches
+
+
+with open("DUMP.txt", "w") as dump:
+    klist_len = len(keylist)
+    iters = 0
+
+    for pub_key, priv_key in keylist.items():
+        iters += 1
+        procinfo = "Processing {}/{} keys".format(iters, klist_len)
+        print(procinfo, end="\r")
+
+        comp = True
+        if pub_key[0] == b"\x04":
+            comp = False
+
+        key_addresses = [a for a in (addresses[iters - 1] if native else pubtoaddrs(pub_key)) if a]
+        address_lines = "".join("Address: {}\n".format(address) for address in key_addresses)
+        if find_addr:
+            if find_addr in key_addresses:
+                wif, matches = processkey(pub_key, priv_key, comp)
+                if not matches:
+                    print("Address found, but private key does not match")
+                    break
+
+                print(" " * len(procinfo))
+                print("Found private key for {}\nWIF: {}\n\nSaved to DUMP.txt".format(find_addr, wif))
+                dump.write("{}WIF: {}\n\n".format(address_lines, wif))
+                break
+            elif iters >= klist_len:
+                print("Address not found in wallet")
+        else:
+            wif, matches = processkey(pub_key, priv_key, comp)
+            if not matches:
+                wif = "doesn't match address"
+
+            dump.write("{}WIF: {}\n\n".format(address_lines, wif))
+            if iters >= klist_len:
+                print(" " * len(procinfo))
+                print("{} private keys found\n\nsaved to DUMP.txt".format(klist_len))
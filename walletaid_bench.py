@@ -0,0 +1,67 @@
+# Parity and speed check for the walletaid_native module: runs walletaid.py
+# once on the pure-Python path and once on the native path, compares the two
+# DUMP.txt files and reports the timings.
+#
+# python3 walletaid_bench.py "wallet.dat" pubkeyprefix privkeyprefix [-p password] [-s prefix] [-b hrp] [-c]
+import os, os.path, sys, argparse, shutil, subprocess, tempfile, time
+
+parser = argparse.ArgumentParser("walletaid_bench.py")
+parser.add_argument("filepath", help="Path to wallet file (use \"\")")
+parser.add_argument("pubkeyprefix", help="public key prefix in hex (e.g. 00 for bitcoin)")
+parser.add_argument("privkeyprefix", help="private key prefix in hex (e.g. 80 for bitcoin)")
+parser.add_argument("-p", metavar="password", default="", help="wallet password, if encrypted")
+parser.add_argument("-s", metavar="prefix", help="also P2SH-P2WPKH addresses for these script prefixes")
+parser.add_argument("-b", metavar="hrp", help="also Bech32 P2WPKH addresses for these human-readable parts")
+parser.add_argument("-c", action="store_true", help="also check private keys against public keys")
+args = parser.parse_args()
+
+here = os.path.dirname(os.path.abspath(__file__))
+script = os.path.join(here, "walletaid.py")
+wallet = os.path.abspath(args.filepath)
+
+
+def run(pure):
+    env = dict(os.environ)
+    env["PYTHONPATH"] = os.pathsep.join(filter(None, [here, env.get("PYTHONPATH")]))
+    if pure:
+        env["WALLETAID_NO_NATIVE"] = "1"
+    else:
+        env.pop("WALLETAID_NO_NATIVE", None)
+    cmd = [sys.executable, script, wallet, args.pubkeyprefix, args.privkeyprefix]
+    if args.s:
+        cmd += ["-s", args.s]
+    if args.b:
+        cmd += ["-b", args.b]
+    if args.c:
+        cmd.append("-c")
+
+    workdir = tempfile.mkdtemp(prefix="walletaid-")
+    try:
+        # No controlling terminal, so getpass falls back to reading stdin
+        start = time.perf_counter()
+        proc = subprocess.run(cmd, cwd=workdir, env=env, input=(args.p + "\n").encode(),
+                              stdout=subprocess.PIPE, stderr=subprocess.PIPE, start_new_session=True)
+        elapsed = time.perf_counter() - start
+        if proc.returncode != 0:
+            sys.exit("{} run failed:\n{}".format("Pure" if pure else "Native", proc.stderr.decode()))
+        with open(os.path.join(workdir, "DUMP.txt")) as dump:
+            return dump.read(), elapsed
+    finally:
+        shutil.rmtree(workdir)
+
+
+try:
+    import walletaid_native
+except ImportError:
+    sys.exit("walletaid_native is not built, see README")
+
+pure_dump, pure_time = run(True)
+native_dump, native_time = run(False)
+keys = pure_dump.count("WIF: ")
+
+print("Pure Python: {:.3f}s".format(pure_time))
+print("Native:      {:.3f}s".format(native_time))
+print("Speedup:     {:.1f}x".format(pure_time / native_time if native_time else float("inf")))
+if pure_dump != native_dump:
+    sys.exit("DUMP.txt differs between the pure and native runs")
+print("DUMP.txt identical ({} keys)".format(keys))
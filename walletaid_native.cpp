@@ -0,0 +1,529 @@
+// MIT License. Copyright (c) 2025 Benedict Hensley Aldridge.
+//See LICENSE for details.
+
+// Native kernels for walletaid.py: record scanning, master key derivation,
+// batch key decryption and Base58 and Bech32 encoding on top of
+// wallet-crypto.h. The batch functions copy their inputs and release the GIL
+// while they run.
+// walletaid.py uses this module automatically when it can be imported.
+//
+// Build (see README):
+//   g++ -std=c++17 -O2 -shared -fPIC $(python3-config --includes) walletaid_native.cpp
+//       -o walletaid_native$(python3-config --extension-suffix)
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "wallet-crypto.h"
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+// Holds a buffer-protocol view (bytes, bytearray, mmap) for one call
+class BufferView {
+private:
+    Py_buffer view;
+    bool held = false;
+public:
+    bool acquire(PyObject* object) {
+        held = PyObject_GetBuffer(object, &view, PyBUF_SIMPLE) == 0;
+        return held;
+    }
+    ~BufferView() {
+        if (held) PyBuffer_Release(&view);
+    }
+    const uint8_t* data() const { return static_cast<const uint8_t*>(view.buf); }
+    size_t size() const { return static_cast<size_t>(view.len); }
+};
+
+bool toBytes(PyObject* object, Bytes& out) {
+    BufferView view;
+    if (!view.acquire(object)) return false;
+    out.assign(view.data(), view.data() + view.size());
+    return true;
+}
+
+// Copies every item of a sequence of bytes-like objects
+bool toBytesList(PyObject* sequence, std::vector<Bytes>& out, const char* what) {
+    PyObject* fast = PySequence_Fast(sequence, what);
+    if (!fast) return false;
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(fast);
+    out.resize(static_cast<size_t>(count));
+    for (Py_ssize_t i = 0; i < count; i++) {
+        if (!toBytes(PySequence_Fast_GET_ITEM(fast, i), out[i])) {
+            Py_DECREF(fast);
+            return false;
+        }
+    }
+    Py_DECREF(fast);
+    return true;
+}
+
+bool toStringList(PyObject* sequence, std::vector<std::string>& out, const char* what) {
+    PyObject* fast = PySequence_Fast(sequence, what);
+    if (!fast) return false;
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(fast);
+    out.resize(static_cast<size_t>(count));
+    for (Py_ssize_t i = 0; i < count; i++) {
+        Py_ssize_t length;
+        const char* text = PyUnicode_AsUTF8AndSize(PySequence_Fast_GET_ITEM(fast, i), &length);
+        if (!text) {
+            Py_DECREF(fast);
+            return false;
+        }
+        out[i].assign(text, static_cast<size_t>(length));
+    }
+    Py_DECREF(fast);
+    return true;
+}
+
+bool toFlagList(PyObject* sequence, size_t expected, std::vector<bool>& out) {
+    PyObject* fast = PySequence_Fast(sequence, "compressed flags must be a sequence");
+    if (!fast) return false;
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(fast);
+    if (static_cast<size_t>(count) != expected) {
+        Py_DECREF(fast);
+        PyErr_SetString(PyExc_ValueError, "one compressed flag is needed per key");
+        return false;
+    }
+    out.resize(expected);
+    for (Py_ssize_t i = 0; i < count; i++) {
+        int flag = PyObject_IsTrue(PySequence_Fast_GET_ITEM(fast, i));
+        if (flag < 0) {
+            Py_DECREF(fast);
+            return false;
+        }
+        out[i] = flag != 0;
+    }
+    Py_DECREF(fast);
+    return true;
+}
+
+PyObject* bytesObject(const uint8_t* data, size_t size) {
+    return PyBytes_FromStringAndSize(reinterpret_cast<const char*>(data), static_cast<Py_ssize_t>(size));
+}
+
+PyObject* bytesObject(const Bytes& data) { return bytesObject(data.data(), data.size()); }
+
+// Python's data[start:stop] for a sequence of the given length
+void pySlice(Py_ssize_t length, Py_ssize_t& start, Py_ssize_t& stop) {
+    auto clamp = [length](Py_ssize_t index) {
+        if (index < 0) index += length;
+        return index < 0 ? Py_ssize_t(0) : (index > length ? length : index);
+    };
+    start = clamp(start);
+    stop = clamp(stop);
+    if (stop < start) stop = start;
+}
+
+Py_ssize_t find(const uint8_t* data, Py_ssize_t size, const Bytes& needle, Py_ssize_t from) {
+    Py_ssize_t n = static_cast<Py_ssize_t>(needle.size());
+    if (from < 0) from = 0;
+    if (n == 0) return from <= size ? from : -1;
+    for (Py_ssize_t i = from; i + n <= size; i++) {
+        const void* hit = memchr(data + i, needle[0], static_cast<size_t>(size - n - i + 1));
+        if (!hit) return -1;
+        i = static_cast<const uint8_t*>(hit) - data;
+        if (memcmp(data + i, needle.data(), static_cast<size_t>(n)) == 0) return i;
+    }
+    return -1;
+}
+
+// bytes.rfind(needle, 0, end)
+Py_ssize_t rfind(const uint8_t* data, Py_ssize_t size, const Bytes& needle, Py_ssize_t end) {
+    Py_ssize_t n = static_cast<Py_ssize_t>(needle.size());
+    if (end < 0) end += size;
+    if (end < 0) return -1;
+    if (end > size) end = size;
+    for (Py_ssize_t i = end - n; i >= 0; i--) {
+        if (data[i] == needle[0] && memcmp(data + i, needle.data(), static_cast<size_t>(n)) == 0) return i;
+    }
+    return -1;
+}
+
+// scan_records(data, kheader, vheader, offsets) -> [(pub, priv), ...]
+//
+// Mirrors walletaid.py's find/rfind loop: every kheader match k from the
+// start of the file, stepping 6 bytes past each, with the closest vheader
+// v before it; pub = data[k+o0:k+o1], priv = data[v+o2:v+o3].
+PyObject* scanRecords(PyObject*, PyObject* args) {
+    PyObject* dataObject;
+    PyObject* kheaderObject;
+    PyObject* vheaderObject;
+    Py_ssize_t offsets[4];
+    if (!PyArg_ParseTuple(args, "OOO(nnnn):scan_records", &dataObject, &kheaderObject, &vheaderObject,
+                          &offsets[0], &offsets[1], &offsets[2], &offsets[3])) {
+        return nullptr;
+    }
+    Bytes kheader, vheader;
+    if (!toBytes(kheaderObject, kheader) || !toBytes(vheaderObject, vheader)) return nullptr;
+    if (kheader.empty() || vheader.empty()) {
+        PyErr_SetString(PyExc_ValueError, "headers must not be empty");
+        return nullptr;
+    }
+    BufferView wallet;
+    if (!wallet.acquire(dataObject)) return nullptr;
+    const uint8_t* data = wallet.data();
+    Py_ssize_t size = static_cast<Py_ssize_t>(wallet.size());
+
+    std::vector<std::pair<Py_ssize_t, Py_ssize_t>> hits;
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t k = find(data, size, kheader, 0); k >= 0; k = find(data, size, kheader, k + 6)) {
+        hits.emplace_back(k, rfind(data, size, vheader, k));
+    }
+    Py_END_ALLOW_THREADS
+
+    PyObject* result = PyList_New(static_cast<Py_ssize_t>(hits.size()));
+    if (!result) return nullptr;
+    for (size_t i = 0; i < hits.size(); i++) {
+        Py_ssize_t pubStart = hits[i].first + offsets[0], pubStop = hits[i].first + offsets[1];
+        Py_ssize_t privStart = hits[i].second + offsets[2], privStop = hits[i].second + offsets[3];
+        pySlice(size, pubStart, pubStop);
+        pySlice(size, privStart, privStop);
+        PyObject* pair = Py_BuildValue("(y#y#)", data + pubStart, pubStop - pubStart,
+                                       data + privStart, privStop - privStart);
+        if (!pair) {
+            Py_DECREF(result);
+            return nullptr;
+        }
+        PyList_SET_ITEM(result, static_cast<Py_ssize_t>(i), pair);
+    }
+    return result;
+}
+
+bool checkBlocks(const Bytes& data, const char* what) {
+    if (data.size() % Aes256::BLOCK_SIZE == 0) return true;
+    PyErr_Format(PyExc_ValueError, "%s must be a multiple of 16 bytes", what);
+    return false;
+}
+
+// decrypt_master_key(crypted, passphrase, salt, iterations) -> bytes
+//
+// EVP_BytesToKey(SHA-512) and AES-256-CBC without removing the padding, as
+// decryptmkey() returns it.
+PyObject* decryptMasterKey(PyObject*, PyObject* args) {
+    PyObject* cryptedObject;
+    PyObject* passphraseObject;
+    PyObject* saltObject;
+    unsigned long iterations;
+    if (!PyArg_ParseTuple(args, "OOOk:decrypt_master_key", &cryptedObject, &passphraseObject, &saltObject,
+                          &iterations)) {
+        return nullptr;
+    }
+    Bytes crypted, passphrase, salt;
+    if (PyUnicode_Check(passphraseObject)) {
+        Py_ssize_t length;
+        const char* text = PyUnicode_AsUTF8AndSize(passphraseObject, &length);
+        if (!text) return nullptr;
+        passphrase.assign(text, text + length);
+    }
+    else if (!toBytes(passphraseObject, passphrase)) return nullptr;
+    if (!toBytes(cryptedObject, crypted) || !toBytes(saltObject, salt)) return nullptr;
+    if (!checkBlocks(crypted, "crypted key")) return nullptr;
+
+    Bytes plain(crypted.size());
+    Py_BEGIN_ALLOW_THREADS
+    uint8_t key[Aes256::KEY_SIZE];
+    uint8_t iv[Aes256::BLOCK_SIZE];
+    // deriveKey counts the first hash as an iteration, like decryptmkey's loop
+    WalletCrypto::deriveKey(passphrase.data(), passphrase.size(), salt.data(), salt.size(),
+                            static_cast<uint32_t>(iterations), key, iv);
+    Aes256(key).cbcDecrypt(iv, crypted.data(), plain.data(), crypted.size());
+    volatile uint8_t* wipe = key;
+    for (size_t i = 0; i < sizeof(key); i++) wipe[i] = 0;
+    Py_END_ALLOW_THREADS
+    return bytesObject(plain);
+}
+
+// decrypt_keys_batch(master_key, crypted_keys, pubkeys) -> [bytes, ...]
+//
+// Each key is decrypted with IV = SHA256d(pubkey)[:16], padding included,
+// as decryptkey() returns it.
+PyObject* decryptKeysBatch(PyObject*, PyObject* args) {
+    PyObject* masterObject;
+    PyObject* cryptedObject;
+    PyObject* pubkeysObject;
+    if (!PyArg_ParseTuple(args, "OOO:decrypt_keys_batch", &masterObject, &cryptedObject, &pubkeysObject)) {
+        return nullptr;
+    }
+    Bytes master;
+    std::vector<Bytes> crypted, pubkeys;
+    if (!toBytes(masterObject, master) || !toBytesList(cryptedObject, crypted, "crypted keys must be a sequence") ||
+        !toBytesList(pubkeysObject, pubkeys, "pubkeys must be a sequence")) {
+        return nullptr;
+    }
+    if (master.size() != Aes256::KEY_SIZE) {
+        PyErr_SetString(PyExc_ValueError, "master key must be 32 bytes");
+        return nullptr;
+    }
+    if (crypted.size() != pubkeys.size()) {
+        PyErr_SetString(PyExc_ValueError, "one pubkey is needed per crypted key");
+        return nullptr;
+    }
+    for (const auto& key : crypted) {
+        if (!checkBlocks(key, "crypted keys")) return nullptr;
+    }
+
+    std::vector<Bytes> plain(crypted.size());
+    Py_BEGIN_ALLOW_THREADS
+    Aes256 cipher(master.data());
+    for (size_t i = 0; i < crypted.size(); i++) {
+        uint8_t iv[Aes256::BLOCK_SIZE];
+        WalletCrypto::keyIV(pubkeys[i].data(), pubkeys[i].size(), iv);
+        plain[i].resize(crypted[i].size());
+        cipher.cbcDecrypt(iv, crypted[i].data(), plain[i].data(), crypted[i].size());
+    }
+    Py_END_ALLOW_THREADS
+
+    PyObject* result = PyList_New(static_cast<Py_ssize_t>(plain.size()));
+    if (!result) return nullptr;
+    for (size_t i = 0; i < plain.size(); i++) {
+        PyObject* item = bytesObject(plain[i]);
+        if (!item) {
+            Py_DECREF(result);
+            return nullptr;
+        }
+        PyList_SET_ITEM(result, static_cast<Py_ssize_t>(i), item);
+    }
+    return result;
+}
+
+PyObject* stringList(const std::vector<std::string>& strings) {
+    PyObject* result = PyList_New(static_cast<Py_ssize_t>(strings.size()));
+    if (!result) return nullptr;
+    for (size_t i = 0; i < strings.size(); i++) {
+        PyObject* item = PyUnicode_FromStringAndSize(strings[i].data(), static_cast<Py_ssize_t>(strings[i].size()));
+        if (!item) {
+            Py_DECREF(result);
+            return nullptr;
+        }
+        PyList_SET_ITEM(result, static_cast<Py_ssize_t>(i), item);
+    }
+    return result;
+}
+
+// Base58Check of prefix + payload (+ suffix), or an empty string if the
+// payload does not fit the encoder
+std::string encodeCheck(const Bytes& prefix, const uint8_t* payload, size_t size, bool suffix01) {
+    uint8_t buffer[92];
+    size_t length = prefix.size() + size + (suffix01 ? 1 : 0);
+    if (length > sizeof(buffer)) return std::string();
+    memcpy(buffer, prefix.data(), prefix.size());
+    memcpy(buffer + prefix.size(), payload, size);
+    if (suffix01) buffer[length - 1] = 0x01;
+    char out[Base58::MAX_ENCODED * 2];
+    size_t n = Base58::encodeCheck(buffer, length, out, sizeof(out));
+    volatile uint8_t* wipe = buffer;
+    for (size_t i = 0; i < sizeof(buffer); i++) wipe[i] = 0;
+    return std::string(out, n);
+}
+
+// encode_addresses_batch(pubkeys, prefix) -> [str, ...]   (pubtoaddr)
+PyObject* encodeAddressesBatch(PyObject*, PyObject* args) {
+    PyObject* pubkeysObject;
+    PyObject* prefixObject;
+    if (!PyArg_ParseTuple(args, "OO:encode_addresses_batch", &pubkeysObject, &prefixObject)) return nullptr;
+    Bytes prefix;
+    std::vector<Bytes> pubkeys;
+    if (!toBytes(prefixObject, prefix) || !toBytesList(pubkeysObject, pubkeys, "pubkeys must be a sequence")) {
+        return nullptr;
+    }
+    std::vector<std::string> addresses(pubkeys.size());
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i = 0; i < pubkeys.size(); i++) {
+        uint8_t hash[Ripemd160::OUTPUT_SIZE];
+        Ripemd160::hash160(pubkeys[i].data(), pubkeys[i].size(), hash);
+        addresses[i] = encodeCheck(prefix, hash, sizeof(hash), false);
+    }
+    Py_END_ALLOW_THREADS
+    return stringList(addresses);
+}
+
+// encode_address_sets_batch(pubkeys, p2pkh_prefixes, p2sh_prefixes, hrps)
+//     -> [[str, ...], ...]
+//
+// Every address of every key, from one hash160 per key: P2PKH under each
+// prefix, then P2SH-P2WPKH under each prefix, then P2WPKH under each
+// human-readable part. Segwit addresses need a compressed key; for any
+// other key they are empty strings. The Bech32 addresses of one hrp are
+// encoded in a single batch, their checksums computed in lanes.
+PyObject* encodeAddressSetsBatch(PyObject*, PyObject* args) {
+    PyObject* pubkeysObject;
+    PyObject* p2pkhObject;
+    PyObject* p2shObject;
+    PyObject* hrpsObject;
+    if (!PyArg_ParseTuple(args, "OOOO:encode_address_sets_batch", &pubkeysObject, &p2pkhObject, &p2shObject,
+                          &hrpsObject)) {
+        return nullptr;
+    }
+    std::vector<Bytes> pubkeys, p2pkhPrefixes, p2shPrefixes;
+    std::vector<std::string> hrps;
+    if (!toBytesList(pubkeysObject, pubkeys, "pubkeys must be a sequence") ||
+        !toBytesList(p2pkhObject, p2pkhPrefixes, "P2PKH prefixes must be a sequence") ||
+        !toBytesList(p2shObject, p2shPrefixes, "P2SH prefixes must be a sequence") ||
+        !toStringList(hrpsObject, hrps, "hrps must be a sequence of str")) {
+        return nullptr;
+    }
+    for (const auto& hrp : hrps) {
+        bool printable = std::all_of(hrp.begin(), hrp.end(), [](char c) { return c >= 33 && c <= 126 && !isupper(c); });
+        if (hrp.empty() || hrp.size() + 1 + 33 + 6 > Bech32::MAX_LENGTH || !printable) {
+            PyErr_SetString(PyExc_ValueError, "hrp must be 1 to 50 printable lowercase characters");
+            return nullptr;
+        }
+    }
+
+    constexpr size_t HASH_SIZE = Ripemd160::OUTPUT_SIZE;
+    const size_t perKey = p2pkhPrefixes.size() + p2shPrefixes.size() + hrps.size();
+    std::vector<std::string> addresses(pubkeys.size() * perKey);
+    Py_BEGIN_ALLOW_THREADS
+    // hash160 once per key; the compressed keys' hashes are also packed
+    // together as the witness programs
+    std::vector<uint8_t> hashes(pubkeys.size() * HASH_SIZE), programs;
+    std::vector<size_t> segwit;
+    for (size_t i = 0; i < pubkeys.size(); i++) {
+        uint8_t* hash = &hashes[i * HASH_SIZE];
+        Ripemd160::hash160(pubkeys[i].data(), pubkeys[i].size(), hash);
+        if (pubkeys[i].size() == Secp256k1::COMPRESSED_SIZE) {
+            segwit.push_back(i);
+            programs.insert(programs.end(), hash, hash + HASH_SIZE);
+        }
+    }
+    for (size_t i = 0; i < pubkeys.size(); i++) {
+        for (size_t p = 0; p < p2pkhPrefixes.size(); p++) {
+            addresses[i * perKey + p] = encodeCheck(p2pkhPrefixes[p], &hashes[i * HASH_SIZE], HASH_SIZE, false);
+        }
+    }
+    if (!p2shPrefixes.empty()) {
+        for (size_t i : segwit) {
+            // The redeem script is OP_0 <20-byte key hash>
+            uint8_t script[2 + HASH_SIZE] = {0x00, 0x14};
+            memcpy(script + 2, &hashes[i * HASH_SIZE], HASH_SIZE);
+            uint8_t scriptHash[HASH_SIZE];
+            Ripemd160::hash160(script, sizeof(script), scriptHash);
+            for (size_t p = 0; p < p2shPrefixes.size(); p++) {
+                addresses[i * perKey + p2pkhPrefixes.size() + p] =
+                    encodeCheck(p2shPrefixes[p], scriptHash, HASH_SIZE, false);
+            }
+        }
+    }
+    const size_t stride = Bech32::MAX_LENGTH + 1;
+    std::vector<char> encoded(segwit.size() * stride);
+    for (size_t h = 0; h < hrps.size(); h++) {
+        size_t length = Bech32::encodeSegwitBatch(hrps[h].c_str(), 0, programs.data(), HASH_SIZE, segwit.size(),
+                                                  encoded.data(), stride);
+        size_t column = p2pkhPrefixes.size() + p2shPrefixes.size() + h;
+        for (size_t k = 0; k < segwit.size(); k++) {
+            addresses[segwit[k] * perKey + column].assign(&encoded[k * stride], length);
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    PyObject* result = PyList_New(static_cast<Py_ssize_t>(pubkeys.size()));
+    if (!result) return nullptr;
+    for (size_t i = 0; i < pubkeys.size(); i++) {
+        PyObject* item = stringList(std::vector<std::string>(addresses.begin() + i * perKey,
+                                                             addresses.begin() + (i + 1) * perKey));
+        if (!item) {
+            Py_DECREF(result);
+            return nullptr;
+        }
+        PyList_SET_ITEM(result, static_cast<Py_ssize_t>(i), item);
+    }
+    return result;
+}
+
+// encode_wifs_batch(privkeys, prefix, compressed) -> [str, ...]   (privtowif)
+PyObject* encodeWifsBatch(PyObject*, PyObject* args) {
+    PyObject* privkeysObject;
+    PyObject* prefixObject;
+    PyObject* compressedObject;
+    if (!PyArg_ParseTuple(args, "OOO:encode_wifs_batch", &privkeysObject, &prefixObject, &compressedObject)) {
+        return nullptr;
+    }
+    Bytes prefix;
+    std::vector<Bytes> privkeys;
+    std::vector<bool> compressed;
+    if (!toBytes(prefixObject, prefix) || !toBytesList(privkeysObject, privkeys, "privkeys must be a sequence") ||
+        !toFlagList(compressedObject, privkeys.size(), compressed)) {
+        return nullptr;
+    }
+    std::vector<std::string> wifs(privkeys.size());
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i = 0; i < privkeys.size(); i++) {
+        wifs[i] = encodeCheck(prefix, privkeys[i].data(), privkeys[i].size(), compressed[i]);
+    }
+    Py_END_ALLOW_THREADS
+    return stringList(wifs);
+}
+
+// derive_public_keys_batch(privkeys, compressed) -> [bytes or None, ...]   (privtopub)
+PyObject* derivePublicKeysBatch(PyObject*, PyObject* args) {
+    PyObject* privkeysObject;
+    PyObject* compressedObject;
+    if (!PyArg_ParseTuple(args, "OO:derive_public_keys_batch", &privkeysObject, &compressedObject)) return nullptr;
+    std::vector<Bytes> privkeys;
+    std::vector<bool> compressed;
+    if (!toBytesList(privkeysObject, privkeys, "privkeys must be a sequence") ||
+        !toFlagList(compressedObject, privkeys.size(), compressed)) {
+        return nullptr;
+    }
+    std::vector<Bytes> pubkeys(privkeys.size());
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i = 0; i < privkeys.size(); i++) {
+        if (privkeys[i].size() != 32) continue;
+        uint8_t out[Secp256k1::UNCOMPRESSED_SIZE];
+        size_t length = Secp256k1::derivePublicKey(privkeys[i].data(), compressed[i], out);
+        pubkeys[i].assign(out, out + length);
+    }
+    Py_END_ALLOW_THREADS
+
+    PyObject* result = PyList_New(static_cast<Py_ssize_t>(pubkeys.size()));
+    if (!result) return nullptr;
+    for (size_t i = 0; i < pubkeys.size(); i++) {
+        PyObject* item;
+        if (pubkeys[i].empty()) {
+            Py_INCREF(Py_None);
+            item = Py_None;
+        }
+        else if (!(item = bytesObject(pubkeys[i]))) {
+            Py_DECREF(result);
+            return nullptr;
+        }
+        PyList_SET_ITEM(result, static_cast<Py_ssize_t>(i), item);
+    }
+    return result;
+}
+
+PyMethodDef methods[] = {
+    {"scan_records", scanRecords, METH_VARARGS,
+     "scan_records(data, kheader, vheader, offsets) -> list of (pub, priv)"},
+    {"decrypt_master_key", decryptMasterKey, METH_VARARGS,
+     "decrypt_master_key(crypted, passphrase, salt, iterations) -> bytes"},
+    {"decrypt_keys_batch", decryptKeysBatch, METH_VARARGS,
+     "decrypt_keys_batch(master_key, crypted_keys, pubkeys) -> list of bytes"},
+    {"encode_addresses_batch", encodeAddressesBatch, METH_VARARGS,
+     "encode_addresses_batch(pubkeys, prefix) -> list of str"},
+    {"encode_address_sets_batch", encodeAddressSetsBatch, METH_VARARGS,
+     "encode_address_sets_batch(pubkeys, p2pkh_prefixes, p2sh_prefixes, hrps) -> list of lists of str"},
+    {"encode_wifs_batch", encodeWifsBatch, METH_VARARGS,
+     "encode_wifs_batch(privkeys, prefix, compressed) -> list of str"},
+    {"derive_public_keys_batch", derivePublicKeysBatch, METH_VARARGS,
+     "derive_public_keys_batch(privkeys, compressed) -> list of bytes or None"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+PyModuleDef moduleDef = {
+    PyModuleDef_HEAD_INIT, "walletaid_native", "Native kernels for walletaid.py", -1, methods,
+    nullptr, nullptr, nullptr, nullptr
+};
+
+}  // namespace
+
+PyMODINIT_FUNC PyInit_walletaid_native(void) { return PyModule_Create(&moduleDef); }